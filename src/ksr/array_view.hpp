@@ -0,0 +1,40 @@
+#ifndef KSR_ARRAY_VIEW_HPP
+#define KSR_ARRAY_VIEW_HPP
+
+#include <cassert>
+#include <cstddef>
+
+namespace ksr {
+
+    // Non-owning view of a contiguous array of `t`, as `std::string_view` is of characters.
+
+    template<typename t>
+    class array_view {
+    public:
+
+        constexpr array_view() noexcept = default;
+
+        constexpr array_view(const t* data, std::size_t size) noexcept
+          : _data{data}, _size{size} {
+        }
+
+        constexpr auto data()  const noexcept -> const t*    { return _data; }
+        constexpr auto size()  const noexcept -> std::size_t { return _size; }
+        constexpr auto empty() const noexcept -> bool        { return _size == 0; }
+
+        constexpr auto begin() const noexcept -> const t* { return _data; }
+        constexpr auto end()   const noexcept -> const t* { return _data + _size; }
+
+        constexpr auto operator[](const std::size_t i) const -> const t& {
+            assert(i < _size);
+            return _data[i];
+        }
+
+    private:
+
+        const t*    _data = nullptr;
+        std::size_t _size = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef KSR_INDEXED_HEAP_HPP
+#define KSR_INDEXED_HEAP_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ksr {
+
+    // Min-heap of items identified by small integers in `[0, capacity)` (typically rows of some
+    // table), each with a key of type `k`, which tracks the position of every item so that items
+    // can be re-keyed or removed in logarithmic time. Items with equal keys are ordered by their
+    // identifiers, so the order of the heap is fully determined by its contents.
+    //
+    // The tree has `arity` children per node and is stored breadth-first in one array, with each
+    // key beside its item. A wider tree is shallower, so pushes (which walk towards the root) touch
+    // fewer nodes, while pops compare the `arity` children of each node from one or two adjacent
+    // cache lines; 4 is a good balance.
+
+    template<typename k, std::size_t arity = 4>
+    class indexed_heap {
+    public:
+
+        static_assert(arity >= 2);
+
+        using item_type = std::uint32_t;
+
+        explicit indexed_heap(std::size_t capacity = 0)
+          : _positions(capacity, npos) {
+        }
+
+        auto capacity() const noexcept -> std::size_t { return _positions.size(); }
+        auto size()     const noexcept -> std::size_t { return _nodes.size(); }
+        auto empty()    const noexcept -> bool        { return _nodes.empty(); }
+
+        auto contains(const item_type item) const -> bool {
+            assert(item < _positions.size());
+            return _positions[item] != npos;
+        }
+
+        auto key(const item_type item) const -> const k& {
+            assert(contains(item));
+            return _nodes[_positions[item]].key;
+        }
+
+        auto top() const -> item_type {
+            assert(!empty());
+            return _nodes.front().item;
+        }
+
+        auto top_key() const -> const k& {
+            assert(!empty());
+            return _nodes.front().key;
+        }
+
+        // Adds `item` with key `key`, or changes the key of `item` to `key` if already present.
+
+        void update(const item_type item, k key) {
+
+            assert(item < _positions.size());
+
+            const auto position = _positions[item];
+            if (position == npos) {
+
+                _nodes.push_back(node{std::move(key), item});
+                _positions[item] = _nodes.size() - 1;
+                sift_up(_nodes.size() - 1);
+
+                return;
+            }
+
+            const auto decreased = less(node{key, item}, _nodes[position]);
+            _nodes[position].key = std::move(key);
+
+            if (decreased) {
+                sift_up(position);
+            }
+            else {
+                sift_down(position);
+            }
+        }
+
+        // Removes `item`, if present.
+
+        void erase(const item_type item) {
+
+            assert(item < _positions.size());
+
+            const auto position = _positions[item];
+            if (position == npos) {
+                return;
+            }
+
+            _positions[item] = npos;
+
+            if (position == _nodes.size() - 1) {
+                _nodes.pop_back();
+                return;
+            }
+
+            // The last node fills the hole, and may belong either above or below it.
+
+            const auto moved = _nodes.back().item;
+
+            _nodes[position] = std::move(_nodes.back());
+            _nodes.pop_back();
+            _positions[moved] = position;
+
+            sift_up(position);
+            if (_positions[moved] == position) {
+                sift_down(position);
+            }
+        }
+
+        void pop() {
+            erase(top());
+        }
+
+        // Replaces the contents of the heap with `entries`, which must name distinct items, in
+        // linear time.
+
+        void assign(std::vector<std::pair<item_type, k>> entries) {
+
+            for (const auto& node : _nodes) {
+                _positions[node.item] = npos;
+            }
+
+            _nodes.clear();
+            _nodes.reserve(entries.size());
+
+            for (auto& [item, key] : entries) {
+
+                assert(item < _positions.size() && _positions[item] == npos);
+
+                _positions[item] = _nodes.size();
+                _nodes.push_back(node{std::move(key), item});
+            }
+
+            // Sifting down each parent, from the last, orders every subtree in turn.
+
+            if (_nodes.size() > 1) {
+                for (auto i = (_nodes.size() - 2) / arity + 1; i-- > 0;) {
+                    sift_down(i);
+                }
+            }
+        }
+
+    private:
+
+        static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+        struct node {
+            k         key;
+            item_type item;
+        };
+
+        static auto less(const node& lhs, const node& rhs) -> bool {
+            return lhs.key < rhs.key || (!(rhs.key < lhs.key) && lhs.item < rhs.item);
+        }
+
+        void sift_up(std::size_t position) {
+
+            auto moving = std::move(_nodes[position]);
+            while (position > 0) {
+
+                const auto parent = (position - 1) / arity;
+                if (!less(moving, _nodes[parent])) {
+                    break;
+                }
+
+                place(position, std::move(_nodes[parent]));
+                position = parent;
+            }
+
+            place(position, std::move(moving));
+        }
+
+        void sift_down(std::size_t position) {
+
+            auto moving = std::move(_nodes[position]);
+            while (true) {
+
+                const auto first = position * arity + 1;
+                if (first >= _nodes.size()) {
+                    break;
+                }
+
+                const auto last = std::min(first + arity, _nodes.size());
+
+                auto least = first;
+                for (auto child = first + 1; child < last; ++child) {
+                    if (less(_nodes[child], _nodes[least])) {
+                        least = child;
+                    }
+                }
+
+                if (!less(_nodes[least], moving)) {
+                    break;
+                }
+
+                place(position, std::move(_nodes[least]));
+                position = least;
+            }
+
+            place(position, std::move(moving));
+        }
+
+        void place(const std::size_t position, node&& value) {
+            _positions[value.item] = position;
+            _nodes[position] = std::move(value);
+        }
+
+        std::vector<node>        _nodes;
+        std::vector<std::size_t> _positions;
+    };
+}
+
+#endif
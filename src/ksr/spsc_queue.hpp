@@ -0,0 +1,122 @@
+#ifndef KSR_SPSC_QUEUE_HPP
+#define KSR_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ksr {
+
+    namespace impl::spsc_queue {
+
+        // Assumed size of a cache line, used to keep the producer-side and consumer-side members of
+        // a queue from sharing one. `std::hardware_destructive_interference_size` would be the
+        // natural choice, but is not reliably available from the standard library yet.
+
+        inline constexpr auto cache_line_size = std::size_t{64};
+
+        constexpr auto round_up_pow2(std::size_t value) -> std::size_t {
+
+            auto result = std::size_t{1};
+            while (result < value) {
+                result <<= 1;
+            }
+
+            return result;
+        }
+    }
+
+    // Bounded, lock-free FIFO queue for passing values from exactly one producer thread to exactly
+    // one consumer thread. `try_push()` may only be called from the producer and `try_pop()` only
+    // from the consumer; neither ever blocks, so callers that need to wait do so themselves (and
+    // may thereby decide how to respond to cancellation while waiting).
+    //
+    // The capacity is fixed on construction, rounded up to a power of two. `t` must be default-
+    // constructible and nothrow-move-assignable; in practice, it is expected to be a small handle
+    // such as a pointer to a buffer owned elsewhere.
+
+    template<typename t>
+    class spsc_queue {
+    public:
+
+        static_assert(std::is_default_constructible_v<t>);
+        static_assert(std::is_nothrow_move_assignable_v<t>);
+
+        explicit spsc_queue(std::size_t min_capacity)
+          : _capacity{impl::spsc_queue::round_up_pow2(min_capacity)},
+            _slots{std::make_unique<t[]>(_capacity)} {}
+
+        spsc_queue(spsc_queue&&)      = delete;
+        spsc_queue(const spsc_queue&) = delete;
+
+        auto operator=(spsc_queue&&)      -> spsc_queue& = delete;
+        auto operator=(const spsc_queue&) -> spsc_queue& = delete;
+
+        auto capacity() const noexcept -> std::size_t { return _capacity; }
+
+        // Appends `value` to the back of the queue if there is room for it, returning whether it was
+        // appended. May only be called from the producer thread.
+
+        auto try_push(t value) noexcept -> bool {
+
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head_cache == _capacity) {
+
+                _head_cache = _head.load(std::memory_order_acquire);
+                if (tail - _head_cache == _capacity) {
+                    return false;
+                }
+            }
+
+            _slots[tail & (_capacity - 1)] = std::move(value);
+            _tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Removes and returns the value at the front of the queue, or returns `std::nullopt` if the
+        // queue is empty. May only be called from the consumer thread.
+
+        auto try_pop() noexcept(std::is_nothrow_move_constructible_v<t>) -> std::optional<t> {
+
+            const auto head = _head.load(std::memory_order_relaxed);
+            if (head == _tail_cache) {
+
+                _tail_cache = _tail.load(std::memory_order_acquire);
+                if (head == _tail_cache) {
+                    return std::nullopt;
+                }
+            }
+
+            auto result = std::optional<t>{std::move(_slots[head & (_capacity - 1)])};
+            _head.store(head + 1, std::memory_order_release);
+
+            return result;
+        }
+
+    private:
+
+        using index_t = std::size_t;
+        static constexpr auto align = impl::spsc_queue::cache_line_size;
+
+        const std::size_t    _capacity;
+        std::unique_ptr<t[]> _slots;
+
+        // Indices increase monotonically (wrapping on overflow) and are reduced modulo the capacity
+        // only when addressing a slot. Each side keeps a private cache of the other side's index so
+        // that the shared atomic is only reloaded when the cached value suggests the queue is full
+        // (for the producer) or empty (for the consumer).
+
+        alignas(align) std::atomic<index_t> _head{0}; // Written by the consumer
+        index_t                             _tail_cache{0};
+
+        alignas(align) std::atomic<index_t> _tail{0}; // Written by the producer
+        index_t                             _head_cache{0};
+    };
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef KSR_STRING_POOL_HPP
+#define KSR_STRING_POOL_HPP
+
+#include "narrow_cast.hpp"
+#include "text_arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ksr {
+
+    // Interns strings, assigning each distinct string a dense ID in order of first appearance, so
+    // that repeated strings are stored once and can be compared and counted by ID. Views returned
+    // by the pool remain valid for its lifetime, including after it is moved from.
+
+    class string_pool {
+    public:
+
+        using id_type = std::uint32_t;
+
+        // Returns the ID of `text`, adding it to the pool if not already present.
+
+        auto intern(const std::string_view text) -> id_type {
+
+            if (const auto it = _ids.find(text); it != _ids.end()) {
+                return it->second;
+            }
+
+            const auto id     = narrow_cast<id_type>(_strings.size());
+            const auto stored = _text.store(text);
+
+            _strings.push_back(stored);
+            _ids.emplace(stored, id);
+
+            return id;
+        }
+
+        // Returns the ID of `text`, or `std::nullopt` if it has not been interned.
+
+        auto find(const std::string_view text) const -> std::optional<id_type> {
+
+            if (const auto it = _ids.find(text); it != _ids.end()) {
+                return it->second;
+            }
+
+            return std::nullopt;
+        }
+
+        auto operator[](const id_type id) const -> std::string_view {
+
+            assert(id < _strings.size());
+            return _strings[id];
+        }
+
+        auto size() const noexcept -> std::size_t { return _strings.size(); }
+
+    private:
+
+        text_arena _text{std::size_t{1} << 16};
+
+        std::vector<std::string_view>                 _strings;
+        std::unordered_map<std::string_view, id_type> _ids;
+    };
+}
+
+#endif
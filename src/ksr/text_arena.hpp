@@ -0,0 +1,92 @@
+#ifndef KSR_TEXT_ARENA_HPP
+#define KSR_TEXT_ARENA_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ksr {
+
+    // Append-only store for text, handing out `std::string_view`s that remain valid for the
+    // lifetime of the arena, including after it is moved from. Text is copied into large blocks
+    // rather than allocated piecemeal, so storing many small strings costs a handful of
+    // allocations in total; text larger than a block gets a block of its own.
+
+    class text_arena {
+    public:
+
+        explicit text_arena(std::size_t block_size = std::size_t{1} << 20)
+          : _block_size{block_size} {
+
+            assert(block_size > 0);
+        }
+
+        // A moved-from arena is empty, and starts a new block for any further text.
+
+        text_arena(text_arena&& rhs) noexcept
+          : _block_size{rhs._block_size},
+            _remaining{std::exchange(rhs._remaining, 0)},
+            _pos{std::exchange(rhs._pos, nullptr)},
+            _blocks{std::move(rhs._blocks)} {}
+
+        text_arena(const text_arena&) = delete;
+
+        auto operator=(text_arena&& rhs) noexcept -> text_arena& {
+
+            _block_size = rhs._block_size;
+            _remaining  = std::exchange(rhs._remaining, 0);
+            _pos        = std::exchange(rhs._pos, nullptr);
+            _blocks     = std::move(rhs._blocks);
+
+            return *this;
+        }
+
+        auto operator=(const text_arena&) -> text_arena& = delete;
+
+        // Copies `text` into the arena and returns a view of the copy.
+
+        auto store(std::string_view text) -> std::string_view {
+
+            if (text.empty()) {
+                return {};
+            }
+
+            // Oversized text goes in a block of its own, leaving the current block to be filled.
+
+            if (text.size() > _block_size) {
+
+                const auto dst = _blocks.emplace_back(new char[text.size()]).get();
+                std::memcpy(dst, text.data(), text.size());
+
+                return std::string_view{dst, text.size()};
+            }
+
+            if (text.size() > _remaining) {
+                _pos       = _blocks.emplace_back(new char[_block_size]).get();
+                _remaining = _block_size;
+            }
+
+            const auto result = std::string_view{_pos, text.size()};
+            std::memcpy(_pos, text.data(), text.size());
+
+            _pos       += text.size();
+            _remaining -= text.size();
+
+            return result;
+        }
+
+    private:
+
+        std::size_t _block_size;
+        std::size_t _remaining = 0;
+        char*       _pos       = nullptr;
+
+        std::vector<std::unique_ptr<char[]>> _blocks;
+    };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "ksr/array_view.hpp"
+
+#include "test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+    constexpr int values[] = {1, 2, 3};
+
+    static_assert(ksr::array_view<int>{}.empty());
+    static_assert(ksr::array_view<int>{values, 3}.size() == 3);
+    static_assert(ksr::array_view<int>{values, 3}[2] == 3);
+}
+
+KSR_TEST(array_view_defaults_to_empty) {
+
+    const auto view = ksr::array_view<std::int64_t>{};
+
+    KSR_CHECK(view.empty());
+    KSR_CHECK(view.size() == 0);
+    KSR_CHECK(view.data() == nullptr);
+    KSR_CHECK(view.begin() == view.end());
+}
+
+KSR_TEST(array_view_views_elements_in_place) {
+
+    const auto ids  = std::vector<std::int64_t>{10, 20, 30, 40};
+    const auto view = ksr::array_view<std::int64_t>{ids.data(), ids.size()};
+
+    KSR_CHECK(!view.empty());
+    KSR_CHECK(view.size() == 4);
+    KSR_CHECK(view.data() == ids.data());
+    KSR_CHECK(&view[2] == &ids[2]);
+    KSR_CHECK(view.end() - view.begin() == 4);
+}
+
+KSR_TEST(array_view_works_with_algorithms) {
+
+    const auto ids  = std::vector<std::int64_t>{10, 20, 30, 40};
+    const auto view = ksr::array_view<std::int64_t>{ids.data(), ids.size()};
+
+    KSR_CHECK(std::is_sorted(view.begin(), view.end()));
+    KSR_CHECK(std::accumulate(view.begin(), view.end(), std::int64_t{0}) == 100);
+
+    const auto found = std::lower_bound(view.begin(), view.end(), 25);
+    KSR_CHECK(found - view.begin() == 2);
+
+    auto total = std::int64_t{0};
+    for (const auto id : ksr::array_view<std::int64_t>{ids.data() + 1, 2}) {
+        total += id;
+    }
+
+    KSR_CHECK(total == 50);
+}
@@ -0,0 +1,162 @@
+#include "ksr/indexed_heap.hpp"
+
+#include "test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Pops every item of `heap`, returning them in the order popped.
+
+    template<typename t>
+    auto drain(t& heap) -> std::vector<std::uint32_t> {
+
+        auto result = std::vector<std::uint32_t>{};
+        while (!heap.empty()) {
+            result.push_back(heap.top());
+            heap.pop();
+        }
+
+        return result;
+    }
+
+    // Applies random updates and erasures to an `indexed_heap` with `arity` children per node and
+    // to an ordered set of (key, item) pairs, checking that they agree throughout.
+
+    template<std::size_t arity>
+    auto matches_reference() -> bool {
+
+        constexpr auto capacity = std::uint32_t{64};
+
+        auto heap      = ksr::indexed_heap<int, arity>{capacity};
+        auto reference = std::set<std::pair<int, std::uint32_t>>{};
+        auto keys      = std::vector<int>(capacity);
+
+        auto random  = std::mt19937{12345};
+        auto item_of = std::uniform_int_distribution<std::uint32_t>{0, capacity - 1};
+        auto key_of  = std::uniform_int_distribution<int>{0, 20};
+
+        for (auto step = 0; step < 20000; ++step) {
+
+            const auto item = item_of(random);
+
+            if (random() % 4 == 0) {
+                heap.erase(item);
+                reference.erase({keys[item], item});
+            }
+            else {
+                reference.erase({keys[item], item});
+                keys[item] = key_of(random);
+                heap.update(item, keys[item]);
+                reference.emplace(keys[item], item);
+            }
+
+            const auto present = (reference.count({keys[item], item}) > 0);
+            if (heap.size() != reference.size() || heap.contains(item) != present) {
+                return false;
+            }
+
+            if (!heap.empty() && (heap.top() != reference.begin()->second ||
+                                  heap.top_key() != reference.begin()->first)) {
+                return false;
+            }
+        }
+
+        for (const auto& [key, item] : reference) {
+
+            if (heap.top() != item || heap.top_key() != key) {
+                return false;
+            }
+
+            heap.pop();
+        }
+
+        return heap.empty();
+    }
+}
+
+KSR_TEST(indexed_heap_pops_in_key_then_item_order) {
+
+    auto heap = ksr::indexed_heap<int>{8};
+
+    heap.update(5, 3);
+    heap.update(2, 1);
+    heap.update(7, 3);
+    heap.update(0, 2);
+    heap.update(3, 1);
+
+    KSR_CHECK(heap.size() == 5);
+    KSR_CHECK(heap.top() == 2 && heap.top_key() == 1);
+    KSR_CHECK(drain(heap) == std::vector<std::uint32_t>{2, 3, 0, 5, 7});
+}
+
+KSR_TEST(indexed_heap_rekeys_items) {
+
+    auto heap = ksr::indexed_heap<int>{8};
+
+    for (auto item = std::uint32_t{0}; item < 8; ++item) {
+        heap.update(item, static_cast<int>(item) * 10);
+    }
+
+    heap.update(6, -1);
+    heap.update(0, 100);
+    heap.update(3, 30);
+
+    KSR_CHECK(heap.size() == 8);
+    KSR_CHECK(heap.key(6) == -1);
+    KSR_CHECK(heap.key(0) == 100);
+    KSR_CHECK(drain(heap) == std::vector<std::uint32_t>{6, 1, 2, 3, 4, 5, 7, 0});
+}
+
+KSR_TEST(indexed_heap_erases_any_item) {
+
+    auto heap = ksr::indexed_heap<int>{8};
+
+    for (auto item = std::uint32_t{0}; item < 8; ++item) {
+        heap.update(item, 7 - static_cast<int>(item));
+    }
+
+    heap.erase(7);
+    heap.erase(3);
+    heap.erase(3);
+
+    KSR_CHECK(!heap.contains(7) && !heap.contains(3) && heap.contains(4));
+    KSR_CHECK(drain(heap) == std::vector<std::uint32_t>{6, 5, 4, 2, 1, 0});
+    KSR_CHECK(!heap.contains(0));
+}
+
+KSR_TEST(indexed_heap_assigns_contents) {
+
+    auto heap = ksr::indexed_heap<int>{16};
+    heap.update(9, 0);
+
+    auto entries = std::vector<std::pair<std::uint32_t, int>>{};
+    for (auto item = std::uint32_t{0}; item < 12; ++item) {
+        entries.emplace_back(item, static_cast<int>((item * 7) % 12));
+    }
+
+    heap.assign(entries);
+
+    KSR_CHECK(heap.size() == 12);
+    KSR_CHECK(heap.key(9) == 3);
+
+    auto keys = std::vector<int>{};
+    while (!heap.empty()) {
+        keys.push_back(heap.top_key());
+        heap.pop();
+    }
+
+    KSR_CHECK(keys == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
+}
+
+KSR_TEST(indexed_heap_matches_ordered_set) {
+
+    KSR_CHECK(matches_reference<2>());
+    KSR_CHECK(matches_reference<4>());
+    KSR_CHECK(matches_reference<8>());
+}
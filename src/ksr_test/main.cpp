@@ -1,5 +1,71 @@
+#include "test.hpp"
+
 #include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+namespace ksr_test {
+
+    namespace {
+
+        struct test_case {
+            const char* name;
+            void (*run)();
+        };
+
+        // Tests are registered during static initialisation, from other translation units, so
+        // the registry is constructed on first use rather than as a namespace-scope variable.
+
+        auto registry() -> std::vector<test_case>& {
+
+            static auto tests = std::vector<test_case>{};
+            return tests;
+        }
+
+        auto current_failed = false;
+    }
+
+    auto register_test(const char* const name, void (* const run)()) -> bool {
+
+        registry().push_back({name, run});
+        return true;
+    }
+
+    void check(
+        const bool passed, const char* const expression, const char* const file, const int line) {
+
+        if (!passed) {
+            std::cerr << file << ':' << line << ": check failed: " << expression << '\n';
+            current_failed = true;
+        }
+    }
+}
 
 auto main() -> int {
-    return EXIT_SUCCESS;
+
+    auto failures = 0;
+
+    for (const auto& test : ksr_test::registry()) {
+
+        ksr_test::current_failed = false;
+
+        try {
+            test.run();
+        }
+        catch (const std::exception& ex) {
+            std::cerr << test.name << ": threw: " << ex.what() << '\n';
+            ksr_test::current_failed = true;
+        }
+
+        if (ksr_test::current_failed) {
+            std::cerr << test.name << ": FAILED\n";
+            ++failures;
+        }
+    }
+
+    std::cout << ksr_test::registry().size() - failures << " of " << ksr_test::registry().size()
+              << " tests passed\n";
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,95 @@
+#include "ksr/spsc_queue.hpp"
+
+#include "test.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+KSR_TEST(spsc_queue_rounds_capacity_up_to_power_of_two) {
+
+    KSR_CHECK(ksr::spsc_queue<int>{1}.capacity() == 1);
+    KSR_CHECK(ksr::spsc_queue<int>{3}.capacity() == 4);
+    KSR_CHECK(ksr::spsc_queue<int>{8}.capacity() == 8);
+    KSR_CHECK(ksr::spsc_queue<int>{9}.capacity() == 16);
+}
+
+KSR_TEST(spsc_queue_pops_in_push_order) {
+
+    auto queue = ksr::spsc_queue<int>{4};
+
+    for (auto i = 0; i < 3; ++i) {
+        KSR_CHECK(queue.try_push(i));
+    }
+
+    for (auto i = 0; i < 3; ++i) {
+        KSR_CHECK(queue.try_pop() == i);
+    }
+}
+
+KSR_TEST(spsc_queue_rejects_push_when_full_and_pop_when_empty) {
+
+    auto queue = ksr::spsc_queue<int>{4};
+    KSR_CHECK(!queue.try_pop());
+
+    for (auto i = 0; i < 4; ++i) {
+        KSR_CHECK(queue.try_push(i));
+    }
+
+    KSR_CHECK(!queue.try_push(4));
+    KSR_CHECK(queue.try_pop() == 0);
+    KSR_CHECK(queue.try_push(4));
+
+    // Wraps around the end of the slots.
+
+    for (auto i = 1; i <= 4; ++i) {
+        KSR_CHECK(queue.try_pop() == i);
+    }
+
+    KSR_CHECK(!queue.try_pop());
+}
+
+KSR_TEST(spsc_queue_moves_values_through) {
+
+    auto queue = ksr::spsc_queue<std::unique_ptr<int>>{2};
+    KSR_CHECK(queue.try_push(std::make_unique<int>(42)));
+
+    const auto value = queue.try_pop();
+    KSR_CHECK(value && *value && **value == 42);
+}
+
+KSR_TEST(spsc_queue_passes_values_between_threads_in_order) {
+
+    constexpr auto count = 100000;
+
+    auto queue    = ksr::spsc_queue<int>{16};
+    auto received = std::vector<int>{};
+    received.reserve(count);
+
+    auto consumer = std::thread{[&queue, &received] {
+        while (received.size() < count) {
+            if (const auto value = queue.try_pop()) {
+                received.push_back(*value);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    for (auto i = 0; i < count; ++i) {
+        while (!queue.try_push(i)) {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.join();
+
+    auto in_order = true;
+    for (auto i = 0; i < count; ++i) {
+        in_order = in_order && (received[static_cast<std::size_t>(i)] == i);
+    }
+
+    KSR_CHECK(in_order);
+}
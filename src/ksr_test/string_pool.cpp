@@ -0,0 +1,56 @@
+#include "ksr/string_pool.hpp"
+
+#include "test.hpp"
+
+#include <string>
+#include <utility>
+
+KSR_TEST(string_pool_assigns_ids_in_order_of_first_appearance) {
+
+    auto pool = ksr::string_pool{};
+
+    KSR_CHECK(pool.intern("b") == 0);
+    KSR_CHECK(pool.intern("a") == 1);
+    KSR_CHECK(pool.intern("b") == 0);
+    KSR_CHECK(pool.intern("")  == 2);
+    KSR_CHECK(pool.intern("")  == 2);
+
+    KSR_CHECK(pool.size() == 3);
+    KSR_CHECK(pool[0] == "b");
+    KSR_CHECK(pool[1] == "a");
+    KSR_CHECK(pool[2].empty());
+}
+
+KSR_TEST(string_pool_finds_only_interned_strings) {
+
+    auto pool = ksr::string_pool{};
+    pool.intern("tag");
+
+    KSR_CHECK(pool.find("tag") == 0u);
+    KSR_CHECK(!pool.find("other"));
+    KSR_CHECK(!pool.find(""));
+    KSR_CHECK(pool.size() == 1);
+}
+
+KSR_TEST(string_pool_keeps_its_own_copies) {
+
+    auto pool = ksr::string_pool{};
+
+    // The interned text must outlive the strings it was interned from.
+
+    for (auto i = 0; i < 10000; ++i) {
+        auto text = std::to_string(i);
+        pool.intern(text);
+    }
+
+    KSR_CHECK(pool.size() == 10000);
+    KSR_CHECK(pool.find("9999") == 9999u);
+    KSR_CHECK(pool[1234] == "1234");
+
+    const auto view = pool[42];
+    auto moved = std::move(pool);
+
+    KSR_CHECK(view == "42");
+    KSR_CHECK(moved.find("42") == 42u);
+    KSR_CHECK(moved.intern("10000") == 10000u);
+}
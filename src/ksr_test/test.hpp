@@ -0,0 +1,27 @@
+#ifndef KSR_TEST_TEST_HPP
+#define KSR_TEST_TEST_HPP
+
+namespace ksr_test {
+
+    // Registers the test `run`, named `name`, to be run by `main()`. Returns `true`, so that
+    // `KSR_TEST` can register a test from the initialiser of a variable.
+
+    auto register_test(const char* name, void (*run)()) -> bool;
+
+    // Records the outcome of a check of `expression`, made at `line` of `file`. A failed check
+    // fails its test, which nevertheless runs on to report any other failures.
+
+    void check(bool passed, const char* expression, const char* file, int line);
+}
+
+// Defines a test named `name`, which fails if any `KSR_CHECK` within it fails or it throws.
+
+#define KSR_TEST(name) \
+    static void name(); \
+    [[maybe_unused]] static const auto name##_registered = ksr_test::register_test(#name, name); \
+    static void name()
+
+#define KSR_CHECK(...) \
+    ksr_test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+
+#endif
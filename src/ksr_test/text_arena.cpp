@@ -0,0 +1,75 @@
+#include "ksr/text_arena.hpp"
+
+#include "test.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+KSR_TEST(text_arena_stores_copies_of_text) {
+
+    auto arena = ksr::text_arena{16};
+    auto text  = std::string{"hello"};
+
+    const auto stored = arena.store(text);
+    text[0] = 'j';
+
+    KSR_CHECK(stored == "hello");
+    KSR_CHECK(stored.data() != text.data());
+    KSR_CHECK(arena.store("").empty());
+}
+
+KSR_TEST(text_arena_packs_text_into_blocks) {
+
+    auto arena = ksr::text_arena{16};
+
+    const auto first  = arena.store("abcd");
+    const auto second = arena.store("efgh");
+
+    KSR_CHECK(first.data() + first.size() == second.data());
+}
+
+KSR_TEST(text_arena_views_survive_further_stores) {
+
+    auto arena = ksr::text_arena{16};
+    auto views = std::vector<std::string_view>{};
+
+    for (auto i = 0; i < 100; ++i) {
+        views.push_back(arena.store(std::to_string(i * 1000)));
+    }
+
+    // Oversized text is stored apart from the current block, which continues to be filled.
+
+    const auto large = std::string(40, 'x');
+    views.push_back(arena.store(large));
+
+    const auto before = arena.store("a");
+    const auto after  = arena.store("b");
+    KSR_CHECK(before.data() + 1 == after.data());
+
+    for (auto i = 0; i < 100; ++i) {
+        KSR_CHECK(views[static_cast<std::size_t>(i)] == std::to_string(i * 1000));
+    }
+
+    KSR_CHECK(views.back() == large);
+}
+
+KSR_TEST(text_arena_views_survive_moves) {
+
+    auto arena = ksr::text_arena{16};
+    const auto stored = arena.store("moved");
+
+    auto moved = std::move(arena);
+    KSR_CHECK(stored == "moved");
+    KSR_CHECK(moved.store("more") == "more");
+
+    // A moved-from arena starts a new block rather than writing into the moved one.
+
+    KSR_CHECK(arena.store("again") == "again");
+
+    auto assigned = ksr::text_arena{};
+    assigned = std::move(moved);
+    KSR_CHECK(stored == "moved");
+}
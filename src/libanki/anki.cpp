@@ -1,28 +1,236 @@
 #include "anki.hpp"
 
 #include "apkg_version.hpp"
+#include "extraction_pipeline.hpp"
+#include "impl/zip_format.hpp"
 #include "zip_archive.hpp"
+#include "zip_stream_reader.hpp"
 
-#include <cassert>
-#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <set>
+#include <vector>
 #include <iostream> // [TODO] temp
 
 namespace anki {
 
-    void import(const path& src) {
+    namespace {
+
+        // Imports the package at `src` through a `zip_archive`, entirely on the calling thread;
+        // used by `import()`, and by `import_async()` for backends that cannot read an entry's
+        // data separately from decompressing it.
+
+        void import_blocking(const path& src, const import_options& options) {
+
+            auto archive = zip_archive{src, options.backend};
+            const auto version = archive_apkg_version(archive);
+            if (!version) {
+                throw error{error_code::unsupported_apkg_version};
+            }
+
+            const auto collection_path = collection_file_path(*version);
+
+            auto extract_options = pipeline_options{};
+            extract_options.verify_crc      = options.verify_crc;
+            extract_options.reuse_resources = options.reuse_buffers;
+
+            auto collection_bytes = read_all_pipelined(archive, collection_path, extract_options);
+
+            archive.close();
+        }
+
+        // Reads the whole of the current entry `entry` of `reader`. A buffer for an entry of known
+        // size grows towards one byte more than its size (checked against its compressed size),
+        // so that the read that finds its end needn't grow it, and an entry running on past its
+        // size fails as soon as it fills it. One with deferred sizes grows as its data arrives,
+        // which `reader` bounds by the data received. Either fails in the same way on growing
+        // past `max_size`.
+
+        auto read_stream_entry(
+            zip_stream_reader& reader, const zip_stream_entry& entry, const std::uint64_t max_size)
+            -> std::vector<std::byte> {
+
+            const auto max_limit = std::min<std::uint64_t>(
+                max_size, std::numeric_limits<std::size_t>::max() - 1) + 1;
+
+            const auto limit = entry.sizes_deferred
+                ? static_cast<std::size_t>(max_limit)
+                : std::min(impl::zip_format::checked_entry_size(entry.info) + 1,
+                      static_cast<std::size_t>(max_limit));
+
+            auto bytes = std::vector<std::byte>{};
+            auto size  = std::size_t{0};
+
+            for (;;) {
+
+                if (size == bytes.size()) {
+
+                    if (size == limit) {
+                        throw error{error_code::zip_archive_inconsistent};
+                    }
+
+                    const auto grown = std::max(size / 2, std::size_t{1} << 16);
+                    bytes.resize(size + std::min(grown, limit - size));
+                }
+
+                const auto size_read = reader.read(bytes.data() + size, bytes.size() - size);
+                if (size_read == 0) {
+                    break;
+                }
+
+                size += size_read;
+            }
+
+            bytes.resize(size);
+            return bytes;
+        }
+    }
+
+    void import(const path& src, const import_options& options) {
+        import_blocking(src, options);
+    }
+
+    void import(const int fd, const import_options& options) {
+
+        auto collection_paths = std::set<std::string>{};
+        #define X(version) collection_paths.insert(collection_file_path(apkg_version::version));
+        LIBANKI_APKG_VERSIONS_X
+        #undef X
+
+        // The version is settled as soon as the entries seen so far give the version that would
+        // be chosen were every collection file present, since no entry still to come can change
+        // it. Until then, the collection file of each version is kept as it arrives, and the one
+        // to use chosen at the end.
+
+        const auto settled_version = archive_apkg_version([] (const path&) { return true; });
+
+        auto reader  = zip_stream_reader{fd, options.verify_crc};
+        auto names   = std::set<std::string>{};
+        auto files   = std::map<std::string, std::vector<std::byte>>{};
+        auto version = std::optional<apkg_version>{};
+
+        const auto contains_file = [&names] (const path& file_path) {
+            return names.count(file_path.string()) != 0;
+        };
+
+        while (const auto entry = reader.next_entry()) {
+
+            names.insert(entry->name);
+            if (collection_paths.count(entry->name) == 0 || files.count(entry->name) != 0) {
+                continue;
+            }
+
+            files[entry->name] = read_stream_entry(reader, *entry, options.max_entry_size);
+
+            version = archive_apkg_version(contains_file);
+            if (version == settled_version) {
+                break;
+            }
+        }
+
+        if (!version) {
+            version = archive_apkg_version(contains_file);
+        }
 
-        auto archive = zip_archive{src};
-        const auto version = archive_apkg_version(archive);
         if (!version) {
             throw error{error_code::unsupported_apkg_version};
         }
 
-        const auto collection_path = collection_file_path(*version);
+        auto collection_bytes = std::move(files.at(collection_file_path(*version).string()));
+        files.clear();
+
+        // The collection is taken before the rest of the stream is drained, so that its entries
+        // are still verified and the descriptor is left past the end of the archive.
+
+        while (reader.next_entry()) {
+        }
+    }
+
+    void import_async(
+        path src, const import_options& options, async_executors executors,
+        std::function<void(std::exception_ptr)> handler) {
+
+        if (options.backend != zip_backend::native) {
+
+            auto io = executors.io;
+            io([src = std::move(src), options, completion = std::move(executors.completion),
+                handler = std::move(handler)] () mutable {
+
+                auto ex = std::exception_ptr{};
+
+                try {
+                    import_blocking(src, options);
+                }
+                catch (...) {
+                    ex = std::current_exception();
+                }
+
+                completion([handler = std::move(handler), ex = std::move(ex)] () mutable {
+                    handler(std::move(ex));
+                });
+            });
+
+            return;
+        }
+
+        const auto verify_crc = options.verify_crc;
+
+        auto opened = [verify_crc, handler = std::move(handler)] (
+            std::exception_ptr ex, async_archive archive) mutable {
+
+            if (ex) {
+                handler(std::move(ex));
+                return;
+            }
+
+            auto detected = [archive, verify_crc, handler = std::move(handler)] (
+                std::exception_ptr ex, std::optional<apkg_version> version) mutable {
+
+                if (!ex && !version) {
+                    ex = std::make_exception_ptr(error{error_code::unsupported_apkg_version});
+                }
+
+                if (ex) {
+                    handler(std::move(ex));
+                    return;
+                }
+
+                auto read = [handler = std::move(handler)] (
+                    std::exception_ptr ex, std::vector<std::byte> /* collection_bytes */) {
+
+                    handler(std::move(ex));
+                };
+
+                archive.read(collection_file_path(*version), std::move(read), verify_crc);
+            };
+
+            archive.apkg_version(std::move(detected));
+        };
+
+        async_archive::open(std::move(src), std::move(executors), std::move(opened));
+    }
+
+    auto import_async(path src, const import_options& options, async_executors executors)
+        -> std::future<void> {
+
+        auto promise = std::make_shared<std::promise<void>>();
+        auto result  = promise->get_future();
+
+        import_async(std::move(src), options, std::move(executors),
+            [promise] (const std::exception_ptr& ex) {
 
-        auto collection_file  = archive.open_file(collection_path);
-        auto collection_bytes = collection_file.read_all();
+                if (ex) {
+                    promise->set_exception(ex);
+                }
+                else {
+                    promise->set_value();
+                }
+            });
 
-        collection_file.close();
-        archive.close();
+        return result;
     }
 }
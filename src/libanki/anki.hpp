@@ -1,15 +1,52 @@
 #ifndef LIBANKI_ANKI_HPP
 #define LIBANKI_ANKI_HPP
 
+#include "async_archive.hpp"
 #include "error.hpp"
 #include "filesystem.hpp"
+#include "import_options.hpp"
+
+#include <exception>
+#include <functional>
+#include <future>
 
 namespace anki {
 
-    // [TODO] doc
-    // throws zip_error, apkg_error
+    // Imports the package at `src`, reading it with `options.backend` on the calling thread and
+    // extracting the collection as `extract_pipelined()` does, honouring `options.reuse_buffers`.
+    // Throws `anki::error` if the package cannot be read, with
+    // `error_code::unsupported_apkg_version` if it holds no collection of a supported version.
+
+    void import(const path& src, const import_options& options = {});
+
+    // As above, for a package read in a single pass from `fd`, which need not be seekable (so
+    // may be a pipe or socket), and is not closed. Only the collection file is decompressed, as
+    // it arrives; other entries are skipped. `options.backend` does not apply. Throws `anki::error`
+    // with `error_code::zip_archive_inconsistent` for a collection larger than
+    // `options.max_entry_size`.
+
+    void import(int fd, const import_options& options = {});
+
+    // As `import(const path&, const import_options&)`, without blocking: the package is opened
+    // and read on `executors.io` and its collection decompressed on `executors.compute` (see
+    // `async_archive`), and `handler` is then called through `executors.completion` with the
+    // exception that `import()` would have thrown, or a null pointer on success.
+    //
+    // That split needs the native backend. The libzip backend cannot read an entry's data
+    // separately from decompressing it, so with it the whole import runs as one task on
+    // `executors.io`, extracting the collection as `extract_pipelined()` does and honouring
+    // `options.reuse_buffers`. With the native backend, decompression state is always kept per
+    // thread, so `options.reuse_buffers` has no further effect.
+
+    void import_async(
+        path src, const import_options& options, async_executors executors,
+        std::function<void(std::exception_ptr)> handler);
+
+    // As above, returning a future of the outcome rather than calling a handler, for callers that
+    // prefer to wait for it; `executors.completion` then only sets the future's result.
 
-    void import(const path& src);
+    auto import_async(path src, const import_options& options, async_executors executors)
+        -> std::future<void>;
 }
 
 #endif
@@ -0,0 +1,423 @@
+#include "apkg_export.hpp"
+
+#include "error.hpp"
+#include "impl/crc32.hpp"
+#include "impl/media_manifest.hpp"
+#include "impl/parallel.hpp"
+#include "impl/zip_writer.hpp"
+#include "impl/zlib/deflater.hpp"
+#include "zip_entry_info.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace anki {
+
+    namespace {
+
+        // Amount of preceding data with which each block after the first is primed; the largest
+        // distance a deflate stream can refer back.
+
+        constexpr auto window_size = std::size_t{1} << 15;
+
+        // Number of blocks that compression may run ahead of the first entry not yet written,
+        // beyond the blocks of that entry itself. Arbitrary; not profiled.
+
+        constexpr auto max_blocks_ahead = std::size_t{256};
+
+        // File signature identifying a format whose data is already compressed: `magic` appears at
+        // byte `offset` of every file in that format.
+
+        struct signature {
+            std::size_t      offset;
+            std::string_view magic;
+        };
+
+        constexpr signature precompressed_signatures[] = {
+            {0, std::string_view{"\xff\xd8\xff", 3}},               // JPEG
+            {0, std::string_view{"\x89PNG", 4}},                    // PNG
+            {0, std::string_view{"GIF8", 4}},                       // GIF
+            {8, std::string_view{"WEBP", 4}},                       // WebP (within a RIFF header)
+            {0, std::string_view{"OggS", 4}},                       // Ogg (Vorbis, Opus)
+            {0, std::string_view{"ID3", 3}},                        // MP3 with an ID3v2 tag
+            {4, std::string_view{"ftyp", 4}},                       // MP4, M4A
+        };
+
+        // Determines whether `[data, data + size)` is in a format whose data is already
+        // compressed, so that deflating it would waste time for no meaningful gain.
+
+        auto is_precompressed(const std::byte* const data, const std::size_t size) -> bool {
+
+            const auto text = std::string_view{reinterpret_cast<const char*>(data), size};
+
+            const auto matches = [text] (const signature& sig) {
+                return text.size() >= sig.offset + sig.magic.size()
+                    && text.compare(sig.offset, sig.magic.size(), sig.magic) == 0;
+            };
+
+            const auto& signatures = precompressed_signatures;
+            if (std::any_of(std::begin(signatures), std::end(signatures), matches)) {
+                return true;
+            }
+
+            // MP3 without an ID3v2 tag starts directly with an MPEG audio frame, identified by an
+            // 11-bit sync word.
+
+            return size >= 2
+                && text[0] == '\xff'
+                && (static_cast<unsigned char>(text[1]) & 0xe0) == 0xe0;
+        }
+
+        auto media_manifest(const std::vector<media_file>& media) -> std::string {
+
+            auto entries = std::vector<media_entry>(media.size());
+            for (auto i = std::size_t{0}; i < media.size(); ++i) {
+                entries[i].archive_name = std::to_string(i);
+                entries[i].name         = media[i].name;
+            }
+
+            return impl::format_media_manifest(entries);
+        }
+
+        // Entry to be written to the package. Its data is split into `blocks.size()` blocks of
+        // the configured size (the last possibly shorter), each of which is checksummed and, for
+        // deflated entries, compressed independently; `remaining` counts the blocks not yet
+        // processed.
+
+        struct pending_entry {
+
+            struct block {
+                std::size_t            size = 0;
+                std::uint32_t          crc  = 0;
+                std::vector<std::byte> compressed;
+            };
+
+            std::string        name;
+            const std::byte*   data   = nullptr;
+            std::size_t        size   = 0;
+            zip_method         method = zip_method::deflated;
+            std::vector<block> blocks;
+            std::size_t        remaining = 0;
+        };
+
+        struct block_job {
+            std::size_t entry;
+            std::size_t block;
+        };
+
+        // Work shared between the compression threads, which process `jobs` in order, and the
+        // calling thread, which writes each entry once all of its blocks are complete. Jobs are
+        // only started below `job_limit`, which the writer raises as it writes each entry, so that
+        // compressed blocks do not pile up faster than they can be written. The first error from
+        // any thread stops the others.
+
+        class export_state {
+        public:
+
+            export_state(std::vector<pending_entry>& entries, const export_options& options)
+              : _entries{entries}, _options{options} {
+
+                _first_jobs.reserve(entries.size() + 1);
+
+                for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+                    auto& entry = entries[i];
+                    _first_jobs.push_back(_jobs.size());
+
+                    const auto block_count = std::max<std::size_t>(
+                        1, (entry.size + options.block_size - 1) / options.block_size);
+
+                    entry.blocks.resize(block_count);
+                    entry.remaining = block_count;
+
+                    for (auto j = std::size_t{0}; j < block_count; ++j) {
+                        _jobs.push_back({i, j});
+                    }
+                }
+
+                _first_jobs.push_back(_jobs.size());
+                _job_limit.store(job_limit_before(0), std::memory_order_relaxed);
+            }
+
+            auto job_count() const noexcept -> std::size_t {
+                return _jobs.size();
+            }
+
+            // Processes jobs until none remain or the export has failed. An unbounded worker
+            // ignores `job_limit`, as it must if it runs on the writing thread.
+
+            void run_worker(const bool bounded) {
+
+                try {
+
+                    auto deflater = impl::zlib::deflater{_options.compression_level};
+
+                    while (!_failed.load(std::memory_order_acquire)) {
+
+                        const auto index = _next_job.fetch_add(1, std::memory_order_relaxed);
+                        if (index >= _jobs.size() || (bounded && !wait_for_limit(index))) {
+                            return;
+                        }
+
+                        run_job(_jobs[index], deflater);
+                    }
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+
+            // Blocks until every block of the specified entry has been processed, returning
+            // `false` if the export fails first.
+
+            auto wait_for_entry(const std::size_t index) -> bool {
+
+                auto lock = std::unique_lock{_mutex};
+                _done.wait(lock, [this, index] {
+                    return _error || _entries[index].remaining == 0;
+                });
+
+                return !_error;
+            }
+
+            // Lets compression run ahead once the specified entry has been written.
+
+            void entry_written(const std::size_t index) {
+
+                {
+                    const auto lock = std::lock_guard{_mutex};
+                    _job_limit.store(job_limit_before(index + 1), std::memory_order_release);
+                }
+
+                _limit_raised.notify_all();
+            }
+
+            void fail(std::exception_ptr error) noexcept {
+
+                {
+                    const auto lock = std::lock_guard{_mutex};
+                    if (!_error) {
+                        _error = std::move(error);
+                    }
+                }
+
+                _failed.store(true, std::memory_order_release);
+                _done.notify_all();
+                _limit_raised.notify_all();
+            }
+
+            void rethrow_if_failed() const {
+
+                const auto lock = std::lock_guard{_mutex};
+                if (_error) {
+                    std::rethrow_exception(_error);
+                }
+            }
+
+        private:
+
+            // Limit on the jobs that may be started while the specified entry is the first not
+            // yet written: all of its own, and `max_blocks_ahead` more.
+
+            auto job_limit_before(const std::size_t index) const -> std::size_t {
+
+                if (index >= _entries.size()) {
+                    return _jobs.size();
+                }
+
+                return std::min(
+                    _jobs.size(),
+                    std::max(_first_jobs[index + 1], _first_jobs[index] + max_blocks_ahead));
+            }
+
+            // Blocks until the specified job may be started, returning `false` if the export
+            // fails first.
+
+            auto wait_for_limit(const std::size_t index) -> bool {
+
+                if (index < _job_limit.load(std::memory_order_acquire)) {
+                    return true;
+                }
+
+                auto lock = std::unique_lock{_mutex};
+                _limit_raised.wait(lock, [this, index] {
+                    return _error || index < _job_limit.load(std::memory_order_relaxed);
+                });
+
+                return !_error;
+            }
+
+            void run_job(const block_job& job, impl::zlib::deflater& deflater) {
+
+                auto& entry = _entries[job.entry];
+                auto& block = entry.blocks[job.block];
+
+                const auto begin = job.block * _options.block_size;
+                const auto size  = std::min(_options.block_size, entry.size - begin);
+                const auto last  = (job.block + 1 == entry.blocks.size());
+
+                const auto src = entry.data + begin;
+                block.size = size;
+                block.crc  = impl::crc32(0, src, size);
+
+                // Each block but the last ends on a byte boundary without ending the deflate
+                // stream, so that the compressed blocks concatenate into a single stream, as in
+                // pigz.
+
+                if (entry.method == zip_method::deflated) {
+
+                    deflater.reset();
+
+                    if (begin > 0) {
+                        const auto dictionary_size = std::min(begin, window_size);
+                        deflater.set_dictionary(src - dictionary_size, dictionary_size);
+                    }
+
+                    deflater.deflate(src, size, last, block.compressed);
+                }
+
+                {
+                    const auto lock = std::lock_guard{_mutex};
+                    --entry.remaining;
+                }
+
+                _done.notify_all();
+            }
+
+            std::vector<pending_entry>& _entries;
+            const export_options&       _options;
+
+            std::vector<block_job>   _jobs;
+            std::vector<std::size_t> _first_jobs;
+            std::atomic<std::size_t> _next_job{0};
+            std::atomic<std::size_t> _job_limit{0};
+            std::atomic<bool>        _failed{false};
+
+            mutable std::mutex      _mutex;
+            std::condition_variable _done;
+            std::condition_variable _limit_raised;
+            std::exception_ptr      _error;
+        };
+
+        // Writes `entry` to `writer`, once its blocks have been processed. A deflated entry whose
+        // compressed data is no smaller than the original is stored instead.
+
+        void write_entry(impl::zip_writer& writer, const pending_entry& entry) {
+
+            auto info = zip_entry_info{};
+            info.size = entry.size;
+
+            for (const auto& block : entry.blocks) {
+                info.crc = impl::crc32_combine(info.crc, block.crc, block.size);
+                info.compressed_size += block.compressed.size();
+            }
+
+            const auto deflated = (entry.method == zip_method::deflated)
+                && info.compressed_size < info.size;
+
+            info.method = deflated ? zip_method::deflated : zip_method::stored;
+            if (!deflated) {
+                info.compressed_size = info.size;
+            }
+
+            writer.begin_entry(entry.name, info);
+
+            if (deflated) {
+                for (const auto& block : entry.blocks) {
+                    writer.write(block.compressed.data(), block.compressed.size());
+                }
+            }
+            else {
+                writer.write(entry.data, entry.size);
+            }
+        }
+    }
+
+    void export_apkg(
+        const path& dst, const apkg_version version, const std::vector<std::byte>& collection,
+        const std::vector<media_file>& media, const export_options& options) {
+
+        assert(options.block_size > 0);
+
+        const auto manifest = media_manifest(media);
+
+        auto entries = std::vector<pending_entry>{};
+        entries.reserve(media.size() + 2);
+
+        const auto add_entry = [&entries] (
+            std::string name, const std::byte* const data, const std::size_t size) {
+
+            auto& entry = entries.emplace_back();
+            entry.name = std::move(name);
+            entry.data = data;
+            entry.size = size;
+            entry.method = (size == 0 || is_precompressed(data, size))
+                ? zip_method::stored
+                : zip_method::deflated;
+        };
+
+        add_entry(collection_file_path(version).string(), collection.data(), collection.size());
+
+        for (auto i = std::size_t{0}; i < media.size(); ++i) {
+            add_entry(std::to_string(i), media[i].bytes.data(), media[i].bytes.size());
+        }
+
+        add_entry(
+            std::string{impl::media_manifest_path},
+            reinterpret_cast<const std::byte*>(manifest.data()), manifest.size());
+
+        auto writer = impl::zip_writer{dst};
+        auto state  = export_state{entries, options};
+
+        // Entries are written in order as soon as each is complete, overlapping the writing of one
+        // with the compression of those that follow. Compressed blocks are released once written,
+        // and compression runs no more than `max_blocks_ahead` blocks past the entry being
+        // written, bounding memory use to that of those blocks and of the largest entry.
+
+        const auto write_entries = [&writer, &entries, &state] {
+
+            try {
+                for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+                    if (!state.wait_for_entry(i)) {
+                        break;
+                    }
+
+                    write_entry(writer, entries[i]);
+                    entries[i].blocks.clear();
+                    entries[i].blocks.shrink_to_fit();
+                    state.entry_written(i);
+                }
+            }
+            catch (...) {
+                state.fail(std::current_exception());
+            }
+        };
+
+        // The calling thread writes, and compresses only for any worker that fails to start,
+        // before it starts writing.
+
+        const auto caller  = std::this_thread::get_id();
+        const auto workers = impl::parallel_thread_count(options.thread_count, state.job_count());
+
+        impl::run_parallel(workers + 1, [&state, &write_entries, caller] (const std::size_t i) {
+
+            if (i == 0) {
+                write_entries();
+            }
+            else {
+                state.run_worker(std::this_thread::get_id() != caller);
+            }
+        });
+
+        state.rethrow_if_failed();
+        writer.finish();
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef LIBANKI_APKG_EXPORT_HPP
+#define LIBANKI_APKG_EXPORT_HPP
+
+#include "apkg_version.hpp"
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace anki {
+
+    // Media file to be included in an exported package, under its original file name (the name
+    // by which notes refer to it).
+
+    struct media_file {
+        std::string            name;
+        std::vector<std::byte> bytes;
+    };
+
+    // Tuning parameters for `export_apkg()`.
+    //
+    // * `thread_count` is the number of compression threads, or 0 to use one per hardware
+    //   thread.
+    // * `block_size` is the size of the blocks into which large entries are split so that each may
+    //   be compressed on a different thread. Each block is primed with the 32 KiB of data that
+    //   precedes it, so this costs little in compression ratio unless blocks are very small.
+    // * `compression_level` is a zlib compression level, from 1 to 9.
+
+    struct export_options {
+        unsigned    thread_count      = 0;
+        std::size_t block_size        = std::size_t{1} << 17;
+        int         compression_level = 6;
+    };
+
+    // Writes a package of the specified version to `dst`, containing the SQLite database
+    // `collection`, each file of `media` (numbered in order) and the media manifest mapping those
+    // numbers to file names. Entries are compressed in parallel and written as each completes.
+    // Media in formats that are already compressed (such as JPEG, MP3 and Ogg) is stored rather
+    // than deflated, as is any entry that deflate fails to shrink.
+    //
+    // The package is written beside `dst` and only moved over it once complete. Throws
+    // `anki::error` on failure, in which case `dst` is left as it was.
+
+    void export_apkg(
+        const path& dst, apkg_version version, const std::vector<std::byte>& collection,
+        const std::vector<media_file>& media, const export_options& options = {});
+}
+
+#endif
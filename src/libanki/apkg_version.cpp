@@ -137,11 +137,19 @@ namespace anki {
 
     auto archive_apkg_version(const zip_archive& archive) -> std::optional<apkg_version> {
 
+        return archive_apkg_version([&archive] (const path& file_path) {
+            return archive.contains_file(file_path);
+        });
+    }
+
+    auto archive_apkg_version(const std::function<bool(const path&)>& contains_file)
+        -> std::optional<apkg_version> {
+
         static const auto& lookup = version_table();
 
-        const auto matches_archive = [&archive] (const version_table_t::value_type& elem) {
+        const auto matches_archive = [&contains_file] (const version_table_t::value_type& elem) {
             const auto& info = elem.second;
-            return archive.contains_file(info.collection_file_path);
+            return contains_file(info.collection_file_path);
         };
 
         const auto iter = std::find_if(lookup.begin(), lookup.end(), matches_archive);
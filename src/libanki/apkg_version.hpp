@@ -3,6 +3,7 @@
 
 #include "filesystem.hpp"
 
+#include <functional>
 #include <optional>
 #include <ostream>
 
@@ -27,6 +28,12 @@ namespace anki {
 
     auto archive_apkg_version(const zip_archive& archive) -> std::optional<apkg_version>;
 
+    // As above, for an archive whose entries are tested for by `contains_file`, for callers that
+    // read archives by other means than `zip_archive`.
+
+    auto archive_apkg_version(const std::function<bool(const path&)>& contains_file)
+        -> std::optional<apkg_version>;
+
     // Returns the relative path within of the main collection file within `apkg` archives of the
     // specified version.
 
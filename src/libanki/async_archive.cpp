@@ -0,0 +1,173 @@
+#include "async_archive.hpp"
+
+#include "error.hpp"
+#include "impl/archive_file.hpp"
+#include "impl/crc32.hpp"
+#include "impl/inflate_buffer.hpp"
+#include "impl/native/archive.hpp"
+#include "impl/zip_format.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace anki {
+
+    namespace {
+
+        // Posts a call of `handler` with the outcome of an operation to `completion`.
+
+        template<typename t>
+        void complete(
+            const executor& completion, completion_handler<t> handler, std::exception_ptr ex,
+            t result) {
+
+            completion([handler = std::move(handler), ex = std::move(ex),
+                result = std::move(result)] () mutable {
+
+                handler(std::move(ex), std::move(result));
+            });
+        }
+
+        // Decodes the data `src` of an entry described by `info`, checking it as the native
+        // backend's `read_all()` does.
+
+        auto decode(const zip_entry_info& info, std::vector<std::byte> src, const bool verify_crc)
+            -> std::vector<std::byte> {
+
+            auto dst = std::vector<std::byte>{};
+
+            switch (info.method) {
+            case zip_method::stored:
+
+                if (info.compressed_size != info.size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                dst = std::move(src);
+                break;
+
+            case zip_method::deflated:
+
+                dst.resize(impl::zip_format::checked_entry_size(info));
+                impl::inflate_buffer(src.data(), src.size(), dst.data(), dst.size());
+                break;
+
+            default:
+                throw error{error_code::zip_unsupported_compression_method};
+            }
+
+            if (verify_crc && impl::crc32(0, dst.data(), dst.size()) != info.crc) {
+                throw error{error_code::zip_bad_crc};
+            }
+
+            return dst;
+        }
+    }
+
+    void async_archive::open(
+        path src, async_executors executors, completion_handler<async_archive> handler) {
+
+        auto io = executors.io;
+        io([src = std::move(src), executors = std::move(executors),
+            handler = std::move(handler)] () mutable {
+
+            auto result = async_archive{};
+            auto ex     = std::exception_ptr{};
+
+            try {
+                result._archive = std::make_shared<const impl::native::archive>(
+                    impl::archive_file{src});
+                result._executors = executors;
+            }
+            catch (...) {
+                ex = std::current_exception();
+            }
+
+            complete(executors.completion, std::move(handler), std::move(ex), std::move(result));
+        });
+    }
+
+    void async_archive::apkg_version(
+        completion_handler<std::optional<anki::apkg_version>> handler) const {
+
+        assert(_archive);
+
+        auto result = std::optional<anki::apkg_version>{};
+        auto ex     = std::exception_ptr{};
+
+        try {
+            result = archive_apkg_version([this] (const path& file_path) {
+                return _archive->contains_file(file_path);
+            });
+        }
+        catch (...) {
+            ex = std::current_exception();
+        }
+
+        complete(_executors.completion, std::move(handler), std::move(ex), result);
+    }
+
+    void async_archive::read(
+        path file_path, completion_handler<std::vector<std::byte>> handler,
+        const bool verify_crc) const {
+
+        assert(_archive);
+
+        _executors.io([archive = _archive, executors = _executors,
+            file_path = std::move(file_path), handler = std::move(handler),
+            verify_crc] () mutable {
+
+            auto info = zip_entry_info{};
+            auto src  = std::vector<std::byte>{};
+            auto ex   = std::exception_ptr{};
+
+            try {
+
+                const auto location = archive->locate_file(file_path);
+                info = location.info;
+
+                if (info.encrypted) {
+                    throw error{error_code::zip_password_required};
+                }
+
+                src.resize(ksr::narrow_cast<std::size_t>(info.compressed_size));
+                archive->source().read_exact_at(location.offset, src.data(), src.size());
+            }
+            catch (...) {
+                ex = std::current_exception();
+            }
+
+            if (ex) {
+
+                complete(
+                    executors.completion, std::move(handler), std::move(ex),
+                    std::vector<std::byte>{});
+                return;
+            }
+
+            // The archive is no longer needed once its data has been read, so is released here
+            // rather than held until decompression completes.
+
+            archive.reset();
+
+            auto compute = executors.compute;
+            compute([executors = std::move(executors), handler = std::move(handler), info,
+                src = std::move(src), verify_crc] () mutable {
+
+                auto dst = std::vector<std::byte>{};
+                auto ex  = std::exception_ptr{};
+
+                try {
+                    dst = decode(info, std::move(src), verify_crc);
+                }
+                catch (...) {
+                    ex = std::current_exception();
+                }
+
+                complete(executors.completion, std::move(handler), std::move(ex), std::move(dst));
+            });
+        });
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef LIBANKI_ASYNC_ARCHIVE_HPP
+#define LIBANKI_ASYNC_ARCHIVE_HPP
+
+#include "apkg_version.hpp"
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace anki {
+
+    namespace impl::native {
+        class archive;
+    }
+
+    // Runs tasks on behalf of asynchronous operations: called with each task, it must run it
+    // exactly once, on whatever thread and whenever it chooses. It may run the task before
+    // returning, but the rest of the operation then runs nested inside the call that posted it.
+
+    using executor = std::function<void(std::function<void()>)>;
+
+    // Executors of an asynchronous operation. `io` runs the reads of archive data, which may block
+    // on the disk; `compute` runs decompression; and every completion handler is called through
+    // `completion`. An event loop would typically supply itself as `completion` and thread pools
+    // as the others, so that it never blocks and can drive many operations at once; `io` and
+    // `compute` may be the same pool.
+
+    struct async_executors {
+        executor io;
+        executor compute;
+        executor completion;
+    };
+
+    // Called once an asynchronous operation completes, with the exception that its synchronous
+    // counterpart would have thrown, or a null pointer and the result on success.
+
+    template<typename t>
+    using completion_handler = std::function<void(std::exception_ptr, t)>;
+
+    // Archive opened and read through `async_executors`, without blocking the thread that starts
+    // each operation. Like `shared_zip_archive`, it is always read with the native backend, and
+    // copies share the open archive. The archive is kept open by any operation in progress, so
+    // copies may be destroyed before their operations complete. Operations may be started from
+    // several threads at once.
+
+    class async_archive {
+    public:
+
+        // Opens the archive at `src` on `executors.io`, passing it to `handler`. Fails as
+        // `shared_zip_archive`'s constructor does. The archive's later operations use `executors`.
+
+        static void open(
+            path src, async_executors executors, completion_handler<async_archive> handler);
+
+        async_archive() = default;
+
+        // Determines the `apkg` version of the archive, as `archive_apkg_version()` does. This
+        // needs only the central directory, already read by `open()`, so nothing is posted to
+        // `io` or `compute`; but `handler` is still called through `completion`.
+
+        void apkg_version(completion_handler<std::optional<anki::apkg_version>> handler) const;
+
+        // Reads the whole of the file `file_path`: its compressed data is read on `io` and
+        // decompressed on `compute`. `verify_crc` may be cleared to skip checksumming it, as for
+        // `pipeline_options`. Fails as `zip_file::read_all()` does.
+
+        void read(
+            path file_path, completion_handler<std::vector<std::byte>> handler,
+            bool verify_crc = true) const;
+
+    private:
+
+        std::shared_ptr<const impl::native::archive> _archive;
+        async_executors                              _executors;
+    };
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "batch_reader.hpp"
+
+#include "error.hpp"
+#include "impl/io_uring/ring.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <exception>
+#include <utility>
+
+namespace anki {
+
+    namespace {
+
+        // Largest single read submitted at once; io_uring takes 32-bit lengths, and Linux caps
+        // any one read at a little under 2 GiB regardless.
+
+        constexpr auto max_read_size = std::size_t{1} << 30;
+
+        // Completes the remainder of `request` with blocking `pread()` calls.
+
+        void read_sync(read_request& request) {
+
+            while (request.bytes_read < request.size) {
+
+                const auto size   = std::min(request.size - request.bytes_read, max_read_size);
+                const auto offset = ksr::narrow_cast<off_t>(request.offset + request.bytes_read);
+                const auto result = pread(request.fd, request.dst + request.bytes_read, size, offset);
+
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw error{error_code::system_error};
+                }
+
+                if (result == 0) {
+                    return;
+                }
+
+                request.bytes_read += static_cast<std::size_t>(result);
+            }
+        }
+    }
+
+    // Requests of one call of `read()` in progress. `ready` holds the indices of requests with data
+    // still to be submitted, in reverse order so that they are submitted in order; a request
+    // returns there after a short read that did not reach the end of its file. `remaining` counts
+    // the requests not yet complete, and `error` is the first failure of any.
+
+    struct batch_reader::pending_batch {
+        std::vector<read_request>* requests  = nullptr;
+        std::vector<std::size_t>   ready;
+        std::size_t                remaining = 0;
+        std::exception_ptr         error;
+    };
+
+    batch_reader::batch_reader(const batch_reader_options& options)
+      : _arena(options.arena_size) {
+
+        if (options.use_io_uring) {
+
+            _ring = impl::io_uring::ring::create(options.queue_depth);
+
+            // A failed registration only costs the fixed-buffer optimisation; reads into the arena
+            // then proceed as for any other memory.
+
+            if (_ring && !_arena.empty()) {
+                _ring->register_buffer(_arena.data(), _arena.size());
+            }
+
+            if (_ring) {
+
+                _slots.resize(_ring->capacity());
+                _free_slots.reserve(_slots.size());
+
+                for (auto i = static_cast<std::uint32_t>(_slots.size()); i-- > 0;) {
+                    _free_slots.push_back(i);
+                }
+            }
+        }
+    }
+
+    batch_reader::~batch_reader() = default;
+
+    void batch_reader::read(std::vector<read_request>& requests) {
+
+        for (auto& request : requests) {
+            request.bytes_read = 0;
+        }
+
+        if (_ring) {
+            read_async(requests);
+        }
+        else {
+            std::for_each(requests.begin(), requests.end(), read_sync);
+        }
+    }
+
+    auto batch_reader::read(
+        const int fd, const std::uint64_t offset, std::byte* const dst, const std::size_t size)
+        -> std::size_t {
+
+        auto requests = std::vector<read_request>(1);
+        requests[0].fd     = fd;
+        requests[0].offset = offset;
+        requests[0].dst    = dst;
+        requests[0].size   = size;
+
+        read(requests);
+        return requests[0].bytes_read;
+    }
+
+    void batch_reader::read_async(std::vector<read_request>& requests) {
+
+        assert(_ring);
+
+        auto own = pending_batch{};
+        own.requests = &requests;
+        own.ready.reserve(requests.size());
+
+        for (auto i = requests.size(); i-- > 0;) {
+            if (requests[i].size > 0) {
+                own.ready.push_back(i);
+            }
+        }
+
+        own.remaining = own.ready.size();
+        if (own.remaining == 0) {
+            return;
+        }
+
+        auto lock = std::unique_lock{_mutex};
+        _batches.push_back(&own);
+
+        // A thread finding the ring idle drives it, for every batch, until its own batch is
+        // complete, and then gives it up to any other thread whose batch is not.
+
+        while (own.remaining > 0) {
+
+            if (_driving) {
+                _progress.wait(lock);
+                continue;
+            }
+
+            _driving = true;
+            drive(lock, own);
+            _driving = false;
+
+            _progress.notify_all();
+        }
+
+        if (own.error) {
+            std::rethrow_exception(own.error);
+        }
+    }
+
+    // Submits and reaps reads until `own` is complete, with `lock` held except while waiting on the
+    // ring or reading synchronously.
+
+    void batch_reader::drive(std::unique_lock<std::mutex>& lock, const pending_batch& own) {
+
+        auto retries = std::vector<slot>{};
+
+        while (own.remaining > 0) {
+
+            queue_ready();
+
+            lock.unlock();
+
+            auto failure = std::exception_ptr{};
+            try {
+                _ring->submit_and_wait(1);
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+
+            lock.lock();
+
+            while (const auto completion = _ring->pop_completion()) {
+
+                const auto id = ksr::narrow_cast<std::uint32_t>(completion->user_data);
+                const auto current = std::exchange(_slots[id], slot{});
+                _free_slots.push_back(id);
+
+                auto& request = (*current.batch->requests)[current.index];
+
+                if (completion->result > 0) {
+
+                    request.bytes_read += static_cast<std::size_t>(completion->result);
+                    if (request.bytes_read < request.size) {
+                        current.batch->ready.push_back(current.index);
+                    }
+                    else {
+                        complete(*current.batch);
+                    }
+                }
+                else if (completion->result == 0) {
+                    complete(*current.batch);
+                }
+                else {
+                    retries.push_back(current);
+                }
+            }
+
+            // Reads that the ring discarded on failing are failed with it; their batches' other
+            // reads are tried again.
+
+            if (failure) {
+
+                for (auto id = std::uint32_t{0}; id < _slots.size(); ++id) {
+
+                    if (_slots[id].batch) {
+                        complete(*std::exchange(_slots[id], slot{}).batch, failure);
+                        _free_slots.push_back(id);
+                    }
+                }
+            }
+
+            if (retries.empty()) {
+                continue;
+            }
+
+            // Some kernels support io_uring but not reads from every kind of file, so any failed
+            // read is retried synchronously, which also yields the canonical error. None of the
+            // batches can complete meanwhile, as these requests are theirs.
+
+            lock.unlock();
+
+            auto errors = std::vector<std::exception_ptr>(retries.size());
+            for (auto i = std::size_t{0}; i < retries.size(); ++i) {
+
+                try {
+                    read_sync((*retries[i].batch->requests)[retries[i].index]);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+
+            lock.lock();
+
+            for (auto i = std::size_t{0}; i < retries.size(); ++i) {
+                complete(*retries[i].batch, errors[i]);
+            }
+
+            retries.clear();
+        }
+    }
+
+    // Queues as many ready reads as the ring has room for, taking batches in the order they
+    // began.
+
+    void batch_reader::queue_ready() {
+
+        for (const auto batch : _batches) {
+
+            auto& requests = *batch->requests;
+
+            while (!batch->ready.empty() && !_free_slots.empty()) {
+
+                const auto index = batch->ready.back();
+                const auto id    = _free_slots.back();
+
+                auto& request = requests[index];
+                const auto size = std::min(request.size - request.bytes_read, max_read_size);
+
+                const auto queued = _ring->prepare_read(
+                    request.fd, request.offset + request.bytes_read,
+                    request.dst + request.bytes_read, static_cast<std::uint32_t>(size), id);
+
+                if (!queued) {
+                    return;
+                }
+
+                batch->ready.pop_back();
+                _free_slots.pop_back();
+                _slots[id] = {batch, index};
+            }
+        }
+    }
+
+    // Records the completion of one request of `batch`, with `error` if it failed, waking the
+    // batch's thread once none remain.
+
+    void batch_reader::complete(pending_batch& batch, const std::exception_ptr& error) {
+
+        if (error && !batch.error) {
+            batch.error = error;
+        }
+
+        if (--batch.remaining == 0) {
+
+            _batches.erase(std::find(_batches.begin(), _batches.end(), &batch));
+            _progress.notify_all();
+        }
+    }
+}
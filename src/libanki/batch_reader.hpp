@@ -0,0 +1,127 @@
+#ifndef LIBANKI_BATCH_READER_HPP
+#define LIBANKI_BATCH_READER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace anki {
+
+    namespace impl::io_uring {
+        class ring;
+    }
+
+    // A single positioned read for `batch_reader::read()`. `bytes_read` is set on completion, and
+    // is less than `size` only if the end of the file was reached.
+
+    struct read_request {
+        int           fd         = -1;
+        std::uint64_t offset     = 0;
+        std::byte*    dst        = nullptr;
+        std::size_t   size       = 0;
+        std::size_t   bytes_read = 0;
+    };
+
+    struct batch_reader_options {
+
+        // Maximum number of reads in flight at once.
+
+        unsigned queue_depth = 64;
+
+        // Size of the arena of memory registered with the kernel (see `batch_reader::arena()`).
+
+        std::size_t arena_size = std::size_t{4} << 20;
+
+        // Whether to attempt to use io_uring at all. When `false`, or when io_uring is unavailable
+        // at runtime, reads are performed synchronously with `pread()`.
+
+        bool use_io_uring = true;
+    };
+
+    // Performs batches of positioned reads, potentially across many files at once, with as few
+    // system calls as possible. On Linux, reads are submitted through io_uring where the kernel
+    // supports it; otherwise, and on other platforms, they fall back to synchronous `pread()`
+    // calls with identical results. Safe to use concurrently from multiple threads: with io_uring,
+    // the reads of concurrent batches share the ring, one of the waiting threads at a time
+    // submitting whatever reads any batch has queued and reaping completions for all of them, so
+    // that reads from many threads are in flight together rather than one batch after another.
+    //
+    // The reader owns an arena of memory that is registered with the kernel when io_uring is in
+    // use. Reads whose destination lies within the arena avoid the per-request cost of pinning the
+    // destination pages; callers that read the same amount of data repeatedly (such as archive
+    // central directories) should stage that data through the arena.
+
+    class batch_reader {
+    public:
+
+        explicit batch_reader(const batch_reader_options& options = {});
+        ~batch_reader();
+
+        batch_reader(batch_reader&&)      = delete;
+        batch_reader(const batch_reader&) = delete;
+
+        auto operator=(batch_reader&&)      -> batch_reader& = delete;
+        auto operator=(const batch_reader&) -> batch_reader& = delete;
+
+        auto uses_io_uring() const noexcept -> bool { return _ring != nullptr; }
+
+        // The registered memory arena. Callers are responsible for partitioning it between the
+        // reads of a batch; it is not otherwise used by the reader. As the reader may be shared
+        // between threads, a caller must hold the lock returned by `lock_arena()` from staging
+        // reads through the arena until it has copied their data out.
+
+        auto arena() noexcept -> std::byte* { return _arena.data(); }
+        auto arena_size() const noexcept -> std::size_t { return _arena.size(); }
+
+        auto lock_arena() -> std::unique_lock<std::mutex> {
+            return std::unique_lock{_arena_mutex};
+        }
+
+        // Performs every read in `requests`, returning once all have completed and their
+        // `bytes_read` members have been set. Throws `anki::error` if any read fails.
+
+        void read(std::vector<read_request>& requests);
+
+        // Convenience function performing a single read and returning the number of bytes read.
+
+        auto read(int fd, std::uint64_t offset, std::byte* dst, std::size_t size) -> std::size_t;
+
+    private:
+
+        struct pending_batch;
+
+        // Request `index` of `batch` in flight in the ring, tagged with its position in `_slots`;
+        // `batch` is null for a free slot.
+
+        struct slot {
+            pending_batch* batch = nullptr;
+            std::size_t    index = 0;
+        };
+
+        void read_async(std::vector<read_request>& requests);
+        void drive(std::unique_lock<std::mutex>& lock, const pending_batch& own);
+        void queue_ready();
+        void complete(pending_batch& batch, const std::exception_ptr& error = nullptr);
+
+        std::unique_ptr<impl::io_uring::ring> _ring;
+        std::vector<std::byte>                _arena;
+        std::mutex                            _arena_mutex;
+
+        // Batches in progress and the ring's slots, guarded by `_mutex`. Only the thread that set
+        // `_driving` uses the ring; `_progress` is notified whenever a batch completes or the ring
+        // is given up.
+
+        std::mutex                  _mutex;
+        std::condition_variable     _progress;
+        bool                        _driving = false;
+        std::vector<pending_batch*> _batches;
+        std::vector<slot>           _slots;
+        std::vector<std::uint32_t>  _free_slots;
+    };
+}
+
+#endif
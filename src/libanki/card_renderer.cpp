@@ -0,0 +1,250 @@
+#include "card_renderer.hpp"
+
+#include "collection.hpp"
+#include "collection_snapshot.hpp"
+#include "note_fields.hpp"
+#include "impl/parallel.hpp"
+#include "impl/template_program.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <optional>
+
+namespace anki {
+
+    namespace {
+
+        // Compiles the note type of each dictionary code of `columns`, or leaves it empty if the
+        // collection lacks it.
+
+        auto compile_notetypes(
+            const collection_columns& columns, const std::vector<notetype>& notetypes)
+            -> std::vector<std::optional<compiled_notetype>> {
+
+            auto result = std::vector<std::optional<compiled_notetype>>{};
+            result.reserve(columns.notetype_ids.size());
+
+            for (const auto id : columns.notetype_ids) {
+
+                const auto it = std::lower_bound(notetypes.begin(), notetypes.end(), id,
+                    [] (const notetype& type, const std::int64_t id) { return type.id < id; });
+
+                if (it != notetypes.end() && it->id == id) {
+                    result.emplace_back(std::in_place, *it);
+                }
+                else {
+                    result.emplace_back();
+                }
+            }
+
+            return result;
+        }
+
+        // Work shared between the rendering threads, which take batches of consecutive cards in
+        // order. The first error from any thread stops the others.
+
+        class render_state {
+        public:
+
+            render_state(
+                const collection_columns& columns, const std::vector<notetype>& notetypes,
+                const render_consumer& consume, const render_options& options)
+
+              : _columns{columns},
+                _compiled{compile_notetypes(_columns, notetypes)},
+                _consume{consume},
+                _batch_size{std::max<std::size_t>(options.batch_size, 1)},
+                _batch_count{(_columns.cards.size() + _batch_size - 1) / _batch_size} {
+            }
+
+            auto batch_count() const noexcept -> std::size_t {
+                return _batch_count;
+            }
+
+            // Renders batches until none remain or rendering has failed.
+
+            void run_worker() noexcept {
+
+                try {
+
+                    auto card = rendered_card{};
+                    auto tags = std::string{};
+
+                    while (!_failed.load(std::memory_order_acquire)) {
+
+                        const auto batch = _next_batch.fetch_add(1, std::memory_order_relaxed);
+                        if (batch >= _batch_count) {
+                            return;
+                        }
+
+                        const auto begin = batch * _batch_size;
+                        const auto end   = std::min(begin + _batch_size, _columns.cards.size());
+
+                        for (auto row = begin; row < end; ++row) {
+                            render_card(row, card, tags);
+                        }
+                    }
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+
+            void fail(std::exception_ptr error) noexcept {
+
+                {
+                    const auto lock = std::lock_guard{_mutex};
+                    if (!_error) {
+                        _error = std::move(error);
+                    }
+                }
+
+                _failed.store(true, std::memory_order_release);
+            }
+
+            void rethrow_if_failed() const {
+
+                const auto lock = std::lock_guard{_mutex};
+                if (_error) {
+                    std::rethrow_exception(_error);
+                }
+            }
+
+        private:
+
+            void render_card(const std::size_t row, rendered_card& card, std::string& tags) {
+
+                const auto& notes = _columns.notes;
+                const auto& cards = _columns.cards;
+
+                const auto note = cards.note[row];
+                if (note == no_row) {
+                    return;
+                }
+
+                const auto& compiled = _compiled[notes.notetype[note]];
+                if (!compiled) {
+                    return;
+                }
+
+                tags.clear();
+                for (const auto tag : notes.tags_of(note)) {
+
+                    if (!tags.empty()) {
+                        tags += ' ';
+                    }
+
+                    tags += _columns.tags[tag];
+                }
+
+                const auto context = card_context{tags, _columns.deck_names[cards.deck[row]]};
+                if (compiled->render(cards.ordinal[row], notes.fields[note], context, card)) {
+                    _consume(row, card);
+                }
+            }
+
+            const collection_columns&                     _columns;
+            std::vector<std::optional<compiled_notetype>> _compiled;
+            const render_consumer&                        _consume;
+
+            std::size_t              _batch_size;
+            std::size_t              _batch_count;
+            std::atomic<std::size_t> _next_batch{0};
+            std::atomic<bool>        _failed{false};
+
+            mutable std::mutex _mutex;
+            std::exception_ptr _error;
+        };
+    }
+
+    compiled_notetype::compiled_notetype(const notetype& type)
+      : _name{type.name}, _cloze{type.cloze}, _field_names{type.fields} {
+
+        _template_names.reserve(type.templates.size());
+        _questions.reserve(type.templates.size());
+        _answers.reserve(type.templates.size());
+
+        for (const auto& card_template : type.templates) {
+
+            _template_names.push_back(card_template.name);
+            _questions.emplace_back(
+                card_template.question_format, impl::card_side::question, _field_names);
+            _answers.emplace_back(
+                card_template.answer_format, impl::card_side::answer, _field_names);
+        }
+    }
+
+    compiled_notetype::~compiled_notetype() = default;
+
+    compiled_notetype::compiled_notetype(compiled_notetype&& rhs) noexcept = default;
+    auto compiled_notetype::operator=(compiled_notetype&& rhs) noexcept
+        -> compiled_notetype& = default;
+
+    auto compiled_notetype::render(
+        const std::size_t ordinal, const std::string_view fields, const card_context& context,
+        rendered_card& dst) const -> bool {
+
+        dst._question.clear();
+        dst._answer.clear();
+
+        // Cloze note types render every card from their one template, with the ordinal
+        // selecting which deletion (numbered from 1) is hidden.
+
+        const auto index = _cloze ? 0 : ordinal;
+        if (index >= _questions.size()) {
+            return false;
+        }
+
+        split_fields(fields, dst._fields);
+
+        auto inputs = impl::template_inputs{};
+        inputs.field_names   = &_field_names;
+        inputs.fields        = &dst._fields;
+        inputs.tags          = context.tags;
+        inputs.notetype_name = _name;
+        inputs.deck_name     = context.deck_name;
+        inputs.template_name = _template_names[index];
+        inputs.cloze_ordinal = static_cast<int>(ordinal + 1);
+
+        _questions[index].render(inputs, dst._question, dst._scratch);
+
+        inputs.front_side = dst._question;
+        _answers[index].render(inputs, dst._answer, dst._scratch);
+
+        return true;
+    }
+
+    namespace {
+
+        // Renders every card of `columns`, as `render_cards()` does.
+
+        void render_all(
+            const collection_columns& columns, const std::vector<notetype>& notetypes,
+            const render_consumer& consume, const render_options& options) {
+
+            auto state = render_state{columns, notetypes, consume, options};
+
+            impl::run_parallel(
+                impl::parallel_thread_count(options.thread_count, state.batch_count()),
+                [&state] (std::size_t) { state.run_worker(); });
+
+            state.rethrow_if_failed();
+        }
+    }
+
+    void render_cards(
+        const collection& collection, const render_consumer& consume,
+        const render_options& options) {
+
+        render_all(collection.columns(), collection.notetypes(), consume, options);
+    }
+
+    void render_cards(
+        const collection_snapshot& snapshot, const render_consumer& consume,
+        const render_options& options) {
+
+        render_all(snapshot.columns(), snapshot.notetypes(), consume, options);
+    }
+}
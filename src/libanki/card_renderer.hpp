@@ -0,0 +1,121 @@
+#ifndef LIBANKI_CARD_RENDERER_HPP
+#define LIBANKI_CARD_RENDERER_HPP
+
+#include "collection_metadata.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+    class collection_snapshot;
+
+    namespace impl {
+        class template_program;
+    }
+
+    // Values of the special template fields of a card that do not come from its note type:
+    // `{{Tags}}` (space-separated) and `{{Deck}}` and `{{Subdeck}}` (from the full deck name).
+
+    struct card_context {
+        std::string_view tags;
+        std::string_view deck_name;
+    };
+
+    // The rendered question and answer of a card, together with the scratch space used to render
+    // them. Reusing one `rendered_card` across cards avoids allocation once its buffers have grown
+    // to fit the largest.
+
+    class rendered_card {
+    public:
+
+        auto question() const noexcept -> std::string_view { return _question; }
+        auto answer()   const noexcept -> std::string_view { return _answer; }
+
+    private:
+
+        friend class compiled_notetype;
+
+        std::string                   _question;
+        std::string                   _answer;
+        std::string                   _scratch[2];
+        std::vector<std::string_view> _fields;
+    };
+
+    // Card templates of a note type, compiled once so that cards can be rendered without parsing
+    // them again. Supports field substitutions, conditional and inverted sections, the special
+    // fields `FrontSide`, `Tags`, `Type`, `Deck`, `Subdeck` and `Card`, and the `text`, `cloze`,
+    // `cloze-only`, `hint`, `furigana`, `kana`, `kanji` and `type` filters; other filters are
+    // ignored. A compiled note type is immutable, and may be shared between threads.
+
+    class compiled_notetype {
+    public:
+
+        explicit compiled_notetype(const notetype& type);
+        ~compiled_notetype();
+
+        compiled_notetype(compiled_notetype&& rhs) noexcept;
+        auto operator=(compiled_notetype&& rhs) noexcept -> compiled_notetype&;
+
+        compiled_notetype(const compiled_notetype&) = delete;
+        auto operator=(const compiled_notetype&) -> compiled_notetype& = delete;
+
+        // Renders both sides of the card with ordinal `ordinal` (as in `card::ordinal`) of a note
+        // with field text `fields` (as in `note::fields`) into `dst`. Returns `false`, leaving
+        // both sides empty, if the note type has no template for the card.
+
+        auto render(
+            std::size_t ordinal, std::string_view fields, const card_context& context,
+            rendered_card& dst) const -> bool;
+
+    private:
+
+        std::string                         _name;
+        bool                                _cloze;
+        std::vector<std::string>            _field_names;
+        std::vector<std::string>            _template_names;
+        std::vector<impl::template_program> _questions;
+        std::vector<impl::template_program> _answers;
+    };
+
+    // Tuning parameters for `render_cards()`.
+    //
+    // * `thread_count` is the number of threads to render with, including the calling thread, or
+    //   0 to use one per hardware thread.
+    // * `batch_size` is the number of consecutive cards that each thread takes at a time.
+
+    struct render_options {
+        unsigned    thread_count = 0;
+        std::size_t batch_size   = 256;
+    };
+
+    // Receives the row of a rendered card within `collection::columns().cards`, and its sides,
+    // which are valid only for the duration of the call.
+
+    using render_consumer = std::function<void(std::size_t row, const rendered_card& card)>;
+
+    // Renders every card of `collection`, compiling the templates of each note type once and
+    // dividing the cards between threads, each of which renders into buffers of its own. `consume`
+    // is called concurrently from those threads, in no particular order. Cards whose note or
+    // template is missing are skipped.
+    //
+    // Throws `anki::error` if the collection cannot be read; an exception thrown by `consume`
+    // stops rendering, and is rethrown once all threads have stopped.
+
+    void render_cards(
+        const collection& collection, const render_consumer& consume,
+        const render_options& options = {});
+
+    // As above, for the cards of `snapshot`, by their rows within `snapshot.columns().cards`.
+    // Throws `anki::error` if the snapshot is corrupt.
+
+    void render_cards(
+        const collection_snapshot& snapshot, const render_consumer& consume,
+        const render_options& options = {});
+}
+
+#endif
@@ -0,0 +1,29 @@
+# Defines the following variables for locating `libdeflate`:
+#
+# * `LIBDEFLATE_FOUND`: whether the library is installed on the system;
+# * `LIBDEFLATE_INCLUDE_DIRS`: include search paths;
+# * `LIBDEFLATE_LIBRARIES`: libraries to link.
+# * `LIBDEFLATE_VERSION`: three-component version number for the installed library.
+
+include(FindPackageHandleStandardArgs)
+find_package(PkgConfig QUIET)
+
+pkg_check_modules(PC_LIBDEFLATE QUIET libdeflate)
+
+find_path(LIBDEFLATE_INCLUDE_DIRS
+    NAMES libdeflate.h
+    HINTS ${PC_LIBDEFLATE_INCLUDE_DIRS}
+)
+
+find_library(LIBDEFLATE_LIBRARIES
+    NAMES libdeflate deflate
+    HINTS ${PC_LIBDEFLATE_LIBRARIES}
+)
+
+set(LIBDEFLATE_VERSION ${PC_LIBDEFLATE_VERSION})
+
+find_package_handle_standard_args(LibDeflate
+    FOUND_VAR     LIBDEFLATE_FOUND
+    REQUIRED_VARS LIBDEFLATE_INCLUDE_DIRS LIBDEFLATE_LIBRARIES
+    VERSION_VAR   LIBDEFLATE_VERSION
+)
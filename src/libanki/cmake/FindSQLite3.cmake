@@ -0,0 +1,29 @@
+# Defines the following variables for locating `sqlite3`:
+#
+# * `SQLITE3_FOUND`: whether the library is installed on the system;
+# * `SQLITE3_INCLUDE_DIRS`: include search paths;
+# * `SQLITE3_LIBRARIES`: libraries to link.
+# * `SQLITE3_VERSION`: three-component version number for the installed library.
+
+include(FindPackageHandleStandardArgs)
+find_package(PkgConfig QUIET)
+
+pkg_check_modules(PC_SQLITE3 QUIET sqlite3)
+
+find_path(SQLITE3_INCLUDE_DIRS
+    NAMES sqlite3.h
+    HINTS ${PC_SQLITE3_INCLUDE_DIRS}
+)
+
+find_library(SQLITE3_LIBRARIES
+    NAMES libsqlite3 sqlite3
+    HINTS ${PC_SQLITE3_LIBRARIES}
+)
+
+set(SQLITE3_VERSION ${PC_SQLITE3_VERSION})
+
+find_package_handle_standard_args(SQLite3
+    FOUND_VAR     SQLITE3_FOUND
+    REQUIRED_VARS SQLITE3_INCLUDE_DIRS SQLITE3_LIBRARIES
+    VERSION_VAR   SQLITE3_VERSION
+)
@@ -0,0 +1,340 @@
+#include "collection.hpp"
+
+#include "error.hpp"
+#include "extraction_pipeline.hpp"
+#include "impl/column_loader.hpp"
+#include "impl/media_manifest.hpp"
+#include "impl/metadata_parser.hpp"
+#include "impl/sqlite/database.hpp"
+#include "impl/zip_format.hpp"
+#include "note_store.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace anki {
+
+    namespace {
+
+        auto required_apkg_version(const zip_archive& archive) -> apkg_version {
+
+            const auto version = archive_apkg_version(archive);
+            if (!version) {
+                throw error{error_code::unsupported_apkg_version};
+            }
+
+            return *version;
+        }
+
+        // Extracts the collection database from `archive` directly into memory owned by SQLite,
+        // and opens it.
+
+        auto open_database(
+            const zip_archive& archive, const apkg_version version, const import_options& options)
+            -> std::unique_ptr<impl::sqlite::database> {
+
+            const auto collection_path = collection_file_path(version);
+            const auto info = archive.stat_file(collection_path);
+            const auto size = impl::zip_format::checked_entry_size(info);
+
+            auto image = impl::sqlite::image{size};
+            auto pos   = std::size_t{0};
+
+            // The pipeline never passes on more than the recorded size, so the image cannot
+            // overflow.
+
+            const auto append = [&image, &pos] (const std::byte* const data, const std::size_t size) {
+
+                assert(size <= image.size() - pos);
+
+                std::memcpy(image.data() + pos, data, size);
+                pos += size;
+            };
+
+            auto extract_options = pipeline_options{};
+            extract_options.verify_crc      = options.verify_crc;
+            extract_options.reuse_resources = options.reuse_buffers;
+
+            extract_pipelined(archive, collection_path, append, extract_options);
+            return std::make_unique<impl::sqlite::database>(std::move(image));
+        }
+
+        // Runs the query `sql` against `db`, converting each result row with `read_row`.
+
+        template<typename t, typename fn>
+        auto load_rows(const impl::sqlite::database& db, const std::string_view sql, fn read_row)
+            -> std::vector<t> {
+
+            auto query = impl::sqlite::statement{db, sql};
+            auto rows  = std::vector<t>{};
+
+            while (query.step()) {
+                rows.push_back(read_row(query));
+            }
+
+            return rows;
+        }
+    }
+
+    // Columns of the single row of the `col` table.
+
+    struct collection::col_record {
+        std::int64_t created = 0;
+        std::string  notetypes;
+        std::string  decks;
+        std::string  deck_configs;
+    };
+
+    // References to the canonical notes of `store` that a collection's notes view, released
+    // together with the collection.
+
+    struct collection::held_notes {
+
+        std::shared_ptr<note_store>        store;
+        std::vector<const canonical_note*> notes;
+
+        ~held_notes() {
+            for (const auto note : notes) {
+                store->release(*note);
+            }
+        }
+    };
+
+    collection::collection(const path& src, const import_options& options)
+      : _archive{src, options.backend},
+        _version{required_apkg_version(_archive)},
+        _options{options} {
+    }
+
+    collection::~collection() = default;
+
+    collection::collection(collection&& rhs) noexcept = default;
+    auto collection::operator=(collection&& rhs) noexcept -> collection& = default;
+
+    auto collection::created() const -> std::int64_t {
+        return col().created;
+    }
+
+    auto collection::notetypes_json() const -> const std::string& {
+        return col().notetypes;
+    }
+
+    auto collection::decks_json() const -> const std::string& {
+        return col().decks;
+    }
+
+    auto collection::deck_configs_json() const -> const std::string& {
+        return col().deck_configs;
+    }
+
+    auto collection::notetypes() const -> const std::vector<notetype>& {
+
+        if (!_notetypes) {
+            _notetypes = impl::parse_notetypes(notetypes_json());
+        }
+
+        return *_notetypes;
+    }
+
+    auto collection::decks() const -> const std::vector<deck>& {
+
+        if (!_decks) {
+            _decks = impl::parse_decks(decks_json());
+        }
+
+        return *_decks;
+    }
+
+    auto collection::deck_configs() const -> const std::vector<deck_config>& {
+
+        if (!_deck_configs) {
+            _deck_configs = impl::parse_deck_configs(deck_configs_json());
+        }
+
+        return *_deck_configs;
+    }
+
+    auto collection::notes() const -> const std::vector<note>& {
+
+        if (!_notes) {
+
+            static constexpr auto sql = std::string_view{
+                "SELECT id, guid, mid, mod, usn, tags, flds, sfld FROM notes ORDER BY id"};
+
+            // With a note store, GUIDs and fields are staged only until the store has matched
+            // them with its canonical notes, whose copies are then viewed instead.
+
+            const auto& store = _options.dedup_notes;
+
+            auto  staged   = ksr::text_arena{};
+            auto& key_text = store ? staged : _note_text;
+
+            const auto read_note = [this, &key_text] (const impl::sqlite::statement& row) {
+
+                auto result = note{};
+                result.id          = row.column_int64(0);
+                result.guid        = key_text.store(row.column_text(1));
+                result.notetype_id = row.column_int64(2);
+                result.modified    = row.column_int64(3);
+                result.usn         = row.column_int64(4);
+                result.tags        = _note_text.store(row.column_text(5));
+                result.fields      = key_text.store(row.column_text(6));
+                result.sort_field  = _note_text.store(row.column_text(7));
+
+                return result;
+            };
+
+            auto notes = load_rows<note>(database(), sql, read_note);
+
+            if (store) {
+
+                auto held = std::make_unique<held_notes>();
+                held->store = store;
+                held->notes = store->add(notes);
+
+                for (auto i = std::size_t{0}; i < notes.size(); ++i) {
+                    notes[i].guid   = held->notes[i]->note.guid;
+                    notes[i].fields = held->notes[i]->note.fields;
+                }
+
+                _held_notes = std::move(held);
+            }
+
+            _notes = std::move(notes);
+        }
+
+        return *_notes;
+    }
+
+    auto collection::cards() const -> const std::vector<card>& {
+
+        if (!_cards) {
+
+            static constexpr auto sql = std::string_view{
+                "SELECT id, nid, did, ord, mod, usn, type, queue, due, ivl, factor, reps, lapses, "
+                "left, odue, odid, flags FROM cards ORDER BY id"};
+
+            _cards = load_rows<card>(database(), sql, [] (const impl::sqlite::statement& row) {
+
+                auto result = card{};
+                result.id               = row.column_int64(0);
+                result.note_id          = row.column_int64(1);
+                result.deck_id          = row.column_int64(2);
+                result.ordinal          = row.column_int64(3);
+                result.modified         = row.column_int64(4);
+                result.usn              = row.column_int64(5);
+                result.type             = row.column_int64(6);
+                result.queue            = row.column_int64(7);
+                result.due              = row.column_int64(8);
+                result.interval         = row.column_int64(9);
+                result.ease_factor      = row.column_int64(10);
+                result.reps             = row.column_int64(11);
+                result.lapses           = row.column_int64(12);
+                result.left             = row.column_int64(13);
+                result.original_due     = row.column_int64(14);
+                result.original_deck_id = row.column_int64(15);
+                result.flags            = row.column_int64(16);
+
+                return result;
+            });
+        }
+
+        return *_cards;
+    }
+
+    auto collection::revlog() const -> const std::vector<review>& {
+
+        if (!_revlog) {
+
+            static constexpr auto sql = std::string_view{
+                "SELECT id, cid, usn, ease, ivl, lastIvl, factor, time, type FROM revlog ORDER BY id"};
+
+            _revlog = load_rows<review>(database(), sql, [] (const impl::sqlite::statement& row) {
+
+                auto result = review{};
+                result.id            = row.column_int64(0);
+                result.card_id       = row.column_int64(1);
+                result.usn           = row.column_int64(2);
+                result.ease          = row.column_int64(3);
+                result.interval      = row.column_int64(4);
+                result.last_interval = row.column_int64(5);
+                result.ease_factor   = row.column_int64(6);
+                result.time          = row.column_int64(7);
+                result.type          = row.column_int64(8);
+
+                return result;
+            });
+        }
+
+        return *_revlog;
+    }
+
+    auto collection::columns() const -> const collection_columns& {
+
+        if (!_columns) {
+            _columns = std::make_unique<collection_columns>(
+                impl::load_columns(database(), _note_text, decks(), notetypes()));
+        }
+
+        return *_columns;
+    }
+
+    auto collection::revlog_columns() const -> const review_columns& {
+
+        if (!_revlog_columns) {
+            _revlog_columns = std::make_unique<review_columns>(
+                impl::load_review_columns(database()));
+        }
+
+        return *_revlog_columns;
+    }
+
+    auto collection::media() const -> const std::vector<media_entry>& {
+
+        if (!_media) {
+
+            const auto bytes = _archive.open_file(impl::media_manifest_path).read_all();
+            const auto json  = std::string_view{reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+
+            _media = impl::parse_media_manifest(json);
+        }
+
+        return *_media;
+    }
+
+    auto collection::open_media(const media_entry& entry) const -> zip_file {
+        return _archive.open_file(entry.archive_name);
+    }
+
+    auto collection::database() const -> const impl::sqlite::database& {
+
+        if (!_database) {
+            _database = open_database(_archive, _version, _options);
+        }
+
+        return *_database;
+    }
+
+    auto collection::col() const -> const col_record& {
+
+        if (!_col) {
+
+            auto query = impl::sqlite::statement{database(), "SELECT crt, models, decks, dconf FROM col"};
+            if (!query.step()) {
+                throw error{error_code::invalid_collection};
+            }
+
+            auto record = std::make_unique<col_record>();
+            record->created      = query.column_int64(0);
+            record->notetypes    = query.column_text(1);
+            record->decks        = query.column_text(2);
+            record->deck_configs = query.column_text(3);
+
+            _col = std::move(record);
+        }
+
+        return *_col;
+    }
+}
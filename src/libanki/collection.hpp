@@ -0,0 +1,129 @@
+#ifndef LIBANKI_COLLECTION_HPP
+#define LIBANKI_COLLECTION_HPP
+
+#include "apkg_version.hpp"
+#include "collection_columns.hpp"
+#include "collection_metadata.hpp"
+#include "collection_records.hpp"
+#include "filesystem.hpp"
+#include "import_options.hpp"
+#include "zip_archive.hpp"
+#include "zip_file.hpp"
+
+#include "ksr/text_arena.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace anki {
+
+    namespace impl::sqlite {
+        class database;
+    }
+
+    // Handle to the collection within an `apkg` package, which keeps the package open and loads
+    // each part of the collection only when first accessed, caching it thereafter. The media
+    // manifest is read straight from the package; everything else requires the collection
+    // database, which is itself extracted and opened on first use, entirely in memory.
+    //
+    // Like `zip_archive`, a collection may only be used by one thread at a time.
+
+    class collection {
+    public:
+
+        // Opens the package at `src` and determines its version, without yet extracting anything.
+        // Throws `anki::error` on failure, including when `src` is not a package of a supported
+        // version.
+
+        explicit collection(const path& src, const import_options& options = {});
+        ~collection();
+
+        collection(collection&& rhs) noexcept;
+        auto operator=(collection&& rhs) noexcept -> collection&;
+
+        collection(const collection&) = delete;
+        auto operator=(const collection&) -> collection& = delete;
+
+        auto version() const noexcept -> apkg_version { return _version; }
+
+        // Creation time of the collection, in seconds since the epoch, adjusted by Anki to the
+        // start of the day on which it was created. Review cards are due on days counted from this
+        // time. Throws `anki::error` if the collection database cannot be read.
+
+        auto created() const -> std::int64_t;
+
+        // JSON text of the note types, decks and deck options of the collection, exactly as
+        // stored. Throws `anki::error` if the collection database cannot be read.
+
+        auto notetypes_json()    const -> const std::string&;
+        auto decks_json()        const -> const std::string&;
+        auto deck_configs_json() const -> const std::string&;
+
+        // The same metadata, parsed, in order of ID. Throws `anki::error` if the collection
+        // database cannot be read or its JSON is malformed.
+
+        auto notetypes()    const -> const std::vector<notetype>&;
+        auto decks()        const -> const std::vector<deck>&;
+        auto deck_configs() const -> const std::vector<deck_config>&;
+
+        // Every row of the corresponding table, ordered by ID. Throws `anki::error` if the
+        // collection database cannot be read. The text of every note is held in a few large
+        // blocks owned by the collection, rather than allocated note by note, except that with
+        // `import_options::dedup_notes` set, note GUIDs and fields view the store's copies.
+
+        auto notes()  const -> const std::vector<note>&;
+        auto cards()  const -> const std::vector<card>&;
+        auto revlog() const -> const std::vector<review>&;
+
+        // The notes and cards of the collection in columnar form, loaded separately from (and
+        // without requiring) `notes()` and `cards()`, with deck and note type names from
+        // `decks()` and `notetypes()`. Throws `anki::error` as those functions do.
+
+        auto columns() const -> const collection_columns&;
+
+        // The revlog in columnar form, loaded separately from `revlog()`. Throws `anki::error` if
+        // the collection database cannot be read.
+
+        auto revlog_columns() const -> const review_columns&;
+
+        // Entries of the package's media manifest, in the order listed. Throws `anki::error` if
+        // the manifest is missing or malformed.
+
+        auto media() const -> const std::vector<media_entry>&;
+
+        // Opens the data of a media file listed by `media()`. Throws `anki::error` on failure.
+
+        auto open_media(const media_entry& entry) const -> zip_file;
+
+    private:
+
+        struct col_record;
+        struct held_notes;
+
+        auto database() const -> const impl::sqlite::database&;
+        auto col() const -> const col_record&;
+
+        zip_archive    _archive;
+        apkg_version   _version;
+        import_options _options;
+
+        mutable std::unique_ptr<impl::sqlite::database>  _database;
+        mutable ksr::text_arena                          _note_text;
+        mutable std::unique_ptr<col_record>              _col;
+        mutable std::unique_ptr<collection_columns>      _columns;
+        mutable std::unique_ptr<review_columns>          _revlog_columns;
+        mutable std::optional<std::vector<notetype>>     _notetypes;
+        mutable std::optional<std::vector<deck>>         _decks;
+        mutable std::optional<std::vector<deck_config>>  _deck_configs;
+        mutable std::optional<std::vector<note>>         _notes;
+        mutable std::unique_ptr<held_notes>              _held_notes;
+        mutable std::optional<std::vector<card>>         _cards;
+        mutable std::optional<std::vector<review>>       _revlog;
+        mutable std::optional<std::vector<media_entry>>  _media;
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "collection_columns.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+
+namespace anki {
+
+    namespace {
+
+        auto find_code(const std::vector<std::int64_t>& ids, const std::int64_t id)
+            -> std::optional<std::uint32_t> {
+
+            const auto it = std::find(ids.begin(), ids.end(), id);
+            if (it == ids.end()) {
+                return std::nullopt;
+            }
+
+            return ksr::narrow_cast<std::uint32_t>(it - ids.begin());
+        }
+
+        auto find_row(const std::vector<std::int64_t>& ids, const std::int64_t id)
+            -> std::optional<std::size_t> {
+
+            const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            if (it == ids.end() || *it != id) {
+                return std::nullopt;
+            }
+
+            return static_cast<std::size_t>(it - ids.begin());
+        }
+    }
+
+    auto note_columns::tags_of(const std::size_t row) const -> tag_list {
+
+        const auto data = tags.data();
+        return tag_list{data + tag_offsets[row], data + tag_offsets[row + 1]};
+    }
+
+    auto collection_columns::deck_code(const std::int64_t deck_id) const
+        -> std::optional<std::uint32_t> {
+
+        return find_code(deck_ids, deck_id);
+    }
+
+    auto collection_columns::notetype_code(const std::int64_t notetype_id) const
+        -> std::optional<std::uint32_t> {
+
+        return find_code(notetype_ids, notetype_id);
+    }
+
+    auto collection_columns::note_row(const std::int64_t note_id) const
+        -> std::optional<std::size_t> {
+
+        return find_row(notes.id, note_id);
+    }
+
+    auto collection_columns::card_row(const std::int64_t card_id) const
+        -> std::optional<std::size_t> {
+
+        return find_row(cards.id, card_id);
+    }
+}
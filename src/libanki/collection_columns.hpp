@@ -0,0 +1,128 @@
+#ifndef LIBANKI_COLLECTION_COLUMNS_HPP
+#define LIBANKI_COLLECTION_COLUMNS_HPP
+
+#include "ksr/string_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    // Columnar (struct-of-arrays) counterparts of the `note`, `card` and `review` records, for
+    // filtering and aggregating over a few attributes at a time: each attribute is held in a
+    // contiguous array of the narrowest type that fits it, so that a scan over one column streams
+    // through memory without touching the others. Row `i` of each table is the `i`th record in
+    // order of ID.
+    //
+    // Decks and note types are dictionary-encoded: their columns hold dense codes indexing
+    // `collection_columns::deck_ids` and `collection_columns::notetype_ids` (and the names
+    // alongside), so that filtering by deck compares 32-bit codes. Tags are interned in
+    // `collection_columns::tags`.
+
+    // Marks a reference to a row that does not exist, such as a card whose note is missing.
+
+    inline constexpr auto no_row = std::numeric_limits<std::uint32_t>::max();
+
+    // Tag IDs of a single note, as a range over `note_columns::tags`.
+
+    struct tag_list {
+
+        const std::uint32_t* first = nullptr;
+        const std::uint32_t* last  = nullptr;
+
+        auto begin() const noexcept -> const std::uint32_t* { return first; }
+        auto end()   const noexcept -> const std::uint32_t* { return last; }
+        auto size()  const noexcept -> std::size_t { return static_cast<std::size_t>(last - first); }
+    };
+
+    // The tags of note `i` are `tags[tag_offsets[i]]` up to `tags[tag_offsets[i + 1]]`, so
+    // `tag_offsets` has one more element than there are notes. `fields` views text owned by the
+    // `collection` from which the columns were loaded.
+
+    struct note_columns {
+
+        std::vector<std::int64_t>     id;
+        std::vector<std::uint32_t>    notetype;
+        std::vector<std::int64_t>     modified;
+        std::vector<std::string_view> fields;
+        std::vector<std::uint32_t>    tag_offsets;
+        std::vector<std::uint32_t>    tags;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+        auto tags_of(std::size_t row) const -> tag_list;
+    };
+
+    // `note` holds the row of each card's note within `note_columns`, or `no_row` if the collection
+    // lacks it, so that joins need not search by ID. `left` is as Anki stores it for learning
+    // cards: the number of learning steps remaining, plus 1000 times the number of those that can
+    // be completed today. Values too large for their column (which Anki never produces) are
+    // clamped.
+
+    struct card_columns {
+
+        std::vector<std::int64_t>  id;
+        std::vector<std::int64_t>  note_id;
+        std::vector<std::uint32_t> note;
+        std::vector<std::uint32_t> deck;
+        std::vector<std::uint16_t> ordinal;
+        std::vector<std::int64_t>  due;
+        std::vector<std::int32_t>  interval;
+        std::vector<std::int32_t>  ease_factor;
+        std::vector<std::int32_t>  reps;
+        std::vector<std::int32_t>  lapses;
+        std::vector<std::int32_t>  left;
+        std::vector<std::int8_t>   queue;
+        std::vector<std::int8_t>   type;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+    };
+
+    // Rows of the revlog, in order of ID (and so of the time of review), reduced to what the
+    // statistics need. `time` is the time taken to answer, in milliseconds.
+
+    struct review_columns {
+
+        std::vector<std::int64_t>  id;
+        std::vector<std::int64_t>  card_id;
+        std::vector<std::int32_t>  interval;
+        std::vector<std::int32_t>  last_interval;
+        std::vector<std::uint32_t> time;
+        std::vector<std::uint8_t>  ease;
+        std::vector<std::uint8_t>  type;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+    };
+
+    struct collection_columns {
+
+        note_columns notes;
+        card_columns cards;
+
+        // Names view text owned by the `collection` from which the columns were loaded, and are
+        // empty for any deck or note type that its metadata lacks.
+
+        std::vector<std::int64_t>     deck_ids;
+        std::vector<std::string_view> deck_names;
+        std::vector<std::int64_t>     notetype_ids;
+        std::vector<std::string_view> notetype_names;
+        ksr::string_pool              tags;
+
+        // Return the dictionary code of the deck or note type with the specified ID, or
+        // `std::nullopt` if no card or note refers to it.
+
+        auto deck_code(std::int64_t deck_id) const -> std::optional<std::uint32_t>;
+        auto notetype_code(std::int64_t notetype_id) const -> std::optional<std::uint32_t>;
+
+        // Return the row of the note or card with the specified ID, or `std::nullopt` if there is
+        // none.
+
+        auto note_row(std::int64_t note_id) const -> std::optional<std::size_t>;
+        auto card_row(std::int64_t card_id) const -> std::optional<std::size_t>;
+    };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef LIBANKI_COLLECTION_METADATA_HPP
+#define LIBANKI_COLLECTION_METADATA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace anki {
+
+    // Metadata held as JSON in the `col` table of a collection, reduced to the members that
+    // libanki uses. Members missing from the JSON keep the defaults below, which are Anki's own.
+
+    // Card template of a note type: the formats from which the question and answer sides of each
+    // card are rendered.
+
+    struct card_template {
+        std::string name;
+        std::string question_format;
+        std::string answer_format;
+    };
+
+    // Note type, from the `models` column. `fields` and `templates` are in order of their
+    // ordinals, and `sort_field` is the index of the field by which notes are sorted.
+
+    struct notetype {
+        std::int64_t               id         = 0;
+        std::string                name;
+        bool                       cloze      = false;
+        std::int64_t               sort_field = 0;
+        std::int64_t               modified   = 0;
+        std::vector<std::string>   fields;
+        std::vector<card_template> templates;
+        std::string                css;
+    };
+
+    // Deck, from the `decks` column. Filtered decks have no options group, so their `config_id`
+    // is 0.
+
+    struct deck {
+        std::int64_t id        = 0;
+        std::string  name;
+        std::int64_t config_id = 0;
+        bool         filtered  = false;
+    };
+
+    // Options group shared by decks, from the `dconf` column. Steps are in minutes, intervals in
+    // days, and ease factors in permille.
+
+    struct deck_config {
+        std::int64_t        id                     = 0;
+        std::string         name;
+        std::int64_t        new_per_day            = 20;
+        std::int64_t        reviews_per_day        = 200;
+        std::vector<double> learning_steps         = {1.0, 10.0};
+        std::int64_t        graduating_interval    = 1;
+        std::int64_t        easy_interval          = 4;
+        std::int64_t        initial_ease           = 2500;
+        double              easy_bonus             = 1.3;
+        double              interval_modifier      = 1.0;
+        std::int64_t        maximum_interval       = 36500;
+        std::vector<double> relearning_steps       = {10.0};
+        double              lapse_multiplier       = 0.0;
+        std::int64_t        minimum_lapse_interval = 1;
+        std::int64_t        leech_threshold        = 8;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef LIBANKI_COLLECTION_RECORDS_HPP
+#define LIBANKI_COLLECTION_RECORDS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace anki {
+
+    // Records loaded from the tables of an Anki collection, with members named after (though not
+    // always identically to) the columns they come from. Timestamps and IDs keep Anki's units:
+    // IDs are creation times in milliseconds, and modification times are in seconds.
+
+    // Row of the `notes` table. `fields` holds the note's field values as stored, separated by
+    // `field_separator` (see `split_fields()`); `sort_field` holds the value of the field by which
+    // the note is sorted, and `tags` its tags separated by spaces. The text is owned by the
+    // `collection` from which the note was loaded, and remains valid for its lifetime.
+
+    struct note {
+        std::int64_t     id          = 0;
+        std::string_view guid;
+        std::int64_t     notetype_id = 0;
+        std::int64_t     modified    = 0;
+        std::int64_t     usn         = 0;
+        std::string_view tags;
+        std::string_view fields;
+        std::string_view sort_field;
+    };
+
+    // Row of the `cards` table. The meaning of `due` depends on `type`: a position for new cards,
+    // a day number for review cards and a timestamp for learning cards.
+
+    struct card {
+        std::int64_t id               = 0;
+        std::int64_t note_id          = 0;
+        std::int64_t deck_id          = 0;
+        std::int64_t ordinal          = 0;
+        std::int64_t modified         = 0;
+        std::int64_t usn              = 0;
+        std::int64_t type             = 0;
+        std::int64_t queue            = 0;
+        std::int64_t due              = 0;
+        std::int64_t interval         = 0;
+        std::int64_t ease_factor      = 0;
+        std::int64_t reps             = 0;
+        std::int64_t lapses           = 0;
+        std::int64_t left             = 0;
+        std::int64_t original_due     = 0;
+        std::int64_t original_deck_id = 0;
+        std::int64_t flags            = 0;
+    };
+
+    // Row of the `revlog` table, recording a single review. Negative intervals are in seconds and
+    // positive ones in days; `time` is the time taken to answer, in milliseconds.
+
+    struct review {
+        std::int64_t id            = 0;
+        std::int64_t card_id       = 0;
+        std::int64_t usn           = 0;
+        std::int64_t ease          = 0;
+        std::int64_t interval      = 0;
+        std::int64_t last_interval = 0;
+        std::int64_t ease_factor   = 0;
+        std::int64_t time          = 0;
+        std::int64_t type          = 0;
+    };
+
+    // Media file listed in a package's media manifest: `archive_name` is the name of the entry
+    // holding its data within the package, and `name` the file name by which notes refer to it.
+
+    struct media_entry {
+        std::string archive_name;
+        std::string name;
+    };
+}
+
+#endif
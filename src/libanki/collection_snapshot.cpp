@@ -0,0 +1,658 @@
+#include "collection_snapshot.hpp"
+
+#include "collection.hpp"
+#include "error.hpp"
+#include "impl/mapped_file.hpp"
+#include "impl/metadata_parser.hpp"
+#include "impl/replace_file.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A snapshot file consists of:
+//
+// * a header of `header_size` bytes, laid out as the `header_*` offsets below describe;
+// * a table locating each of `section_count` sections, in the order of `section`, as its offset
+//   from the start of the file and its size in bytes, each as 8 bytes; and
+// * the sections themselves, each starting at a multiple of 8 bytes.
+//
+// Unlike the search index, all integers (including those of the header) are in the byte order of
+// the host that saved the snapshot, so that columns can be read in place; the header records a
+// known value in that order, and a host of the other order rejects the snapshot.
+//
+// Each column is an array of the type of the corresponding member of `snapshot_notes`,
+// `snapshot_cards` or `snapshot_revlog`. Each table of strings is two sections: the offset of each
+// string within the text, as 8 bytes, followed by the end of the last; then the text itself.
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto magic      = std::uint32_t{0x4e534b41};  // "AKSN"
+        constexpr auto version    = std::uint32_t{1};
+        constexpr auto byte_order = std::uint32_t{0x01020304};
+
+        constexpr auto header_magic         = std::size_t{0};
+        constexpr auto header_version       = std::size_t{4};
+        constexpr auto header_byte_order    = std::size_t{8};
+        constexpr auto header_section_count = std::size_t{12};
+        constexpr auto header_created       = std::size_t{16};
+        constexpr auto header_source_size   = std::size_t{24};
+        constexpr auto header_source_mtime  = std::size_t{32};
+        constexpr auto header_file_size     = std::size_t{40};
+        constexpr auto header_size          = std::size_t{64};
+
+        constexpr auto section_entry_size = std::size_t{16};
+        constexpr auto section_alignment  = std::size_t{8};
+
+        enum class section : std::uint32_t {
+            note_id, note_notetype, note_modified, note_field_offsets, note_field_text,
+            note_tag_offsets, note_tags,
+            card_id, card_note_id, card_note, card_deck, card_ordinal, card_due, card_interval,
+            card_ease_factor, card_reps, card_lapses, card_left, card_queue, card_type,
+            review_id, review_card_id, review_interval, review_last_interval, review_time,
+            review_ease, review_type,
+            deck_ids, deck_name_offsets, deck_name_text,
+            notetype_ids, notetype_name_offsets, notetype_name_text,
+            tag_name_offsets, tag_name_text,
+            notetypes_json, decks_json, deck_configs_json,
+            count,
+        };
+
+        constexpr auto section_count = static_cast<std::size_t>(section::count);
+
+        [[noreturn]] void throw_invalid() {
+            throw error{error_code::invalid_snapshot};
+        }
+
+        template<typename t>
+        void store(std::byte* const dst, const t value) {
+            std::memcpy(dst, &value, sizeof(t));
+        }
+
+        template<typename t>
+        auto load(const std::byte* const src) -> t {
+
+            auto result = t{};
+            std::memcpy(&result, src, sizeof(t));
+
+            return result;
+        }
+
+        // Builds the bytes of a snapshot, with its sections appended in order.
+
+        class snapshot_builder {
+        public:
+
+            snapshot_builder()
+              : _bytes(header_size + section_count * section_entry_size) {
+            }
+
+            template<typename t>
+            void append(const section id, const std::vector<t>& column) {
+                append(id, column.data(), column.size() * sizeof(t));
+            }
+
+            void append(const section id, const std::string_view text) {
+                append(id, text.data(), text.size());
+            }
+
+            // Appends the table of the `count` strings that `string_at` returns, by index.
+
+            template<typename fn>
+            void append_strings(
+                const section offsets_id, const section text_id, const std::size_t count,
+                fn string_at) {
+
+                auto offsets = std::vector<std::uint64_t>{};
+                offsets.reserve(count + 1);
+
+                auto offset = std::uint64_t{0};
+                for (auto i = std::size_t{0}; i < count; ++i) {
+                    offsets.push_back(offset);
+                    offset += string_at(i).size();
+                }
+
+                offsets.push_back(offset);
+                append(offsets_id, offsets);
+
+                begin_section(text_id);
+                for (auto i = std::size_t{0}; i < count; ++i) {
+
+                    const auto text = string_at(i);
+                    const auto data = reinterpret_cast<const std::byte*>(text.data());
+
+                    _bytes.insert(_bytes.end(), data, data + text.size());
+                }
+
+                end_section(text_id);
+            }
+
+            auto finish(
+                const std::int64_t created, const std::uint64_t source_size,
+                const std::int64_t source_mtime) -> std::vector<std::byte> {
+
+                assert(_next == section_count);
+
+                const auto dst = _bytes.data();
+                store(dst + header_magic,         magic);
+                store(dst + header_version,       version);
+                store(dst + header_byte_order,    byte_order);
+                store(dst + header_section_count, static_cast<std::uint32_t>(section_count));
+                store(dst + header_created,       created);
+                store(dst + header_source_size,   source_size);
+                store(dst + header_source_mtime,  source_mtime);
+                store(dst + header_file_size,     static_cast<std::uint64_t>(_bytes.size()));
+
+                return std::move(_bytes);
+            }
+
+        private:
+
+            void append(const section id, const void* const data, const std::size_t size) {
+
+                const auto bytes = static_cast<const std::byte*>(data);
+
+                begin_section(id);
+                _bytes.insert(_bytes.end(), bytes, bytes + size);
+                end_section(id);
+            }
+
+            void begin_section(const section id) {
+
+                assert(static_cast<std::size_t>(id) == _next);
+                (void) id;
+
+                _bytes.resize((_bytes.size() + section_alignment - 1) & ~(section_alignment - 1));
+                _begin = _bytes.size();
+            }
+
+            void end_section(const section id) {
+
+                const auto entry = header_size + static_cast<std::size_t>(id) * section_entry_size;
+                store(_bytes.data() + entry,     static_cast<std::uint64_t>(_begin));
+                store(_bytes.data() + entry + 8,
+                    static_cast<std::uint64_t>(_bytes.size() - _begin));
+
+                ++_next;
+            }
+
+            std::vector<std::byte> _bytes;
+            std::size_t            _begin = 0;
+            std::size_t            _next  = 0;
+        };
+
+        // Locates the sections of a mapped snapshot whose header has been validated.
+
+        class snapshot_reader {
+        public:
+
+            snapshot_reader(const std::byte* const data, const std::size_t size)
+              : _data{data}, _size{size} {
+            }
+
+            auto bytes(const section id) const -> std::pair<const std::byte*, std::size_t> {
+
+                const auto index  = static_cast<std::size_t>(id);
+                const auto entry  = _data + header_size + index * section_entry_size;
+                const auto offset = load<std::uint64_t>(entry);
+                const auto size   = load<std::uint64_t>(entry + 8);
+
+                if (offset % section_alignment != 0 || offset > _size || size > _size - offset) {
+                    throw_invalid();
+                }
+
+                return {_data + offset, static_cast<std::size_t>(size)};
+            }
+
+            template<typename t>
+            auto column(const section id) const -> ksr::array_view<t> {
+
+                const auto [data, size] = bytes(id);
+                if (size % sizeof(t) != 0) {
+                    throw_invalid();
+                }
+
+                return {reinterpret_cast<const t*>(data), size / sizeof(t)};
+            }
+
+            // As `column()`, but requiring `count` elements.
+
+            template<typename t>
+            auto column(const section id, const std::size_t count) const -> ksr::array_view<t> {
+
+                const auto result = column<t>(id);
+                if (result.size() != count) {
+                    throw_invalid();
+                }
+
+                return result;
+            }
+
+            auto text(const section id) const -> std::string_view {
+
+                const auto [data, size] = bytes(id);
+                return {reinterpret_cast<const char*>(data), size};
+            }
+
+            // Reads a table of `count` strings, or of however many it holds if `count` is omitted.
+
+            auto strings(
+                const section offsets_id, const section text_id,
+                const std::optional<std::size_t> count = std::nullopt) const -> snapshot_strings {
+
+                const auto offsets = column<std::uint64_t>(offsets_id);
+                if (offsets.empty() || (count && offsets.size() != *count + 1)) {
+                    throw_invalid();
+                }
+
+                return {offsets, text(text_id)};
+            }
+
+        private:
+
+            const std::byte* _data;
+            std::size_t      _size;
+        };
+
+        template<typename t>
+        auto to_vector(const ksr::array_view<t> column) -> std::vector<t> {
+            return std::vector<t>(column.begin(), column.end());
+        }
+
+        auto to_vector(const snapshot_strings& strings) -> std::vector<std::string_view> {
+
+            auto result = std::vector<std::string_view>{};
+            result.reserve(strings.size());
+
+            for (auto i = std::size_t{0}; i < strings.size(); ++i) {
+                result.push_back(strings[i]);
+            }
+
+            return result;
+        }
+
+        // Checks that every code of `codes` is less than `count`, or is `no_row` if `optional`.
+
+        void check_codes(
+            const std::vector<std::uint32_t>& codes, const std::size_t count,
+            const bool optional = false) {
+
+            for (const auto code : codes) {
+                if (code >= count && !(optional && code == no_row)) {
+                    throw_invalid();
+                }
+            }
+        }
+
+        void check_ordered(const std::vector<std::int64_t>& ids) {
+
+            if (std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<>{}) != ids.end()) {
+                throw_invalid();
+            }
+        }
+
+        // Size of the file at `src`, and its modification time in nanoseconds since the epoch.
+
+        auto stamp_of(const path& src) -> std::pair<std::uint64_t, std::int64_t> {
+
+            struct stat info;
+            if (::stat(src.c_str(), &info) != 0) {
+                throw error{error_code::system_error};
+            }
+
+            const auto mtime = std::int64_t{info.st_mtim.tv_sec} * 1'000'000'000
+                + info.st_mtim.tv_nsec;
+
+            return {static_cast<std::uint64_t>(info.st_size), mtime};
+        }
+    }
+
+    // Columns and metadata taken from the mapping on first use, each once however many threads
+    // ask for it at once; an attempt that throws is made afresh by the next.
+
+    struct collection_snapshot::loaded {
+        std::once_flag           columns_once;
+        collection_columns       columns;
+        std::once_flag           revlog_once;
+        review_columns           revlog;
+        std::once_flag           notetypes_once;
+        std::vector<notetype>    notetypes;
+        std::once_flag           decks_once;
+        std::vector<deck>        decks;
+        std::once_flag           deck_configs_once;
+        std::vector<deck_config> deck_configs;
+    };
+
+    auto snapshot_strings::operator[](const std::size_t i) const -> std::string_view {
+
+        assert(i < size());
+
+        const auto begin = _offsets[i];
+        const auto end   = _offsets[i + 1];
+
+        if (begin > end || end > _text.size()) {
+            throw_invalid();
+        }
+
+        return _text.substr(
+            static_cast<std::size_t>(begin), static_cast<std::size_t>(end - begin));
+    }
+
+    void collection_snapshot::save(const collection& collection, const path& dst) {
+        write(collection, dst, 0, 0);
+    }
+
+    auto collection_snapshot::open(const path& src) -> collection_snapshot {
+
+        auto result = collection_snapshot{};
+        result._file = std::make_unique<impl::mapped_file>(src);
+        result.attach(result._file->data(), result._file->size());
+        result._loaded = std::make_unique<loaded>();
+
+        return result;
+    }
+
+    auto collection_snapshot::open_or_create(
+        const path& package, const path& snapshot, const import_options& options)
+        -> collection_snapshot {
+
+        const auto [size, mtime] = stamp_of(package);
+
+        // A snapshot that is missing, unreadable or stale is simply replaced.
+
+        try {
+
+            auto result = open(snapshot);
+            if (result._source_size == size && result._source_mtime == mtime) {
+                return result;
+            }
+        }
+        catch (const error& ex) {
+
+            const auto code = ex.code();
+            if (code != error_code::system_error && code != error_code::invalid_snapshot) {
+                throw;
+            }
+        }
+
+        write(collection{package, options}, snapshot, size, mtime);
+        return open(snapshot);
+    }
+
+    collection_snapshot::~collection_snapshot() = default;
+
+    collection_snapshot::collection_snapshot(collection_snapshot&& rhs) noexcept = default;
+
+    auto collection_snapshot::operator=(collection_snapshot&& rhs) noexcept
+        -> collection_snapshot& = default;
+
+    auto collection_snapshot::deck_ids() const noexcept -> ksr::array_view<std::int64_t> {
+        return _deck_ids;
+    }
+
+    auto collection_snapshot::notetype_ids() const noexcept -> ksr::array_view<std::int64_t> {
+        return _notetype_ids;
+    }
+
+    auto collection_snapshot::columns() const -> const collection_columns& {
+
+        std::call_once(_loaded->columns_once, [this] {
+
+            auto result = collection_columns{};
+
+            auto& notes = result.notes;
+            notes.id          = to_vector(_notes.id);
+            notes.notetype    = to_vector(_notes.notetype);
+            notes.modified    = to_vector(_notes.modified);
+            notes.fields      = to_vector(_notes.fields);
+            notes.tag_offsets = to_vector(_notes.tag_offsets);
+            notes.tags        = to_vector(_notes.tags);
+
+            auto& cards = result.cards;
+            cards.id          = to_vector(_cards.id);
+            cards.note_id     = to_vector(_cards.note_id);
+            cards.note        = to_vector(_cards.note);
+            cards.deck        = to_vector(_cards.deck);
+            cards.ordinal     = to_vector(_cards.ordinal);
+            cards.due         = to_vector(_cards.due);
+            cards.interval    = to_vector(_cards.interval);
+            cards.ease_factor = to_vector(_cards.ease_factor);
+            cards.reps        = to_vector(_cards.reps);
+            cards.lapses      = to_vector(_cards.lapses);
+            cards.left        = to_vector(_cards.left);
+            cards.queue       = to_vector(_cards.queue);
+            cards.type        = to_vector(_cards.type);
+
+            result.deck_ids       = to_vector(_deck_ids);
+            result.deck_names     = to_vector(_deck_names);
+            result.notetype_ids   = to_vector(_notetype_ids);
+            result.notetype_names = to_vector(_notetype_names);
+
+            // Tags were saved in order of ID, so are interned afresh in the same order; a name
+            // saved twice would shift the IDs of those after it.
+
+            for (auto i = std::size_t{0}; i < _tags.size(); ++i) {
+                if (result.tags.intern(_tags[i]) != i) {
+                    throw_invalid();
+                }
+            }
+
+            check_ordered(notes.id);
+            check_ordered(cards.id);
+            check_codes(notes.notetype, result.notetype_ids.size());
+            check_codes(notes.tags, result.tags.size());
+            check_codes(cards.note, notes.size(), true);
+            check_codes(cards.deck, result.deck_ids.size());
+
+            const auto& offsets = notes.tag_offsets;
+            if (offsets.front() != 0 || offsets.back() != notes.tags.size()
+                || !std::is_sorted(offsets.begin(), offsets.end())) {
+
+                throw_invalid();
+            }
+
+            _loaded->columns = std::move(result);
+        });
+
+        return _loaded->columns;
+    }
+
+    auto collection_snapshot::revlog_columns() const -> const review_columns& {
+
+        std::call_once(_loaded->revlog_once, [this] {
+
+            auto result = review_columns{};
+            result.id            = to_vector(_revlog.id);
+            result.card_id       = to_vector(_revlog.card_id);
+            result.interval      = to_vector(_revlog.interval);
+            result.last_interval = to_vector(_revlog.last_interval);
+            result.time          = to_vector(_revlog.time);
+            result.ease          = to_vector(_revlog.ease);
+            result.type          = to_vector(_revlog.type);
+
+            if (!std::is_sorted(result.id.begin(), result.id.end())) {
+                throw_invalid();
+            }
+
+            _loaded->revlog = std::move(result);
+        });
+
+        return _loaded->revlog;
+    }
+
+    auto collection_snapshot::notetypes() const -> const std::vector<notetype>& {
+
+        std::call_once(_loaded->notetypes_once, [this] {
+            _loaded->notetypes = impl::parse_notetypes(_notetypes_json);
+        });
+
+        return _loaded->notetypes;
+    }
+
+    auto collection_snapshot::decks() const -> const std::vector<deck>& {
+
+        std::call_once(_loaded->decks_once, [this] {
+            _loaded->decks = impl::parse_decks(_decks_json);
+        });
+
+        return _loaded->decks;
+    }
+
+    auto collection_snapshot::deck_configs() const -> const std::vector<deck_config>& {
+
+        std::call_once(_loaded->deck_configs_once, [this] {
+            _loaded->deck_configs = impl::parse_deck_configs(_deck_configs_json);
+        });
+
+        return _loaded->deck_configs;
+    }
+
+    void collection_snapshot::write(
+        const collection& collection, const path& dst, const std::uint64_t source_size,
+        const std::int64_t source_mtime) {
+
+        const auto& columns = collection.columns();
+        const auto& notes   = columns.notes;
+        const auto& cards   = columns.cards;
+        const auto& revlog  = collection.revlog_columns();
+
+        auto builder = snapshot_builder{};
+
+        builder.append(section::note_id,       notes.id);
+        builder.append(section::note_notetype, notes.notetype);
+        builder.append(section::note_modified, notes.modified);
+        builder.append_strings(section::note_field_offsets, section::note_field_text, notes.size(),
+            [&notes] (std::size_t i) { return notes.fields[i]; });
+        builder.append(section::note_tag_offsets, notes.tag_offsets);
+        builder.append(section::note_tags,        notes.tags);
+
+        builder.append(section::card_id,          cards.id);
+        builder.append(section::card_note_id,     cards.note_id);
+        builder.append(section::card_note,        cards.note);
+        builder.append(section::card_deck,        cards.deck);
+        builder.append(section::card_ordinal,     cards.ordinal);
+        builder.append(section::card_due,         cards.due);
+        builder.append(section::card_interval,    cards.interval);
+        builder.append(section::card_ease_factor, cards.ease_factor);
+        builder.append(section::card_reps,        cards.reps);
+        builder.append(section::card_lapses,      cards.lapses);
+        builder.append(section::card_left,        cards.left);
+        builder.append(section::card_queue,       cards.queue);
+        builder.append(section::card_type,        cards.type);
+
+        builder.append(section::review_id,            revlog.id);
+        builder.append(section::review_card_id,       revlog.card_id);
+        builder.append(section::review_interval,      revlog.interval);
+        builder.append(section::review_last_interval, revlog.last_interval);
+        builder.append(section::review_time,          revlog.time);
+        builder.append(section::review_ease,          revlog.ease);
+        builder.append(section::review_type,          revlog.type);
+
+        builder.append(section::deck_ids, columns.deck_ids);
+        builder.append_strings(section::deck_name_offsets, section::deck_name_text,
+            columns.deck_names.size(),
+            [&columns] (std::size_t i) { return columns.deck_names[i]; });
+
+        builder.append(section::notetype_ids, columns.notetype_ids);
+        builder.append_strings(section::notetype_name_offsets, section::notetype_name_text,
+            columns.notetype_names.size(),
+            [&columns] (std::size_t i) { return columns.notetype_names[i]; });
+
+        builder.append_strings(section::tag_name_offsets, section::tag_name_text,
+            columns.tags.size(), [&columns] (std::size_t i) {
+                return columns.tags[static_cast<ksr::string_pool::id_type>(i)];
+            });
+
+        builder.append(section::notetypes_json,    collection.notetypes_json());
+        builder.append(section::decks_json,        collection.decks_json());
+        builder.append(section::deck_configs_json, collection.deck_configs_json());
+
+        const auto bytes = builder.finish(collection.created(), source_size, source_mtime);
+        impl::replace_file(dst, bytes.data(), bytes.size());
+    }
+
+    void collection_snapshot::attach(const std::byte* const data, const std::size_t size) {
+
+        const auto table_end = header_size + section_count * section_entry_size;
+
+        if (size < table_end || load<std::uint32_t>(data + header_magic) != magic
+            || load<std::uint32_t>(data + header_version) != version
+            || load<std::uint32_t>(data + header_byte_order) != byte_order
+            || load<std::uint32_t>(data + header_section_count) != section_count
+            || load<std::uint64_t>(data + header_file_size) != size) {
+
+            throw_invalid();
+        }
+
+        _created      = load<std::int64_t>(data + header_created);
+        _source_size  = load<std::uint64_t>(data + header_source_size);
+        _source_mtime = load<std::int64_t>(data + header_source_mtime);
+
+        // Every section is bounds-checked, and the columns of each table checked to be of equal
+        // length, without reading the columns themselves.
+
+        const auto reader = snapshot_reader{data, size};
+
+        auto& notes = _notes;
+        notes.id = reader.column<std::int64_t>(section::note_id);
+
+        const auto note_count = notes.id.size();
+        notes.notetype    = reader.column<std::uint32_t>(section::note_notetype, note_count);
+        notes.modified    = reader.column<std::int64_t>(section::note_modified, note_count);
+        notes.fields      = reader.strings(
+            section::note_field_offsets, section::note_field_text, note_count);
+        notes.tag_offsets = reader.column<std::uint32_t>(section::note_tag_offsets, note_count + 1);
+        notes.tags        = reader.column<std::uint32_t>(section::note_tags);
+
+        auto& cards = _cards;
+        cards.id = reader.column<std::int64_t>(section::card_id);
+
+        const auto card_count = cards.id.size();
+        cards.note_id     = reader.column<std::int64_t>(section::card_note_id, card_count);
+        cards.note        = reader.column<std::uint32_t>(section::card_note, card_count);
+        cards.deck        = reader.column<std::uint32_t>(section::card_deck, card_count);
+        cards.ordinal     = reader.column<std::uint16_t>(section::card_ordinal, card_count);
+        cards.due         = reader.column<std::int64_t>(section::card_due, card_count);
+        cards.interval    = reader.column<std::int32_t>(section::card_interval, card_count);
+        cards.ease_factor = reader.column<std::int32_t>(section::card_ease_factor, card_count);
+        cards.reps        = reader.column<std::int32_t>(section::card_reps, card_count);
+        cards.lapses      = reader.column<std::int32_t>(section::card_lapses, card_count);
+        cards.left        = reader.column<std::int32_t>(section::card_left, card_count);
+        cards.queue       = reader.column<std::int8_t>(section::card_queue, card_count);
+        cards.type        = reader.column<std::int8_t>(section::card_type, card_count);
+
+        auto& revlog = _revlog;
+        revlog.id = reader.column<std::int64_t>(section::review_id);
+
+        const auto review_count = revlog.id.size();
+        revlog.card_id       = reader.column<std::int64_t>(section::review_card_id, review_count);
+        revlog.interval      = reader.column<std::int32_t>(section::review_interval, review_count);
+        revlog.last_interval = reader.column<std::int32_t>(
+            section::review_last_interval, review_count);
+        revlog.time          = reader.column<std::uint32_t>(section::review_time, review_count);
+        revlog.ease          = reader.column<std::uint8_t>(section::review_ease, review_count);
+        revlog.type          = reader.column<std::uint8_t>(section::review_type, review_count);
+
+        _deck_ids       = reader.column<std::int64_t>(section::deck_ids);
+        _deck_names     = reader.strings(
+            section::deck_name_offsets, section::deck_name_text, _deck_ids.size());
+        _notetype_ids   = reader.column<std::int64_t>(section::notetype_ids);
+        _notetype_names = reader.strings(
+            section::notetype_name_offsets, section::notetype_name_text, _notetype_ids.size());
+        _tags           = reader.strings(section::tag_name_offsets, section::tag_name_text);
+
+        _notetypes_json    = reader.text(section::notetypes_json);
+        _decks_json        = reader.text(section::decks_json);
+        _deck_configs_json = reader.text(section::deck_configs_json);
+    }
+}
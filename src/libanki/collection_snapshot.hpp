@@ -0,0 +1,216 @@
+#ifndef LIBANKI_COLLECTION_SNAPSHOT_HPP
+#define LIBANKI_COLLECTION_SNAPSHOT_HPP
+
+#include "collection_columns.hpp"
+#include "collection_metadata.hpp"
+#include "filesystem.hpp"
+#include "import_options.hpp"
+
+#include "ksr/array_view.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+
+    namespace impl {
+        class mapped_file;
+    }
+
+    // Strings stored end to end, string `i` running from `offsets[i]` to `offsets[i + 1]` within
+    // `text`. Throws `anki::error` with `error_code::invalid_snapshot` on access to a string whose
+    // offsets are out of range, as only a corrupt snapshot has.
+
+    class snapshot_strings {
+    public:
+
+        snapshot_strings() = default;
+
+        snapshot_strings(ksr::array_view<std::uint64_t> offsets, std::string_view text)
+          : _offsets{offsets}, _text{text} {
+        }
+
+        auto size() const noexcept -> std::size_t {
+            return _offsets.empty() ? 0 : _offsets.size() - 1;
+        }
+
+        auto operator[](std::size_t i) const -> std::string_view;
+
+    private:
+
+        ksr::array_view<std::uint64_t> _offsets;
+        std::string_view               _text;
+    };
+
+    // Views of the columns of a snapshot, with the members and meanings of `note_columns`,
+    // `card_columns` and `review_columns`.
+
+    struct snapshot_notes {
+
+        ksr::array_view<std::int64_t>  id;
+        ksr::array_view<std::uint32_t> notetype;
+        ksr::array_view<std::int64_t>  modified;
+        snapshot_strings               fields;
+        ksr::array_view<std::uint32_t> tag_offsets;
+        ksr::array_view<std::uint32_t> tags;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+    };
+
+    struct snapshot_cards {
+
+        ksr::array_view<std::int64_t>  id;
+        ksr::array_view<std::int64_t>  note_id;
+        ksr::array_view<std::uint32_t> note;
+        ksr::array_view<std::uint32_t> deck;
+        ksr::array_view<std::uint16_t> ordinal;
+        ksr::array_view<std::int64_t>  due;
+        ksr::array_view<std::int32_t>  interval;
+        ksr::array_view<std::int32_t>  ease_factor;
+        ksr::array_view<std::int32_t>  reps;
+        ksr::array_view<std::int32_t>  lapses;
+        ksr::array_view<std::int32_t>  left;
+        ksr::array_view<std::int8_t>   queue;
+        ksr::array_view<std::int8_t>   type;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+    };
+
+    struct snapshot_revlog {
+
+        ksr::array_view<std::int64_t>  id;
+        ksr::array_view<std::int64_t>  card_id;
+        ksr::array_view<std::int32_t>  interval;
+        ksr::array_view<std::int32_t>  last_interval;
+        ksr::array_view<std::uint32_t> time;
+        ksr::array_view<std::uint8_t>  ease;
+        ksr::array_view<std::uint8_t>  type;
+
+        auto size() const noexcept -> std::size_t { return id.size(); }
+    };
+
+    // Snapshot of a collection in libanki's own binary format, holding its columns (as
+    // `collection::columns()` and `collection::revlog_columns()` load them), its creation time and
+    // its metadata JSON. Every column is stored as an array in the byte order of the host, aligned
+    // for its type, so that `notes()`, `cards()`, `revlog()` and the dictionaries view a mapped
+    // snapshot in place: opening one reads only its header, and columns are paged in from disk as
+    // they are first scanned. `columns()` and `revlog_columns()`, by contrast, copy.
+    //
+    // Rows and codes referring from one column to another are as saved, and are not validated
+    // when a snapshot is opened, only by `columns()`; string offsets are validated as strings are
+    // read. A snapshot may be read from several threads at once.
+
+    class collection_snapshot {
+    public:
+
+        // Saves a snapshot of `collection` to `dst`, replacing any existing file. Throws
+        // `anki::error` if the collection cannot be read, or with `error_code::system_error` if
+        // the snapshot cannot be written, in which case `dst` is left as it was.
+
+        static void save(const collection& collection, const path& dst);
+
+        // Maps the snapshot saved at `src`. Throws `anki::error` with `error_code::system_error`
+        // if the file cannot be mapped, or `error_code::invalid_snapshot` if it is not a snapshot
+        // of this version saved on a host of the same byte order.
+
+        static auto open(const path& src) -> collection_snapshot;
+
+        // Opens the snapshot at `snapshot` if it was saved from the package at `package` as the
+        // package now is (by its size and modification time); otherwise opens the package, saves
+        // a snapshot of its collection to `snapshot` and opens that. Throws `anki::error` as the
+        // `collection` constructor and `save()` do.
+
+        static auto open_or_create(
+            const path& package, const path& snapshot, const import_options& options = {})
+            -> collection_snapshot;
+
+        ~collection_snapshot();
+
+        collection_snapshot(collection_snapshot&& rhs) noexcept;
+        auto operator=(collection_snapshot&& rhs) noexcept -> collection_snapshot&;
+
+        collection_snapshot(const collection_snapshot&) = delete;
+        auto operator=(const collection_snapshot&) -> collection_snapshot& = delete;
+
+        auto created() const noexcept -> std::int64_t { return _created; }
+
+        auto notetypes_json()    const noexcept -> std::string_view { return _notetypes_json; }
+        auto decks_json()        const noexcept -> std::string_view { return _decks_json; }
+        auto deck_configs_json() const noexcept -> std::string_view { return _deck_configs_json; }
+
+        auto notes()  const noexcept -> const snapshot_notes&  { return _notes; }
+        auto cards()  const noexcept -> const snapshot_cards&  { return _cards; }
+        auto revlog() const noexcept -> const snapshot_revlog& { return _revlog; }
+
+        // Dictionaries of the deck and note type codes of `cards()` and `notes()`, and of the tag
+        // IDs of `notes()`, as in `collection_columns`.
+
+        auto deck_ids()     const noexcept -> ksr::array_view<std::int64_t>;
+        auto notetype_ids() const noexcept -> ksr::array_view<std::int64_t>;
+
+        auto deck_names()     const noexcept -> const snapshot_strings& { return _deck_names; }
+        auto notetype_names() const noexcept -> const snapshot_strings& { return _notetype_names; }
+        auto tags()           const noexcept -> const snapshot_strings& { return _tags; }
+
+        // The columns as `collection::columns()` and `collection::revlog_columns()` give them, for
+        // consumers taking those, such as `scheduler`, `render_cards()`, `revlog_stats` and the
+        // indexes. On first use, every column is copied out of the mapping into memory kept for
+        // the life of the snapshot; text stays in place, but each string takes a view. This costs
+        // a full read of the columns and about as much memory again as they take on disk, so
+        // prefer the views above where they will do. Since consumers index by the columns freely,
+        // rows, codes and tag IDs are then checked to refer within their tables, and IDs to be in
+        // order; throws `anki::error` with `error_code::invalid_snapshot` if they do not.
+
+        auto columns()        const -> const collection_columns&;
+        auto revlog_columns() const -> const review_columns&;
+
+        // The metadata, parsed on first use as `collection::notetypes()` and so on parse it.
+        // Throws `anki::error` if its JSON is malformed.
+
+        auto notetypes()    const -> const std::vector<notetype>&;
+        auto decks()        const -> const std::vector<deck>&;
+        auto deck_configs() const -> const std::vector<deck_config>&;
+
+    private:
+
+        struct loaded;
+
+        collection_snapshot() = default;
+
+        // Saves as `save()` does, recording the size and modification time (in nanoseconds since
+        // the epoch) of the package the collection was read from.
+
+        static void write(
+            const collection& collection, const path& dst, std::uint64_t source_size,
+            std::int64_t source_mtime);
+
+        void attach(const std::byte* data, std::size_t size);
+
+        std::unique_ptr<impl::mapped_file> _file;
+        std::unique_ptr<loaded>            _loaded;
+
+        std::int64_t     _created       = 0;
+        std::uint64_t    _source_size   = 0;
+        std::int64_t     _source_mtime  = 0;
+        std::string_view _notetypes_json;
+        std::string_view _decks_json;
+        std::string_view _deck_configs_json;
+
+        snapshot_notes  _notes;
+        snapshot_cards  _cards;
+        snapshot_revlog _revlog;
+
+        ksr::array_view<std::int64_t> _deck_ids;
+        snapshot_strings              _deck_names;
+        ksr::array_view<std::int64_t> _notetype_ids;
+        snapshot_strings              _notetype_names;
+        snapshot_strings              _tags;
+    };
+}
+
+#endif
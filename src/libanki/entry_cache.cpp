@@ -0,0 +1,160 @@
+#include "entry_cache.hpp"
+
+#include <utility>
+
+namespace anki {
+
+    entry_cache::entry_cache(const std::size_t byte_budget)
+      : _budget{byte_budget} {
+    }
+
+    auto entry_cache::get(
+        const std::string& name, const std::function<std::vector<std::byte>()>& load)
+        -> shared_entry {
+
+        {
+            const auto lock = std::shared_lock{_mutex};
+
+            const auto it = _slots.find(name);
+            if (it != _slots.end()) {
+
+                it->second.referenced.store(true, std::memory_order_relaxed);
+                _hits.fetch_add(1, std::memory_order_relaxed);
+
+                return it->second.data;
+            }
+        }
+
+        // A miss claims the load of its entry unless another thread already has. The entry is
+        // looked for again before claiming it, in case a load finished since the check above.
+
+        auto promise = std::promise<shared_entry>{};
+        auto pending = std::shared_future<shared_entry>{};
+
+        {
+            const auto loading_lock = std::lock_guard{_loading_mutex};
+
+            const auto loading = _loading.find(name);
+            if (loading != _loading.end()) {
+                pending = loading->second;
+            }
+            else {
+
+                const auto lock = std::shared_lock{_mutex};
+
+                const auto it = _slots.find(name);
+                if (it != _slots.end()) {
+
+                    it->second.referenced.store(true, std::memory_order_relaxed);
+                    _hits.fetch_add(1, std::memory_order_relaxed);
+
+                    return it->second.data;
+                }
+
+                _loading.emplace(name, promise.get_future().share());
+            }
+        }
+
+        if (pending.valid()) {
+
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return pending.get();
+        }
+
+        _misses.fetch_add(1, std::memory_order_relaxed);
+
+        // The entry is cached before the load is released, so that a thread arriving in between
+        // finds one or the other. If loading or caching it fails, the load is released with the
+        // error, which is passed to the threads waiting for it, and the next miss loads it afresh.
+
+        auto data = shared_entry{};
+
+        try {
+            data = std::make_shared<const std::vector<std::byte>>(load());
+            insert(name, data);
+        }
+        catch (...) {
+
+            promise.set_exception(std::current_exception());
+
+            const auto loading_lock = std::lock_guard{_loading_mutex};
+            _loading.erase(name);
+
+            throw;
+        }
+
+        const auto loading_lock = std::lock_guard{_loading_mutex};
+        _loading.erase(name);
+        promise.set_value(data);
+
+        return data;
+    }
+
+    auto entry_cache::stats() const -> entry_cache_stats {
+
+        const auto lock = std::shared_lock{_mutex};
+
+        auto result = entry_cache_stats{};
+        result.hits        = _hits.load(std::memory_order_relaxed);
+        result.misses      = _misses.load(std::memory_order_relaxed);
+        result.evictions   = _evictions.load(std::memory_order_relaxed);
+        result.size        = _size;
+        result.entry_count = _slots.size();
+
+        return result;
+    }
+
+    void entry_cache::clear() {
+
+        const auto lock = std::lock_guard{_mutex};
+
+        _evictions.fetch_add(_slots.size(), std::memory_order_relaxed);
+        _slots.clear();
+        _clock.clear();
+        _size = 0;
+    }
+
+    void entry_cache::insert(const std::string& name, const shared_entry& data) {
+
+        const auto size = data->size();
+        if (size > _budget) {
+            return;
+        }
+
+        const auto lock = std::lock_guard{_mutex};
+
+        // The hand is the front of `_clock`: an entry given a second chance moves to the back.
+        // Every bit is cleared by one pass, so the sweep evicts something within two.
+
+        while (_size + size > _budget) {
+
+            auto victim = std::move(_clock.front());
+            _clock.pop_front();
+
+            auto& candidate = _slots.find(victim)->second;
+            if (candidate.referenced.exchange(false, std::memory_order_relaxed)) {
+                _clock.push_back(std::move(victim));
+                continue;
+            }
+
+            _size -= candidate.data->size();
+            _slots.erase(victim);
+            _evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // The name joins the clock first, so that if the slot cannot then be added, undoing that
+        // leaves the cache as it was.
+
+        _clock.push_back(name);
+
+        try {
+            _slots[name].data = data;
+        }
+        catch (...) {
+            _clock.pop_back();
+            throw;
+        }
+
+        _size += size;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef LIBANKI_ENTRY_CACHE_HPP
+#define LIBANKI_ENTRY_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace anki {
+
+    // Decompressed contents of an archive entry, shared between the cache holding it and every
+    // reader of it. The contents are immutable, and outlive their eviction from the cache for as
+    // long as any reader holds them.
+
+    using shared_entry = std::shared_ptr<const std::vector<std::byte>>;
+
+    // Counters of an `entry_cache`. A lookup that finds its entry being loaded by another thread
+    // waits for that load and counts as a hit, since it decompresses nothing itself.
+
+    struct entry_cache_stats {
+        std::uint64_t hits        = 0;
+        std::uint64_t misses      = 0;
+        std::uint64_t evictions   = 0;
+        std::size_t   size        = 0; // Bytes of entry data held
+        std::size_t   entry_count = 0;
+    };
+
+    // Cache of decompressed archive entries, keyed by entry name and bounded by the total size of
+    // the entries it holds; attached to an archive by `zip_archive::set_cache()` or
+    // `shared_zip_archive::set_cache()`, and read through their `read_shared()`. Since entries
+    // are keyed by name alone, a cache should be attached to only one archive.
+    //
+    // Entries are evicted by the CLOCK policy: each entry has a reference bit, set by every hit,
+    // and eviction sweeps the entries in order of insertion, clearing set bits and evicting the
+    // first entry found without one. A hit therefore takes only a shared lock, sets a bit and
+    // copies a `shared_ptr`, and lookups from several threads do not contend for an exclusive
+    // lock as they would to reorder an LRU list. Concurrent misses for the same entry load it
+    // once (single flight): the first thread loads it and the others wait for its result.
+    //
+    // Entries larger than the whole budget are returned without being cached. A cache may be used
+    // from several threads at once.
+
+    class entry_cache {
+    public:
+
+        explicit entry_cache(std::size_t byte_budget);
+
+        entry_cache(const entry_cache&) = delete;
+        auto operator=(const entry_cache&) -> entry_cache& = delete;
+
+        // Returns the entry named `name`, calling `load` to produce its contents if it is not
+        // cached. Any exception thrown by `load`, or in caching what it returns, is rethrown to
+        // this caller and to any caller waiting for the same load, and nothing is cached; a later
+        // call loads the entry afresh.
+
+        auto get(const std::string& name, const std::function<std::vector<std::byte>()>& load)
+            -> shared_entry;
+
+        auto stats() const -> entry_cache_stats;
+
+        // Evicts every entry. Loads in progress complete, but their results are still cached.
+
+        void clear();
+
+    private:
+
+        struct slot {
+            shared_entry              data;
+            mutable std::atomic<bool> referenced{false};
+        };
+
+        void insert(const std::string& name, const shared_entry& data);
+
+        std::size_t _budget;
+
+        // Guarded by `_mutex`, which hits take shared and everything else exclusively: the cached
+        // entries, their names in order of insertion (the clock), and the total size of their
+        // data. Loads in progress are guarded by `_loading_mutex`.
+
+        mutable std::shared_mutex                _mutex;
+        std::unordered_map<std::string, slot>    _slots;
+        std::deque<std::string>                  _clock;
+        std::size_t                              _size = 0;
+
+        std::mutex                                                      _loading_mutex;
+        std::unordered_map<std::string, std::shared_future<shared_entry>> _loading;
+
+        std::atomic<std::uint64_t> _hits{0};
+        std::atomic<std::uint64_t> _misses{0};
+        std::atomic<std::uint64_t> _evictions{0};
+    };
+}
+
+#endif
@@ -37,6 +37,13 @@
 
 #define LIBANKI_ERROR_CODES_X \
     X(internal_error) \
+    X(invalid_collection) \
+    X(invalid_media_manifest) \
+    X(invalid_review_journal) \
+    X(invalid_search_index) \
+    X(invalid_snapshot) \
+    X(invalid_tag_query) \
+    X(sqlite_error) \
     X(system_error) \
     X(unsupported_apkg_version) \
     LIBANKI_ERROR_CODES_ZIP_X
@@ -0,0 +1,463 @@
+#include "extraction_pipeline.hpp"
+
+#include "error.hpp"
+#include "impl/crc32.hpp"
+#include "impl/zip_format.hpp"
+#include "impl/zlib/inflater.hpp"
+#include "zip_archive.hpp"
+#include "zip_entry_info.hpp"
+#include "zip_file.hpp"
+
+#include "ksr/narrow_cast.hpp"
+#include "ksr/spsc_queue.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace anki {
+
+    namespace {
+
+        // Unit of data passed between pipeline stages. `data` is allocated once, when the owning
+        // `stage_link` is constructed; `size` counts the bytes of it that are currently populated.
+        // `last` marks the final block of the entry, which may be empty.
+
+        struct block {
+            std::vector<std::byte> data;
+            std::size_t            size = 0;
+            bool                   last = false;
+        };
+
+        using block_queue = ksr::spsc_queue<block*>;
+
+        // Connection between two adjacent pipeline stages, owning a fixed pool of blocks. Blocks
+        // travel downstream through `filled` and return upstream through `recycled`, so that each
+        // queue has exactly one producer and one consumer and no block is ever reallocated.
+
+        class stage_link {
+        public:
+
+            stage_link(std::size_t block_count, std::size_t block_size)
+              : filled{block_count}, recycled{block_count} {
+
+                _blocks.reserve(block_count);
+                for (auto i = std::size_t{0}; i < block_count; ++i) {
+
+                    auto& new_block = _blocks.emplace_back(std::make_unique<block>());
+                    new_block->data.resize(block_size);
+
+                    [[maybe_unused]] const auto pushed = recycled.try_push(new_block.get());
+                    assert(pushed);
+                }
+            }
+
+            block_queue filled;
+            block_queue recycled;
+
+        private:
+
+            std::vector<std::unique_ptr<block>> _blocks;
+        };
+
+        // Cancellation and error state shared between all stages of a pipeline. The first error
+        // reported is retained for rethrowing on the calling thread; any error aborts every stage.
+
+        class pipeline_state {
+        public:
+
+            auto aborted() const noexcept -> bool {
+                return _aborted.load(std::memory_order_acquire);
+            }
+
+            void fail(std::exception_ptr error) noexcept {
+
+                const auto lock = std::lock_guard{_mutex};
+                if (!_error) {
+                    _error = std::move(error);
+                }
+
+                _aborted.store(true, std::memory_order_release);
+            }
+
+            void rethrow_if_failed() const {
+
+                const auto lock = std::lock_guard{_mutex};
+                if (_error) {
+                    std::rethrow_exception(_error);
+                }
+            }
+
+        private:
+
+            std::atomic<bool>  _aborted{false};
+            mutable std::mutex _mutex;
+            std::exception_ptr _error;
+        };
+
+        // Accumulates the CRC and size of an entry's decompressed data and checks them against the
+        // values recorded in `info`. Data running past the recorded size is rejected as soon as it
+        // arrives, so that an entry with a falsified size cannot grow without bound before it is
+        // checked. The CRC is neither computed nor checked unless `verify_crc` is set.
+
+        class entry_verifier {
+        public:
+
+            entry_verifier(const zip_entry_info& info, bool verify_crc)
+              : _info{info}, _verify_crc{verify_crc} {
+            }
+
+            void update(const std::byte* data, std::size_t size) {
+
+                if (size > _info.size - _size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                if (_verify_crc) {
+                    _crc = impl::crc32(_crc, data, size);
+                }
+
+                _size += size;
+            }
+
+            void check() const {
+
+                if (_size != _info.size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                if (_verify_crc && _crc != _info.crc) {
+                    throw error{error_code::zip_bad_crc};
+                }
+            }
+
+        private:
+
+            const zip_entry_info& _info;
+            bool                  _verify_crc;
+            std::uint32_t         _crc  = 0;
+            std::uint64_t         _size = 0;
+        };
+
+        // Blocks until a value can be popped from `queue`, returning it, or until the pipeline is
+        // aborted, returning `nullptr`. Spins briefly before backing off to short sleeps, since a
+        // stage waiting on I/O may wait for some time.
+
+        auto wait_pop(block_queue& queue, const pipeline_state& state) -> block* {
+
+            static constexpr auto spin_limit = 64;           // Arbitrary; not profiled
+            static constexpr auto backoff    = std::chrono::microseconds{50};
+
+            for (auto spins = 0; !state.aborted(); ++spins) {
+
+                if (const auto popped = queue.try_pop()) {
+                    return *popped;
+                }
+
+                if (spins < spin_limit) {
+                    std::this_thread::yield();
+                }
+                else {
+                    std::this_thread::sleep_for(backoff);
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Pushes a block onto a queue of a `stage_link`. Each queue can hold every block of its
+        // link, so this never needs to wait.
+
+        void push(block_queue& queue, block* const value) {
+
+            [[maybe_unused]] const auto pushed = queue.try_push(value);
+            assert(pushed);
+        }
+
+        // I/O stage: reads raw entry data from `file` into blocks of `out`. For stored entries
+        // there is no decompression stage, so `verifier` is non-null and the data is verified here
+        // instead.
+
+        void read_stage(
+            const zip_file& file, stage_link& out, entry_verifier* const verifier,
+            const pipeline_state& state) {
+
+            while (const auto dst = wait_pop(out.recycled, state)) {
+
+                dst->size = file.read(dst->data.data(), dst->data.size());
+                dst->last = (dst->size < dst->data.size());
+
+                if (verifier) {
+
+                    verifier->update(dst->data.data(), dst->size);
+                    if (dst->last) {
+                        verifier->check();
+                    }
+                }
+
+                push(out.filled, dst);
+                if (dst->last) {
+                    return;
+                }
+            }
+        }
+
+        // Decompression stage: inflates raw deflate data from blocks of `in` into blocks of `out`,
+        // verifying the result.
+
+        void inflate_stage(
+            stage_link& in, stage_link& out, impl::zlib::inflater& inflater,
+            const zip_entry_info& info, const bool verify_crc, const pipeline_state& state) {
+
+            auto verifier = entry_verifier{info, verify_crc};
+            auto finished = false;
+
+            auto dst = wait_pop(out.recycled, state);
+            if (!dst) {
+                return;
+            }
+
+            dst->size = 0;
+
+            while (true) {
+
+                const auto src = wait_pop(in.filled, state);
+                if (!src) {
+                    return;
+                }
+
+                auto pos = std::size_t{0};
+                while (!finished) {
+
+                    const auto out_pos = dst->data.data() + dst->size;
+                    const auto result  = inflater.inflate(
+                        src->data.data() + pos, src->size - pos,
+                        out_pos, dst->data.size() - dst->size);
+
+                    verifier.update(out_pos, result.produced);
+
+                    pos       += result.consumed;
+                    dst->size += result.produced;
+                    finished   = result.finished;
+
+                    if (dst->size == dst->data.size()) {
+
+                        dst->last = false;
+                        push(out.filled, dst);
+
+                        dst = wait_pop(out.recycled, state);
+                        if (!dst) {
+                            return;
+                        }
+
+                        dst->size = 0;
+                    }
+                    else if (result.consumed == 0 && result.produced == 0) {
+                        break;
+                    }
+                }
+
+                // Blocks are drained up to the last even once the deflate stream has ended, since
+                // the I/O stage may still be waiting to recycle one.
+
+                const auto last = src->last;
+                push(in.recycled, src);
+
+                if (last) {
+                    break;
+                }
+            }
+
+            if (!finished) {
+                throw error{error_code::zip_invalid_compressed_data};
+            }
+
+            verifier.check();
+
+            dst->last = true;
+            push(out.filled, dst);
+        }
+
+        // Consumption stage: passes the data from each block of `in` to `consume`.
+
+        void consume_stage(
+            stage_link& in, const extract_consumer& consume, const pipeline_state& state) {
+
+            while (const auto src = wait_pop(in.filled, state)) {
+
+                if (src->size > 0) {
+                    consume(src->data.data(), src->size);
+                }
+
+                const auto last = src->last;
+                push(in.recycled, src);
+
+                if (last) {
+                    return;
+                }
+            }
+        }
+
+        // Buffers and decoder of one pipeline. Those of a pipeline that completes are left as
+        // they started (every block back in its link's `recycled` queue), so may be reused.
+
+        struct pipeline_resources {
+
+            pipeline_resources(const pipeline_options& options)
+              : read_buffer_size{options.read_buffer_size},
+                inflate_buffer_size{options.inflate_buffer_size},
+                buffer_count{options.buffer_count},
+                raw_link{options.buffer_count, options.read_buffer_size} {
+            }
+
+            auto fits(const pipeline_options& options) const noexcept -> bool {
+                return read_buffer_size == options.read_buffer_size
+                    && inflate_buffer_size == options.inflate_buffer_size
+                    && buffer_count == options.buffer_count;
+            }
+
+            std::size_t read_buffer_size;
+            std::size_t inflate_buffer_size;
+            std::size_t buffer_count;
+
+            stage_link                            raw_link;
+            std::unique_ptr<stage_link>           inflated_link;
+            std::unique_ptr<impl::zlib::inflater> inflater;
+        };
+
+        // Resources kept by each thread for its next pipeline, when `reuse_resources` is set.
+
+        thread_local auto kept_resources = std::unique_ptr<pipeline_resources>{};
+
+        auto acquire_resources(const pipeline_options& options)
+            -> std::unique_ptr<pipeline_resources> {
+
+            if (options.reuse_resources && kept_resources && kept_resources->fits(options)) {
+                return std::move(kept_resources);
+            }
+
+            return std::make_unique<pipeline_resources>(options);
+        }
+
+        // Starts a thread running `stage`, reporting any exception it throws to `state`.
+
+        template<typename fn>
+        auto start_stage(pipeline_state& state, fn stage) -> std::thread {
+
+            return std::thread{[&state, stage = std::move(stage)] {
+
+                try {
+                    stage();
+                }
+                catch (...) {
+                    state.fail(std::current_exception());
+                }
+            }};
+        }
+    }
+
+    void extract_pipelined(
+        const zip_archive& archive, const path& file_path, const extract_consumer& consume,
+        const pipeline_options& options) {
+
+        assert(options.read_buffer_size    > 0);
+        assert(options.inflate_buffer_size > 0);
+        assert(options.buffer_count        > 0);
+
+        const auto info = archive.stat_file(file_path);
+
+        if (info.encrypted) {
+            throw error{error_code::zip_unsupported_encryption_method};
+        }
+
+        const auto stored = (info.method == zip_method::stored);
+        if (!stored && info.method != zip_method::deflated) {
+            throw error{error_code::zip_unsupported_compression_method};
+        }
+
+        auto file      = archive.open_raw_file(file_path);
+        auto state     = pipeline_state{};
+        auto resources = acquire_resources(options);
+        auto verifier  = entry_verifier{info, options.verify_crc};
+
+        auto& raw_link = resources->raw_link;
+
+        auto threads = std::vector<std::thread>{};
+        threads.reserve(2);
+
+        try {
+
+            if (stored) {
+
+                threads.push_back(start_stage(state, [&] {
+                    read_stage(file, raw_link, &verifier, state);
+                }));
+
+                consume_stage(raw_link, consume, state);
+            }
+            else {
+
+                if (!resources->inflated_link) {
+                    resources->inflated_link = std::make_unique<stage_link>(
+                        options.buffer_count, options.inflate_buffer_size);
+                }
+
+                if (resources->inflater) {
+                    resources->inflater->reset();
+                }
+                else {
+                    resources->inflater = std::make_unique<impl::zlib::inflater>();
+                }
+
+                auto& inflated_link = *resources->inflated_link;
+                auto& inflater      = *resources->inflater;
+
+                threads.push_back(start_stage(state, [&] {
+                    read_stage(file, raw_link, nullptr, state);
+                }));
+
+                threads.push_back(start_stage(state, [&] {
+                    inflate_stage(
+                        raw_link, inflated_link, inflater, info, options.verify_crc, state);
+                }));
+
+                consume_stage(inflated_link, consume, state);
+            }
+        }
+        catch (...) {
+            state.fail(std::current_exception());
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        state.rethrow_if_failed();
+        file.close();
+
+        if (options.reuse_resources) {
+            kept_resources = std::move(resources);
+        }
+    }
+
+    auto read_all_pipelined(
+        const zip_archive& archive, const path& file_path, const pipeline_options& options)
+        -> std::vector<std::byte> {
+
+        auto bytes = std::vector<std::byte>{};
+        bytes.reserve(impl::zip_format::checked_entry_size(archive.stat_file(file_path)));
+
+        const auto append = [&bytes] (const std::byte* const data, const std::size_t size) {
+            bytes.insert(bytes.end(), data, data + size);
+        };
+
+        extract_pipelined(archive, file_path, append, options);
+        return bytes;
+    }
+}
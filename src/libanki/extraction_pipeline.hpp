@@ -0,0 +1,63 @@
+#ifndef LIBANKI_EXTRACTION_PIPELINE_HPP
+#define LIBANKI_EXTRACTION_PIPELINE_HPP
+
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace anki {
+
+    class zip_archive;
+
+    // Callback receiving successive blocks of decompressed data from `extract_pipelined()`. The
+    // referenced bytes are only valid for the duration of the call.
+
+    using extract_consumer = std::function<void(const std::byte* data, std::size_t size)>;
+
+    // Tuning parameters for `extract_pipelined()`. Each stage owns `buffer_count` buffers of the
+    // stated size, which bounds both the memory used and how far one stage may run ahead of the
+    // next.
+    //
+    // `verify_crc` may be cleared for archives from a trusted source (such as those this library
+    // has just written itself) to skip checksumming the decompressed data. The decompressed size
+    // is still checked, and corrupt deflate data is still detected by the decoder.
+    //
+    // `reuse_resources` keeps the buffers and deflate decoder of a pipeline that completes
+    // successfully for the next pipeline started from the same thread (with the same buffer
+    // sizes), rather than freeing them, for threads that extract many archives in turn.
+
+    struct pipeline_options {
+        std::size_t read_buffer_size    = std::size_t{1} << 20;
+        std::size_t inflate_buffer_size = std::size_t{1} << 20;
+        std::size_t buffer_count        = 4;
+        bool        verify_crc          = true;
+        bool        reuse_resources     = false;
+    };
+
+    // Extracts the specified file from `archive`, passing its decompressed contents to `consume`
+    // in order. Reading compressed data from the archive, decompressing it and consuming the
+    // result each run on their own thread, so that I/O latency overlaps decompression; stages are
+    // connected by bounded lock-free queues of reusable buffers. The CRC (unless disabled through
+    // `options`) and size of the decompressed data are verified before the final block is
+    // consumed, and data beyond the recorded size is rejected before any of it is consumed, so
+    // `consume` is never passed more than the recorded size in total.
+    //
+    // `archive` must be open and must not be used by any other thread until this function
+    // returns. `consume` is invoked on the calling thread. Throws `zip_error` on failure, or
+    // propagates any exception thrown from `consume` (after the other stages have stopped).
+
+    void extract_pipelined(
+        const zip_archive& archive, const path& file_path, const extract_consumer& consume,
+        const pipeline_options& options = {});
+
+    // Convenience wrapper around `extract_pipelined()` that accumulates the decompressed contents
+    // of the specified file into memory; equivalent in effect to `zip_file::read_all()`.
+
+    auto read_all_pipelined(
+        const zip_archive& archive, const path& file_path, const pipeline_options& options = {})
+        -> std::vector<std::byte>;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef LIBANKI_IMPL_ARCHIVE_BACKEND_HPP
+#define LIBANKI_IMPL_ARCHIVE_BACKEND_HPP
+
+#include "../filesystem.hpp"
+#include "../zip_entry_info.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace anki::impl {
+
+    // Interfaces implemented by each zip backend, behind `zip_archive` and `zip_file`. The public
+    // classes handle the open/closed state; an implementation object exists only while open, and
+    // its members otherwise follow the contracts documented for the public members they back.
+
+    class file_backend {
+    public:
+
+        virtual ~file_backend() = default;
+
+        virtual auto read(std::byte* dst, std::size_t size) -> std::size_t = 0;
+        virtual auto read_all() -> std::vector<std::byte> = 0;
+        virtual void close() = 0;
+    };
+
+    class archive_backend {
+    public:
+
+        virtual ~archive_backend() = default;
+
+        virtual auto contains_file(const path& file_path) const -> bool = 0;
+        virtual auto stat_file(const path& file_path) const -> zip_entry_info = 0;
+
+        // Opens the specified file; if `raw` is set, reads yield the data as stored in the archive
+        // rather than decompressed (see `zip_archive::open_raw_file()`).
+
+        virtual auto open_file(const path& file_path, bool raw) const
+            -> std::unique_ptr<file_backend> = 0;
+
+        virtual void close() = 0;
+    };
+}
+
+#endif
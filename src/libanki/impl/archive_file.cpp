@@ -0,0 +1,108 @@
+#include "archive_file.hpp"
+
+#include "../batch_reader.hpp"
+#include "../error.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+namespace anki::impl {
+
+    archive_file::archive_file(const path& src, batch_reader* const reader)
+      : _fd{::open(src.c_str(), O_RDONLY | O_CLOEXEC)}, _reader{reader} {
+
+        if (_fd < 0) {
+            throw error{errno == ENOENT ? error_code::zip_file_not_found : error_code::zip_file_open_failed};
+        }
+
+        struct stat file_stat = {};
+        if (fstat(_fd, &file_stat) != 0) {
+
+            ::close(_fd);
+            throw error{error_code::zip_read_error};
+        }
+
+        _size = static_cast<std::uint64_t>(file_stat.st_size);
+    }
+
+    archive_file::~archive_file() {
+
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+    }
+
+    archive_file::archive_file(archive_file&& rhs) noexcept
+      : _fd{std::exchange(rhs._fd, -1)},
+        _size{rhs._size},
+        _reader{rhs._reader},
+        _cache{std::move(rhs._cache)} {
+    }
+
+    void archive_file::add_cached_range(cached_range range) {
+        _cache.push_back(std::move(range));
+    }
+
+    auto archive_file::read_at(
+        const std::uint64_t offset, std::byte* const dst, const std::size_t size) const
+        -> std::size_t {
+
+        const auto available = ksr::narrow_cast<std::size_t>(
+            std::min<std::uint64_t>(size, _size - std::min(offset, _size)));
+
+        const auto covers_read = [offset, available] (const cached_range& range) {
+            return range.offset <= offset
+                && offset + available <= range.offset + range.bytes.size();
+        };
+
+        const auto range = std::find_if(_cache.begin(), _cache.end(), covers_read);
+        if (range != _cache.end()) {
+            std::copy_n(range->bytes.data() + (offset - range->offset), available, dst);
+            return available;
+        }
+
+        if (_reader) {
+            return _reader->read(_fd, offset, dst, available);
+        }
+
+        auto size_read = std::size_t{0};
+        while (size_read < available) {
+
+            const auto result = pread(
+                _fd, dst + size_read, available - size_read,
+                ksr::narrow_cast<off_t>(offset + size_read));
+
+            if (result < 0) {
+
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw error{error_code::zip_read_error};
+            }
+
+            if (result == 0) {
+                break;
+            }
+
+            size_read += static_cast<std::size_t>(result);
+        }
+
+        return size_read;
+    }
+
+    void archive_file::read_exact_at(
+        const std::uint64_t offset, std::byte* const dst, const std::size_t size) const {
+
+        if (read_at(offset, dst, size) != size) {
+            throw error{error_code::zip_premature_eof};
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef LIBANKI_IMPL_ARCHIVE_FILE_HPP
+#define LIBANKI_IMPL_ARCHIVE_FILE_HPP
+
+#include "../filesystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace anki {
+    class batch_reader;
+}
+
+namespace anki::impl {
+
+    // Range of an archive file already read into memory.
+
+    struct cached_range {
+        std::uint64_t          offset = 0;
+        std::vector<std::byte> bytes;
+    };
+
+    // Read-only handle to an archive file on disk, shared by the zip backends. Positioned reads go
+    // through a `batch_reader` if one is supplied and directly through `pread()` otherwise, and
+    // are served from memory instead where they fall entirely within a range cached up front.
+    // Reads may be made concurrently from multiple threads.
+
+    class archive_file {
+    public:
+
+        // Opens the file at `src` for reading. If `reader` is non-null, it must outlive this
+        // object. Throws `anki::error` on failure.
+
+        explicit archive_file(const path& src, batch_reader* reader = nullptr);
+        ~archive_file();
+
+        archive_file(archive_file&& rhs) noexcept;
+        archive_file(const archive_file&) = delete;
+
+        auto operator=(archive_file&&)      -> archive_file& = delete;
+        auto operator=(const archive_file&) -> archive_file& = delete;
+
+        auto fd()     const noexcept -> int           { return _fd; }
+        auto size()   const noexcept -> std::uint64_t { return _size; }
+        auto reader() const noexcept -> batch_reader* { return _reader; }
+
+        // Adds a range to be served from memory. Ranges should be added before the file is shared
+        // between threads.
+
+        void add_cached_range(cached_range range);
+
+        // Reads up to `size` bytes at `offset` into `dst` and returns the number of bytes read,
+        // which is less than `size` only at the end of the file. Throws `anki::error` on failure.
+
+        auto read_at(std::uint64_t offset, std::byte* dst, std::size_t size) const -> std::size_t;
+
+        // As for `read_at()`, but throws `anki::error` if fewer than `size` bytes are available.
+
+        void read_exact_at(std::uint64_t offset, std::byte* dst, std::size_t size) const;
+
+    private:
+
+        int           _fd     = -1;
+        std::uint64_t _size   = 0;
+        batch_reader* _reader = nullptr;
+
+        std::vector<cached_range> _cache;
+    };
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef LIBANKI_IMPL_BYTE_ORDER_HPP
+#define LIBANKI_IMPL_BYTE_ORDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anki::impl {
+
+    // Loads and stores of little-endian integers at addresses that need not be aligned, as used by
+    // the on-disk formats libanki reads and writes.
+
+    inline auto load_u16(const std::byte* src) -> std::uint16_t {
+        return static_cast<std::uint16_t>(
+            std::to_integer<unsigned>(src[0]) | (std::to_integer<unsigned>(src[1]) << 8));
+    }
+
+    inline auto load_u32(const std::byte* src) -> std::uint32_t {
+        return std::uint32_t{load_u16(src)} | (std::uint32_t{load_u16(src + 2)} << 16);
+    }
+
+    inline auto load_u64(const std::byte* src) -> std::uint64_t {
+        return std::uint64_t{load_u32(src)} | (std::uint64_t{load_u32(src + 4)} << 32);
+    }
+
+    inline void store_u16(std::byte* dst, std::uint16_t value) {
+        dst[0] = static_cast<std::byte>(value & 0xff);
+        dst[1] = static_cast<std::byte>(value >> 8);
+    }
+
+    inline void store_u32(std::byte* dst, std::uint32_t value) {
+        store_u16(dst,     static_cast<std::uint16_t>(value & 0xffff));
+        store_u16(dst + 2, static_cast<std::uint16_t>(value >> 16));
+    }
+
+    inline void store_u64(std::byte* dst, std::uint64_t value) {
+        store_u32(dst,     static_cast<std::uint32_t>(value & 0xffffffff));
+        store_u32(dst + 4, static_cast<std::uint32_t>(value >> 32));
+    }
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include "column_loader.hpp"
+
+#include "sqlite/database.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <boost/container/flat_map.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using boost::container::flat_map;
+
+namespace anki::impl {
+
+    namespace {
+
+        // Assigns dense codes to IDs in order of first appearance.
+
+        class dictionary {
+        public:
+
+            auto code(const std::int64_t id) -> std::uint32_t {
+
+                const auto next = ksr::narrow_cast<std::uint32_t>(_ids.size());
+                const auto [it, inserted] = _codes.try_emplace(id, next);
+
+                if (inserted) {
+                    _ids.push_back(id);
+                }
+
+                return it->second;
+            }
+
+            // Returns the ID for each code, leaving the dictionary empty.
+
+            auto release() -> std::vector<std::int64_t> {
+
+                _codes.clear();
+                return std::exchange(_ids, {});
+            }
+
+        private:
+
+            flat_map<std::int64_t, std::uint32_t> _codes;
+            std::vector<std::int64_t>             _ids;
+        };
+
+        template<typename t>
+        auto clamp_to(const std::int64_t value) -> t {
+
+            using limits = std::numeric_limits<t>;
+            return static_cast<t>(std::clamp<std::int64_t>(value, limits::min(), limits::max()));
+        }
+
+        template<typename... ts>
+        void reserve_columns(const std::size_t size, ts&... columns) {
+            (columns.reserve(size), ...);
+        }
+
+        auto row_count(const sqlite::database& db, const std::string_view table) -> std::size_t {
+
+            auto query = sqlite::statement{db, "SELECT count(*) FROM " + std::string{table}};
+            if (!query.step()) {
+                return 0;
+            }
+
+            return static_cast<std::size_t>(std::max<std::int64_t>(query.column_int64(0), 0));
+        }
+
+        // Interns each of the space-separated tags in `text`, appending their IDs to `dst`.
+
+        void append_tags(
+            const std::string_view text, ksr::string_pool& pool, std::vector<std::uint32_t>& dst) {
+
+            auto pos = text.find_first_not_of(' ');
+            while (pos != std::string_view::npos) {
+
+                const auto end = std::min(text.find(' ', pos), text.size());
+                dst.push_back(pool.intern(text.substr(pos, end - pos)));
+
+                pos = text.find_first_not_of(' ', end);
+            }
+        }
+
+        // Returns the names of the entries of `metadata` with each of `ids`, or an empty name for
+        // those it lacks.
+
+        template<typename t>
+        auto names_by_id(const std::vector<t>& metadata, const std::vector<std::int64_t>& ids)
+            -> std::vector<std::string_view> {
+
+            auto names = std::vector<std::string_view>{};
+            names.reserve(ids.size());
+
+            for (const auto id : ids) {
+
+                const auto it = std::lower_bound(metadata.begin(), metadata.end(), id,
+                    [] (const t& entry, const std::int64_t id) { return entry.id < id; });
+
+                const auto found = it != metadata.end() && it->id == id;
+                names.push_back(found ? std::string_view{it->name} : std::string_view{});
+            }
+
+            return names;
+        }
+
+        void load_notes(
+            const sqlite::database& db, ksr::text_arena& text, collection_columns& columns) {
+
+            auto& notes = columns.notes;
+
+            const auto count = row_count(db, "notes");
+            reserve_columns(count, notes.id, notes.notetype, notes.modified, notes.fields);
+            reserve_columns(count + 1, notes.tag_offsets);
+
+            notes.tag_offsets.push_back(0);
+
+            auto notetypes = dictionary{};
+            auto query     = sqlite::statement{
+                db, "SELECT id, mid, mod, tags, flds FROM notes ORDER BY id"};
+
+            while (query.step()) {
+
+                notes.id.push_back(query.column_int64(0));
+                notes.notetype.push_back(notetypes.code(query.column_int64(1)));
+                notes.modified.push_back(query.column_int64(2));
+                notes.fields.push_back(text.store(query.column_text(4)));
+
+                append_tags(query.column_text(3), columns.tags, notes.tags);
+                notes.tag_offsets.push_back(ksr::narrow_cast<std::uint32_t>(notes.tags.size()));
+            }
+
+            columns.notetype_ids = notetypes.release();
+        }
+
+        void load_cards(const sqlite::database& db, collection_columns& columns) {
+
+            auto& cards = columns.cards;
+
+            reserve_columns(row_count(db, "cards"),
+                cards.id, cards.note_id, cards.note, cards.deck, cards.ordinal, cards.due,
+                cards.interval, cards.ease_factor, cards.reps, cards.lapses, cards.left, cards.queue,
+                cards.type);
+
+            auto decks = dictionary{};
+            auto query = sqlite::statement{db,
+                "SELECT id, nid, did, ord, due, ivl, factor, reps, lapses, left, queue, type FROM cards "
+                "ORDER BY id"};
+
+            while (query.step()) {
+
+                const auto note_id  = query.column_int64(1);
+                const auto note_row = columns.note_row(note_id);
+
+                cards.id.push_back(query.column_int64(0));
+                cards.note_id.push_back(note_id);
+                cards.note.push_back(note_row ? ksr::narrow_cast<std::uint32_t>(*note_row) : no_row);
+                cards.deck.push_back(decks.code(query.column_int64(2)));
+                cards.ordinal.push_back(clamp_to<std::uint16_t>(query.column_int64(3)));
+                cards.due.push_back(query.column_int64(4));
+                cards.interval.push_back(clamp_to<std::int32_t>(query.column_int64(5)));
+                cards.ease_factor.push_back(clamp_to<std::int32_t>(query.column_int64(6)));
+                cards.reps.push_back(clamp_to<std::int32_t>(query.column_int64(7)));
+                cards.lapses.push_back(clamp_to<std::int32_t>(query.column_int64(8)));
+                cards.left.push_back(clamp_to<std::int32_t>(query.column_int64(9)));
+                cards.queue.push_back(clamp_to<std::int8_t>(query.column_int64(10)));
+                cards.type.push_back(clamp_to<std::int8_t>(query.column_int64(11)));
+            }
+
+            columns.deck_ids = decks.release();
+        }
+    }
+
+    auto load_columns(
+        const sqlite::database& db, ksr::text_arena& text, const std::vector<deck>& decks,
+        const std::vector<notetype>& notetypes) -> collection_columns {
+
+        auto result = collection_columns{};
+
+        load_notes(db, text, result);
+        load_cards(db, result);
+
+        result.deck_names     = names_by_id(decks, result.deck_ids);
+        result.notetype_names = names_by_id(notetypes, result.notetype_ids);
+
+        return result;
+    }
+
+    auto load_review_columns(const sqlite::database& db) -> review_columns {
+
+        auto result = review_columns{};
+
+        reserve_columns(row_count(db, "revlog"),
+            result.id, result.card_id, result.interval, result.last_interval, result.time,
+            result.ease, result.type);
+
+        auto query = sqlite::statement{db,
+            "SELECT id, cid, ivl, lastIvl, time, ease, type FROM revlog ORDER BY id"};
+
+        while (query.step()) {
+
+            result.id.push_back(query.column_int64(0));
+            result.card_id.push_back(query.column_int64(1));
+            result.interval.push_back(clamp_to<std::int32_t>(query.column_int64(2)));
+            result.last_interval.push_back(clamp_to<std::int32_t>(query.column_int64(3)));
+            result.time.push_back(clamp_to<std::uint32_t>(query.column_int64(4)));
+            result.ease.push_back(clamp_to<std::uint8_t>(query.column_int64(5)));
+            result.type.push_back(clamp_to<std::uint8_t>(query.column_int64(6)));
+        }
+
+        return result;
+    }
+}
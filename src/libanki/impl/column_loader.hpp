@@ -0,0 +1,31 @@
+#ifndef LIBANKI_IMPL_COLUMN_LOADER_HPP
+#define LIBANKI_IMPL_COLUMN_LOADER_HPP
+
+#include "../collection_columns.hpp"
+#include "../collection_metadata.hpp"
+
+#include "ksr/text_arena.hpp"
+
+#include <vector>
+
+namespace anki::impl {
+
+    namespace sqlite {
+        class database;
+    }
+
+    // Loads the notes and cards of the collection database `db` into columns, with one query per
+    // table, storing note text in `text` and naming decks and note types from `decks` and
+    // `notetypes` (which must be sorted by ID, and outlive the result). Throws `anki::error` if
+    // the database cannot be read.
+
+    auto load_columns(
+        const sqlite::database& db, ksr::text_arena& text, const std::vector<deck>& decks,
+        const std::vector<notetype>& notetypes) -> collection_columns;
+
+    // Loads the revlog of `db` into columns. Throws `anki::error` if the database cannot be read.
+
+    auto load_review_columns(const sqlite::database& db) -> review_columns;
+}
+
+#endif
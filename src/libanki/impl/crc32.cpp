@@ -0,0 +1,191 @@
+#include "crc32.hpp"
+
+#include "zlib/inflater.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <cassert>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBANKI_CRC32_PCLMUL
+#include <immintrin.h>
+#endif
+
+namespace anki::impl {
+
+    namespace {
+
+        // Each kernel operates on the internal (inverted) CRC state rather than on the checksum
+        // value itself. zlib's implementation serves as the portable kernel, since it is already a
+        // dependency and is faster than any simple table-driven loop.
+
+        auto update_scalar(std::uint32_t state, const std::byte* data, std::size_t size)
+            -> std::uint32_t {
+
+            return ~zlib::crc32(~state, data, size);
+        }
+
+#ifdef LIBANKI_CRC32_PCLMUL
+
+        // Folding kernel for a whole number of 16-byte blocks, at least 64 bytes in total. The
+        // constants are powers of x modulo the polynomial (bit-reflected), as given in the Intel
+        // paper and used by zlib's own SIMD implementations: `k1`/`k2` fold across 64 bytes,
+        // `k3`/`k4` across 16, `k5` reduces 96 bits to 64, and the final pair performs Barrett
+        // reduction to 32 bits.
+
+        __attribute__((target("pclmul,sse4.1")))
+        inline auto fold(__m128i acc, __m128i next, __m128i k) -> __m128i {
+
+            const auto lo = _mm_clmulepi64_si128(acc, k, 0x00);
+            const auto hi = _mm_clmulepi64_si128(acc, k, 0x11);
+            return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+        }
+
+        inline auto load(const std::byte* src) -> __m128i {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        }
+
+        __attribute__((target("pclmul,sse4.1")))
+        auto update_pclmul_blocks(std::uint32_t state, const std::byte* data, std::size_t size)
+            -> std::uint32_t {
+
+            alignas(16) static constexpr std::uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+            alignas(16) static constexpr std::uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+            alignas(16) static constexpr std::uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+            alignas(16) static constexpr std::uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+            auto x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(state)));
+            auto x2 = load(data + 16);
+            auto x3 = load(data + 32);
+            auto x4 = load(data + 48);
+
+            data += 64;
+            size -= 64;
+
+            auto k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+            while (size >= 64) {
+
+                x1 = fold(x1, load(data),      k);
+                x2 = fold(x2, load(data + 16), k);
+                x3 = fold(x3, load(data + 32), k);
+                x4 = fold(x4, load(data + 48), k);
+
+                data += 64;
+                size -= 64;
+            }
+
+            k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+            x1 = fold(x1, x2, k);
+            x1 = fold(x1, x3, k);
+            x1 = fold(x1, x4, k);
+
+            while (size >= 16) {
+
+                x1 = fold(x1, load(data), k);
+
+                data += 16;
+                size -= 16;
+            }
+
+            // Fold 128 bits down to 64.
+
+            const auto mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+            x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+            x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+            k  = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+            x2 = _mm_srli_si128(x1, 4);
+            x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            // Barrett reduction to 32 bits.
+
+            k  = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+            x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+            x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), k, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+        }
+
+        auto update_pclmul(std::uint32_t state, const std::byte* data, std::size_t size)
+            -> std::uint32_t {
+
+            // Below this size the setup and reduction steps outweigh the folding; not profiled
+            // beyond confirming that the kernel requires at least 64 bytes.
+
+            static constexpr auto min_size = std::size_t{64};
+
+            if (size >= min_size) {
+
+                const auto block_size = size & ~std::size_t{15};
+                state = update_pclmul_blocks(state, data, block_size);
+
+                data += block_size;
+                size -= block_size;
+            }
+
+            return update_scalar(state, data, size);
+        }
+
+#endif
+
+        using update_fn = auto (*)(std::uint32_t, const std::byte*, std::size_t) -> std::uint32_t;
+
+        auto detect_kernel() -> crc32_kernel {
+
+#ifdef LIBANKI_CRC32_PCLMUL
+            if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+                return crc32_kernel::pclmul;
+            }
+#endif
+
+            return crc32_kernel::scalar;
+        }
+
+        auto kernel_update(crc32_kernel kernel) -> update_fn {
+
+            switch (kernel) {
+#ifdef LIBANKI_CRC32_PCLMUL
+            case crc32_kernel::pclmul: return update_pclmul;
+#endif
+            default:                   return update_scalar;
+            }
+        }
+    }
+
+    auto active_crc32_kernel() -> crc32_kernel {
+
+        static const auto kernel = detect_kernel();
+        return kernel;
+    }
+
+    auto crc32_kernel_supported(const crc32_kernel kernel) -> bool {
+        return kernel == crc32_kernel::scalar || kernel == active_crc32_kernel();
+    }
+
+    auto crc32(std::uint32_t crc, const std::byte* data, std::size_t size) -> std::uint32_t {
+
+        static const auto update = kernel_update(active_crc32_kernel());
+        return ~update(~crc, data, size);
+    }
+
+    auto crc32(
+        const crc32_kernel kernel, const std::uint32_t crc, const std::byte* const data,
+        const std::size_t size) -> std::uint32_t {
+
+        assert(crc32_kernel_supported(kernel));
+        return ~kernel_update(kernel)(~crc, data, size);
+    }
+
+    auto crc32_combine(
+        const std::uint32_t crc1, const std::uint32_t crc2, const std::uint64_t size2)
+        -> std::uint32_t {
+
+        return static_cast<std::uint32_t>(
+            ::crc32_combine(crc1, crc2, ksr::narrow_cast<z_off_t>(size2)));
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef LIBANKI_IMPL_CRC32_HPP
+#define LIBANKI_IMPL_CRC32_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anki::impl {
+
+    // Implementations of `crc32()`, one of which is chosen on first use according to the features
+    // of the CPU.
+    //
+    // * `scalar` defers to zlib's portable implementation (`zlib::crc32()`).
+    // * `pclmul` folds 64 bytes per iteration with carry-less multiplication (PCLMULQDQ), as in
+    //   Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+    //
+    // The SSE4.2 `crc32` instruction is no use here: it computes CRC-32C, whose polynomial differs
+    // from the one zip archives use.
+
+    enum class crc32_kernel {
+        scalar,
+        pclmul,
+    };
+
+    // Returns the kernel used by `crc32()` on this machine.
+
+    auto active_crc32_kernel() -> crc32_kernel;
+
+    // Determines whether `kernel` can run on this machine; `crc32_kernel::scalar` always can.
+
+    auto crc32_kernel_supported(crc32_kernel kernel) -> bool;
+
+    // Continues the CRC-32 checksum `crc` (using the zip/gzip polynomial) over
+    // `[data, data + size)`. The checksum of an empty sequence is 0, and results are identical to
+    // those of zlib's `crc32()`.
+
+    auto crc32(std::uint32_t crc, const std::byte* data, std::size_t size) -> std::uint32_t;
+
+    // As above, computed by `kernel` rather than the active kernel, so that each kernel can be
+    // checked against the others. `kernel` must be supported by this machine.
+
+    auto crc32(crc32_kernel kernel, std::uint32_t crc, const std::byte* data, std::size_t size)
+        -> std::uint32_t;
+
+    // Given the checksums `crc1` and `crc2` of two adjacent sequences, the second of which is
+    // `size2` bytes long, returns the checksum of their concatenation, so that parts of a sequence
+    // may be checksummed independently.
+
+    auto crc32_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t size2) -> std::uint32_t;
+}
+
+#endif
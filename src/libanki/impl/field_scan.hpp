@@ -0,0 +1,44 @@
+#ifndef LIBANKI_IMPL_FIELD_SCAN_HPP
+#define LIBANKI_IMPL_FIELD_SCAN_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+
+    // Implementations of the separator scan behind `split_fields()` and `field_at()`, one of which
+    // is chosen on first use according to the features of the CPU.
+    //
+    // * `scalar` finds each separator with `std::memchr()`.
+    // * `sse2` compares 16 bytes at a time. SSE2 is part of the x86-64 baseline, so the scalar
+    //   kernel is only used on other architectures.
+    // * `avx2` compares 32 bytes at a time.
+
+    enum class field_scan_kernel {
+        scalar,
+        sse2,
+        avx2,
+    };
+
+    // Returns the kernel used by `split_fields()` and `field_at()` on this machine.
+
+    auto active_field_scan_kernel() -> field_scan_kernel;
+
+    // Determines whether `kernel` can run on this machine; `field_scan_kernel::scalar` always can.
+
+    auto field_scan_kernel_supported(field_scan_kernel kernel) -> bool;
+
+    // As `anki::split_fields()` and `anki::field_at()`, scanning with `kernel` rather than the
+    // active kernel, so that each kernel can be checked against the others. `kernel` must be
+    // supported by this machine.
+
+    void split_fields(
+        field_scan_kernel kernel, std::string_view fields, std::vector<std::string_view>& dst);
+
+    auto field_at(field_scan_kernel kernel, std::string_view fields, std::size_t index)
+        -> std::optional<std::string_view>;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "inflate_buffer.hpp"
+
+#include "../error.hpp"
+
+#ifdef LIBANKI_HAVE_LIBDEFLATE
+#include "libdeflate.h"
+#else
+#include "zlib/inflater.hpp"
+#endif
+
+namespace anki::impl {
+
+#ifdef LIBANKI_HAVE_LIBDEFLATE
+
+    namespace {
+
+        // libdeflate decompressors hold no state between calls but are relatively costly to
+        // allocate, so one is kept per thread.
+
+        class decompressor {
+        public:
+
+            decompressor()
+              : _handle{libdeflate_alloc_decompressor()} {
+
+                if (!_handle) {
+                    throw error{error_code::zip_bad_alloc};
+                }
+            }
+
+            ~decompressor() {
+                libdeflate_free_decompressor(_handle);
+            }
+
+            decompressor(decompressor&&)      = delete;
+            decompressor(const decompressor&) = delete;
+
+            auto operator=(decompressor&&)      -> decompressor& = delete;
+            auto operator=(const decompressor&) -> decompressor& = delete;
+
+            auto get() const noexcept -> libdeflate_decompressor* { return _handle; }
+
+        private:
+
+            libdeflate_decompressor* _handle;
+        };
+    }
+
+    void inflate_buffer(
+        const std::byte* const src, const std::size_t src_size,
+        std::byte* const dst, const std::size_t dst_size) {
+
+        thread_local const auto instance = decompressor{};
+
+        // Passing a null `actual_out_nbytes_ret` makes libdeflate itself require that the output
+        // fills `dst` exactly.
+
+        const auto result = libdeflate_deflate_decompress(
+            instance.get(), src, src_size, dst, dst_size, nullptr);
+
+        switch (result) {
+        case LIBDEFLATE_SUCCESS:            return;
+        case LIBDEFLATE_SHORT_OUTPUT:       throw error{error_code::zip_archive_inconsistent};
+        case LIBDEFLATE_INSUFFICIENT_SPACE: throw error{error_code::zip_archive_inconsistent};
+        default:                            throw error{error_code::zip_invalid_compressed_data};
+        }
+    }
+
+#else
+
+    void inflate_buffer(
+        const std::byte* const src, const std::size_t src_size,
+        std::byte* const dst, const std::size_t dst_size) {
+
+        thread_local auto inflater = zlib::inflater{};
+        inflater.reset();
+
+        auto consumed = std::size_t{0};
+        auto produced = std::size_t{0};
+
+        while (true) {
+
+            const auto result = inflater.inflate(
+                src + consumed, src_size - consumed, dst + produced, dst_size - produced);
+
+            consumed += result.consumed;
+            produced += result.produced;
+
+            if (result.finished) {
+                break;
+            }
+
+            if (result.consumed == 0 && result.produced == 0) {
+
+                // No progress with the output buffer full means the data decompresses to more
+                // than `dst_size` bytes; otherwise, the input ended before the stream did.
+
+                throw error{(produced == dst_size)
+                    ? error_code::zip_archive_inconsistent
+                    : error_code::zip_invalid_compressed_data};
+            }
+        }
+
+        if (produced != dst_size) {
+            throw error{error_code::zip_archive_inconsistent};
+        }
+    }
+
+#endif
+}
@@ -0,0 +1,18 @@
+#ifndef LIBANKI_IMPL_INFLATE_BUFFER_HPP
+#define LIBANKI_IMPL_INFLATE_BUFFER_HPP
+
+#include <cstddef>
+
+namespace anki::impl {
+
+    // Decompresses the complete raw deflate stream `[src, src + src_size)` into
+    // `[dst, dst + dst_size)`, which must be exactly the size of the decompressed data (as
+    // recorded for a zip entry in its archive's central directory). Decoding a whole buffer at
+    // once avoids the bookkeeping of a streaming decoder; libdeflate is used where available and
+    // zlib otherwise. Throws `anki::error` if the data is invalid or does not decompress to
+    // exactly `dst_size` bytes.
+
+    void inflate_buffer(const std::byte* src, std::size_t src_size, std::byte* dst, std::size_t dst_size);
+}
+
+#endif
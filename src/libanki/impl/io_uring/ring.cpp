@@ -0,0 +1,275 @@
+#include "ring.hpp"
+
+#include "../../error.hpp"
+
+#include <cassert>
+
+#ifdef LIBANKI_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace anki::impl::io_uring {
+
+    namespace {
+
+        auto sys_setup(unsigned entries, io_uring_params& params) -> int {
+            return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        }
+
+        auto sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) -> int {
+            return static_cast<int>(
+                syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+        auto sys_register(int fd, unsigned opcode, const void* arg, unsigned count) -> int {
+            return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+        }
+
+        // The ring indices are shared with the kernel, which reads and writes them concurrently;
+        // they are accessed through these rather than via `std::atomic` since they live in memory
+        // mapped from the kernel rather than in objects constructed by this process.
+
+        auto load_acquire(const unsigned* ptr) -> unsigned {
+            return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+        }
+
+        void store_release(unsigned* ptr, unsigned value) {
+            __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+        }
+
+        template<typename t>
+        auto offset_ptr(void* base, std::uint32_t offset) -> t* {
+            return reinterpret_cast<t*>(static_cast<char*>(base) + offset);
+        }
+
+        auto map_ring(int fd, std::size_t size, off_t offset) -> void* {
+
+            const auto ptr = mmap(
+                nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+            return (ptr != MAP_FAILED) ? ptr : nullptr;
+        }
+    }
+
+    auto ring::create(const unsigned entries) -> std::unique_ptr<ring> {
+
+        auto params = io_uring_params{};
+        const auto fd = sys_setup(entries, params);
+
+        // Any failure here (`ENOSYS` from older kernels, `EPERM` under seccomp or the
+        // `io_uring_disabled` sysctl, `ENOMEM`, ...) simply means that io_uring is unavailable.
+
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        auto result = std::unique_ptr<ring>{new ring{}};
+        result->_fd         = fd;
+        result->_sq_entries = params.sq_entries;
+
+        result->_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        result->_cq_ring_size = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+        result->_sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+
+        const auto single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            result->_sq_ring_size = result->_cq_ring_size =
+                std::max(result->_sq_ring_size, result->_cq_ring_size);
+        }
+
+        result->_sq_ring = map_ring(fd, result->_sq_ring_size, IORING_OFF_SQ_RING);
+        result->_cq_ring = single_mmap
+            ? result->_sq_ring
+            : map_ring(fd, result->_cq_ring_size, IORING_OFF_CQ_RING);
+        result->_sqes = map_ring(fd, result->_sqes_size, IORING_OFF_SQES);
+
+        if (!result->_sq_ring || !result->_cq_ring || !result->_sqes) {
+            return nullptr;
+        }
+
+        result->_sq_head  = offset_ptr<unsigned>(result->_sq_ring, params.sq_off.head);
+        result->_sq_tail  = offset_ptr<unsigned>(result->_sq_ring, params.sq_off.tail);
+        result->_sq_mask  = offset_ptr<unsigned>(result->_sq_ring, params.sq_off.ring_mask);
+        result->_sq_array = offset_ptr<unsigned>(result->_sq_ring, params.sq_off.array);
+        result->_cq_head  = offset_ptr<unsigned>(result->_cq_ring, params.cq_off.head);
+        result->_cq_tail  = offset_ptr<unsigned>(result->_cq_ring, params.cq_off.tail);
+        result->_cq_mask  = offset_ptr<unsigned>(result->_cq_ring, params.cq_off.ring_mask);
+        result->_cqes     = offset_ptr<void>(result->_cq_ring, params.cq_off.cqes);
+
+        return result;
+    }
+
+    ring::~ring() {
+
+        if (_sqes) {
+            munmap(_sqes, _sqes_size);
+        }
+
+        if (_cq_ring && _cq_ring != _sq_ring) {
+            munmap(_cq_ring, _cq_ring_size);
+        }
+
+        if (_sq_ring) {
+            munmap(_sq_ring, _sq_ring_size);
+        }
+
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+    }
+
+    auto ring::register_buffer(std::byte* const data, const std::size_t size) -> bool {
+
+        assert(!_fixed_data);
+
+        auto iov = iovec{};
+        iov.iov_base = data;
+        iov.iov_len  = size;
+
+        if (sys_register(_fd, IORING_REGISTER_BUFFERS, &iov, 1) != 0) {
+            return false;
+        }
+
+        _fixed_data = data;
+        _fixed_size = size;
+
+        return true;
+    }
+
+    auto ring::prepare_read(
+        const int fd, const std::uint64_t offset, std::byte* const dst, const std::uint32_t size,
+        const std::uint64_t user_data) -> bool {
+
+        // Only this process writes the submission queue tail, so it needs no synchronisation on
+        // load. Entries stay in the queue only until `submit_and_wait()` returns, which leaves
+        // none unconsumed, but the kernel's head is read rather than relied on.
+
+        if (*_sq_tail - load_acquire(_sq_head) + _pending == _sq_entries) {
+            return false;
+        }
+
+        const auto tail  = *_sq_tail + _pending;
+        const auto index = tail & *_sq_mask;
+
+        auto& sqe = static_cast<io_uring_sqe*>(_sqes)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+
+        const auto fixed = _fixed_data
+            && dst >= _fixed_data
+            && dst + size <= _fixed_data + _fixed_size;
+
+        sqe.opcode    = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd        = fd;
+        sqe.off       = offset;
+        sqe.addr      = reinterpret_cast<std::uint64_t>(dst);
+        sqe.len       = size;
+        sqe.user_data = user_data;
+        sqe.buf_index = 0;
+
+        _sq_array[index] = index;
+        ++_pending;
+
+        return true;
+    }
+
+    void ring::submit_and_wait(const unsigned min_complete) {
+
+        store_release(_sq_tail, *_sq_tail + _pending);
+        _pending = 0;
+
+        // A successful `io_uring_enter()` may consume fewer entries than asked (and then does not
+        // wait), so it is repeated until the kernel has consumed every one. Entries it consumed
+        // before being interrupted are likewise not submitted again.
+
+        for (;;) {
+
+            const auto unsubmitted = *_sq_tail - load_acquire(_sq_head);
+
+            const auto result = sys_enter(_fd, unsubmitted, min_complete, IORING_ENTER_GETEVENTS);
+            if (result >= 0 && static_cast<unsigned>(result) == unsubmitted) {
+                return;
+            }
+
+            // A call consuming nothing without error would only be repeated to the same end.
+
+            if ((result < 0 && errno != EINTR) || result == 0) {
+                break;
+            }
+        }
+
+        // The entries not yet consumed are withdrawn, which is safe since the kernel reads the
+        // queue only within `io_uring_enter()`, and then every read submitted is waited for: each
+        // consumed entry posts exactly one completion.
+
+        store_release(_sq_tail, load_acquire(_sq_head));
+
+        for (;;) {
+
+            const auto outstanding = load_acquire(_sq_head) - load_acquire(_cq_tail);
+
+            if (outstanding == 0) {
+                break;
+            }
+
+            if (sys_enter(_fd, 0, outstanding, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                break;
+            }
+        }
+
+        throw error{error_code::system_error};
+    }
+
+    auto ring::pop_completion() -> std::optional<completion> {
+
+        const auto head = *_cq_head;
+        if (head == load_acquire(_cq_tail)) {
+            return std::nullopt;
+        }
+
+        const auto& cqe = static_cast<const io_uring_cqe*>(_cqes)[head & *_cq_mask];
+
+        auto result = completion{};
+        result.user_data = cqe.user_data;
+        result.result    = cqe.res;
+
+        store_release(_cq_head, head + 1);
+        return result;
+    }
+}
+
+#else
+
+namespace anki::impl::io_uring {
+
+    auto ring::create(unsigned) -> std::unique_ptr<ring> {
+        return nullptr;
+    }
+
+    ring::~ring() = default;
+
+    auto ring::register_buffer(std::byte*, std::size_t) -> bool {
+        return false;
+    }
+
+    auto ring::prepare_read(int, std::uint64_t, std::byte*, std::uint32_t, std::uint64_t) -> bool {
+        return false;
+    }
+
+    void ring::submit_and_wait(unsigned) {
+        assert(false);
+    }
+
+    auto ring::pop_completion() -> std::optional<completion> {
+        return std::nullopt;
+    }
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef LIBANKI_IMPL_IO_URING_RING_HPP
+#define LIBANKI_IMPL_IO_URING_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace anki::impl::io_uring {
+
+    // Minimal wrapper for a Linux io_uring instance, driven through the raw system calls rather
+    // than liburing so as not to add a dependency. Supports only what `batch_reader` needs: queued
+    // reads into arbitrary or registered memory, submission, and reaping completions. Not
+    // thread-safe.
+
+    class ring {
+    public:
+
+        struct completion {
+            std::uint64_t user_data = 0;
+            int           result    = 0; // Bytes read, or a negated `errno` value
+        };
+
+        // Creates a ring with room for at least `entries` queued submissions, or returns `nullptr`
+        // if io_uring is unavailable (because libanki was built without it, or because the
+        // running kernel does not support it or forbids its use).
+
+        static auto create(unsigned entries) -> std::unique_ptr<ring>;
+
+        ~ring();
+
+        ring(ring&&)      = delete;
+        ring(const ring&) = delete;
+
+        auto operator=(ring&&)      -> ring& = delete;
+        auto operator=(const ring&) -> ring& = delete;
+
+        // Maximum number of submissions that may be queued at once.
+
+        auto capacity() const noexcept -> unsigned { return _sq_entries; }
+
+        // Registers `[data, data + size)` with the kernel as the sole fixed buffer of the ring, so
+        // that reads into it avoid mapping the pages afresh for each request. Returns whether the
+        // registration succeeded; it may legitimately fail, such as under a low `RLIMIT_MEMLOCK`.
+
+        auto register_buffer(std::byte* data, std::size_t size) -> bool;
+
+        // Queues a read of `size` bytes at `offset` of `fd` into `dst`, tagged with `user_data`.
+        // If `dst` lies within the registered buffer, the read uses it. Returns `false` without
+        // queueing anything if the submission queue is full.
+        //
+        // Each read gives exactly one completion, so a caller that never has more than
+        // `capacity()` reads submitted but not yet popped cannot overflow the completion queue.
+
+        auto prepare_read(
+            int fd, std::uint64_t offset, std::byte* dst, std::uint32_t size,
+            std::uint64_t user_data) -> bool;
+
+        // Submits all queued reads and blocks until at least `min_complete` completions are
+        // available. Throws `anki::error` on failure, but only once every read already submitted
+        // has completed, so that none still writes into its destination; reads not yet submitted
+        // are then discarded, and the completions of those submitted remain to be popped.
+
+        void submit_and_wait(unsigned min_complete);
+
+        // Removes and returns the oldest available completion, if any.
+
+        auto pop_completion() -> std::optional<completion>;
+
+    private:
+
+        ring() = default;
+
+        int _fd = -1;
+
+        unsigned _sq_entries = 0;
+        unsigned _pending    = 0; // Queued but not yet submitted
+
+        void*       _sq_ring      = nullptr;
+        void*       _cq_ring      = nullptr;
+        void*       _sqes         = nullptr;
+        std::size_t _sq_ring_size = 0;
+        std::size_t _cq_ring_size = 0;
+        std::size_t _sqes_size    = 0;
+
+        unsigned* _sq_head  = nullptr;
+        unsigned* _sq_tail  = nullptr;
+        unsigned* _sq_mask  = nullptr;
+        unsigned* _sq_array = nullptr;
+        unsigned* _cq_head  = nullptr;
+        unsigned* _cq_tail  = nullptr;
+        unsigned* _cq_mask  = nullptr;
+        void*     _cqes     = nullptr;
+
+        std::byte*  _fixed_data = nullptr;
+        std::size_t _fixed_size = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,447 @@
+#include "json_reader.hpp"
+
+#include "utf8.hpp"
+
+#include <charconv>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBANKI_JSON_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace anki::impl {
+
+    namespace {
+
+        auto is_string_special(const char c) -> bool {
+            return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+        }
+
+        // Returns the position of the first character at or after `pos` within `text` that ends a
+        // run of plain string content (a quote, backslash or control character), or `npos` if
+        // there is none. SSE2 is part of the x86-64 baseline, so needs no runtime detection.
+
+        auto find_string_special(const std::string_view text, std::size_t pos) -> std::size_t {
+
+#ifdef LIBANKI_JSON_SIMD
+            const auto quote     = _mm_set1_epi8('"');
+            const auto backslash = _mm_set1_epi8('\\');
+            const auto control   = _mm_set1_epi8(0x1f);
+
+            for (; pos + 16 <= text.size(); pos += 16) {
+
+                const auto chunk = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(text.data() + pos));
+                const auto special = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                    _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+
+                const auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                if (mask != 0) {
+                    return pos + static_cast<std::size_t>(__builtin_ctz(mask));
+                }
+            }
+#endif
+
+            for (; pos < text.size(); ++pos) {
+                if (is_string_special(text[pos])) {
+                    return pos;
+                }
+            }
+
+            return std::string_view::npos;
+        }
+
+        auto parse_double(const std::string_view token, double& value) -> bool {
+
+            const auto end = token.data() + token.size();
+            const auto [ptr, ec] = std::from_chars(token.data(), end, value);
+
+            return ec == std::errc{} && ptr == end;
+        }
+    }
+
+    json_reader::json_reader(const std::string_view json, const error_code error)
+      : _json{json}, _error{error} {
+    }
+
+    auto json_reader::peek() -> json_type {
+
+        skip_whitespace();
+        if (_pos == _json.size()) {
+            fail();
+        }
+
+        switch (const auto c = _json[_pos]) {
+        case '{': return json_type::object;
+        case '[': return json_type::array;
+        case '"': return json_type::string;
+        case 't':
+        case 'f': return json_type::boolean;
+        case 'n': return json_type::null;
+        default:
+
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                return json_type::number;
+            }
+
+            fail();
+        }
+    }
+
+    void json_reader::begin_object() {
+
+        expect('{');
+        _first = true;
+    }
+
+    void json_reader::begin_array() {
+
+        expect('[');
+        _first = true;
+    }
+
+    auto json_reader::next_member() -> std::optional<std::string_view> {
+
+        skip_whitespace();
+        if (_pos < _json.size() && _json[_pos] == '}') {
+
+            ++_pos;
+            _first = false;
+
+            return std::nullopt;
+        }
+
+        if (!_first) {
+            expect(',');
+        }
+
+        _first = false;
+        expect('"');
+
+        // Keys without escapes, which is to say almost all of them, are returned in place.
+
+        const auto start = _pos;
+        const auto end   = find_string_special(_json, start);
+
+        if (end != std::string_view::npos && _json[end] == '"') {
+            _pos = end + 1;
+            expect(':');
+            return _json.substr(start, end - start);
+        }
+
+        _key.clear();
+        read_string_into(_key);
+        expect(':');
+
+        return std::string_view{_key};
+    }
+
+    auto json_reader::next_element() -> bool {
+
+        skip_whitespace();
+        if (_pos < _json.size() && _json[_pos] == ']') {
+
+            ++_pos;
+            _first = false;
+
+            return false;
+        }
+
+        if (!_first) {
+            expect(',');
+        }
+
+        _first = false;
+        return true;
+    }
+
+    auto json_reader::read_string() -> std::string {
+
+        expect('"');
+
+        auto result = std::string{};
+        read_string_into(result);
+
+        return result;
+    }
+
+    auto json_reader::read_double() -> double {
+
+        auto value = 0.0;
+        if (!parse_double(read_number_token(), value)) {
+            fail();
+        }
+
+        return value;
+    }
+
+    auto json_reader::read_int64() -> std::int64_t {
+
+        using limits = std::numeric_limits<std::int64_t>;
+
+        const auto token = read_number_token();
+        const auto end   = token.data() + token.size();
+
+        auto value = std::int64_t{0};
+        if (const auto [ptr, ec] = std::from_chars(token.data(), end, value);
+            ec == std::errc{} && ptr == end) {
+
+            return value;
+        }
+
+        auto real = 0.0;
+        if (!parse_double(token, real)) {
+            fail();
+        }
+
+        if (real >= static_cast<double>(limits::max())) {
+            return limits::max();
+        }
+
+        if (real <= static_cast<double>(limits::min())) {
+            return limits::min();
+        }
+
+        return static_cast<std::int64_t>(real);
+    }
+
+    auto json_reader::read_bool() -> bool {
+
+        if (peek() == json_type::number) {
+            return read_double() != 0.0;
+        }
+
+        if (_json[_pos] == 't') {
+            skip_literal("true");
+            return true;
+        }
+
+        skip_literal("false");
+        return false;
+    }
+
+    void json_reader::skip() {
+
+        switch (peek()) {
+        case json_type::string:  ++_pos; skip_string(); break;
+        case json_type::number:  read_number_token();   break;
+        case json_type::boolean: read_bool();           break;
+        case json_type::null:    skip_literal("null");  break;
+        case json_type::object:
+        case json_type::array: {
+
+            // Only the brackets need matching: strings are skipped whole, and every other
+            // character is passed over.
+
+            auto closers = std::string{};
+            do {
+
+                switch (const auto c = next()) {
+                case '{': closers += '}'; break;
+                case '[': closers += ']'; break;
+                case '"': skip_string();  break;
+                case '}':
+                case ']':
+
+                    if (closers.empty() || closers.back() != c) {
+                        fail();
+                    }
+
+                    closers.pop_back();
+                    break;
+
+                default:
+                    break;
+                }
+            }
+            while (!closers.empty());
+
+            _first = false;
+            break;
+        }
+        }
+    }
+
+    void json_reader::finish() {
+
+        skip_whitespace();
+        if (_pos != _json.size()) {
+            fail();
+        }
+    }
+
+    void json_reader::fail() const {
+        throw error{_error};
+    }
+
+    void json_reader::skip_whitespace() {
+
+        while (_pos < _json.size()) {
+
+            const auto c = _json[_pos];
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                return;
+            }
+
+            ++_pos;
+        }
+    }
+
+    auto json_reader::next() -> char {
+
+        if (_pos == _json.size()) {
+            fail();
+        }
+
+        return _json[_pos++];
+    }
+
+    void json_reader::expect(const char c) {
+
+        skip_whitespace();
+        if (next() != c) {
+            fail();
+        }
+    }
+
+    auto json_reader::read_hex4() -> std::uint32_t {
+
+        auto value = std::uint32_t{0};
+        for (auto i = 0; i < 4; ++i) {
+
+            const auto c = next();
+            const auto digit =
+                (c >= '0' && c <= '9') ? c - '0' :
+                (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+
+            if (digit < 0) {
+                fail();
+            }
+
+            value = (value << 4) | static_cast<std::uint32_t>(digit);
+        }
+
+        return value;
+    }
+
+    void json_reader::read_escape(std::string& dst) {
+
+        switch (const auto c = next()) {
+        case '"':
+        case '\\':
+        case '/': dst += c;    return;
+        case 'b': dst += '\b'; return;
+        case 'f': dst += '\f'; return;
+        case 'n': dst += '\n'; return;
+        case 'r': dst += '\r'; return;
+        case 't': dst += '\t'; return;
+        case 'u': break;
+        default:  fail();
+        }
+
+        auto code_point = read_hex4();
+
+        // Characters outside the basic multilingual plane are escaped as a UTF-16 surrogate pair.
+
+        if (code_point >= 0xd800 && code_point < 0xdc00) {
+
+            if (next() != '\\' || next() != 'u') {
+                fail();
+            }
+
+            const auto low = read_hex4();
+            if (low < 0xdc00 || low >= 0xe000) {
+                fail();
+            }
+
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+        }
+        else if (code_point >= 0xdc00 && code_point < 0xe000) {
+            fail();
+        }
+
+        append_utf8(dst, code_point);
+    }
+
+    // Reads the remainder of a string whose opening quote has been consumed, appending its
+    // decoded contents to `dst` a run of plain characters at a time.
+
+    void json_reader::read_string_into(std::string& dst) {
+
+        while (true) {
+
+            const auto end = find_string_special(_json, _pos);
+            if (end == std::string_view::npos) {
+                fail();
+            }
+
+            dst.append(_json, _pos, end - _pos);
+            _pos = end + 1;
+
+            switch (_json[end]) {
+            case '"':  _first = false;    return;
+            case '\\': read_escape(dst);  break;
+            default:   fail();
+            }
+        }
+    }
+
+    // Like `read_string_into()`, but discards the contents, and so need not decode escapes beyond
+    // stepping over the escaped character.
+
+    void json_reader::skip_string() {
+
+        while (true) {
+
+            const auto end = find_string_special(_json, _pos);
+            if (end == std::string_view::npos) {
+                fail();
+            }
+
+            _pos = end + 1;
+
+            switch (_json[end]) {
+            case '"':  _first = false; return;
+            case '\\': next();         break;
+            default:   fail();
+            }
+        }
+    }
+
+    auto json_reader::read_number_token() -> std::string_view {
+
+        skip_whitespace();
+
+        const auto start = _pos;
+        while (_pos < _json.size()) {
+
+            const auto c = _json[_pos];
+            if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') {
+                break;
+            }
+
+            ++_pos;
+        }
+
+        if (_pos == start) {
+            fail();
+        }
+
+        _first = false;
+        return _json.substr(start, _pos - start);
+    }
+
+    void json_reader::skip_literal(const std::string_view literal) {
+
+        skip_whitespace();
+        if (_json.substr(_pos, literal.size()) != literal) {
+            fail();
+        }
+
+        _pos += literal.size();
+        _first = false;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef LIBANKI_IMPL_JSON_READER_HPP
+#define LIBANKI_IMPL_JSON_READER_HPP
+
+#include "../error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace anki::impl {
+
+    enum class json_type {
+        object,
+        array,
+        string,
+        number,
+        boolean,
+        null,
+    };
+
+    // On-demand reader for JSON text: rather than building a document tree, the caller walks the
+    // text value by value, reading the values it wants and skipping the rest. Skipped values are
+    // only checked for balanced structure, and the scan for the end of each string (which, for
+    // note type CSS and templates, is most of the text) is vectorised.
+    //
+    // Objects are read with `begin_object()` followed by calls to `next_member()` until it
+    // returns `std::nullopt`, reading or skipping each member's value in between; arrays likewise
+    // with `begin_array()` and `next_element()`. Malformed text, and values of a type other than
+    // that requested, cause `anki::error` to be thrown with the code given on construction.
+
+    class json_reader {
+    public:
+
+        json_reader(std::string_view json, error_code error);
+
+        // Returns the type of the next value, without consuming it.
+
+        auto peek() -> json_type;
+
+        void begin_object();
+        void begin_array();
+
+        // Returns the key of the next member of the current object, or `std::nullopt` (consuming
+        // the closing brace) if there are no more. The key remains valid until the next call.
+
+        auto next_member() -> std::optional<std::string_view>;
+
+        // Returns whether the current array has another element, consuming the closing bracket
+        // if not.
+
+        auto next_element() -> bool;
+
+        auto read_string() -> std::string;
+        auto read_double() -> double;
+
+        // Reads a number, truncating any fractional part and clamping it to the range of the
+        // result.
+
+        auto read_int64() -> std::int64_t;
+
+        // Reads `true` or `false`, or a number, which is true if non-zero; older collections use
+        // either form for flags.
+
+        auto read_bool() -> bool;
+
+        void skip();
+
+        // Throws unless only whitespace remains.
+
+        void finish();
+
+    private:
+
+        [[noreturn]] void fail() const;
+
+        void skip_whitespace();
+        auto next() -> char;
+        void expect(char c);
+
+        auto read_hex4() -> std::uint32_t;
+        void read_escape(std::string& dst);
+        void read_string_into(std::string& dst);
+        void skip_string();
+        auto read_number_token() -> std::string_view;
+        void skip_literal(std::string_view literal);
+
+        std::string_view _json;
+        std::size_t      _pos = 0;
+        error_code       _error;
+
+        // Whether the next member or element is the first of its container, and so is not
+        // preceded by a comma.
+
+        bool _first = false;
+
+        std::string _key;
+    };
+}
+
+#endif
@@ -0,0 +1,205 @@
+#include "archive.hpp"
+
+#include "batch_source.hpp"
+#include "error.hpp"
+
+#include "ksr/final_act.hpp"
+#include "ksr/narrow_cast.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace anki::impl::libzip {
+
+    archive::archive(const path& src) {
+
+        const auto libzip_src = src.string();
+
+        auto error_code = ZIP_ER_OK;
+        _handle = zip_open(libzip_src.c_str(), ZIP_RDONLY, &error_code);
+
+        if (!_handle) {
+            throw_error(error_code);
+        }
+    }
+
+    archive::archive(std::unique_ptr<archive_file> file) {
+
+        auto error = zip_error_t{};
+        zip_error_init(&error);
+        const auto guard = ksr::final_act([&error] { zip_error_fini(&error); });
+
+        const auto source = create_batch_source(std::move(file), error);
+        if (!source) {
+            throw_error(error);
+        }
+
+        _handle = zip_open_from_source(source, ZIP_RDONLY, &error);
+        if (!_handle) {
+            zip_source_free(source);
+            throw_error(error);
+        }
+    }
+
+    archive::~archive() {
+
+        try {
+            close();
+        }
+        catch (...) {}
+    }
+
+    auto archive::contains_file(const path& file_path) const -> bool {
+
+        assert(_handle);
+
+        const auto libzip_file = file_path.string();
+        const auto result = zip_name_locate(_handle, libzip_file.c_str(), 0);
+
+        // Somewhat strangely, `zip_name_locate()` fails and sets a `ZIP_ER_NOENT` when the file is not
+        // contained within the archive. So we explicitly exclude that case from error detection.
+
+        const auto error = zip_get_error(_handle);
+        if (error && has_error_excluding(*error, ZIP_ER_NOENT)) {
+            throw_error(*error);
+        }
+
+        return result >= 0;
+    }
+
+    auto archive::stat_file(const path& file_path) const -> zip_entry_info {
+
+        assert(_handle);
+
+        const auto libzip_file_path = file_path.string();
+
+        auto stat = zip_stat_t{};
+        zip_stat_init(&stat);
+
+        if (zip_stat(_handle, libzip_file_path.c_str(), 0, &stat) != 0) {
+            throw_error(*_handle);
+        }
+
+        // libzip reads all of these from the central directory, so they should always be valid for
+        // an entry of an archive opened from a file; anything else indicates a malformed archive.
+
+        static constexpr auto required_fields = zip_uint64_t{
+            ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE | ZIP_STAT_CRC |
+            ZIP_STAT_COMP_METHOD | ZIP_STAT_ENCRYPTION_METHOD};
+
+        if ((stat.valid & required_fields) != required_fields) {
+            throw_error(ZIP_ER_INCONS);
+        }
+
+        auto info = zip_entry_info{};
+        info.method          = zip_method{stat.comp_method};
+        info.compressed_size = stat.comp_size;
+        info.size            = stat.size;
+        info.crc             = stat.crc;
+        info.encrypted       = (stat.encryption_method != ZIP_EM_NONE);
+
+        return info;
+    }
+
+    auto archive::open_file(const path& file_path, const bool raw) const
+        -> std::unique_ptr<file_backend> {
+
+        assert(_handle);
+
+        const auto libzip_file_path = file_path.string();
+        const auto flags            = raw ? zip_flags_t{ZIP_FL_COMPRESSED} : zip_flags_t{0};
+        const auto file_handle      = zip_fopen(_handle, libzip_file_path.c_str(), flags);
+
+        if (!file_handle) {
+            throw_error(*_handle);
+        }
+
+        return std::make_unique<file>(file_handle);
+    }
+
+    void archive::close() {
+
+        if (!_handle) {
+            return;
+        }
+
+        const bool result = zip_close(_handle);
+        if (result != 0) {
+            throw_error(*_handle);
+        }
+
+        _handle = nullptr;
+    }
+
+    file::~file() {
+
+        try {
+            close();
+        }
+        catch (...) {}
+    }
+
+    auto file::read(std::byte* const dst, const std::size_t size) -> std::size_t {
+
+        assert(_handle);
+
+        const auto wide_size_read = std::int64_t{zip_fread(_handle, dst, size)};
+        if (wide_size_read < 0) {
+            throw_error(*_handle);
+        }
+
+        return ksr::narrow_cast<std::size_t>(wide_size_read);
+    }
+
+    auto file::read_all() -> std::vector<std::byte> {
+
+        static constexpr auto chunk_size = std::size_t{8192}; // Arbitrary; not profiled
+
+        assert(_handle);
+
+        auto bytes     = std::vector<std::byte>{};
+        auto pos       = std::size_t{0};
+        auto size_read = std::size_t{0};
+
+        do {
+
+            // Each chunk of `bytes` is unnecessarily zeroed before being populated with data read
+            // from the file; this seems unlikely to be a performance problem though.
+
+            pos = bytes.size();
+            bytes.resize(pos + chunk_size);
+
+            const auto wide_size_read = std::int64_t{zip_fread(_handle, &bytes[pos], chunk_size)};
+            if (wide_size_read >= 0) {
+                size_read = ksr::narrow_cast<std::size_t>(wide_size_read);
+            }
+            else {
+                throw_error(*_handle);
+            }
+        }
+        while (size_read == chunk_size);
+
+        assert(size_read < chunk_size);
+        const auto unused_size = chunk_size - size_read;
+
+        assert(unused_size < bytes.size());
+        bytes.resize(bytes.size() - unused_size);
+
+        return bytes;
+    }
+
+    void file::close() {
+
+        if (!_handle) {
+            return;
+        }
+
+        const auto error_code = zip_fclose(_handle);
+        if (error_code != 0) {
+            throw_error(error_code);
+        }
+
+        _handle = nullptr;
+    }
+}
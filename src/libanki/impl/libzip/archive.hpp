@@ -0,0 +1,61 @@
+#ifndef LIBANKI_IMPL_LIBZIP_ARCHIVE_HPP
+#define LIBANKI_IMPL_LIBZIP_ARCHIVE_HPP
+
+#include "../archive_backend.hpp"
+#include "../archive_file.hpp"
+
+#include "zip.h"
+
+#include <memory>
+
+namespace anki::impl::libzip {
+
+    // Backend implementing `zip_archive` with libzip, which performs all parsing, decompression
+    // and CRC verification itself.
+
+    class archive : public archive_backend {
+    public:
+
+        // Opens an archive from the filesystem path `src` through libzip's own file I/O.
+
+        explicit archive(const path& src);
+
+        // Opens an archive from `file`, through a source that routes all reads via that file's
+        // reader and cached ranges; see `create_batch_source()`.
+
+        explicit archive(std::unique_ptr<archive_file> file);
+
+        ~archive() override;
+
+        auto contains_file(const path& file_path) const -> bool override;
+        auto stat_file(const path& file_path) const -> zip_entry_info override;
+
+        auto open_file(const path& file_path, bool raw) const
+            -> std::unique_ptr<file_backend> override;
+
+        void close() override;
+
+    private:
+
+        zip_t* _handle = nullptr;
+    };
+
+    class file : public file_backend {
+    public:
+
+        explicit file(zip_file_t* handle)
+          : _handle{handle} {}
+
+        ~file() override;
+
+        auto read(std::byte* dst, std::size_t size) -> std::size_t override;
+        auto read_all() -> std::vector<std::byte> override;
+        void close() override;
+
+    private:
+
+        zip_file_t* _handle = nullptr;
+    };
+}
+
+#endif
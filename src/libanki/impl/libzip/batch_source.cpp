@@ -0,0 +1,156 @@
+#include "batch_source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace anki::impl::libzip {
+
+    namespace {
+
+        class batch_source {
+        public:
+
+            explicit batch_source(std::unique_ptr<archive_file> file)
+              : _file{std::move(file)} {
+
+                zip_error_init(&_error);
+            }
+
+            ~batch_source() {
+                zip_error_fini(&_error);
+            }
+
+            batch_source(batch_source&&)      = delete;
+            batch_source(const batch_source&) = delete;
+
+            auto operator=(batch_source&&)      -> batch_source& = delete;
+            auto operator=(const batch_source&) -> batch_source& = delete;
+
+            // Implements the libzip source callback protocol; see `zip_source_function()`.
+
+            auto invoke(void* data, zip_uint64_t len, zip_source_cmd_t cmd) -> zip_int64_t;
+
+        private:
+
+            auto read(std::byte* dst, zip_uint64_t len) -> zip_int64_t;
+            auto stat(void* data, zip_uint64_t len) -> zip_int64_t;
+
+            std::unique_ptr<archive_file> _file;
+            std::uint64_t                 _pos = 0;
+            zip_error_t                   _error;
+        };
+
+        auto batch_source::invoke(void* const data, const zip_uint64_t len, const zip_source_cmd_t cmd)
+            -> zip_int64_t {
+
+            switch (cmd) {
+
+            case ZIP_SOURCE_OPEN:
+                _pos = 0;
+                return 0;
+
+            case ZIP_SOURCE_READ:
+                return read(static_cast<std::byte*>(data), len);
+
+            case ZIP_SOURCE_CLOSE:
+                return 0;
+
+            case ZIP_SOURCE_STAT:
+                return stat(data, len);
+
+            case ZIP_SOURCE_ERROR:
+                return zip_error_to_data(&_error, data, len);
+
+            case ZIP_SOURCE_FREE:
+                delete this;
+                return 0;
+
+            case ZIP_SOURCE_SEEK: {
+
+                const auto pos = zip_source_seek_compute_offset(_pos, _file->size(), data, len, &_error);
+                if (pos < 0) {
+                    return -1;
+                }
+
+                _pos = static_cast<std::uint64_t>(pos);
+                return 0;
+            }
+
+            case ZIP_SOURCE_TELL:
+                return static_cast<zip_int64_t>(_pos);
+
+            case ZIP_SOURCE_SUPPORTS:
+                return zip_source_make_command_bitmask(
+                    ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT,
+                    ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, ZIP_SOURCE_SEEK, ZIP_SOURCE_TELL,
+                    ZIP_SOURCE_SUPPORTS, -1);
+
+            default:
+                zip_error_set(&_error, ZIP_ER_OPNOTSUPP, 0);
+                return -1;
+            }
+        }
+
+        auto batch_source::read(std::byte* const dst, const zip_uint64_t len) -> zip_int64_t {
+
+            try {
+
+                const auto size      = std::min<zip_uint64_t>(len, std::numeric_limits<std::size_t>::max());
+                const auto size_read = _file->read_at(_pos, dst, static_cast<std::size_t>(size));
+                _pos += size_read;
+
+                return static_cast<zip_int64_t>(size_read);
+            }
+            catch (const std::bad_alloc&) {
+                zip_error_set(&_error, ZIP_ER_MEMORY, 0);
+            }
+            catch (...) {
+                zip_error_set(&_error, ZIP_ER_READ, errno);
+            }
+
+            return -1;
+        }
+
+        auto batch_source::stat(void* const data, const zip_uint64_t len) -> zip_int64_t {
+
+            if (len < sizeof(zip_stat_t)) {
+                zip_error_set(&_error, ZIP_ER_INVAL, 0);
+                return -1;
+            }
+
+            auto& stat = *static_cast<zip_stat_t*>(data);
+            zip_stat_init(&stat);
+
+            stat.valid = ZIP_STAT_SIZE;
+            stat.size  = _file->size();
+
+            return sizeof(zip_stat_t);
+        }
+
+        auto source_callback(void* state, void* data, zip_uint64_t len, zip_source_cmd_t cmd)
+            -> zip_int64_t {
+
+            return static_cast<batch_source*>(state)->invoke(data, len, cmd);
+        }
+    }
+
+    auto create_batch_source(std::unique_ptr<archive_file> file, zip_error_t& error)
+        -> zip_source_t* {
+
+        const auto state = new (std::nothrow) batch_source{std::move(file)};
+        if (!state) {
+            zip_error_set(&error, ZIP_ER_MEMORY, 0);
+            return nullptr;
+        }
+
+        const auto source = zip_source_function_create(source_callback, state, &error);
+        if (!source) {
+            delete state;
+        }
+
+        return source;
+    }
+}
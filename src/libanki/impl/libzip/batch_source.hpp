@@ -0,0 +1,24 @@
+#ifndef LIBANKI_IMPL_LIBZIP_BATCH_SOURCE_HPP
+#define LIBANKI_IMPL_LIBZIP_BATCH_SOURCE_HPP
+
+#include "../archive_file.hpp"
+
+#include "zip.h"
+
+#include <memory>
+
+namespace anki::impl::libzip {
+
+    // Creates a libzip source reading from `file`, so that libzip's reads go through the file's
+    // `batch_reader` (if any) and are served from its cached ranges where possible. This lets
+    // libzip parse a central directory fetched up front as part of a larger batch without issuing
+    // any reads of its own.
+    //
+    // On success, the returned source owns `file`. On failure, returns `nullptr` and populates
+    // `error`.
+
+    auto create_batch_source(std::unique_ptr<archive_file> file, zip_error_t& error)
+        -> zip_source_t*;
+}
+
+#endif
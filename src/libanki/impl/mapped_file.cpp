@@ -0,0 +1,71 @@
+#include "mapped_file.hpp"
+
+#include "../error.hpp"
+
+#include "ksr/final_act.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace anki::impl {
+
+    mapped_file::mapped_file(const path& src) {
+
+        const auto fd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw error{error_code::system_error};
+        }
+
+        const auto guard = ksr::final_act([fd] { ::close(fd); });
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            throw error{error_code::system_error};
+        }
+
+        _size = static_cast<std::size_t>(info.st_size);
+        if (_size == 0) {
+            return;
+        }
+
+        // The mapping outlives the descriptor, so the file need not be kept open.
+
+        const auto ptr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) {
+            throw error{error_code::system_error};
+        }
+
+        _data = static_cast<const std::byte*>(ptr);
+    }
+
+    mapped_file::~mapped_file() {
+        unmap();
+    }
+
+    mapped_file::mapped_file(mapped_file&& rhs) noexcept
+      : _data{std::exchange(rhs._data, nullptr)}, _size{std::exchange(rhs._size, 0)} {
+    }
+
+    auto mapped_file::operator=(mapped_file&& rhs) noexcept -> mapped_file& {
+
+        if (this != &rhs) {
+
+            unmap();
+            _data = std::exchange(rhs._data, nullptr);
+            _size = std::exchange(rhs._size, 0);
+        }
+
+        return *this;
+    }
+
+    void mapped_file::unmap() noexcept {
+
+        if (_data) {
+            ::munmap(const_cast<std::byte*>(_data), _size);
+        }
+    }
+}
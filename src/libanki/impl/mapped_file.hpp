@@ -0,0 +1,40 @@
+#ifndef LIBANKI_IMPL_MAPPED_FILE_HPP
+#define LIBANKI_IMPL_MAPPED_FILE_HPP
+
+#include "../filesystem.hpp"
+
+#include <cstddef>
+
+namespace anki::impl {
+
+    // Read-only mapping of the whole of a file into memory, which pages it in on demand and
+    // shares those pages with any other process mapping the same file.
+
+    class mapped_file {
+    public:
+
+        // Maps the file at `src`. Throws `anki::error` with `error_code::system_error` if it cannot
+        // be opened or mapped; an empty file maps to an empty range.
+
+        explicit mapped_file(const path& src);
+        ~mapped_file();
+
+        mapped_file(mapped_file&& rhs) noexcept;
+        auto operator=(mapped_file&& rhs) noexcept -> mapped_file&;
+
+        mapped_file(const mapped_file&) = delete;
+        auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+        auto data() const noexcept -> const std::byte* { return _data; }
+        auto size() const noexcept -> std::size_t      { return _size; }
+
+    private:
+
+        void unmap() noexcept;
+
+        const std::byte* _data = nullptr;
+        std::size_t      _size = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include "media_manifest.hpp"
+
+#include "json_reader.hpp"
+
+namespace anki::impl {
+
+    namespace {
+
+        // Appends `text` to `dst` as a JSON string literal.
+
+        void append_json_string(std::string& dst, const std::string_view text) {
+
+            static constexpr auto hex_digits = "0123456789abcdef";
+
+            dst += '"';
+
+            for (const auto c : text) {
+
+                const auto code = static_cast<unsigned char>(c);
+
+                if (c == '"' || c == '\\') {
+                    dst += '\\';
+                    dst += c;
+                }
+                else if (code < 0x20) {
+                    dst += "\\u00";
+                    dst += hex_digits[code >> 4];
+                    dst += hex_digits[code & 0xf];
+                }
+                else {
+                    dst += c;
+                }
+            }
+
+            dst += '"';
+        }
+    }
+
+    auto parse_media_manifest(const std::string_view json) -> std::vector<media_entry> {
+
+        auto reader  = json_reader{json, error_code::invalid_media_manifest};
+        auto entries = std::vector<media_entry>{};
+
+        reader.begin_object();
+        while (const auto key = reader.next_member()) {
+
+            auto& entry = entries.emplace_back();
+            entry.archive_name = *key;
+            entry.name         = reader.read_string();
+        }
+
+        reader.finish();
+        return entries;
+    }
+
+    auto format_media_manifest(const std::vector<media_entry>& entries) -> std::string {
+
+        auto manifest = std::string{"{"};
+
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+            if (i > 0) {
+                manifest += ", ";
+            }
+
+            append_json_string(manifest, entries[i].archive_name);
+            manifest += ": ";
+            append_json_string(manifest, entries[i].name);
+        }
+
+        manifest += '}';
+        return manifest;
+    }
+}
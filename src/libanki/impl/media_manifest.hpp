@@ -0,0 +1,27 @@
+#ifndef LIBANKI_IMPL_MEDIA_MANIFEST_HPP
+#define LIBANKI_IMPL_MEDIA_MANIFEST_HPP
+
+#include "../collection_records.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+
+    // Path of the media manifest within packages of every version: a JSON object mapping the name
+    // of the entry holding each media file to that file's name.
+
+    inline constexpr auto media_manifest_path = std::string_view{"media"};
+
+    // Parses the media manifest `json`, returning its entries in the order they appear. Throws
+    // `anki::error` if `json` is not an object whose values are all strings.
+
+    auto parse_media_manifest(std::string_view json) -> std::vector<media_entry>;
+
+    // Formats `entries` as a media manifest.
+
+    auto format_media_manifest(const std::vector<media_entry>& entries) -> std::string;
+}
+
+#endif
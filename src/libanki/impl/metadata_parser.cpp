@@ -0,0 +1,320 @@
+#include "metadata_parser.hpp"
+
+#include "json_reader.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <utility>
+
+namespace anki::impl {
+
+    namespace {
+
+        // Each `read_into()` overload reads a value into `dst` if it has the expected type, and
+        // otherwise skips it, leaving `dst` unchanged: Anki has written `null`s and other oddities
+        // for some members over the years, none of which should prevent an import.
+
+        void read_into(json_reader& reader, std::int64_t& dst) {
+
+            if (reader.peek() == json_type::number) {
+                dst = reader.read_int64();
+            }
+            else {
+                reader.skip();
+            }
+        }
+
+        void read_into(json_reader& reader, double& dst) {
+
+            if (reader.peek() == json_type::number) {
+                dst = reader.read_double();
+            }
+            else {
+                reader.skip();
+            }
+        }
+
+        void read_into(json_reader& reader, bool& dst) {
+
+            const auto type = reader.peek();
+            if (type == json_type::boolean || type == json_type::number) {
+                dst = reader.read_bool();
+            }
+            else {
+                reader.skip();
+            }
+        }
+
+        void read_into(json_reader& reader, std::string& dst) {
+
+            if (reader.peek() == json_type::string) {
+                dst = reader.read_string();
+            }
+            else {
+                reader.skip();
+            }
+        }
+
+        // Calls `read_element()` for each element of an array, or skips a value of another type.
+
+        template<typename fn>
+        void read_array(json_reader& reader, fn read_element) {
+
+            if (reader.peek() != json_type::array) {
+                reader.skip();
+                return;
+            }
+
+            reader.begin_array();
+            while (reader.next_element()) {
+                read_element();
+            }
+        }
+
+        // Elements that are not numbers are skipped rather than read as 0.
+
+        void read_into(json_reader& reader, std::vector<double>& dst) {
+
+            if (reader.peek() != json_type::array) {
+                reader.skip();
+                return;
+            }
+
+            auto values = std::vector<double>{};
+            read_array(reader, [&reader, &values] {
+                if (reader.peek() == json_type::number) {
+                    values.push_back(reader.read_double());
+                }
+                else {
+                    reader.skip();
+                }
+            });
+
+            dst = std::move(values);
+        }
+
+        // Calls `read_member(key)` for each member of an object, skipping those for which it
+        // returns `false`, or skips a value of another type.
+
+        template<typename fn>
+        void read_object(json_reader& reader, fn read_member) {
+
+            if (reader.peek() != json_type::object) {
+                reader.skip();
+                return;
+            }
+
+            reader.begin_object();
+            while (const auto key = reader.next_member()) {
+                if (!read_member(*key)) {
+                    reader.skip();
+                }
+            }
+        }
+
+        // Sorts `(ordinal, value)` pairs by ordinal, returning the values alone.
+
+        template<typename t>
+        auto in_ordinal_order(std::vector<std::pair<std::int64_t, t>>& entries) -> std::vector<t> {
+
+            std::stable_sort(entries.begin(), entries.end(), [] (const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
+
+            auto result = std::vector<t>{};
+            result.reserve(entries.size());
+
+            for (auto& entry : entries) {
+                result.push_back(std::move(entry.second));
+            }
+
+            return result;
+        }
+
+        // Parses the top-level object of a `col` column, reading each value with `read_entry()`.
+        // Entries lacking an ID take it from their key.
+
+        template<typename t, typename fn>
+        auto parse_by_id(const std::string_view json, fn read_entry) -> std::vector<t> {
+
+            auto reader = json_reader{json, error_code::invalid_collection};
+            auto result = std::vector<t>{};
+
+            reader.begin_object();
+            while (const auto key = reader.next_member()) {
+
+                auto key_id = std::int64_t{0};
+                static_cast<void>(std::from_chars(key->data(), key->data() + key->size(), key_id));
+
+                auto& entry = result.emplace_back(read_entry(reader));
+                if (entry.id == 0) {
+                    entry.id = key_id;
+                }
+            }
+
+            reader.finish();
+
+            std::stable_sort(result.begin(), result.end(), [] (const t& lhs, const t& rhs) {
+                return lhs.id < rhs.id;
+            });
+
+            return result;
+        }
+
+        auto read_notetype(json_reader& reader) -> notetype {
+
+            auto result    = notetype{};
+            auto fields    = std::vector<std::pair<std::int64_t, std::string>>{};
+            auto templates = std::vector<std::pair<std::int64_t, card_template>>{};
+
+            const auto read_field = [&reader, &fields] {
+
+                auto& [ordinal, name] = fields.emplace_back(std::int64_t{0}, std::string{});
+                read_object(reader, [&] (const std::string_view key) {
+
+                    if      (key == "name") { read_into(reader, name); }
+                    else if (key == "ord")  { read_into(reader, ordinal); }
+                    else                    { return false; }
+
+                    return true;
+                });
+            };
+
+            const auto read_template = [&reader, &templates] {
+
+                auto& [ordinal, tmpl] = templates.emplace_back(std::int64_t{0}, card_template{});
+                read_object(reader, [&] (const std::string_view key) {
+
+                    if      (key == "name") { read_into(reader, tmpl.name); }
+                    else if (key == "ord")  { read_into(reader, ordinal); }
+                    else if (key == "qfmt") { read_into(reader, tmpl.question_format); }
+                    else if (key == "afmt") { read_into(reader, tmpl.answer_format); }
+                    else                    { return false; }
+
+                    return true;
+                });
+            };
+
+            read_object(reader, [&] (const std::string_view key) {
+
+                if (key == "type") {
+
+                    auto type = std::int64_t{0};
+                    read_into(reader, type);
+
+                    result.cloze = type == 1;
+                }
+                else if (key == "id")    { read_into(reader, result.id); }
+                else if (key == "name")  { read_into(reader, result.name); }
+                else if (key == "sortf") { read_into(reader, result.sort_field); }
+                else if (key == "mod")   { read_into(reader, result.modified); }
+                else if (key == "css")   { read_into(reader, result.css); }
+                else if (key == "flds")  { read_array(reader, read_field); }
+                else if (key == "tmpls") { read_array(reader, read_template); }
+                else                     { return false; }
+
+                return true;
+            });
+
+            result.fields    = in_ordinal_order(fields);
+            result.templates = in_ordinal_order(templates);
+
+            return result;
+        }
+
+        auto read_deck(json_reader& reader) -> deck {
+
+            auto result = deck{};
+            read_object(reader, [&] (const std::string_view key) {
+
+                if      (key == "id")   { read_into(reader, result.id); }
+                else if (key == "name") { read_into(reader, result.name); }
+                else if (key == "conf") { read_into(reader, result.config_id); }
+                else if (key == "dyn")  { read_into(reader, result.filtered); }
+                else                    { return false; }
+
+                return true;
+            });
+
+            if (result.filtered) {
+                result.config_id = 0;
+            }
+
+            return result;
+        }
+
+        auto read_deck_config(json_reader& reader) -> deck_config {
+
+            auto result = deck_config{};
+
+            const auto read_new = [&] (const std::string_view key) {
+
+                if (key == "ints") {
+
+                    auto intervals = std::vector<double>{};
+                    read_into(reader, intervals);
+
+                    if (intervals.size() >= 2) {
+                        result.graduating_interval = static_cast<std::int64_t>(intervals[0]);
+                        result.easy_interval       = static_cast<std::int64_t>(intervals[1]);
+                    }
+                }
+                else if (key == "perDay")        { read_into(reader, result.new_per_day); }
+                else if (key == "delays")        { read_into(reader, result.learning_steps); }
+                else if (key == "initialFactor") { read_into(reader, result.initial_ease); }
+                else                             { return false; }
+
+                return true;
+            };
+
+            const auto read_review = [&] (const std::string_view key) {
+
+                if      (key == "perDay") { read_into(reader, result.reviews_per_day); }
+                else if (key == "ease4")  { read_into(reader, result.easy_bonus); }
+                else if (key == "ivlFct") { read_into(reader, result.interval_modifier); }
+                else if (key == "maxIvl") { read_into(reader, result.maximum_interval); }
+                else                      { return false; }
+
+                return true;
+            };
+
+            const auto read_lapse = [&] (const std::string_view key) {
+
+                if      (key == "delays")     { read_into(reader, result.relearning_steps); }
+                else if (key == "mult")       { read_into(reader, result.lapse_multiplier); }
+                else if (key == "minInt")     { read_into(reader, result.minimum_lapse_interval); }
+                else if (key == "leechFails") { read_into(reader, result.leech_threshold); }
+                else                          { return false; }
+
+                return true;
+            };
+
+            read_object(reader, [&] (const std::string_view key) {
+
+                if      (key == "id")    { read_into(reader, result.id); }
+                else if (key == "name")  { read_into(reader, result.name); }
+                else if (key == "new")   { read_object(reader, read_new); }
+                else if (key == "rev")   { read_object(reader, read_review); }
+                else if (key == "lapse") { read_object(reader, read_lapse); }
+                else                     { return false; }
+
+                return true;
+            });
+
+            return result;
+        }
+    }
+
+    auto parse_notetypes(const std::string_view json) -> std::vector<notetype> {
+        return parse_by_id<notetype>(json, read_notetype);
+    }
+
+    auto parse_decks(const std::string_view json) -> std::vector<deck> {
+        return parse_by_id<deck>(json, read_deck);
+    }
+
+    auto parse_deck_configs(const std::string_view json) -> std::vector<deck_config> {
+        return parse_by_id<deck_config>(json, read_deck_config);
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef LIBANKI_IMPL_METADATA_PARSER_HPP
+#define LIBANKI_IMPL_METADATA_PARSER_HPP
+
+#include "../collection_metadata.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+
+    // Parse the JSON of the corresponding column of the `col` table, an object keyed by ID,
+    // returning its entries in order of ID. Only the members held by the result are decoded; the
+    // rest are skipped. Throws `anki::error` if `json` is malformed.
+
+    auto parse_notetypes(std::string_view json) -> std::vector<notetype>;
+    auto parse_decks(std::string_view json) -> std::vector<deck>;
+    auto parse_deck_configs(std::string_view json) -> std::vector<deck_config>;
+}
+
+#endif
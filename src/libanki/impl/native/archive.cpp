@@ -0,0 +1,268 @@
+#include "archive.hpp"
+
+#include "../../error.hpp"
+#include "../crc32.hpp"
+#include "../inflate_buffer.hpp"
+#include "../zip_format.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace anki::impl::native {
+
+    namespace {
+
+        // Returns a buffer of at least `size` bytes for compressed entry data, kept per thread so
+        // that concurrent reads neither contend for nor repeatedly allocate one. A buffer grown beyond
+        // `retained_size` shrinks again on the next call that needs no more, so that one large
+        // entry does not pin that much memory on every thread that has ever read it.
+
+        auto compressed_scratch(const std::size_t size) -> std::byte* {
+
+            static constexpr auto retained_size = std::size_t{1} << 22; // Arbitrary; not profiled
+            thread_local auto buffer = std::vector<std::byte>{};
+
+            if (buffer.size() > retained_size && size <= retained_size) {
+                buffer = std::vector<std::byte>(retained_size);
+            }
+
+            if (buffer.size() < size) {
+                buffer.resize(size);
+            }
+
+            return buffer.data();
+        }
+    }
+
+    archive::archive(archive_file file)
+      : _file{std::make_shared<const archive_file>(std::move(file))},
+        _directory{*_file},
+        _data_offsets{new std::atomic<std::uint64_t>[_directory.entries().size()]} {
+
+        for (auto i = std::size_t{0}; i < _directory.entries().size(); ++i) {
+            _data_offsets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    auto archive::contains_file(const path& file_path) const -> bool {
+
+        assert(_file);
+        return _directory.find(file_path.string()) != nullptr;
+    }
+
+    auto archive::stat_file(const path& file_path) const -> zip_entry_info {
+        return find_entry(file_path).info;
+    }
+
+    auto archive::open_file(const path& file_path, const bool raw) const
+        -> std::unique_ptr<file_backend> {
+
+        const auto& target = find_entry(file_path);
+
+        // These match the checks libzip makes on opening a file, so that both backends report
+        // unreadable entries at the same point.
+
+        if (!raw) {
+
+            if (target.info.encrypted) {
+                throw error{error_code::zip_password_required};
+            }
+
+            if (target.info.method != zip_method::stored && target.info.method != zip_method::deflated) {
+                throw error{error_code::zip_unsupported_compression_method};
+            }
+        }
+
+        const auto offset = entry_data_offset(target);
+        return std::make_unique<file>(_file, target.info, offset, raw);
+    }
+
+    void archive::close() {
+        _file.reset();
+    }
+
+    auto archive::locate_file(const path& file_path) const -> data_location {
+
+        const auto& target = find_entry(file_path);
+        return data_location{target.info, entry_data_offset(target)};
+    }
+
+    auto archive::find_entry(const path& file_path) const -> const entry& {
+
+        assert(_file);
+
+        const auto target = _directory.find(file_path.string());
+        if (!target) {
+            throw error{error_code::zip_file_not_found};
+        }
+
+        return *target;
+    }
+
+    auto archive::entry_data_offset(const entry& target) const -> std::uint64_t {
+
+        // Threads that race to fill the same slot read the same local header and store the same
+        // value, so no ordering beyond atomicity is needed.
+
+        const auto index = &target - _directory.entries().data();
+        auto& slot = _data_offsets[ksr::narrow_cast<std::size_t>(index)];
+
+        auto offset = slot.load(std::memory_order_relaxed);
+        if (offset == 0) {
+            offset = data_offset(*_file, target);
+            slot.store(offset, std::memory_order_relaxed);
+        }
+
+        return offset;
+    }
+
+    file::file(
+        std::weak_ptr<const archive_file> archive, const zip_entry_info& info,
+        const std::uint64_t data_offset, const bool raw)
+      : _archive{std::move(archive)}, _info{info}, _data_offset{data_offset}, _raw{raw} {
+    }
+
+    auto file::read(std::byte* const dst, const std::size_t size) -> std::size_t {
+
+        const auto archive = lock_archive();
+
+        // Deflated entries are decoded whole on the first read and subsequently served from
+        // memory; the caller's buffer is rarely large enough to decode into directly.
+
+        if (!_raw && _info.method == zip_method::deflated) {
+
+            if (_pos == 0 && _decoded.empty()) {
+                _decoded = decode_all(*archive);
+            }
+
+            // `read_all()` from the start decodes into its own buffer rather than `_decoded`,
+            // leaving nothing for later reads.
+
+            if (_pos == _info.size || _pos > _decoded.size()) {
+                return 0;
+            }
+
+            const auto available = _decoded.size() - ksr::narrow_cast<std::size_t>(_pos);
+            const auto size_read = std::min(size, available);
+
+            std::copy_n(_decoded.data() + _pos, size_read, dst);
+            _pos += size_read;
+
+            return size_read;
+        }
+
+        // Otherwise the entry is stored, or read raw, so is read straight from the archive; a
+        // stored entry must then take up as many bytes there as it has, as `decode_all()` checks.
+
+        if (!_raw && _info.compressed_size != _info.size) {
+            throw error{error_code::zip_archive_inconsistent};
+        }
+
+        const auto total     = _raw ? _info.compressed_size : _info.size;
+        const auto size_read = ksr::narrow_cast<std::size_t>(std::min<std::uint64_t>(size, total - _pos));
+
+        archive->read_exact_at(_data_offset + _pos, dst, size_read);
+        _pos += size_read;
+
+        if (!_raw) {
+
+            _crc = impl::crc32(_crc, dst, size_read);
+            if (_pos == total && _crc != _info.crc) {
+                throw error{error_code::zip_bad_crc};
+            }
+        }
+
+        return size_read;
+    }
+
+    auto file::read_all() -> std::vector<std::byte> {
+
+        // Reading from the start is the common case, and can go straight to a buffer of the
+        // final size; anything else reads the remainder through `read()`.
+
+        if (_pos == 0) {
+
+            const auto archive = lock_archive();
+
+            if (_raw) {
+
+                auto bytes = std::vector<std::byte>(ksr::narrow_cast<std::size_t>(_info.compressed_size));
+                archive->read_exact_at(_data_offset, bytes.data(), bytes.size());
+
+                _pos = _info.compressed_size;
+                return bytes;
+            }
+
+            // The data has been checked whole, so a later `read()` at the end has nothing left
+            // to check either.
+
+            auto bytes = decode_all(*archive);
+            _pos = _info.size;
+            _crc = _info.crc;
+
+            return bytes;
+        }
+
+        static constexpr auto chunk_size = std::size_t{8192}; // Arbitrary; not profiled
+
+        auto bytes = std::vector<std::byte>{};
+        auto size_read = std::size_t{0};
+
+        do {
+
+            const auto pos = bytes.size();
+            bytes.resize(pos + chunk_size);
+
+            size_read = read(bytes.data() + pos, chunk_size);
+            bytes.resize(pos + size_read);
+        }
+        while (size_read == chunk_size);
+
+        return bytes;
+    }
+
+    void file::close() {
+        _archive.reset();
+    }
+
+    auto file::lock_archive() const -> std::shared_ptr<const archive_file> {
+
+        auto archive = _archive.lock();
+        if (!archive) {
+            throw error{error_code::zip_archive_closed};
+        }
+
+        return archive;
+    }
+
+    auto file::decode_all(const archive_file& archive) const -> std::vector<std::byte> {
+
+        auto bytes = std::vector<std::byte>(zip_format::checked_entry_size(_info));
+
+        if (_info.method == zip_method::stored) {
+
+            if (_info.compressed_size != _info.size) {
+                throw error{error_code::zip_archive_inconsistent};
+            }
+
+            archive.read_exact_at(_data_offset, bytes.data(), bytes.size());
+        }
+        else {
+
+            const auto compressed_size = ksr::narrow_cast<std::size_t>(_info.compressed_size);
+            const auto compressed      = compressed_scratch(compressed_size);
+
+            archive.read_exact_at(_data_offset, compressed, compressed_size);
+            inflate_buffer(compressed, compressed_size, bytes.data(), bytes.size());
+        }
+
+        if (impl::crc32(0, bytes.data(), bytes.size()) != _info.crc) {
+            throw error{error_code::zip_bad_crc};
+        }
+
+        return bytes;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef LIBANKI_IMPL_NATIVE_ARCHIVE_HPP
+#define LIBANKI_IMPL_NATIVE_ARCHIVE_HPP
+
+#include "../archive_backend.hpp"
+#include "../archive_file.hpp"
+#include "central_directory.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace anki::impl::native {
+
+    // Backend implementing `zip_archive` with an in-house, read-only zip parser. The central
+    // directory is parsed once on opening; entries are decompressed whole into buffers sized from
+    // the central directory, rather than through a streaming decoder.
+    //
+    // Every `const` member may be called concurrently from any number of threads, without
+    // locking: the directory is immutable once parsed, the offset of each entry's data is cached
+    // atomically when first found, and decoder state is kept per thread. Only `close()` requires
+    // exclusive access.
+
+    class archive : public archive_backend {
+    public:
+
+        explicit archive(archive_file file);
+
+        auto contains_file(const path& file_path) const -> bool override;
+        auto stat_file(const path& file_path) const -> zip_entry_info override;
+
+        auto open_file(const path& file_path, bool raw) const
+            -> std::unique_ptr<file_backend> override;
+
+        void close() override;
+
+        // Central directory record of the specified file and the offset of its data within
+        // `source()`, for callers that copy or decode the data themselves. Throws as `open_file()`
+        // does if there is no such file.
+
+        struct data_location {
+            zip_entry_info info;
+            std::uint64_t  offset = 0;
+        };
+
+        auto locate_file(const path& file_path) const -> data_location;
+
+        auto source() const noexcept -> const archive_file& { return *_file; }
+
+    private:
+
+        auto find_entry(const path& file_path) const -> const entry&;
+        auto entry_data_offset(const entry& target) const -> std::uint64_t;
+
+        std::shared_ptr<const archive_file> _file;
+        central_directory                   _directory;
+
+        // Offset of each entry's data, indexed as `_directory.entries()`, or 0 where not yet read
+        // from the entry's local header (data can never begin at offset 0).
+
+        std::unique_ptr<std::atomic<std::uint64_t>[]> _data_offsets;
+    };
+
+    // File opened from a native `archive`. Holds only a weak reference to the archive file, so
+    // that operations fail once the archive is closed.
+
+    class file : public file_backend {
+    public:
+
+        file(std::weak_ptr<const archive_file> archive, const zip_entry_info& info,
+             std::uint64_t data_offset, bool raw);
+
+        auto read(std::byte* dst, std::size_t size) -> std::size_t override;
+        auto read_all() -> std::vector<std::byte> override;
+        void close() override;
+
+    private:
+
+        auto lock_archive() const -> std::shared_ptr<const archive_file>;
+        auto decode_all(const archive_file& archive) const -> std::vector<std::byte>;
+
+        std::weak_ptr<const archive_file> _archive;
+        zip_entry_info                    _info;
+        std::uint64_t                     _data_offset;
+        bool                              _raw;
+
+        // Position within the data as read (whether raw or decoded), the running CRC of stored data
+        // read so far, and the fully decoded data of a deflated entry once it is first read.
+
+        std::uint64_t          _pos = 0;
+        std::uint32_t          _crc = 0;
+        std::vector<std::byte> _decoded;
+    };
+}
+
+#endif
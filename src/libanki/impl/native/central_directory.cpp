@@ -0,0 +1,230 @@
+#include "central_directory.hpp"
+
+#include "../../error.hpp"
+#include "../archive_file.hpp"
+#include "../zip_format.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+using namespace anki::impl::zip_format;
+
+namespace anki::impl::native {
+
+    namespace {
+
+        constexpr auto flag_encrypted      = std::uint16_t{0x0001};
+        constexpr auto flag_strong_encrypt = std::uint16_t{0x0040};
+
+        [[noreturn]] void throw_inconsistent() {
+            throw error{error_code::zip_archive_inconsistent};
+        }
+
+        // Replaces any fields of `target` holding the zip64 marker value with their extended
+        // values from the zip64 extra field among `[extra, extra + size)`, if present. The extended
+        // values appear in a fixed order but only for those fields that hold the marker.
+
+        void apply_zip64_extra(
+            entry& target, std::uint32_t& disk, const std::byte* extra, std::size_t size) {
+
+            while (size >= 4) {
+
+                const auto id        = load_u16(extra);
+                const auto data_size = std::size_t{load_u16(extra + 2)};
+
+                if (data_size > size - 4) {
+                    throw_inconsistent();
+                }
+
+                if (id == zip64_extra_id) {
+
+                    auto data      = extra + 4;
+                    auto remaining = data_size;
+
+                    const auto take_u64 = [&data, &remaining] (std::uint64_t& field) {
+
+                        if (remaining < 8) {
+                            throw_inconsistent();
+                        }
+
+                        field = load_u64(data);
+                        data      += 8;
+                        remaining -= 8;
+                    };
+
+                    if (target.info.size == zip64_marker_32) {
+                        take_u64(target.info.size);
+                    }
+
+                    if (target.info.compressed_size == zip64_marker_32) {
+                        take_u64(target.info.compressed_size);
+                    }
+
+                    if (target.local_header_offset == zip64_marker_32) {
+                        take_u64(target.local_header_offset);
+                    }
+
+                    if (disk == zip64_marker_16) {
+
+                        if (remaining < 4) {
+                            throw_inconsistent();
+                        }
+
+                        disk = load_u32(data);
+                    }
+
+                    return;
+                }
+
+                extra += 4 + data_size;
+                size  -= 4 + data_size;
+            }
+        }
+    }
+
+    auto parse_entries(const std::byte* data, std::size_t size, std::uint64_t entry_count)
+        -> std::vector<entry> {
+
+        // Each record takes at least `central_header_size` bytes, which bounds the reservation
+        // against a corrupt entry count.
+
+        auto entries = std::vector<entry>{};
+        entries.reserve(ksr::narrow_cast<std::size_t>(
+            std::min<std::uint64_t>(entry_count, size / central_header_size)));
+
+        for (auto i = std::uint64_t{0}; i < entry_count; ++i) {
+
+            if (size < central_header_size || load_u32(data) != central_header_signature) {
+                throw_inconsistent();
+            }
+
+            const auto name_size    = std::size_t{load_u16(data + 28)};
+            const auto extra_size   = std::size_t{load_u16(data + 30)};
+            const auto comment_size = std::size_t{load_u16(data + 32)};
+            const auto record_size  = central_header_size + name_size + extra_size + comment_size;
+
+            if (record_size > size) {
+                throw_inconsistent();
+            }
+
+            auto& new_entry = entries.emplace_back();
+            new_entry.flags                = load_u16(data + 8);
+            new_entry.info.method          = zip_method{load_u16(data + 10)};
+            new_entry.info.crc             = load_u32(data + 16);
+            new_entry.info.compressed_size = load_u32(data + 20);
+            new_entry.info.size            = load_u32(data + 24);
+            new_entry.local_header_offset  = load_u32(data + 42);
+            new_entry.info.encrypted       = (new_entry.flags & (flag_encrypted | flag_strong_encrypt)) != 0;
+
+            const auto name = reinterpret_cast<const char*>(data + central_header_size);
+            new_entry.name.assign(name, name_size);
+
+            auto disk = std::uint32_t{load_u16(data + 34)};
+            apply_zip64_extra(new_entry, disk, data + central_header_size + name_size, extra_size);
+
+            if (disk != 0) {
+                throw error{error_code::zip_unsupported_multi_disk};
+            }
+
+            data += record_size;
+            size -= record_size;
+        }
+
+        return entries;
+    }
+
+    central_directory::central_directory(const archive_file& file) {
+
+        if (file.size() == 0) {
+            return;
+        }
+
+        const auto tail_size   = std::min<std::uint64_t>(file.size(), max_tail_size);
+        const auto tail_offset = file.size() - tail_size;
+
+        auto tail = std::vector<std::byte>(ksr::narrow_cast<std::size_t>(tail_size));
+        file.read_exact_at(tail_offset, tail.data(), tail.size());
+
+        const auto read = [&file] (
+            const std::uint64_t offset, std::byte* const dst, const std::size_t size) {
+
+            file.read_exact_at(offset, dst, size);
+        };
+
+        const auto location = locate_central_directory(tail.data(), tail.size(), tail_offset, read);
+        if (!location) {
+            throw error{error_code::zip_invalid_archive};
+        }
+
+        // The directory usually lies wholly or partly within the tail already; only what precedes
+        // the tail needs reading.
+
+        const auto directory_size = ksr::narrow_cast<std::size_t>(location->size);
+        auto directory = std::vector<std::byte>{};
+
+        if (location->offset >= tail_offset) {
+
+            const auto begin = tail.begin() + ksr::narrow_cast<std::ptrdiff_t>(location->offset - tail_offset);
+            directory.assign(begin, begin + ksr::narrow_cast<std::ptrdiff_t>(directory_size));
+        }
+        else {
+
+            directory.resize(directory_size);
+            file.read_exact_at(location->offset, directory.data(), directory.size());
+        }
+
+        _entries = parse_entries(directory.data(), directory.size(), location->entry_count);
+        _offset  = location->offset;
+
+        if (_entries.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw_inconsistent();
+        }
+
+        _by_name.resize(_entries.size());
+        std::iota(_by_name.begin(), _by_name.end(), std::uint32_t{0});
+
+        // A stable sort keeps duplicate names in archive order, so that `find()` returns the first
+        // as libzip does.
+
+        std::stable_sort(_by_name.begin(), _by_name.end(), [this] (auto lhs, auto rhs) {
+            return _entries[lhs].name < _entries[rhs].name;
+        });
+    }
+
+    auto central_directory::find(std::string_view name) const -> const entry* {
+
+        const auto iter = std::lower_bound(
+            _by_name.begin(), _by_name.end(), name,
+            [this] (std::uint32_t index, std::string_view key) {
+                return _entries[index].name < key;
+            });
+
+        return (iter != _by_name.end() && _entries[*iter].name == name)
+            ? &_entries[*iter]
+            : nullptr;
+    }
+
+    auto data_offset(const archive_file& file, const entry& target) -> std::uint64_t {
+
+        auto header = std::array<std::byte, local_header_size>{};
+        file.read_exact_at(target.local_header_offset, header.data(), header.size());
+
+        if (load_u32(header.data()) != local_header_signature) {
+            throw_inconsistent();
+        }
+
+        const auto name_size  = std::uint64_t{load_u16(header.data() + 26)};
+        const auto extra_size = std::uint64_t{load_u16(header.data() + 28)};
+        const auto offset     = target.local_header_offset + local_header_size + name_size + extra_size;
+
+        if (offset > file.size() || target.info.compressed_size > file.size() - offset) {
+            throw_inconsistent();
+        }
+
+        return offset;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef LIBANKI_IMPL_NATIVE_CENTRAL_DIRECTORY_HPP
+#define LIBANKI_IMPL_NATIVE_CENTRAL_DIRECTORY_HPP
+
+#include "../../zip_entry_info.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+    class archive_file;
+}
+
+namespace anki::impl::native {
+
+    // Central directory record for a single archive entry, with any zip64 extended values
+    // resolved. Names are kept exactly as stored in the archive, without any conversion between
+    // character encodings.
+
+    struct entry {
+        std::string    name;
+        zip_entry_info info;
+        std::uint16_t  flags               = 0;
+        std::uint64_t  local_header_offset = 0;
+    };
+
+    // Parses the `entry_count` central directory records held in `[data, data + size)`. Throws
+    // `anki::error` if the records are malformed or would extend beyond the buffer.
+
+    auto parse_entries(const std::byte* data, std::size_t size, std::uint64_t entry_count)
+        -> std::vector<entry>;
+
+    // Complete, immutable central directory of an archive, indexed by entry name.
+
+    class central_directory {
+    public:
+
+        // Locates, reads and parses the central directory of `file`, an empty file being taken as
+        // an empty archive, as libzip takes it. Throws `anki::error` if the file is not a zip
+        // archive or its central directory is malformed.
+
+        explicit central_directory(const archive_file& file);
+
+        // Returns the first entry named `name`, or `nullptr` if there is none. Names are
+        // case-sensitive and include any directories.
+
+        auto find(std::string_view name) const -> const entry*;
+
+        // All entries, in the order recorded in the archive.
+
+        auto entries() const noexcept -> const std::vector<entry>& { return _entries; }
+
+        // Offset of the directory within its archive, which entry data must precede.
+
+        auto offset() const noexcept -> std::uint64_t { return _offset; }
+
+    private:
+
+        std::vector<entry>         _entries;
+        std::vector<std::uint32_t> _by_name; // Indices into `_entries`, ordered by name
+        std::uint64_t              _offset = 0;
+    };
+
+    // Reads the local file header of `target` from `file` and returns the offset of the first
+    // byte of the entry's data. Throws `anki::error` if the local header is malformed.
+
+    auto data_offset(const archive_file& file, const entry& target) -> std::uint64_t;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef LIBANKI_IMPL_PARALLEL_HPP
+#define LIBANKI_IMPL_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace anki::impl {
+
+    // Number of threads to divide `work_count` units of work between: `requested`, or one per
+    // hardware thread if that is 0, but no more than there are units, and at least one.
+
+    inline auto parallel_thread_count(const std::size_t requested, const std::size_t work_count)
+        -> std::size_t {
+
+        const auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        return std::clamp<std::size_t>(
+            requested > 0 ? requested : hardware_threads, 1, std::max<std::size_t>(work_count, 1));
+    }
+
+    // Calls `fn(i)` for each `i` below `thread_count`, each on a thread of its own but for
+    // `fn(0)`, which the calling thread runs once the others are started. If a thread fails to
+    // start, no more are, and the calling thread runs the indices left over before its own, so
+    // work is never lost for want of threads.
+    //
+    // Every thread is joined before returning. If any call of `fn` throws, the first exception
+    // caught is rethrown then; callers whose threads share work should therefore have `fn` stop
+    // the others early itself if it fails.
+
+    template<typename fn>
+    void run_parallel(const std::size_t thread_count, fn&& run) {
+
+        auto error_mutex = std::mutex{};
+        auto first_error = std::exception_ptr{};
+
+        const auto run_index = [&run, &error_mutex, &first_error] (const std::size_t index) {
+
+            try {
+                run(index);
+            }
+            catch (...) {
+
+                const auto lock = std::lock_guard{error_mutex};
+                if (!first_error) {
+                    first_error = std::current_exception();
+                }
+            }
+        };
+
+        auto threads = std::vector<std::thread>{};
+        threads.reserve(thread_count > 0 ? thread_count - 1 : 0);
+
+        try {
+            for (auto i = std::size_t{1}; i < thread_count; ++i) {
+                threads.emplace_back(run_index, i);
+            }
+        }
+        catch (const std::system_error&) {
+        }
+
+        for (auto i = threads.size() + 1; i < thread_count; ++i) {
+            run_index(i);
+        }
+
+        if (thread_count > 0) {
+            run_index(0);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (first_error) {
+            std::rethrow_exception(first_error);
+        }
+    }
+}
+
+#endif
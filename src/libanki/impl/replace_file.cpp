@@ -0,0 +1,99 @@
+#include "replace_file.hpp"
+
+#include "../error.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <utility>
+
+namespace anki::impl {
+
+    namespace {
+
+        void write_all(const int fd, const std::byte* data, std::size_t size) {
+
+            while (size > 0) {
+
+                const auto result = ::write(fd, data, size);
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw error{error_code::system_error};
+                }
+
+                data += result;
+                size -= static_cast<std::size_t>(result);
+            }
+        }
+    }
+
+    // The temporary file is named uniquely, so that several threads or processes replacing `dst`
+    // at once each write their own, and is not inherited by processes started while it is being
+    // written.
+
+    replacement_file::replacement_file(const path& dst)
+      : _dst{dst}, _temp{dst.native() + ".XXXXXX"}, _fd{::mkostemp(_temp.data(), O_CLOEXEC)} {
+
+        if (_fd < 0) {
+            throw error{error_code::system_error};
+        }
+
+        if (::fchmod(_fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0) {
+
+            ::close(_fd);
+            ::unlink(_temp.c_str());
+            throw error{error_code::system_error};
+        }
+    }
+
+    replacement_file::~replacement_file() {
+
+        if (_fd >= 0) {
+
+            ::close(_fd);
+            ::unlink(_temp.c_str());
+        }
+    }
+
+    void replacement_file::commit() {
+
+        const auto fd = std::exchange(_fd, -1);
+
+        const auto synced = (::fsync(fd) == 0);
+        if (::close(fd) != 0 || !synced || ::rename(_temp.c_str(), _dst.c_str()) != 0) {
+
+            ::unlink(_temp.c_str());
+            throw error{error_code::system_error};
+        }
+
+        // The rename itself is made durable by syncing the directory holding both names.
+
+        const auto directory = _dst.has_parent_path() ? _dst.parent_path() : path{"."};
+
+        const auto directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory_fd < 0) {
+            throw error{error_code::system_error};
+        }
+
+        const auto directory_synced = (::fsync(directory_fd) == 0);
+        ::close(directory_fd);
+
+        if (!directory_synced) {
+            throw error{error_code::system_error};
+        }
+    }
+
+    void replace_file(const path& dst, const std::byte* const data, const std::size_t size) {
+
+        auto file = replacement_file{dst};
+        write_all(file.fd(), data, size);
+        file.commit();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef LIBANKI_IMPL_REPLACE_FILE_HPP
+#define LIBANKI_IMPL_REPLACE_FILE_HPP
+
+#include "../filesystem.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace anki::impl {
+
+    // File written in place of `dst`: a uniquely named file beside it, which `commit()` syncs to
+    // disk and moves over `dst`, so that processes which have the existing file mapped keep
+    // reading it intact, and a crash leaves either the old file or the whole of the new one. Until
+    // then `dst` is untouched, and the file is removed if destroyed uncommitted. The new file is
+    // readable by all and writable by its owner.
+
+    class replacement_file {
+    public:
+
+        // Creates the file to replace `dst`. Throws `anki::error` with
+        // `error_code::system_error` on failure.
+
+        explicit replacement_file(const path& dst);
+
+        ~replacement_file();
+
+        replacement_file(replacement_file&&)      = delete;
+        replacement_file(const replacement_file&) = delete;
+
+        auto operator=(replacement_file&&)      -> replacement_file& = delete;
+        auto operator=(const replacement_file&) -> replacement_file& = delete;
+
+        // Descriptor through which to write the file, or -1 once committed.
+
+        auto fd() const noexcept -> int { return _fd; }
+
+        // Syncs the file and moves it over `dst`. Throws `anki::error` with
+        // `error_code::system_error` on failure, in which case the file is removed and `dst` is
+        // left as it was, unless only the final sync of its directory failed.
+
+        void commit();
+
+    private:
+
+        path        _dst;
+        std::string _temp;
+        int         _fd = -1;
+    };
+
+    // Writes `size` bytes from `data` to `dst` through a `replacement_file`, replacing any
+    // existing file. Throws `anki::error` with `error_code::system_error` on failure, in which
+    // case `dst` is left as it was, unless only the final sync of its directory failed.
+
+    void replace_file(const path& dst, const std::byte* data, std::size_t size);
+}
+
+#endif
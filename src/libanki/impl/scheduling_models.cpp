@@ -0,0 +1,234 @@
+#include "scheduling_models.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace anki::impl {
+
+    namespace {
+
+        // Intervals are capped at 2^24 days (some 46,000 years), well beyond any deck's maximum,
+        // so that every interval is exactly representable as a `float` and intervals one day
+        // apart can be computed without overflow.
+
+        constexpr auto interval_limit = std::int64_t{1} << 24;
+
+        auto maximum_interval_of(const deck_config& config) -> std::int32_t {
+            return static_cast<std::int32_t>(
+                std::clamp<std::int64_t>(config.maximum_interval, 1, interval_limit));
+        }
+    }
+
+    namespace sm2 {
+
+        void review_intervals(
+            const deck_config& config, const std::size_t count, const review_inputs& src,
+            const answer_columns& dst) {
+
+            const auto modifier = static_cast<float>(config.interval_modifier);
+            const auto bonus    = static_cast<float>(config.easy_bonus);
+            const auto lapse    = static_cast<float>(config.lapse_multiplier);
+            const auto maximum  = maximum_interval_of(config);
+            const auto minimum  = static_cast<std::int32_t>(
+                std::clamp<std::int64_t>(config.minimum_lapse_interval, 1, maximum));
+
+            // Converts to whole days, truncating as Anki does, and capping at the maximum first
+            // so that the conversion cannot overflow.
+
+            const auto max_days = static_cast<float>(maximum);
+            const auto to_days  = [max_days] (float days) {
+                return static_cast<std::int32_t>(std::min(days, max_days));
+            };
+
+            for (auto i = std::size_t{0}; i < count; ++i) {
+
+                const auto interval = std::min(src.interval[i], maximum);
+                const auto current  = static_cast<float>(interval);
+                const auto ease     = static_cast<float>(src.ease_factor[i]) * 0.001f;
+                const auto late     = static_cast<float>(src.days_late[i]);
+                const auto half     = static_cast<float>(src.days_late[i] / 2);
+
+                const auto again = std::max(to_days(current * lapse), minimum);
+                const auto hard  = std::max(
+                    to_days(current * hard_factor * modifier), interval + 1);
+                const auto good  = std::max(
+                    to_days((current + half) * ease * modifier), hard + 1);
+                const auto easy  = std::max(
+                    to_days((current + late) * ease * bonus * modifier), good + 1);
+
+                dst.again[i] = again;
+                dst.hard[i]  = std::min(hard, maximum);
+                dst.good[i]  = std::min(good, maximum);
+                dst.easy[i]  = std::min(easy, maximum);
+            }
+        }
+    }
+
+    namespace fsrs {
+
+        namespace {
+
+            // The forgetting curve, R(t) = (1 + factor * t / S) ^ decay, passes through 90% at
+            // t = S.
+
+            constexpr auto decay  = -0.5f;
+            constexpr auto factor = 19.0f / 81.0f;
+
+            constexpr auto min_stability  = 0.01f;
+            constexpr auto min_difficulty = 1.0f;
+            constexpr auto max_difficulty = 10.0f;
+
+            auto clamp_difficulty(const float difficulty) -> float {
+                return std::min(std::max(difficulty, min_difficulty), max_difficulty);
+            }
+
+            auto initial_difficulty(const weights& w, const float rating) -> float {
+                return clamp_difficulty(w[4] - std::exp(w[5] * (rating - 1.0f)) + 1.0f);
+            }
+
+            // Difficulty moves towards 10 on lapses and towards 1 on easy answers, more slowly
+            // the closer it is, and reverts a little towards that of an easy first answer.
+
+            auto next_difficulty(const weights& w, const float difficulty, const float rating)
+                -> float {
+
+                const auto delta  = -w[6] * (rating - 3.0f);
+                const auto damped = difficulty + delta * (10.0f - difficulty) / 9.0f;
+
+                return clamp_difficulty(
+                    w[7] * initial_difficulty(w, 4.0f) + (1.0f - w[7]) * damped);
+            }
+
+            auto recall_stability(
+                const weights& w, const memory_state state, const float recall, const float rating)
+                -> float {
+
+                const auto hard_penalty = (rating == 2.0f) ? w[15] : 1.0f;
+                const auto easy_bonus   = (rating == 4.0f) ? w[16] : 1.0f;
+
+                const auto increase = std::exp(w[8]) * (11.0f - state.difficulty)
+                    * std::pow(state.stability, -w[9]) * (std::exp(w[10] * (1.0f - recall)) - 1.0f)
+                    * hard_penalty * easy_bonus;
+
+                return state.stability * (1.0f + increase);
+            }
+
+            auto forget_stability(const weights& w, const memory_state state, const float recall)
+                -> float {
+
+                const auto stability = w[11] * std::pow(state.difficulty, -w[12])
+                    * (std::pow(state.stability + 1.0f, w[13]) - 1.0f)
+                    * std::exp(w[14] * (1.0f - recall));
+
+                return std::min(stability, state.stability);
+            }
+
+            // Converts stability to days for `desired_retention`, by inverting the forgetting
+            // curve.
+
+            auto interval_scale(const float desired_retention) -> float {
+                return (std::pow(desired_retention, 1.0f / decay) - 1.0f) / factor;
+            }
+        }
+
+        auto retrievability(const float elapsed_days, const float stability) -> float {
+            return std::pow(
+                1.0f + factor * elapsed_days / std::max(stability, min_stability), decay);
+        }
+
+        auto initial_state(const weights& w, const int rating) -> memory_state {
+
+            const auto index = static_cast<std::size_t>(std::clamp(rating, 1, 4) - 1);
+            return memory_state{w[index], initial_difficulty(w, static_cast<float>(rating))};
+        }
+
+        auto next_state(
+            const weights& w, memory_state state, const float elapsed_days, const int rating)
+            -> memory_state {
+
+            const auto grade = static_cast<float>(std::clamp(rating, 1, 4));
+            state.stability = std::max(state.stability, min_stability);
+
+            auto result = memory_state{};
+            result.difficulty = next_difficulty(w, state.difficulty, grade);
+
+            if (elapsed_days < 1.0f) {
+                result.stability = state.stability * std::exp(w[17] * (grade - 3.0f + w[18]));
+            }
+            else {
+
+                const auto recall = retrievability(elapsed_days, state.stability);
+                result.stability = (rating == 1)
+                    ? forget_stability(w, state, recall)
+                    : recall_stability(w, state, recall, grade);
+            }
+
+            result.stability = std::max(result.stability, min_stability);
+            return result;
+        }
+
+        auto state_from_sm2(const weights& w, const float ease_factor, const float interval)
+            -> memory_state {
+
+            // With 90% retention, stability equals the interval; the difficulty is that for which
+            // a good answer would multiply stability by the ease factor, as SM-2 multiplies the
+            // interval.
+
+            static constexpr auto sm2_retention = 0.9f;
+
+            const auto stability = std::max(interval, min_stability);
+            const auto increase  = std::exp(w[8]) * std::pow(stability, -w[9])
+                * (std::exp(w[10] * (1.0f - sm2_retention)) - 1.0f);
+
+            const auto difficulty = 11.0f - (ease_factor - 1.0f) / increase;
+            return memory_state{stability, clamp_difficulty(difficulty)};
+        }
+
+        auto interval_for(
+            const float stability, const float desired_retention,
+            const std::int32_t maximum_interval) -> std::int32_t {
+
+            const auto days = std::round(stability * interval_scale(desired_retention));
+            return static_cast<std::int32_t>(
+                std::min(std::max(days, 1.0f), static_cast<float>(maximum_interval)));
+        }
+
+        void review_intervals(
+            const weights& w, const float desired_retention, const std::int32_t maximum_interval,
+            const std::size_t count, const review_inputs& src, const answer_columns& dst) {
+
+            const auto scale    = interval_scale(desired_retention);
+            const auto maximum  = static_cast<std::int32_t>(
+                std::clamp<std::int64_t>(maximum_interval, 1, interval_limit));
+            const auto max_days = static_cast<float>(maximum);
+
+            const auto to_days = [max_days] (float days) {
+                const auto rounded = std::max(std::round(days), 1.0f);
+                return static_cast<std::int32_t>(std::min(rounded, max_days));
+            };
+
+            for (auto i = std::size_t{0}; i < count; ++i) {
+
+                const auto state  = memory_state{
+                    std::max(src.stability[i], min_stability), src.difficulty[i]};
+                const auto recall = retrievability(src.elapsed_days[i], state.stability);
+
+                const auto again = to_days(forget_stability(w, state, recall) * scale);
+                const auto hard  = to_days(recall_stability(w, state, recall, 2.0f) * scale);
+                const auto good  = to_days(recall_stability(w, state, recall, 3.0f) * scale);
+                const auto easy  = to_days(recall_stability(w, state, recall, 4.0f) * scale);
+
+                // Hard is capped by good, as the hard penalty can exceed the benefit of recall at
+                // low retrievability, then each answer is kept at least a day beyond the last.
+
+                const auto ordered_hard = std::min(hard, good);
+                const auto ordered_good = std::max(good, ordered_hard + 1);
+
+                dst.again[i] = again;
+                dst.hard[i]  = ordered_hard;
+                dst.good[i]  = std::min(ordered_good, maximum);
+                dst.easy[i]  = std::min(std::max(easy, ordered_good + 1), maximum);
+            }
+        }
+    }
+}
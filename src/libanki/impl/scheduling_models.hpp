@@ -0,0 +1,109 @@
+#ifndef LIBANKI_IMPL_SCHEDULING_MODELS_HPP
+#define LIBANKI_IMPL_SCHEDULING_MODELS_HPP
+
+#include "../collection_metadata.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace anki::impl {
+
+    // Destination of the intervals, in days, that each answer to a review card would give, for
+    // `count` cards at a time. The batch functions below fill element `i` of each array from
+    // element `i` of each of their inputs, in straight-line loops over the arrays that compilers
+    // can vectorise.
+
+    struct answer_columns {
+        std::int32_t* again = nullptr;
+        std::int32_t* hard  = nullptr;
+        std::int32_t* good  = nullptr;
+        std::int32_t* easy  = nullptr;
+    };
+
+    namespace sm2 {
+
+        // Anki's SM-2 variant, as in its v2 and v3 schedulers without fuzz. Hard multiplies the
+        // interval by `hard_factor`; good and easy multiply the interval (plus some or all of the
+        // days the review is late) by the ease factor, and easy by the easy bonus too. Each answer
+        // gives at least one day more than the one before, and the interval modifier and maximum
+        // interval apply to all.
+
+        inline constexpr auto hard_factor = 1.2f;
+
+        // Ease factors, in permille, are adjusted by these on each answer to a review card, and
+        // never fall below `minimum_ease`.
+
+        inline constexpr auto minimum_ease = std::int32_t{1300};
+        inline constexpr auto again_ease   = std::int32_t{-200};
+        inline constexpr auto hard_ease    = std::int32_t{-150};
+        inline constexpr auto easy_ease    = std::int32_t{150};
+
+        struct review_inputs {
+            const std::int32_t* interval    = nullptr;
+            const std::int32_t* ease_factor = nullptr;
+            const std::int32_t* days_late   = nullptr;
+        };
+
+        void review_intervals(
+            const deck_config& config, std::size_t count, const review_inputs& src,
+            const answer_columns& dst);
+    }
+
+    namespace fsrs {
+
+        // The Free Spaced Repetition Scheduler (version 5), which models each card's memory by its
+        // stability (the interval, in days, at which recall probability falls to 90%) and its
+        // difficulty (from 1 to 10), and schedules reviews for when recall probability is predicted
+        // to fall to the desired retention.
+
+        using weights = std::array<float, 19>;
+
+        struct memory_state {
+            float stability  = 0.0f;
+            float difficulty = 0.0f;
+        };
+
+        // Probability of recalling a card with stability `stability` after `elapsed_days`.
+
+        auto retrievability(float elapsed_days, float stability) -> float;
+
+        // Memory state after the first answer to a new card, where `rating` is 1 (again) to 4
+        // (easy).
+
+        auto initial_state(const weights& w, int rating) -> memory_state;
+
+        // Memory state after answering a card in `state` with `rating`, `elapsed_days` after its
+        // last review; reviews on the same day as the last use FSRS's short-term model.
+
+        auto next_state(const weights& w, memory_state state, float elapsed_days, int rating)
+            -> memory_state;
+
+        // Memory state of a card scheduled by SM-2 with `interval` days and `ease_factor` (as a
+        // ratio, not permille), assuming SM-2 retained 90% of cards, as FSRS does when first
+        // enabled for a collection without review history.
+
+        auto state_from_sm2(const weights& w, float ease_factor, float interval) -> memory_state;
+
+        // Interval, in days, after which a card with stability `stability` falls to
+        // `desired_retention`, rounded and clamped to `[1, maximum_interval]`.
+
+        auto interval_for(float stability, float desired_retention, std::int32_t maximum_interval)
+            -> std::int32_t;
+
+        struct review_inputs {
+            const float* stability    = nullptr;
+            const float* difficulty   = nullptr;
+            const float* elapsed_days = nullptr;
+        };
+
+        // As `sm2::review_intervals()`, except that intervals follow from each answer's new
+        // memory state, adjusted so that each answer gives a longer interval than the one before.
+
+        void review_intervals(
+            const weights& w, float desired_retention, std::int32_t maximum_interval,
+            std::size_t count, const review_inputs& src, const answer_columns& dst);
+    }
+}
+
+#endif
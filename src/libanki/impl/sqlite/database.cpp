@@ -0,0 +1,113 @@
+#include "database.hpp"
+
+#include "../../error.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace anki::impl::sqlite {
+
+    namespace {
+
+        [[noreturn]] void throw_error(int sqlite_code) {
+
+            switch (sqlite_code & 0xff) {
+            case SQLITE_CORRUPT:
+            case SQLITE_NOTADB:
+            case SQLITE_ERROR:  throw error{error_code::invalid_collection};
+            default:            throw error{error_code::sqlite_error};
+            }
+        }
+    }
+
+    image::image(const std::size_t size)
+      : _data{static_cast<std::byte*>(sqlite3_malloc64(std::max<std::size_t>(size, 1)))},
+        _size{size} {
+
+        if (!_data) {
+            throw error{error_code::sqlite_error};
+        }
+    }
+
+    image::~image() {
+        sqlite3_free(_data);
+    }
+
+    image::image(image&& rhs) noexcept
+      : _data{std::exchange(rhs._data, nullptr)}, _size{std::exchange(rhs._size, 0)} {
+    }
+
+    auto image::release() noexcept -> std::byte* {
+
+        _size = 0;
+        return std::exchange(_data, nullptr);
+    }
+
+    database::database(image data) {
+
+        auto code = sqlite3_open_v2(":memory:", &_handle, SQLITE_OPEN_READWRITE, nullptr);
+        if (code != SQLITE_OK) {
+
+            sqlite3_close(_handle);
+            throw_error(code);
+        }
+
+        // SQLite takes ownership of the image even if deserialisation fails.
+
+        const auto size = ksr::narrow_cast<sqlite3_int64>(data.size());
+
+        code = sqlite3_deserialize(
+            _handle, "main", reinterpret_cast<unsigned char*>(data.release()), size, size,
+            SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_READONLY);
+
+        if (code != SQLITE_OK) {
+
+            sqlite3_close(_handle);
+            throw_error(code);
+        }
+    }
+
+    database::~database() {
+        sqlite3_close(_handle);
+    }
+
+    statement::statement(const database& db, const std::string_view sql) {
+
+        const auto code = sqlite3_prepare_v2(
+            db.handle(), sql.data(), ksr::narrow_cast<int>(sql.size()), &_handle, nullptr);
+
+        if (code != SQLITE_OK) {
+            throw_error(code);
+        }
+    }
+
+    statement::~statement() {
+        sqlite3_finalize(_handle);
+    }
+
+    auto statement::step() -> bool {
+
+        const auto code = sqlite3_step(_handle);
+        switch (code) {
+        case SQLITE_ROW:  return true;
+        case SQLITE_DONE: return false;
+        default:          throw_error(code);
+        }
+    }
+
+    auto statement::column_int64(const int index) const -> std::int64_t {
+        return sqlite3_column_int64(_handle, index);
+    }
+
+    auto statement::column_text(const int index) const -> std::string_view {
+
+        // The pointer must be fetched before the size, since fetching it may convert the value.
+
+        const auto text = reinterpret_cast<const char*>(sqlite3_column_text(_handle, index));
+        const auto size = sqlite3_column_bytes(_handle, index);
+
+        return text ? std::string_view{text, static_cast<std::size_t>(size)} : std::string_view{};
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef LIBANKI_IMPL_SQLITE_DATABASE_HPP
+#define LIBANKI_IMPL_SQLITE_DATABASE_HPP
+
+#include "sqlite3.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace anki::impl::sqlite {
+
+    // Buffer allocated by SQLite's allocator, as required for a database image whose ownership
+    // passes to SQLite, so that data can be extracted straight into it.
+
+    class image {
+    public:
+
+        // Allocates `size` bytes, throwing `anki::error` on failure.
+
+        explicit image(std::size_t size);
+        ~image();
+
+        image(image&& rhs) noexcept;
+        image(const image&) = delete;
+
+        auto operator=(image&&)      -> image& = delete;
+        auto operator=(const image&) -> image& = delete;
+
+        auto data() const noexcept -> std::byte*  { return _data; }
+        auto size() const noexcept -> std::size_t { return _size; }
+
+        // Relinquishes ownership of the buffer, returning it.
+
+        auto release() noexcept -> std::byte*;
+
+    private:
+
+        std::byte*  _data = nullptr;
+        std::size_t _size = 0;
+    };
+
+    // RAII wrapper for a read-only SQLite connection to a database image held in memory, such as
+    // a collection extracted from an `apkg` archive. The image is never written to disk.
+
+    class database {
+    public:
+
+        // Opens the database held in `data`, taking ownership of it. Throws `anki::error` if the
+        // image is not a valid SQLite database.
+
+        explicit database(image data);
+        ~database();
+
+        database(database&&)      = delete;
+        database(const database&) = delete;
+
+        auto operator=(database&&)      -> database& = delete;
+        auto operator=(const database&) -> database& = delete;
+
+        auto handle() const noexcept -> sqlite3* { return _handle; }
+
+    private:
+
+        sqlite3* _handle = nullptr;
+    };
+
+    // RAII wrapper for a prepared statement. Columns are indexed from 0, as in SQLite's own API.
+
+    class statement {
+    public:
+
+        // Prepares `sql` against `db`. Throws `anki::error` on failure, including when the
+        // statement refers to tables or columns that the database lacks.
+
+        statement(const database& db, std::string_view sql);
+        ~statement();
+
+        statement(statement&&)      = delete;
+        statement(const statement&) = delete;
+
+        auto operator=(statement&&)      -> statement& = delete;
+        auto operator=(const statement&) -> statement& = delete;
+
+        // Advances to the next result row, returning `false` once there are none. Throws
+        // `anki::error` on failure.
+
+        auto step() -> bool;
+
+        auto column_int64(int index) const -> std::int64_t;
+
+        // Returns the text of the specified column, which remains valid until the next call to
+        // `step()`. `NULL` values yield an empty string.
+
+        auto column_text(int index) const -> std::string_view;
+
+    private:
+
+        sqlite3_stmt* _handle = nullptr;
+    };
+}
+
+#endif
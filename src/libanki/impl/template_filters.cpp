@@ -0,0 +1,394 @@
+#include "template_filters.hpp"
+
+#include "utf8.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+
+namespace anki::impl {
+
+    namespace {
+
+        auto is_space(const char c) -> bool {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        auto to_lower(const char c) -> char {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        // Returns whether `text` starts with `prefix` at `pos`, ignoring ASCII case.
+
+        auto starts_with_nocase(
+            const std::string_view text, std::size_t pos, const std::string_view prefix) -> bool {
+
+            if (text.size() - pos < prefix.size()) {
+                return false;
+            }
+
+            for (const auto c : prefix) {
+                if (to_lower(text[pos++]) != c) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // If a `br` or `div` tag (opening, closing or self-closing) starts at `pos`, returns the
+        // position following it.
+
+        auto skip_blank_tag(const std::string_view text, std::size_t pos)
+            -> std::optional<std::size_t> {
+
+            ++pos;
+            if (pos < text.size() && text[pos] == '/') {
+                ++pos;
+            }
+
+            if (starts_with_nocase(text, pos, "br")) {
+                pos += 2;
+            }
+            else if (starts_with_nocase(text, pos, "div")) {
+                pos += 3;
+            }
+            else {
+                return std::nullopt;
+            }
+
+            while (pos < text.size() && is_space(text[pos])) {
+                ++pos;
+            }
+
+            if (pos < text.size() && text[pos] == '/') {
+                ++pos;
+            }
+
+            if (pos < text.size() && text[pos] == '>') {
+                return pos + 1;
+            }
+
+            return std::nullopt;
+        }
+
+        // Decodes the character reference starting at `text[pos]` (an ampersand), returning the
+        // position following it, or `std::nullopt` if it is not a reference this understands.
+
+        auto decode_reference(const std::string_view text, const std::size_t pos, std::string& dst)
+            -> std::optional<std::size_t> {
+
+            static constexpr auto max_length = std::size_t{10};
+
+            const auto end = text.find(';', pos + 1);
+            if (end == std::string_view::npos || end - pos > max_length) {
+                return std::nullopt;
+            }
+
+            const auto name = text.substr(pos + 1, end - pos - 1);
+
+            if (name.size() > 1 && name[0] == '#') {
+
+                const auto hex    = (name[1] == 'x' || name[1] == 'X');
+                const auto digits = name.substr(hex ? 2 : 1);
+
+                auto code_point = std::uint32_t{0};
+                const auto [ptr, ec] = std::from_chars(
+                    digits.data(), digits.data() + digits.size(), code_point, hex ? 16 : 10);
+
+                if (ec != std::errc{} || ptr != digits.data() + digits.size()
+                    || code_point > 0x10ffff || (code_point >= 0xd800 && code_point < 0xe000)) {
+
+                    return std::nullopt;
+                }
+
+                append_utf8(dst, code_point);
+                return end + 1;
+            }
+
+            if      (name == "amp")  { dst += '&'; }
+            else if (name == "lt")   { dst += '<'; }
+            else if (name == "gt")   { dst += '>'; }
+            else if (name == "quot") { dst += '"'; }
+            else if (name == "apos") { dst += '\''; }
+            else if (name == "nbsp") { dst += ' '; }
+            else                     { return std::nullopt; }
+
+            return end + 1;
+        }
+
+        struct cloze_deletion {
+            std::size_t      begin   = 0;
+            std::size_t      end     = 0;
+            int              ordinal = 0;
+            std::string_view text;
+            std::string_view hint;
+        };
+
+        // Finds the first cloze deletion, `{{cN::text}}` or `{{cN::text::hint}}`, at or after
+        // `pos`.
+
+        auto find_cloze(const std::string_view text, std::size_t pos)
+            -> std::optional<cloze_deletion> {
+
+            while ((pos = text.find("{{c", pos)) != std::string_view::npos) {
+
+                auto result = cloze_deletion{};
+                result.begin = pos;
+
+                const auto digits = text.data() + pos + 3;
+                const auto end    = text.data() + text.size();
+                const auto [ptr, ec] = std::from_chars(digits, end, result.ordinal);
+
+                const auto content = static_cast<std::size_t>(ptr - text.data()) + 2;
+                if (ec != std::errc{} || text.substr(content - 2, 2) != "::") {
+                    pos += 3;
+                    continue;
+                }
+
+                const auto close = text.find("}}", content);
+                if (close == std::string_view::npos) {
+                    return std::nullopt;
+                }
+
+                const auto body      = text.substr(content, close - content);
+                const auto separator = body.find("::");
+
+                result.end  = close + 2;
+                result.text = body.substr(0, separator);
+
+                if (separator != std::string_view::npos) {
+                    result.hint = body.substr(separator + 2);
+                }
+
+                return result;
+            }
+
+            return std::nullopt;
+        }
+
+        void append_hex(std::string& dst, std::uint64_t value) {
+
+            static constexpr auto hex_digits = "0123456789abcdef";
+
+            char digits[16];
+            auto count = 0;
+
+            do {
+                digits[count++] = hex_digits[value & 0xf];
+                value >>= 4;
+            }
+            while (value != 0);
+
+            while (count > 0) {
+                dst += digits[--count];
+            }
+        }
+    }
+
+    auto field_is_empty(const std::string_view text) -> bool {
+
+        auto pos = std::size_t{0};
+        while (pos < text.size()) {
+
+            if (is_space(text[pos])) {
+                ++pos;
+                continue;
+            }
+
+            if (text[pos] != '<') {
+                return false;
+            }
+
+            const auto next = skip_blank_tag(text, pos);
+            if (!next) {
+                return false;
+            }
+
+            pos = *next;
+        }
+
+        return true;
+    }
+
+    void strip_html(const std::string_view text, std::string& dst) {
+
+        auto pos = std::size_t{0};
+        while (pos < text.size()) {
+
+            const auto special = text.find_first_of("<&", pos);
+            dst.append(text, pos, special - pos);
+
+            if (special == std::string_view::npos) {
+                return;
+            }
+
+            pos = special;
+
+            if (text[pos] == '&') {
+
+                if (const auto next = decode_reference(text, pos, dst)) {
+                    pos = *next;
+                }
+                else {
+                    dst += '&';
+                    ++pos;
+                }
+
+                continue;
+            }
+
+            const auto comment = (text.compare(pos, 4, "<!--") == 0);
+            const auto end     = comment ? text.find("-->", pos + 4) : text.find('>', pos + 1);
+
+            if (end == std::string_view::npos) {
+                pos = comment ? text.size() : pos + 1;
+
+                if (!comment) {
+                    dst += '<';
+                }
+            }
+            else {
+                pos = end + (comment ? 3 : 1);
+            }
+        }
+    }
+
+    void render_cloze(
+        const std::string_view text, const int ordinal, const card_side side, std::string& dst) {
+
+        auto pos = std::size_t{0};
+        while (const auto cloze = find_cloze(text, pos)) {
+
+            dst.append(text, pos, cloze->begin - pos);
+            pos = cloze->end;
+
+            if (cloze->ordinal != ordinal) {
+                dst += cloze->text;
+            }
+            else if (side == card_side::question) {
+                dst += "<span class=cloze>[";
+                dst += cloze->hint.empty() ? std::string_view{"..."} : cloze->hint;
+                dst += "]</span>";
+            }
+            else {
+                dst += "<span class=cloze>";
+                dst += cloze->text;
+                dst += "</span>";
+            }
+        }
+
+        dst.append(text, pos);
+    }
+
+    void render_cloze_only(const std::string_view text, const int ordinal, std::string& dst) {
+
+        auto pos   = std::size_t{0};
+        auto first = true;
+
+        while (const auto cloze = find_cloze(text, pos)) {
+
+            pos = cloze->end;
+
+            if (cloze->ordinal == ordinal) {
+
+                if (!first) {
+                    dst += ", ";
+                }
+
+                dst += cloze->text;
+                first = false;
+            }
+        }
+    }
+
+    void render_hint(
+        const std::string_view text, const std::string_view field_name, std::string& dst) {
+
+        if (field_is_empty(text)) {
+            return;
+        }
+
+        // The element ID need only distinguish the hints of a single card, so a hash of the text
+        // serves, as in Anki.
+
+        auto hash = std::uint64_t{0xcbf29ce484222325};
+        for (const auto c : text) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+        }
+
+        dst += "<a class=hint href=\"#\" onclick=\"this.style.display='none';"
+               "document.getElementById('hint";
+        append_hex(dst, hash);
+        dst += "').style.display='block';return false;\">";
+        dst += field_name;
+        dst += "</a><div id=\"hint";
+        append_hex(dst, hash);
+        dst += "\" class=hint style=\"display: none\">";
+        dst += text;
+        dst += "</div>";
+    }
+
+    void render_furigana(const std::string_view text, const furigana_mode mode, std::string& dst) {
+
+        auto pos = std::size_t{0};
+        while (pos < text.size()) {
+
+            const auto open  = text.find('[', pos);
+            const auto close = (open == std::string_view::npos)
+                ? std::string_view::npos
+                : text.find(']', open + 2);
+
+            if (close == std::string_view::npos) {
+                break;
+            }
+
+            // The base is the run of text preceding the bracket, back to a space or the end of a
+            // tag; a single space before it is dropped, so that annotated words can be spaced
+            // apart in the source.
+
+            auto base_begin = open;
+            while (base_begin > pos && text[base_begin - 1] != ' ' && text[base_begin - 1] != '>') {
+                --base_begin;
+            }
+
+            if (base_begin == open) {
+                dst.append(text, pos, open + 1 - pos);
+                pos = open + 1;
+                continue;
+            }
+
+            const auto match_begin = (base_begin > pos && text[base_begin - 1] == ' ')
+                ? base_begin - 1
+                : base_begin;
+
+            dst.append(text, pos, match_begin - pos);
+
+            const auto base    = text.substr(base_begin, open - base_begin);
+            const auto reading = text.substr(open + 1, close - open - 1);
+
+            if (reading.compare(0, 6, "sound:") == 0) {
+                dst.append(text, match_begin, close + 1 - match_begin);
+            }
+            else {
+
+                switch (mode) {
+                case furigana_mode::kana:  dst += reading; break;
+                case furigana_mode::kanji: dst += base;    break;
+                case furigana_mode::ruby:
+
+                    dst += "<ruby><rb>";
+                    dst += base;
+                    dst += "</rb><rt>";
+                    dst += reading;
+                    dst += "</rt></ruby>";
+                    break;
+                }
+            }
+
+            pos = close + 1;
+        }
+
+        dst.append(text, pos);
+    }
+}
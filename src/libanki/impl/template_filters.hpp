@@ -0,0 +1,53 @@
+#ifndef LIBANKI_IMPL_TEMPLATE_FILTERS_HPP
+#define LIBANKI_IMPL_TEMPLATE_FILTERS_HPP
+
+#include <string>
+#include <string_view>
+
+namespace anki::impl {
+
+    enum class card_side {
+        question,
+        answer,
+    };
+
+    // Text transformations applied by card templates, following Anki's own. Each appends its
+    // result to `dst`.
+
+    // Returns whether field text would display as empty: that is, whether it holds nothing but
+    // whitespace and line break or `div` tags. Conditional sections test fields with this.
+
+    auto field_is_empty(std::string_view text) -> bool;
+
+    // Removes HTML tags and comments, and decodes character references (`text:` filter).
+
+    void strip_html(std::string_view text, std::string& dst);
+
+    // Renders the cloze deletions of `text` (`cloze:` filter). Deletions numbered `ordinal` are
+    // hidden on the question side, showing their hint if any, and highlighted on the answer
+    // side; all others show their text.
+
+    void render_cloze(std::string_view text, int ordinal, card_side side, std::string& dst);
+
+    // Renders only the text of the deletions numbered `ordinal`, separated by commas
+    // (`cloze-only:` filter).
+
+    void render_cloze_only(std::string_view text, int ordinal, std::string& dst);
+
+    // Renders `text` hidden behind a link labelled with the field name (`hint:` filter).
+
+    void render_hint(std::string_view text, std::string_view field_name, std::string& dst);
+
+    // Renders `base[reading]` annotations in `text` as ruby text (`furigana:` filter), or keeps
+    // only the readings (`kana:`) or bases (`kanji:`).
+
+    enum class furigana_mode {
+        ruby,
+        kana,
+        kanji,
+    };
+
+    void render_furigana(std::string_view text, furigana_mode mode, std::string& dst);
+}
+
+#endif
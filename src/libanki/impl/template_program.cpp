@@ -0,0 +1,306 @@
+#include "template_program.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace anki::impl {
+
+    namespace {
+
+        auto trim(std::string_view text) -> std::string_view {
+
+            static constexpr auto whitespace = std::string_view{" \t\n\r"};
+
+            const auto begin = text.find_first_not_of(whitespace);
+            if (begin == std::string_view::npos) {
+                return {};
+            }
+
+            const auto end = text.find_last_not_of(whitespace);
+            return text.substr(begin, end + 1 - begin);
+        }
+    }
+
+    template_program::template_program(
+        const std::string_view source, const card_side side,
+        const std::vector<std::string>& field_names)
+
+      : _side{side} {
+
+        // Each open section, with the name by which its end tag must refer to it.
+
+        auto open_sections = std::vector<std::pair<std::size_t, std::string_view>>{};
+
+        auto pos = std::size_t{0};
+        while (pos < source.size()) {
+
+            const auto open  = source.find("{{", pos);
+            const auto close = (open == std::string_view::npos)
+                ? std::string_view::npos
+                : source.find("}}", open + 2);
+
+            if (close == std::string_view::npos) {
+                break;
+            }
+
+            add_text(source.substr(pos, open - pos));
+            pos = close + 2;
+
+            const auto tag = trim(source.substr(open + 2, close - open - 2));
+            if (tag.empty()) {
+                add_text(source.substr(open, pos - open));
+                continue;
+            }
+
+            switch (tag[0]) {
+            case '#':
+            case '^': {
+
+                const auto name = trim(tag.substr(1));
+                const auto ref  = resolve(name, field_names);
+
+                auto& section = _ops.emplace_back();
+                section.code   = (tag[0] == '#') ? op_code::section : op_code::inverted_section;
+                section.source = ref.source;
+                section.index  = ref.index;
+
+                open_sections.emplace_back(_ops.size() - 1, name);
+                break;
+            }
+            case '/': {
+
+                const auto name = trim(tag.substr(1));
+                if (!open_sections.empty() && open_sections.back().second == name) {
+
+                    _ops[open_sections.back().first].operand = ksr::narrow_cast<std::uint32_t>(
+                        _ops.size());
+
+                    open_sections.pop_back();
+                }
+
+                break;
+            }
+            default:
+                add_substitution(tag, field_names);
+                break;
+            }
+        }
+
+        add_text(source.substr(pos));
+
+        for (const auto& section : open_sections) {
+            _ops[section.first].operand = ksr::narrow_cast<std::uint32_t>(_ops.size());
+        }
+    }
+
+    void template_program::render(
+        const template_inputs& inputs, std::string& dst, std::string (&scratch)[2]) const {
+
+        auto pc = std::size_t{0};
+        while (pc < _ops.size()) {
+
+            const auto& op = _ops[pc];
+
+            switch (op.code) {
+            case op_code::text:
+
+                dst.append(_literals, op.index, op.operand);
+                ++pc;
+                break;
+
+            case op_code::section:
+            case op_code::inverted_section: {
+
+                const auto empty = field_is_empty(value_of(op, inputs));
+                const auto shown = (op.code == op_code::section) != empty;
+
+                pc = shown ? pc + 1 : op.operand;
+                break;
+            }
+            case op_code::field: {
+
+                // Filters alternate between the two scratch buffers, each reading the result of
+                // the one before.
+
+                auto value = value_of(op, inputs);
+                for (auto i = std::size_t{0}; i < op.filter_count; ++i) {
+
+                    auto& result = scratch[i % 2];
+                    result.clear();
+
+                    apply(_filters[op.operand + i], op, value, inputs, result);
+                    value = result;
+                }
+
+                dst += value;
+                ++pc;
+                break;
+            }
+            }
+        }
+    }
+
+    auto template_program::resolve(
+        const std::string_view name, const std::vector<std::string>& field_names) -> field_ref {
+
+        static constexpr std::pair<std::string_view, field_source> special_fields[] = {
+            {"FrontSide", field_source::front_side},
+            {"Tags",      field_source::tags},
+            {"Type",      field_source::notetype},
+            {"Deck",      field_source::deck},
+            {"Subdeck",   field_source::subdeck},
+            {"Card",      field_source::card},
+        };
+
+        for (const auto& [special_name, source] : special_fields) {
+            if (name == special_name) {
+                return field_ref{source, 0};
+            }
+        }
+
+        const auto it = std::find(field_names.begin(), field_names.end(), name);
+        if (it == field_names.end()) {
+            return field_ref{};
+        }
+
+        const auto index = ksr::narrow_cast<std::uint32_t>(it - field_names.begin());
+        return field_ref{field_source::note, index};
+    }
+
+    auto template_program::value_of(const op& op, const template_inputs& inputs)
+        -> std::string_view {
+
+        switch (op.source) {
+        case field_source::note:
+
+            return (op.index < inputs.fields->size())
+                ? (*inputs.fields)[op.index]
+                : std::string_view{};
+
+        case field_source::front_side: return inputs.front_side;
+        case field_source::tags:       return trim(inputs.tags);
+        case field_source::notetype:   return inputs.notetype_name;
+        case field_source::deck:       return inputs.deck_name;
+        case field_source::card:       return inputs.template_name;
+        case field_source::unknown:    return {};
+        case field_source::subdeck: {
+
+            const auto separator = inputs.deck_name.rfind("::");
+            return (separator == std::string_view::npos)
+                ? inputs.deck_name
+                : inputs.deck_name.substr(separator + 2);
+        }
+        }
+
+        return {};
+    }
+
+    void template_program::add_text(const std::string_view text) {
+
+        if (text.empty()) {
+            return;
+        }
+
+        auto& op = _ops.emplace_back();
+        op.code    = op_code::text;
+        op.index   = ksr::narrow_cast<std::uint32_t>(_literals.size());
+        op.operand = ksr::narrow_cast<std::uint32_t>(text.size());
+
+        _literals += text;
+    }
+
+    // Adds a substitution of the form `{{filter:...:filter:Field}}`. Filters are listed
+    // outermost first, so are stored in reverse, in the order they are applied.
+
+    void template_program::add_substitution(
+        const std::string_view tag, const std::vector<std::string>& field_names) {
+
+        static constexpr std::pair<std::string_view, filter> filter_names[] = {
+            {"text",       filter::text},
+            {"cloze",      filter::cloze},
+            {"cloze-only", filter::cloze_only},
+            {"hint",       filter::hint},
+            {"furigana",   filter::furigana},
+            {"kana",       filter::kana},
+            {"kanji",      filter::kanji},
+        };
+
+        const auto separator = tag.rfind(':');
+        const auto filtered  = (separator != std::string_view::npos);
+        const auto name      = trim(filtered ? tag.substr(separator + 1) : tag);
+
+        auto specs = filtered ? tag.substr(0, separator) : std::string_view{};
+
+        // Type-in-the-answer fields are left for the reviewer to replace with an input, which
+        // Anki marks by rewriting them in double brackets.
+
+        if (trim(specs.substr(0, specs.find(':'))) == "type") {
+
+            add_text("[[");
+            add_text(tag);
+            add_text("]]");
+
+            return;
+        }
+
+        const auto ref = resolve(name, field_names);
+        if (ref.source == field_source::unknown) {
+
+            add_text("{unknown field ");
+            add_text(name);
+            add_text("}");
+
+            return;
+        }
+
+        auto& op = _ops.emplace_back();
+        op.code    = op_code::field;
+        op.source  = ref.source;
+        op.index   = ref.index;
+        op.operand = ksr::narrow_cast<std::uint32_t>(_filters.size());
+
+        // Filters that libanki does not implement, such as text-to-speech, are dropped, leaving
+        // the text unfiltered.
+
+        while (!specs.empty()) {
+
+            const auto split = specs.rfind(':');
+            const auto last  = (split == std::string_view::npos);
+            const auto spec  = trim(last ? specs : specs.substr(split + 1));
+
+            specs = last ? std::string_view{} : specs.substr(0, split);
+
+            for (const auto& [filter_name, filter] : filter_names) {
+                if (spec == filter_name) {
+                    _filters.push_back(filter);
+                    ++op.filter_count;
+                }
+            }
+        }
+    }
+
+    void template_program::apply(
+        const filter filter, const op& op, const std::string_view value,
+        const template_inputs& inputs, std::string& dst) const {
+
+        switch (filter) {
+        case filter::text:       strip_html(value, dst); break;
+        case filter::cloze:      render_cloze(value, inputs.cloze_ordinal, _side, dst); break;
+        case filter::cloze_only: render_cloze_only(value, inputs.cloze_ordinal, dst); break;
+        case filter::furigana:   render_furigana(value, furigana_mode::ruby, dst); break;
+        case filter::kana:       render_furigana(value, furigana_mode::kana, dst); break;
+        case filter::kanji:      render_furigana(value, furigana_mode::kanji, dst); break;
+        case filter::hint: {
+
+            const auto label = (op.source == field_source::note)
+                ? std::string_view{(*inputs.field_names)[op.index]}
+                : std::string_view{};
+
+            render_hint(value, label, dst);
+            break;
+        }
+        }
+    }
+}
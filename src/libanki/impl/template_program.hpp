@@ -0,0 +1,113 @@
+#ifndef LIBANKI_IMPL_TEMPLATE_PROGRAM_HPP
+#define LIBANKI_IMPL_TEMPLATE_PROGRAM_HPP
+
+#include "template_filters.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+
+    // Everything a template may refer to when rendering one side of one card.
+
+    struct template_inputs {
+        const std::vector<std::string>*      field_names   = nullptr;
+        const std::vector<std::string_view>* fields        = nullptr;
+        std::string_view                     front_side;
+        std::string_view                     tags;
+        std::string_view                     notetype_name;
+        std::string_view                     deck_name;
+        std::string_view                     template_name;
+        int                                  cloze_ordinal = 0;
+    };
+
+    // Card template compiled to a flat list of operations: literal text, field substitutions
+    // (each with its chain of filters) and conditional sections, which jump past their contents
+    // when the condition fails. Field names are resolved to indices at compile time, so rendering
+    // is a single pass over the operations with no parsing or lookup.
+    //
+    // Malformed templates render as Anki renders them where that is cheap to match (unknown
+    // fields render as `{unknown field NAME}`), and otherwise leniently: unterminated tags are
+    // literal text, unmatched section ends are ignored and unclosed sections end with the
+    // template.
+
+    class template_program {
+    public:
+
+        template_program(
+            std::string_view source, card_side side, const std::vector<std::string>& field_names);
+
+        // Renders the template into `dst`, using `scratch` for intermediate filter results.
+
+        void render(
+            const template_inputs& inputs, std::string& dst, std::string (&scratch)[2]) const;
+
+    private:
+
+        enum class op_code : std::uint8_t {
+            text,
+            field,
+            section,
+            inverted_section,
+        };
+
+        enum class field_source : std::uint8_t {
+            note,
+            front_side,
+            tags,
+            notetype,
+            deck,
+            subdeck,
+            card,
+            unknown,
+        };
+
+        enum class filter : std::uint8_t {
+            text,
+            cloze,
+            cloze_only,
+            hint,
+            furigana,
+            kana,
+            kanji,
+        };
+
+        // `index` is the offset of literal text within `_literals`, or the index of a note field.
+        // `operand` is the length of literal text, the index within `_filters` of a field's first
+        // filter, or the index of the operation following a section.
+
+        struct op {
+            op_code       code         = op_code::text;
+            field_source  source       = field_source::note;
+            std::uint16_t filter_count = 0;
+            std::uint32_t index        = 0;
+            std::uint32_t operand      = 0;
+        };
+
+        struct field_ref {
+            field_source  source = field_source::unknown;
+            std::uint32_t index  = 0;
+        };
+
+        static auto resolve(std::string_view name, const std::vector<std::string>& field_names)
+            -> field_ref;
+
+        static auto value_of(const op& op, const template_inputs& inputs) -> std::string_view;
+
+        void add_text(std::string_view text);
+        void add_substitution(std::string_view tag, const std::vector<std::string>& field_names);
+
+        void apply(
+            filter filter, const op& op, std::string_view value, const template_inputs& inputs,
+            std::string& dst) const;
+
+        card_side           _side;
+        std::vector<op>     _ops;
+        std::vector<filter> _filters;
+        std::string         _literals;
+    };
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "text_tokenizer.hpp"
+
+#include "template_filters.hpp"
+#include "utf8.hpp"
+
+namespace anki::impl {
+
+    namespace {
+
+        enum class char_class {
+            separator,
+            letter,
+            ideograph,
+            mark,
+        };
+
+        auto in_range(const std::uint32_t code_point, std::uint32_t first, std::uint32_t last)
+            -> bool {
+
+            return code_point >= first && code_point <= last;
+        }
+
+        auto classify(const std::uint32_t code_point) -> char_class {
+
+            if (code_point < 0x80) {
+
+                const auto is_alnum = in_range(code_point, '0', '9')
+                    || in_range(code_point, 'a', 'z') || in_range(code_point, 'A', 'Z');
+
+                return is_alnum ? char_class::letter : char_class::separator;
+            }
+
+            if (code_point < 0xc0 || code_point == 0xd7 || code_point == 0xf7) {
+                return char_class::separator;
+            }
+
+            if (in_range(code_point, 0x0300, 0x036f)) {
+                return char_class::mark;
+            }
+
+            if (in_range(code_point, 0x3040, 0x30ff) || in_range(code_point, 0x3400, 0x4dbf)
+                || in_range(code_point, 0x4e00, 0x9fff) || in_range(code_point, 0xf900, 0xfaff)
+                || in_range(code_point, 0x20000, 0x2ffff)) {
+
+                return char_class::ideograph;
+            }
+
+            // General and supplemental punctuation, CJK punctuation, CJK compatibility and
+            // halfwidth forms, and specials.
+
+            if (in_range(code_point, 0x2000, 0x206f) || in_range(code_point, 0x2e00, 0x2e7f)
+                || in_range(code_point, 0x3000, 0x303f) || in_range(code_point, 0xfe30, 0xfe4f)
+                || in_range(code_point, 0xff5f, 0xff65) || code_point >= 0xfff0) {
+
+                return char_class::separator;
+            }
+
+            return char_class::letter;
+        }
+
+        // Base letters of U+00C0 to U+017F, where `*` marks the ligatures, which fold to two
+        // letters, and spaces the two symbols in that range, which are never folded.
+
+        constexpr char latin_bases[] =
+            "aaaaaa*ceeeeiiiidnooooo ouuuuy**"  // U+00C0
+            "aaaaaa*ceeeeiiiidnooooo ouuuuy*y"  // U+00E0
+            "aaaaaaccccccccddddeeeeeeeeee"      // U+0100
+            "gggggggghhhhiiiiiiiiii**jjkkk"     // U+011C
+            "llllllllllnnnnnnnnnoooooo**"       // U+0139
+            "rrrrrrsssssssstttttt"              // U+0154
+            "uuuuuuuuuuuuwwyyyzzzzzzs";         // U+0168
+
+        static_assert(sizeof(latin_bases) == 0x180 - 0xc0 + 1);
+
+        auto latin_ligature(const std::uint32_t code_point) -> std::string_view {
+
+            switch (code_point) {
+            case 0xc6:  case 0xe6:  return "ae";
+            case 0xde:  case 0xfe:  return "th";
+            case 0xdf:              return "ss";
+            case 0x132: case 0x133: return "ij";
+            case 0x152: case 0x153: return "oe";
+            default:                return {};
+            }
+        }
+
+        // Greek letters with tonos or dialytika, and final sigma, with the plain lower-case
+        // letters they fold to.
+
+        constexpr std::pair<std::uint16_t, std::uint16_t> greek_folds[] = {
+            {0x386, 0x3b1}, {0x388, 0x3b5}, {0x389, 0x3b7}, {0x38a, 0x3b9}, {0x38c, 0x3bf},
+            {0x38e, 0x3c5}, {0x38f, 0x3c9}, {0x390, 0x3b9}, {0x3aa, 0x3b9}, {0x3ab, 0x3c5},
+            {0x3ac, 0x3b1}, {0x3ad, 0x3b5}, {0x3ae, 0x3b7}, {0x3af, 0x3b9}, {0x3b0, 0x3c5},
+            {0x3c2, 0x3c3}, {0x3ca, 0x3b9}, {0x3cb, 0x3c5}, {0x3cc, 0x3bf}, {0x3cd, 0x3c5},
+            {0x3ce, 0x3c9},
+        };
+
+        // Appends the folded form of the letter `code_point` to `dst`.
+
+        void append_folded(std::string& dst, std::uint32_t code_point) {
+
+            if (code_point < 0x80) {
+                dst += static_cast<char>(in_range(code_point, 'A', 'Z')
+                    ? code_point - 'A' + 'a'
+                    : code_point);
+
+                return;
+            }
+
+            if (in_range(code_point, 0xc0, 0x17f)) {
+
+                const auto base = latin_bases[code_point - 0xc0];
+                if (base == '*') {
+                    dst += latin_ligature(code_point);
+                }
+                else {
+                    dst += base;
+                }
+
+                return;
+            }
+
+            if (in_range(code_point, 0x391, 0x3a9)) {
+                code_point += 0x20;
+            }
+            else if (in_range(code_point, 0x386, 0x3ce)) {
+                for (const auto& [from, to] : greek_folds) {
+                    if (code_point == from) {
+                        code_point = to;
+                    }
+                }
+            }
+            else if (in_range(code_point, 0x400, 0x40f)) {
+                code_point += 0x50;
+            }
+            else if (in_range(code_point, 0x410, 0x42f)) {
+                code_point += 0x20;
+            }
+
+            // Cyrillic yo is commonly written without its diaeresis.
+
+            if (code_point == 0x451) {
+                code_point = 0x435;
+            }
+
+            append_utf8(dst, code_point);
+        }
+    }
+
+    void text_tokenizer::tokenize(const std::string_view text, std::vector<std::string_view>& dst) {
+
+        _text.clear();
+        _terms.clear();
+        _bounds.clear();
+        _term_begin = 0;
+
+        strip_html(text, _text);
+
+        auto pos = std::size_t{0};
+        while (pos < _text.size()) {
+
+            auto code_point = decode_utf8(_text, pos).value_or(0);
+
+            // Fullwidth ASCII characters are treated as the characters they stand for.
+
+            if (in_range(code_point, 0xff01, 0xff5e)) {
+                code_point -= 0xfee0;
+            }
+
+            switch (classify(code_point)) {
+            case char_class::separator:
+                end_term();
+                break;
+
+            case char_class::letter:
+                append_folded(_terms, code_point);
+                break;
+
+            case char_class::ideograph:
+                end_term();
+                append_utf8(_terms, code_point);
+                end_term();
+                break;
+
+            case char_class::mark:
+                break;
+            }
+        }
+
+        end_term();
+
+        // Views are only taken once the terms are complete, since they may move as they grow.
+
+        dst.clear();
+        for (const auto& [begin, size] : _bounds) {
+            dst.emplace_back(_terms.data() + begin, size);
+        }
+    }
+
+    void text_tokenizer::end_term() {
+
+        const auto size = _terms.size() - _term_begin;
+        if (size > max_term_size) {
+            _terms.resize(_term_begin);
+        }
+        else if (size > 0) {
+            _bounds.emplace_back(_term_begin, size);
+        }
+
+        _term_begin = _terms.size();
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LIBANKI_IMPL_TEXT_TOKENIZER_HPP
+#define LIBANKI_IMPL_TEXT_TOKENIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace anki::impl {
+
+    // Splits field text into the terms by which it is searched. HTML tags are dropped and
+    // character references decoded, as for the `text` filter. Terms are runs of letters and
+    // digits, folded so that case and diacritics do not matter: Latin letters (through Latin
+    // Extended-A, and in their fullwidth forms) fold to unaccented ASCII, Greek and Cyrillic
+    // letters to lower case without accents, and combining marks are dropped. CJK ideographs and
+    // kana, which are not written with spaces between words, are each a term of their own.
+    //
+    // A tokenizer holds only the buffers it reuses between calls.
+
+    class text_tokenizer {
+    public:
+
+        // Terms longer than this many bytes, which are unlikely to be words, are dropped.
+
+        static constexpr auto max_term_size = std::size_t{64};
+
+        // Replaces the contents of `dst` with the terms of `text`, in order. The views are valid
+        // until the next call.
+
+        void tokenize(std::string_view text, std::vector<std::string_view>& dst);
+
+    private:
+
+        void end_term();
+
+        std::string                                      _text;
+        std::string                                      _terms;
+        std::vector<std::pair<std::size_t, std::size_t>> _bounds;
+        std::size_t                                      _term_begin = 0;
+    };
+}
+
+#endif
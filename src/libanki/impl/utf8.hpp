@@ -0,0 +1,89 @@
+#ifndef LIBANKI_IMPL_UTF8_HPP
+#define LIBANKI_IMPL_UTF8_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace anki::impl {
+
+    // Appends the UTF-8 encoding of `code_point` to `dst`.
+
+    inline void append_utf8(std::string& dst, const std::uint32_t code_point) {
+
+        const auto put = [&dst] (std::uint32_t byte) {
+            dst += static_cast<char>(byte);
+        };
+
+        if (code_point < 0x80) {
+            put(code_point);
+        }
+        else if (code_point < 0x800) {
+            put(0xc0 | (code_point >> 6));
+            put(0x80 | (code_point & 0x3f));
+        }
+        else if (code_point < 0x10000) {
+            put(0xe0 | (code_point >> 12));
+            put(0x80 | ((code_point >> 6) & 0x3f));
+            put(0x80 | (code_point & 0x3f));
+        }
+        else {
+            put(0xf0 | (code_point >> 18));
+            put(0x80 | ((code_point >> 12) & 0x3f));
+            put(0x80 | ((code_point >> 6) & 0x3f));
+            put(0x80 | (code_point & 0x3f));
+        }
+    }
+
+    // Decodes the code point whose encoding starts at `text[pos]`, advancing `pos` past it.
+    // Returns `std::nullopt`, advancing `pos` by one byte, if the bytes there are not valid UTF-8
+    // (including overlong encodings and surrogates).
+
+    inline auto decode_utf8(const std::string_view text, std::size_t& pos)
+        -> std::optional<std::uint32_t> {
+
+        const auto byte = [&text] (std::size_t i) {
+            return static_cast<std::uint32_t>(static_cast<unsigned char>(text[i]));
+        };
+
+        const auto lead = byte(pos);
+        if (lead < 0x80) {
+            ++pos;
+            return lead;
+        }
+
+        const auto length = (lead >= 0xf0) ? 4u : (lead >= 0xe0) ? 3u : (lead >= 0xc0) ? 2u : 0u;
+        if (length == 0 || lead > 0xf4 || text.size() - pos < length) {
+            ++pos;
+            return std::nullopt;
+        }
+
+        auto code_point = lead & (0x7fu >> length);
+        for (auto i = std::size_t{1}; i < length; ++i) {
+
+            const auto next = byte(pos + i);
+            if ((next & 0xc0) != 0x80) {
+                ++pos;
+                return std::nullopt;
+            }
+
+            code_point = (code_point << 6) | (next & 0x3f);
+        }
+
+        static constexpr std::uint32_t min_code_point[] = {0, 0, 0x80, 0x800, 0x10000};
+
+        if (code_point < min_code_point[length] || code_point > 0x10ffff
+            || (code_point >= 0xd800 && code_point < 0xe000)) {
+
+            ++pos;
+            return std::nullopt;
+        }
+
+        pos += length;
+        return code_point;
+    }
+}
+
+#endif
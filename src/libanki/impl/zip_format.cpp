@@ -0,0 +1,129 @@
+#include "zip_format.hpp"
+
+#include "../error.hpp"
+
+#include <array>
+#include <limits>
+
+namespace anki::impl::zip_format {
+
+    namespace {
+
+        // Reads the zip64 end of central directory record referenced by the locator at offset
+        // `locator_offset`, from the tail if it lies there and otherwise through `read`, if set.
+        // The record must precede the locator.
+
+        auto read_zip64_eocd(
+            const std::byte* tail, std::uint64_t tail_offset, std::uint64_t locator_offset,
+            const archive_reader& read) -> std::optional<central_directory_location> {
+
+            const auto locator     = tail + (locator_offset - tail_offset);
+            const auto eocd_offset = load_u64(locator + 8);
+
+            if (eocd_offset > locator_offset || zip64_eocd_size > locator_offset - eocd_offset) {
+                return std::nullopt;
+            }
+
+            auto outside = std::array<std::byte, zip64_eocd_size>{};
+            auto record  = static_cast<const std::byte*>(outside.data());
+
+            if (eocd_offset >= tail_offset) {
+                record = tail + (eocd_offset - tail_offset);
+            }
+            else if (read) {
+                read(eocd_offset, outside.data(), outside.size());
+            }
+            else {
+                return std::nullopt;
+            }
+
+            if (load_u32(record) != zip64_eocd_signature) {
+                return std::nullopt;
+            }
+
+            auto location = central_directory_location{};
+            location.entry_count = load_u64(record + 32);
+            location.size        = load_u64(record + 40);
+            location.offset      = load_u64(record + 48);
+
+            if (location.offset > eocd_offset || location.size > eocd_offset - location.offset) {
+                return std::nullopt;
+            }
+
+            return location;
+        }
+    }
+
+    auto locate_central_directory(
+        const std::byte* tail, std::size_t tail_size, std::uint64_t tail_offset,
+        const archive_reader& read) -> std::optional<central_directory_location> {
+
+        if (tail_size < eocd_size) {
+            return std::nullopt;
+        }
+
+        // The record is followed only by its comment, so the search runs backwards and takes the
+        // first candidate whose comment length fits within the remaining bytes; signatures found
+        // further forward may be bytes of the comment itself.
+
+        for (auto pos = tail_size - eocd_size + 1; pos-- > 0;) {
+
+            const auto record = tail + pos;
+            if (load_u32(record) != eocd_signature) {
+                continue;
+            }
+
+            const auto comment_size = std::size_t{load_u16(record + 20)};
+            if (pos + eocd_size + comment_size > tail_size) {
+                continue;
+            }
+
+            auto location = central_directory_location{};
+            location.entry_count = load_u16(record + 10);
+            location.size        = load_u32(record + 12);
+            location.offset      = load_u32(record + 16);
+
+            if (pos >= zip64_locator_size) {
+
+                const auto locator = record - zip64_locator_size;
+                if (load_u32(locator) == zip64_locator_signature) {
+                    return read_zip64_eocd(
+                        tail, tail_offset, tail_offset + pos - zip64_locator_size, read);
+                }
+            }
+
+            const auto record_offset = tail_offset + pos;
+            if (location.offset > record_offset || location.size > record_offset - location.offset) {
+                return std::nullopt;
+            }
+
+            return location;
+        }
+
+        return std::nullopt;
+    }
+
+    auto max_entry_size(const zip_entry_info& info) noexcept -> std::uint64_t {
+
+        constexpr auto max_size = std::numeric_limits<std::uint64_t>::max();
+
+        if (info.method == zip_method::stored) {
+            return info.compressed_size;
+        }
+
+        return info.compressed_size > max_size / max_deflate_ratio
+            ? max_size
+            : info.compressed_size * max_deflate_ratio;
+    }
+
+    auto checked_entry_size(const zip_entry_info& info) -> std::size_t {
+
+        if (info.size > max_entry_size(info)
+            || info.size > std::numeric_limits<std::size_t>::max()) {
+
+            throw error{error_code::zip_archive_inconsistent};
+        }
+
+        return static_cast<std::size_t>(info.size);
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef LIBANKI_IMPL_ZIP_FORMAT_HPP
+#define LIBANKI_IMPL_ZIP_FORMAT_HPP
+
+#include "byte_order.hpp"
+
+#include "../zip_entry_info.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace anki::impl::zip_format {
+
+    // Constants and helpers describing the on-disk structure of zip archives, as laid out in
+    // PKWARE's APPNOTE.TXT. All multi-byte fields are little-endian and need not be aligned, so
+    // are accessed through the helpers of `byte_order.hpp`.
+
+    inline constexpr auto local_header_signature    = std::uint32_t{0x04034b50};
+    inline constexpr auto central_header_signature  = std::uint32_t{0x02014b50};
+    inline constexpr auto eocd_signature            = std::uint32_t{0x06054b50};
+    inline constexpr auto zip64_locator_signature   = std::uint32_t{0x07064b50};
+    inline constexpr auto zip64_eocd_signature      = std::uint32_t{0x06064b50};
+    inline constexpr auto data_descriptor_signature = std::uint32_t{0x08074b50};
+
+    inline constexpr auto local_header_size   = std::size_t{30};
+    inline constexpr auto central_header_size = std::size_t{46};
+    inline constexpr auto eocd_size           = std::size_t{22};
+    inline constexpr auto zip64_locator_size  = std::size_t{20};
+    inline constexpr auto zip64_eocd_size     = std::size_t{56};
+    inline constexpr auto max_comment_size    = std::size_t{0xffff};
+
+    // Fields too small for a zip64 value hold these markers, and the value itself is stored in the
+    // zip64 extended information extra field (which has ID `zip64_extra_id`) instead.
+
+    inline constexpr auto zip64_extra_id  = std::uint16_t{0x0001};
+    inline constexpr auto zip64_marker_16 = std::uint16_t{0xffff};
+    inline constexpr auto zip64_marker_32 = std::uint32_t{0xffffffff};
+
+    // Number of bytes at the end of an archive that are guaranteed to contain the end of central
+    // directory record and, for zip64 archives, the zip64 end of central directory locator.
+
+    inline constexpr auto max_tail_size = eocd_size + max_comment_size + zip64_locator_size;
+
+    // Greatest ratio of decompressed to compressed size that deflate can achieve: each 258-byte
+    // match costs at least two bits, plus a little framing.
+
+    inline constexpr auto max_deflate_ratio = std::uint64_t{1032};
+
+    // Greatest decompressed size that an entry with the compressed size of `info` can genuinely
+    // have: its compressed size if it is stored, and `max_deflate_ratio` times that otherwise.
+
+    auto max_entry_size(const zip_entry_info& info) noexcept -> std::uint64_t;
+
+    // Returns the decompressed size of `info`, for sizing a buffer to hold the entry, after
+    // checking that it is no more than `max_entry_size(info)`. Sizes are taken from headers that
+    // a malicious archive may set at will, so this keeps a tiny archive from demanding an
+    // enormous buffer. Throws `anki::error` with `error_code::zip_archive_inconsistent` if the
+    // size is implausible or does not fit in a `std::size_t`.
+
+    auto checked_entry_size(const zip_entry_info& info) -> std::size_t;
+
+    // Position and extent of an archive's central directory, as recorded in its end of central
+    // directory record (or the zip64 equivalent).
+
+    struct central_directory_location {
+        std::uint64_t offset      = 0;
+        std::uint64_t size        = 0;
+        std::uint64_t entry_count = 0;
+    };
+
+    // Reads `size` bytes at `offset` within an archive into `dst`, throwing `anki::error` if it
+    // cannot.
+
+    using archive_reader =
+        std::function<void(std::uint64_t offset, std::byte* dst, std::size_t size)>;
+
+    // Locates the central directory of an archive given its final bytes `[tail, tail + tail_size)`,
+    // which begin at offset `tail_offset` within the archive. `tail` should span at least
+    // `max_tail_size` bytes, or the whole archive if it is smaller. A zip64 end of central
+    // directory record lying before `tail` (as it does when the archive has a long comment, or
+    // data between the record and its locator) is read through `read`. Returns `std::nullopt` if
+    // no consistent end of central directory record can be found, including when such a record
+    // lies outside `tail` and `read` is empty.
+
+    auto locate_central_directory(
+        const std::byte* tail, std::size_t tail_size, std::uint64_t tail_offset,
+        const archive_reader& read = {}) -> std::optional<central_directory_location>;
+}
+
+#endif
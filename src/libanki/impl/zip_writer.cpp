@@ -0,0 +1,297 @@
+#include "zip_writer.hpp"
+
+#include "../error.hpp"
+#include "zip_format.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+
+using namespace anki::impl::zip_format;
+
+namespace anki::impl {
+
+    namespace {
+
+        // Size of the output buffer; entry data at least this large is written directly instead.
+        // Arbitrary; not profiled.
+
+        constexpr auto buffer_size = std::size_t{1} << 20;
+
+        constexpr auto version_default = std::uint16_t{20};
+        constexpr auto version_zip64   = std::uint16_t{45};
+
+        // DOS date for 1980-01-01, the earliest representable, with a time of midnight.
+
+        constexpr auto dos_date = std::uint16_t{(1 << 5) | 1};
+        constexpr auto dos_time = std::uint16_t{0};
+
+        // Marks the entry name as UTF-8; names in pure ASCII leave it unset, for the benefit of
+        // older readers.
+
+        constexpr auto flag_utf8 = std::uint16_t{0x0800};
+
+        auto needs_zip64(std::uint64_t value) -> bool {
+            return value >= zip64_marker_32;
+        }
+
+        auto narrow_or_marker(std::uint64_t value) -> std::uint32_t {
+            return needs_zip64(value) ? zip64_marker_32 : static_cast<std::uint32_t>(value);
+        }
+
+        auto name_flags(std::string_view name) -> std::uint16_t {
+
+            const auto is_ascii = std::all_of(name.begin(), name.end(), [] (const char c) {
+                return static_cast<unsigned char>(c) < 0x80;
+            });
+
+            return is_ascii ? 0 : flag_utf8;
+        }
+
+        void write_all(int fd, const std::byte* data, std::size_t size) {
+
+            while (size > 0) {
+
+                const auto result = ::write(fd, data, size);
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw error{error_code::zip_write_error};
+                }
+
+                data += result;
+                size -= static_cast<std::size_t>(result);
+            }
+        }
+
+        // Builder for a single little-endian record.
+
+        class record {
+        public:
+
+            void put_u16(std::uint16_t value) { store_u16(extend(2), value); }
+            void put_u32(std::uint32_t value) { store_u32(extend(4), value); }
+            void put_u64(std::uint64_t value) { store_u64(extend(8), value); }
+
+            void put_bytes(const void* data, std::size_t size) {
+
+                const auto src = static_cast<const std::byte*>(data);
+                std::copy(src, src + size, extend(size));
+            }
+
+            auto data() const noexcept -> const std::byte* { return _bytes.data(); }
+            auto size() const noexcept -> std::size_t      { return _bytes.size(); }
+
+        private:
+
+            auto extend(std::size_t size) -> std::byte* {
+
+                _bytes.resize(_bytes.size() + size);
+                return _bytes.data() + _bytes.size() - size;
+            }
+
+            std::vector<std::byte> _bytes;
+        };
+    }
+
+    zip_writer::zip_writer(const path& dst)
+      : _file{dst} {
+
+        _buffer.reserve(buffer_size);
+    }
+
+    zip_writer::~zip_writer() = default;
+
+    void zip_writer::begin_entry(const std::string_view name, const zip_entry_info& info) {
+
+        assert(_file.fd() >= 0);
+        assert(!info.encrypted);
+
+        check_entry_complete();
+
+        if (name.size() > zip64_marker_16) {
+            throw error{error_code::zip_invalid_argument};
+        }
+
+        // The local header can only hold zip64 sizes in its extra field, which then must hold
+        // both sizes.
+
+        const auto zip64 = needs_zip64(info.size) || needs_zip64(info.compressed_size);
+        const auto flags = name_flags(name);
+
+        auto header = record{};
+        header.put_u32(local_header_signature);
+        header.put_u16(zip64 ? version_zip64 : version_default);
+        header.put_u16(flags);
+        header.put_u16(static_cast<std::uint16_t>(info.method));
+        header.put_u16(dos_time);
+        header.put_u16(dos_date);
+        header.put_u32(info.crc);
+        header.put_u32(zip64 ? zip64_marker_32 : narrow_or_marker(info.compressed_size));
+        header.put_u32(zip64 ? zip64_marker_32 : narrow_or_marker(info.size));
+        header.put_u16(static_cast<std::uint16_t>(name.size()));
+        header.put_u16(zip64 ? 20 : 0);
+        header.put_bytes(name.data(), name.size());
+
+        if (zip64) {
+            header.put_u16(zip64_extra_id);
+            header.put_u16(16);
+            header.put_u64(info.size);
+            header.put_u64(info.compressed_size);
+        }
+
+        auto& entry = _entries.emplace_back();
+        entry.name                = std::string{name};
+        entry.info                = info;
+        entry.local_header_offset = _offset;
+
+        _entry_written = 0;
+        append(header.data(), header.size());
+    }
+
+    void zip_writer::write(const std::byte* const data, const std::size_t size) {
+
+        assert(!_entries.empty());
+
+        _entry_written += size;
+        append(data, size);
+    }
+
+    void zip_writer::finish() {
+
+        assert(_file.fd() >= 0);
+        check_entry_complete();
+
+        const auto directory_offset = _offset;
+
+        for (const auto& entry : _entries) {
+
+            const auto& info = entry.info;
+
+            auto extra = record{};
+            if (needs_zip64(info.size)) {
+                extra.put_u64(info.size);
+            }
+            if (needs_zip64(info.compressed_size)) {
+                extra.put_u64(info.compressed_size);
+            }
+            if (needs_zip64(entry.local_header_offset)) {
+                extra.put_u64(entry.local_header_offset);
+            }
+
+            const auto zip64   = (extra.size() > 0);
+            const auto version = zip64 ? version_zip64 : version_default;
+
+            auto header = record{};
+            header.put_u32(central_header_signature);
+            header.put_u16(version);
+            header.put_u16(version);
+            header.put_u16(name_flags(entry.name));
+            header.put_u16(static_cast<std::uint16_t>(info.method));
+            header.put_u16(dos_time);
+            header.put_u16(dos_date);
+            header.put_u32(info.crc);
+            header.put_u32(narrow_or_marker(info.compressed_size));
+            header.put_u32(narrow_or_marker(info.size));
+            header.put_u16(static_cast<std::uint16_t>(entry.name.size()));
+            header.put_u16(zip64 ? static_cast<std::uint16_t>(4 + extra.size()) : 0);
+            header.put_u16(0);                                  // Comment length
+            header.put_u16(0);                                  // Starting disk
+            header.put_u16(0);                                  // Internal attributes
+            header.put_u32(0);                                  // External attributes
+            header.put_u32(narrow_or_marker(entry.local_header_offset));
+            header.put_bytes(entry.name.data(), entry.name.size());
+
+            if (zip64) {
+                header.put_u16(zip64_extra_id);
+                header.put_u16(static_cast<std::uint16_t>(extra.size()));
+                header.put_bytes(extra.data(), extra.size());
+            }
+
+            append(header.data(), header.size());
+        }
+
+        const auto directory_size = _offset - directory_offset;
+        const auto entry_count    = std::uint64_t{_entries.size()};
+
+        const auto zip64 = needs_zip64(directory_offset) || needs_zip64(directory_size)
+            || entry_count >= zip64_marker_16;
+
+        auto tail = record{};
+
+        if (zip64) {
+
+            const auto zip64_eocd_offset = _offset;
+
+            tail.put_u32(zip64_eocd_signature);
+            tail.put_u64(zip64_eocd_size - 12);                 // Size of the remaining record
+            tail.put_u16(version_zip64);
+            tail.put_u16(version_zip64);
+            tail.put_u32(0);                                    // This disk
+            tail.put_u32(0);                                    // Central directory disk
+            tail.put_u64(entry_count);
+            tail.put_u64(entry_count);
+            tail.put_u64(directory_size);
+            tail.put_u64(directory_offset);
+
+            tail.put_u32(zip64_locator_signature);
+            tail.put_u32(0);                                    // Zip64 EOCD disk
+            tail.put_u64(zip64_eocd_offset);
+            tail.put_u32(1);                                    // Total disks
+        }
+
+        const auto short_count = static_cast<std::uint16_t>(
+            std::min<std::uint64_t>(entry_count, zip64_marker_16));
+
+        tail.put_u32(eocd_signature);
+        tail.put_u16(0);                                        // This disk
+        tail.put_u16(0);                                        // Central directory disk
+        tail.put_u16(short_count);
+        tail.put_u16(short_count);
+        tail.put_u32(narrow_or_marker(directory_size));
+        tail.put_u32(narrow_or_marker(directory_offset));
+        tail.put_u16(0);                                        // Comment length
+
+        append(tail.data(), tail.size());
+        flush();
+
+        _file.commit();
+    }
+
+    void zip_writer::check_entry_complete() const {
+
+        if (!_entries.empty() && _entry_written != _entries.back().info.compressed_size) {
+            throw error{error_code::zip_internal_error};
+        }
+    }
+
+    void zip_writer::append(const std::byte* data, std::size_t size) {
+
+        _offset += size;
+
+        if (_buffer.size() + size <= buffer_size) {
+            _buffer.insert(_buffer.end(), data, data + size);
+            return;
+        }
+
+        flush();
+
+        if (size < buffer_size) {
+            _buffer.insert(_buffer.end(), data, data + size);
+            return;
+        }
+
+        write_all(_file.fd(), data, size);
+    }
+
+    void zip_writer::flush() {
+
+        write_all(_file.fd(), _buffer.data(), _buffer.size());
+        _buffer.clear();
+    }
+}
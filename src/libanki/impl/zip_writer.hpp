@@ -0,0 +1,83 @@
+#ifndef LIBANKI_IMPL_ZIP_WRITER_HPP
+#define LIBANKI_IMPL_ZIP_WRITER_HPP
+
+#include "../filesystem.hpp"
+#include "../zip_entry_info.hpp"
+#include "replace_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki::impl {
+
+    // Writes a new zip archive sequentially. Each entry's metadata must be known before its data
+    // is written, since entries are written with their sizes and CRC in the local header rather
+    // than in a trailing data descriptor; this keeps the output readable by the simplest zip
+    // readers, including this library's native backend. Zip64 structures are written only where
+    // sizes, offsets or the entry count require them. Timestamps are fixed at the earliest DOS
+    // date, so that identical input produces identical archives.
+    //
+    // The archive is written to a `replacement_file`, which only replaces `dst` once `finish()`
+    // completes, so that a failed write leaves any existing file there intact and no truncated
+    // archive behind.
+
+    class zip_writer {
+    public:
+
+        // Starts an archive to be written to `dst`. Throws `anki::error` on failure.
+
+        explicit zip_writer(const path& dst);
+
+        // Discards the archive if `finish()` has not completed.
+
+        ~zip_writer();
+
+        zip_writer(zip_writer&&)      = delete;
+        zip_writer(const zip_writer&) = delete;
+
+        auto operator=(zip_writer&&)      -> zip_writer& = delete;
+        auto operator=(const zip_writer&) -> zip_writer& = delete;
+
+        // Starts a new entry named `name` and described by `info`, whose data (already compressed
+        // by `info.method`) must then be supplied through `write()`, `info.compressed_size` bytes
+        // in total. `info.encrypted` must be unset. Throws `anki::error` on failure.
+
+        void begin_entry(std::string_view name, const zip_entry_info& info);
+
+        // Appends `[data, data + size)` to the data of the current entry. Throws `anki::error` on
+        // failure.
+
+        void write(const std::byte* data, std::size_t size);
+
+        // Writes the central directory and moves the archive into place at `dst`. No further
+        // entries may be added. Throws `anki::error` on failure.
+
+        void finish();
+
+    private:
+
+        struct central_entry {
+            std::string    name;
+            zip_entry_info info;
+            std::uint64_t  local_header_offset = 0;
+        };
+
+        void check_entry_complete() const;
+
+        void append(const std::byte* data, std::size_t size);
+        void flush();
+
+        replacement_file _file;
+
+        std::vector<std::byte> _buffer;
+        std::uint64_t          _offset = 0;
+
+        std::vector<central_entry> _entries;
+        std::uint64_t              _entry_written = 0;
+    };
+}
+
+#endif
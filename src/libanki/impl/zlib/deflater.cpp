@@ -0,0 +1,124 @@
+#include "deflater.hpp"
+
+#include "../../error.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace anki::impl::zlib {
+
+    namespace {
+
+        // zlib counts bytes in `uInt`, which may be narrower than `std::size_t`; larger requests
+        // are simply split across several calls.
+
+        constexpr auto max_chunk = std::size_t{std::numeric_limits<uInt>::max()};
+
+        auto clamp_size(std::size_t size) -> uInt {
+            return static_cast<uInt>(std::min(size, max_chunk));
+        }
+
+        [[noreturn]] void throw_error(int zlib_code) {
+
+            switch (zlib_code) {
+            case Z_MEM_ERROR: throw error{error_code::zip_bad_alloc};
+            default:          throw error{error_code::zip_internal_error};
+            }
+        }
+    }
+
+    deflater::deflater(const int level) {
+
+        // As for `inflater`, a negative window size selects raw deflate data. The memory level is
+        // zlib's default.
+
+        const auto code = deflateInit2(&_stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if (code != Z_OK) {
+            throw_error(code);
+        }
+    }
+
+    deflater::~deflater() {
+        deflateEnd(&_stream);
+    }
+
+    void deflater::set_dictionary(const std::byte* data, std::size_t size) {
+
+        // Only the final 32 KiB of a dictionary can be referenced by deflate data, and zlib
+        // discards the rest anyway.
+
+        static constexpr auto window_size = std::size_t{1} << 15;
+
+        if (size > window_size) {
+            data += size - window_size;
+            size  = window_size;
+        }
+
+        const auto code = deflateSetDictionary(
+            &_stream, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+
+        if (code != Z_OK) {
+            throw_error(code);
+        }
+    }
+
+    void deflater::deflate(
+        const std::byte* src, std::size_t src_size, const bool finish,
+        std::vector<std::byte>& dst) {
+
+        // Reserving the bound up front means that zlib normally completes in a single call; the
+        // loop only continues where a block is larger than zlib can count in one go.
+
+        dst.reserve(dst.size() + deflateBound(&_stream, clamp_size(src_size)) + 16);
+
+        while (true) {
+
+            const auto chunk_size = clamp_size(src_size);
+            const auto last_chunk = (chunk_size == src_size);
+            const auto flush      = !last_chunk ? Z_NO_FLUSH : finish ? Z_FINISH : Z_SYNC_FLUSH;
+
+            // zlib never writes through `next_in`; the `const_cast` is only required by its API.
+
+            _stream.next_in  = reinterpret_cast<Bytef*>(const_cast<std::byte*>(src));
+            _stream.avail_in = chunk_size;
+
+            do {
+
+                if (dst.size() == dst.capacity()) {
+                    dst.reserve(dst.capacity() * 2);
+                }
+
+                const auto old_size = dst.size();
+                dst.resize(dst.capacity());
+
+                _stream.next_out  = reinterpret_cast<Bytef*>(dst.data() + old_size);
+                _stream.avail_out = clamp_size(dst.size() - old_size);
+
+                const auto avail_out = _stream.avail_out;
+
+                const auto code = ::deflate(&_stream, flush);
+                if (code != Z_OK && code != Z_STREAM_END && code != Z_BUF_ERROR) {
+                    throw_error(code);
+                }
+
+                dst.resize(old_size + (avail_out - _stream.avail_out));
+            }
+            while (_stream.avail_in > 0 || _stream.avail_out == 0);
+
+            src      += chunk_size;
+            src_size -= chunk_size;
+
+            if (last_chunk) {
+                return;
+            }
+        }
+    }
+
+    void deflater::reset() {
+
+        const auto code = deflateReset(&_stream);
+        if (code != Z_OK) {
+            throw_error(code);
+        }
+    }
+}
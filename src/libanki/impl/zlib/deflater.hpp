@@ -0,0 +1,54 @@
+#ifndef LIBANKI_IMPL_ZLIB_DEFLATER_HPP
+#define LIBANKI_IMPL_ZLIB_DEFLATER_HPP
+
+#include "zlib.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace anki::impl::zlib {
+
+    // RAII wrapper for a zlib stream encoding raw deflate data (that is, data without a zlib or
+    // gzip header, as stored within zip archives). Input is compressed a block at a time, so that
+    // independently compressed blocks may be concatenated into a single deflate stream.
+
+    class deflater {
+    public:
+
+        // Throws `anki::error` if the zlib stream cannot be initialised. `level` is a zlib
+        // compression level, from 0 to 9.
+
+        explicit deflater(int level);
+        ~deflater();
+
+        deflater(deflater&&)      = delete;
+        deflater(const deflater&) = delete;
+
+        auto operator=(deflater&&)      -> deflater& = delete;
+        auto operator=(const deflater&) -> deflater& = delete;
+
+        // Primes the stream with `[data, data + size)` as preceding context, so that the next
+        // block may refer back into it. Only valid before the first call to `deflate()` since the
+        // stream was constructed or reset.
+
+        void set_dictionary(const std::byte* data, std::size_t size);
+
+        // Compresses `[src, src + src_size)`, appending the output to `dst`. If `finish` is set,
+        // the output ends the deflate stream; otherwise it ends on a byte boundary with a sync
+        // flush, and without marking the final deflate block, so that a further stream may follow
+        // it directly.
+
+        void deflate(const std::byte* src, std::size_t src_size, bool finish, std::vector<std::byte>& dst);
+
+        // Returns the stream to its initial state, ready to encode a new block while retaining
+        // the memory already allocated by zlib.
+
+        void reset();
+
+    private:
+
+        z_stream _stream = {};
+    };
+}
+
+#endif
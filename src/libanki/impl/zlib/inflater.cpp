@@ -0,0 +1,101 @@
+#include "inflater.hpp"
+
+#include "../../error.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace anki::impl::zlib {
+
+    namespace {
+
+        // zlib counts bytes in `uInt`, which may be narrower than `std::size_t`; larger requests
+        // are simply split across several calls.
+
+        constexpr auto max_chunk = std::size_t{std::numeric_limits<uInt>::max()};
+
+        auto clamp_size(std::size_t size) -> uInt {
+            return static_cast<uInt>(std::min(size, max_chunk));
+        }
+
+        [[noreturn]] void throw_error(int zlib_code) {
+
+            switch (zlib_code) {
+            case Z_DATA_ERROR: throw error{error_code::zip_invalid_compressed_data};
+            case Z_MEM_ERROR:  throw error{error_code::zip_bad_alloc};
+            default:           throw error{error_code::zip_internal_error};
+            }
+        }
+    }
+
+    inflater::inflater() {
+
+        // A negative window size selects raw deflate data; 15 is the largest window permitted by
+        // the deflate format and hence by the zip format.
+
+        const auto code = inflateInit2(&_stream, -15);
+        if (code != Z_OK) {
+            throw_error(code);
+        }
+    }
+
+    inflater::~inflater() {
+        inflateEnd(&_stream);
+    }
+
+    auto inflater::inflate(
+        const std::byte* const src, const std::size_t src_size,
+        std::byte* const dst, const std::size_t dst_size) -> result {
+
+        // zlib never writes through `next_in`; the `const_cast` is only required by its API. It
+        // rejects a null `next_out` even with no room for output, as when decoding an empty entry
+        // into an empty buffer, so one is substituted.
+
+        auto no_output = Bytef{};
+
+        _stream.next_in   = reinterpret_cast<Bytef*>(const_cast<std::byte*>(src));
+        _stream.avail_in  = clamp_size(src_size);
+        _stream.next_out  = dst ? reinterpret_cast<Bytef*>(dst) : &no_output;
+        _stream.avail_out = clamp_size(dst_size);
+
+        const auto avail_in  = _stream.avail_in;
+        const auto avail_out = _stream.avail_out;
+
+        const auto code = ::inflate(&_stream, Z_NO_FLUSH);
+        if (code != Z_OK && code != Z_STREAM_END && code != Z_BUF_ERROR) {
+            throw_error(code);
+        }
+
+        auto output = result{};
+        output.consumed = avail_in - _stream.avail_in;
+        output.produced = avail_out - _stream.avail_out;
+        output.finished = (code == Z_STREAM_END);
+
+        return output;
+    }
+
+    void inflater::reset() {
+
+        const auto code = inflateReset(&_stream);
+        if (code != Z_OK) {
+            throw_error(code);
+        }
+    }
+
+    auto crc32(std::uint32_t crc, const std::byte* data, std::size_t size) -> std::uint32_t {
+
+        auto wide_crc = uLong{crc};
+
+        while (size > 0) {
+
+            const auto chunk_size = clamp_size(size);
+            wide_crc = ::crc32(wide_crc, reinterpret_cast<const Bytef*>(data), chunk_size);
+
+            data += chunk_size;
+            size -= chunk_size;
+        }
+
+        return static_cast<std::uint32_t>(wide_crc);
+    }
+}
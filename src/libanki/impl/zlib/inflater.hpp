@@ -0,0 +1,61 @@
+#ifndef LIBANKI_IMPL_ZLIB_INFLATER_HPP
+#define LIBANKI_IMPL_ZLIB_INFLATER_HPP
+
+#include "zlib.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anki::impl::zlib {
+
+    // RAII wrapper for a zlib stream decoding raw deflate data (that is, data without a zlib or
+    // gzip header, as stored within zip archives). Input and output are supplied incrementally, so
+    // a single stream may be driven by buffers arriving from elsewhere.
+
+    class inflater {
+    public:
+
+        // Outcome of a single call to `inflate()`: the number of input bytes consumed, the number
+        // of output bytes produced, and whether the end of the deflate stream has been reached.
+
+        struct result {
+            std::size_t consumed = 0;
+            std::size_t produced = 0;
+            bool        finished = false;
+        };
+
+        // Throws `anki::error` if the zlib stream cannot be initialised.
+
+        inflater();
+        ~inflater();
+
+        inflater(inflater&&)      = delete;
+        inflater(const inflater&) = delete;
+
+        auto operator=(inflater&&)      -> inflater& = delete;
+        auto operator=(const inflater&) -> inflater& = delete;
+
+        // Decodes as much of `[src, src + src_size)` into `[dst, dst + dst_size)` as possible. A
+        // result consuming and producing nothing indicates that more input or more output space
+        // is required. Throws `anki::error` if the input is not valid deflate data.
+
+        auto inflate(const std::byte* src, std::size_t src_size, std::byte* dst, std::size_t dst_size)
+            -> result;
+
+        // Returns the stream to its initial state, ready to decode a new deflate stream while
+        // retaining the memory already allocated by zlib.
+
+        void reset();
+
+    private:
+
+        z_stream _stream = {};
+    };
+
+    // Continues the CRC-32 checksum `crc` over `[data, data + size)`; the checksum of an empty
+    // sequence is 0.
+
+    auto crc32(std::uint32_t crc, const std::byte* data, std::size_t size) -> std::uint32_t;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef LIBANKI_IMPORT_OPTIONS_HPP
+#define LIBANKI_IMPORT_OPTIONS_HPP
+
+#include "zip_backend.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace anki {
+
+    class note_store;
+
+    // Options controlling how packages are read, by `import()` and `collection`. `verify_crc`
+    // may be cleared to skip checksumming the extracted collection when a package comes from a
+    // trusted source, such as one this library has just exported. `reuse_buffers` may be set
+    // by a thread that reads many packages in turn to keep its extraction buffers and decoder
+    // from one package to the next (see `pipeline_options::reuse_resources`).
+    //
+    // `dedup_notes` may be set to a store shared by the collections of many packages, so that the
+    // notes they have in common are held once: `collection::notes()` then adds each note to the
+    // store and views the GUID and fields of the store's copy, and the collection releases its
+    // notes from the store when it is destroyed.
+    //
+    // `max_entry_size` bounds the decompressed size of each entry that `import(int, ...)` reads
+    // from a stream. An entry whose sizes follow its data can otherwise only be bounded by what
+    // its compressed data could expand to, so a caller reading packages from an untrusted peer
+    // may want to set a limit of its own.
+
+    struct import_options {
+        zip_backend                 backend        = zip_backend::libzip;
+        bool                        verify_crc     = true;
+        bool                        reuse_buffers  = false;
+        std::shared_ptr<note_store> dedup_notes;
+        std::uint64_t               max_entry_size = std::numeric_limits<std::uint64_t>::max();
+    };
+}
+
+#endif
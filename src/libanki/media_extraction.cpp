@@ -0,0 +1,393 @@
+#include "media_extraction.hpp"
+
+#include "error.hpp"
+#include "impl/archive_file.hpp"
+#include "impl/crc32.hpp"
+#include "impl/mapped_file.hpp"
+#include "impl/media_manifest.hpp"
+#include "impl/native/archive.hpp"
+#include "impl/parallel.hpp"
+#include "impl/zip_format.hpp"
+#include "impl/zlib/inflater.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto chunk_size = std::size_t{1} << 20; // Arbitrary; not profiled
+
+        // Whether `name` may be created within the destination directory without escaping it.
+
+        auto is_plain_file_name(const std::string_view name) -> bool {
+            return !name.empty() && name != "." && name != ".."
+                && name.find_first_of(std::string_view{"/\0", 2}) == std::string_view::npos;
+        }
+
+        void write_all(const int fd, const std::byte* data, std::size_t size) {
+
+            while (size > 0) {
+
+                const auto result = ::write(fd, data, size);
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw error{error_code::system_error};
+                }
+
+                data += result;
+                size -= static_cast<std::size_t>(result);
+            }
+        }
+
+        // File being extracted, which is removed on destruction unless `commit()` has succeeded.
+
+        class output_file {
+        public:
+
+            explicit output_file(path dst)
+              : _path{std::move(dst)},
+                _fd{::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)} {
+
+                if (_fd < 0) {
+                    throw error{error_code::system_error};
+                }
+            }
+
+            ~output_file() {
+
+                if (_fd >= 0) {
+                    ::close(_fd);
+                    ::unlink(_path.c_str());
+                }
+            }
+
+            output_file(const output_file&) = delete;
+            auto operator=(const output_file&) -> output_file& = delete;
+
+            auto fd()        const noexcept -> int         { return _fd; }
+            auto file_path() const noexcept -> const path& { return _path; }
+
+            // Reserves `size` bytes for the file, so that it is laid out in one piece rather than
+            // grown write by write. Filesystems that cannot preallocate are left to do without.
+
+            void preallocate(const std::uint64_t size) const {
+
+                if (size == 0) {
+                    return;
+                }
+
+                if (::fallocate(_fd, 0, 0, static_cast<off_t>(size)) != 0
+                    && errno != EOPNOTSUPP && errno != ENOSYS) {
+
+                    throw error{error_code::system_error};
+                }
+            }
+
+            void commit() {
+
+                const auto result = ::close(_fd);
+                _fd = -1;
+
+                if (result != 0) {
+                    ::unlink(_path.c_str());
+                    throw error{error_code::system_error};
+                }
+            }
+
+        private:
+
+            path _path;
+            int  _fd;
+        };
+
+        // Ways of copying stored data, from the most to the least direct. Each thread falls back
+        // to the next when the kernel or filesystem rejects one, and keeps to it thereafter.
+
+        enum class copy_method {
+            copy_file_range,
+            sendfile,
+            read_write,
+        };
+
+        auto is_unsupported(const int err) noexcept -> bool {
+            return err == EXDEV || err == ENOSYS || err == EINVAL || err == EOPNOTSUPP;
+        }
+
+        // State of a thread extracting files, kept from one file to the next. Entry data is read
+        // from `package`, a mapping of the whole package shared by every thread, so that neither
+        // compressed data nor the checksum of stored data needs a read of its own.
+
+        class extractor {
+        public:
+
+            extractor(
+                const impl::native::archive& archive, const impl::mapped_file& package,
+                const media_extraction_options& options)
+              : _archive{archive}, _package{package}, _options{options} {
+            }
+
+            void extract(const media_entry& entry, const path& dst) {
+
+                const auto location = _archive.locate_file(entry.archive_name);
+                const auto& info    = location.info;
+
+                if (info.encrypted) {
+                    throw error{error_code::zip_password_required};
+                }
+
+                if (info.method != zip_method::stored && info.method != zip_method::deflated) {
+                    throw error{error_code::zip_unsupported_compression_method};
+                }
+
+                if (location.offset > _package.size()
+                    || info.compressed_size > _package.size() - location.offset) {
+
+                    throw error{error_code::zip_premature_eof};
+                }
+
+                // The size is checked before anything is created, so that a bogus size in the
+                // central directory cannot claim disk space through `preallocate()`.
+
+                const auto size = impl::zip_format::checked_entry_size(info);
+
+                auto file = output_file{dst};
+                file.preallocate(size);
+
+                if (info.method == zip_method::stored) {
+                    copy_stored(file, info, location.offset);
+                }
+                else {
+                    inflate(file, info, _package.data() + location.offset);
+                }
+
+                file.commit();
+            }
+
+        private:
+
+            void copy_stored(
+                const output_file& file, const zip_entry_info& info, const std::uint64_t offset) {
+
+                if (info.compressed_size != info.size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                const auto size = ksr::narrow_cast<std::size_t>(info.size);
+
+                if (_options.verify_crc
+                    && impl::crc32(0, _package.data() + offset, size) != info.crc) {
+
+                    throw error{error_code::zip_bad_crc};
+                }
+
+                auto src_offset = static_cast<off_t>(offset);
+                auto remaining  = size;
+
+                while (remaining > 0) {
+
+                    const auto copied = copy_chunk(file.fd(), src_offset, remaining);
+                    if (copied == 0) {
+                        throw error{error_code::zip_premature_eof};
+                    }
+
+                    remaining -= copied;
+                }
+            }
+
+            // Copies up to `count` bytes from the package at `src_offset` to the end of `dst_fd`
+            // by the current copy method, advancing `src_offset`, and returns the number copied.
+
+            auto copy_chunk(const int dst_fd, off_t& src_offset, const std::size_t count)
+                -> std::size_t {
+
+                const auto src_fd = _archive.source().fd();
+
+                for (;;) {
+
+                    auto result = ssize_t{-1};
+
+                    switch (_method) {
+                    case copy_method::copy_file_range:
+                        result = ::copy_file_range(src_fd, &src_offset, dst_fd, nullptr, count, 0);
+                        break;
+
+                    case copy_method::sendfile:
+                        result = ::sendfile(dst_fd, src_fd, &src_offset, count);
+                        break;
+
+                    case copy_method::read_write:
+                        write_all(dst_fd, _package.data() + src_offset, count);
+                        src_offset += static_cast<off_t>(count);
+                        return count;
+                    }
+
+                    if (result >= 0) {
+                        return static_cast<std::size_t>(result);
+                    }
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    if (!is_unsupported(errno)) {
+                        throw error{error_code::system_error};
+                    }
+
+                    _method = (_method == copy_method::copy_file_range)
+                        ? copy_method::sendfile : copy_method::read_write;
+                }
+            }
+
+            void inflate(
+                const output_file& file, const zip_entry_info& info, const std::byte* src) {
+
+                if (_inflater) {
+                    _inflater->reset();
+                }
+                else {
+                    _inflater = std::make_unique<impl::zlib::inflater>();
+                    _output.resize(chunk_size);
+                }
+
+                auto remaining = ksr::narrow_cast<std::size_t>(info.compressed_size);
+                auto size      = std::uint64_t{0};
+                auto crc       = std::uint32_t{0};
+                auto finished  = false;
+
+                while (!finished) {
+
+                    const auto result = _inflater->inflate(
+                        src, remaining, _output.data(), _output.size());
+
+                    src       += result.consumed;
+                    remaining -= result.consumed;
+                    finished   = result.finished;
+
+                    if (result.produced == 0 && result.consumed == 0) {
+                        break;
+                    }
+
+                    // Data beyond the recorded size is rejected before it is written, so that a
+                    // decompression bomb cannot fill the destination filesystem.
+
+                    if (result.produced > info.size - size) {
+                        throw error{error_code::zip_archive_inconsistent};
+                    }
+
+                    if (_options.verify_crc) {
+                        crc = impl::crc32(crc, _output.data(), result.produced);
+                    }
+
+                    write_all(file.fd(), _output.data(), result.produced);
+                    size += result.produced;
+                }
+
+                if (!finished) {
+                    throw error{error_code::zip_invalid_compressed_data};
+                }
+
+                if (size != info.size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                if (_options.verify_crc && crc != info.crc) {
+                    throw error{error_code::zip_bad_crc};
+                }
+            }
+
+            const impl::native::archive&    _archive;
+            const impl::mapped_file&        _package;
+            const media_extraction_options& _options;
+
+            copy_method                           _method = copy_method::copy_file_range;
+            std::unique_ptr<impl::zlib::inflater> _inflater;
+            std::vector<std::byte>                _output;
+        };
+    }
+
+    auto extract_media(
+        const path& src, const path& dst, const media_extraction_options& options)
+        -> std::size_t {
+
+        const auto archive = impl::native::archive{impl::archive_file{src}};
+        const auto package = impl::mapped_file{src};
+
+        const auto manifest = archive.open_file(impl::media_manifest_path, false)->read_all();
+        const auto entries  = impl::parse_media_manifest(std::string_view{
+            reinterpret_cast<const char*>(manifest.data()), manifest.size()});
+
+        for (const auto& entry : entries) {
+            if (!is_plain_file_name(entry.name)) {
+                throw error{error_code::invalid_media_manifest};
+            }
+        }
+
+        // A name listed more than once would be extracted by several threads at once, racing to
+        // truncate and remove the same file; only its last listing is kept, which is what
+        // extracting the manifest in order would leave behind.
+
+        auto last_listing = std::unordered_map<std::string_view, std::size_t>{};
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+            last_listing[entries[i].name] = i;
+        }
+
+        auto files = std::vector<const media_entry*>{};
+        files.reserve(last_listing.size());
+
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+            if (last_listing[entries[i].name] == i) {
+                files.push_back(&entries[i]);
+            }
+        }
+
+        if (files.empty()) {
+            return 0;
+        }
+
+        // Files are handed out one at a time, since their sizes vary too widely to divide them
+        // evenly up front. The first error stops every thread from starting another file.
+
+        auto next   = std::atomic<std::size_t>{0};
+        auto failed = std::atomic<bool>{false};
+
+        const auto run = [&] {
+
+            auto current = extractor{archive, package, options};
+
+            for (auto i = next++; i < files.size() && !failed.load(std::memory_order_relaxed);
+                 i = next++) {
+
+                try {
+                    current.extract(*files[i], dst / files[i]->name);
+                }
+                catch (...) {
+                    failed.store(true, std::memory_order_relaxed);
+                    throw;
+                }
+            }
+        };
+
+        impl::run_parallel(
+            impl::parallel_thread_count(options.thread_count, files.size()),
+            [&run] (std::size_t) { run(); });
+
+        return files.size();
+    }
+}
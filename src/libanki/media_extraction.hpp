@@ -0,0 +1,43 @@
+#ifndef LIBANKI_MEDIA_EXTRACTION_HPP
+#define LIBANKI_MEDIA_EXTRACTION_HPP
+
+#include "filesystem.hpp"
+
+#include <cstddef>
+
+namespace anki {
+
+    // Tuning parameters for `extract_media()`.
+    //
+    // * `thread_count` is the number of threads to extract with, including the calling thread, or
+    //   0 to use one per hardware thread.
+    // * `verify_crc` may be cleared for packages from a trusted source to skip checksumming the
+    //   extracted files.
+
+    struct media_extraction_options {
+        unsigned thread_count = 0;
+        bool     verify_crc   = true;
+    };
+
+    // Extracts every media file listed in the manifest of the package at `src` into the existing
+    // directory `dst`, each under its own name (replacing any file of that name), and returns the
+    // number extracted, using several threads. A name listed more than once is extracted once,
+    // from its last listing. Stored files are copied from the package within the
+    // kernel, by `copy_file_range()` (or `sendfile()` where that is not supported), and checksummed
+    // in place through a mapping of the package; deflated files are decoded from that mapping in
+    // chunks, into a buffer kept by each thread, and written out as they go. Each file is
+    // preallocated at its final size before it is written.
+    //
+    // Throws `anki::error` if the package or its manifest cannot be read, with
+    // `error_code::invalid_media_manifest` if the manifest names a file outside `dst`, or with
+    // `error_code::system_error` if a file cannot be written, or with
+    // `error_code::zip_archive_inconsistent` if a file's recorded size is larger than its
+    // compressed size allows or its data decompresses to more. A file whose extraction fails is
+    // removed, but files already extracted are left in place.
+
+    auto extract_media(
+        const path& src, const path& dst, const media_extraction_options& options = {})
+        -> std::size_t;
+}
+
+#endif
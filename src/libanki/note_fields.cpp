@@ -0,0 +1,218 @@
+#include "note_fields.hpp"
+
+#include "impl/field_scan.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBANKI_FIELD_SCAN_SIMD
+#include <immintrin.h>
+#endif
+
+namespace anki {
+
+    namespace {
+
+        using impl::field_scan_kernel;
+
+        auto detect_kernel() -> field_scan_kernel {
+
+#ifdef LIBANKI_FIELD_SCAN_SIMD
+            if (__builtin_cpu_supports("avx2")) {
+                return field_scan_kernel::avx2;
+            }
+
+            return field_scan_kernel::sse2;
+#else
+            return field_scan_kernel::scalar;
+#endif
+        }
+
+        // Each kernel calls `visit(pos)` with the position of each separator within
+        // `[data, data + size)`, in order, stopping early if `visit` returns `false`. Returns
+        // whether the whole of the data was scanned.
+
+        template<typename fn>
+        auto scan_scalar(const char* const data, const std::size_t size, fn&& visit) -> bool {
+
+            auto pos = std::size_t{0};
+            while (pos < size) {
+
+                const auto found = static_cast<const char*>(
+                    std::memchr(data + pos, field_separator, size - pos));
+
+                if (!found) {
+                    break;
+                }
+
+                pos = static_cast<std::size_t>(found - data);
+                if (!visit(pos)) {
+                    return false;
+                }
+
+                ++pos;
+            }
+
+            return true;
+        }
+
+#ifdef LIBANKI_FIELD_SCAN_SIMD
+
+        // Visits each set bit of `mask` as a separator at `base` plus the bit's index.
+
+        template<typename fn>
+        auto visit_mask(unsigned mask, const std::size_t base, fn& visit) -> bool {
+
+            while (mask != 0) {
+
+                if (!visit(base + static_cast<std::size_t>(__builtin_ctz(mask)))) {
+                    return false;
+                }
+
+                mask &= mask - 1;
+            }
+
+            return true;
+        }
+
+        template<typename fn>
+        auto scan_sse2(const char* const data, const std::size_t size, fn&& visit) -> bool {
+
+            const auto separator = _mm_set1_epi8(field_separator);
+
+            auto pos = std::size_t{0};
+            for (; pos + 16 <= size; pos += 16) {
+
+                const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const auto mask  = static_cast<unsigned>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, separator)));
+
+                if (!visit_mask(mask, pos, visit)) {
+                    return false;
+                }
+            }
+
+            return scan_scalar(data + pos, size - pos, [&visit, pos] (std::size_t tail_pos) {
+                return visit(pos + tail_pos);
+            });
+        }
+
+        template<typename fn>
+        __attribute__((target("avx2")))
+        auto scan_avx2(const char* const data, const std::size_t size, fn&& visit) -> bool {
+
+            const auto separator = _mm256_set1_epi8(field_separator);
+
+            auto pos = std::size_t{0};
+            for (; pos + 32 <= size; pos += 32) {
+
+                const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                const auto mask  = static_cast<unsigned>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, separator)));
+
+                if (!visit_mask(mask, pos, visit)) {
+                    return false;
+                }
+            }
+
+            return scan_sse2(data + pos, size - pos, [&visit, pos] (std::size_t tail_pos) {
+                return visit(pos + tail_pos);
+            });
+        }
+
+#endif
+
+        template<typename fn>
+        auto scan(const field_scan_kernel kernel, const std::string_view text, fn&& visit) -> bool {
+
+            switch (kernel) {
+#ifdef LIBANKI_FIELD_SCAN_SIMD
+            case field_scan_kernel::avx2: return scan_avx2(text.data(), text.size(), visit);
+            case field_scan_kernel::sse2: return scan_sse2(text.data(), text.size(), visit);
+#endif
+            default:                      return scan_scalar(text.data(), text.size(), visit);
+            }
+        }
+    }
+
+    namespace impl {
+
+        auto active_field_scan_kernel() -> field_scan_kernel {
+
+            static const auto kernel = detect_kernel();
+            return kernel;
+        }
+
+        auto field_scan_kernel_supported(const field_scan_kernel kernel) -> bool {
+
+            switch (kernel) {
+            case field_scan_kernel::scalar: return true;
+#ifdef LIBANKI_FIELD_SCAN_SIMD
+            case field_scan_kernel::sse2:   return true;
+#endif
+            default:                        return kernel == active_field_scan_kernel();
+            }
+        }
+
+        void split_fields(
+            const field_scan_kernel kernel, const std::string_view fields,
+            std::vector<std::string_view>& dst) {
+
+            assert(field_scan_kernel_supported(kernel));
+
+            dst.clear();
+
+            auto start = std::size_t{0};
+            scan(kernel, fields, [&] (const std::size_t pos) {
+
+                dst.push_back(fields.substr(start, pos - start));
+                start = pos + 1;
+
+                return true;
+            });
+
+            dst.push_back(fields.substr(start));
+        }
+
+        auto field_at(
+            const field_scan_kernel kernel, const std::string_view fields, const std::size_t index)
+            -> std::optional<std::string_view> {
+
+            assert(field_scan_kernel_supported(kernel));
+
+            auto count  = std::size_t{0};
+            auto start  = std::size_t{0};
+            auto result = std::optional<std::string_view>{};
+
+            const auto complete = scan(kernel, fields, [&] (const std::size_t pos) {
+
+                if (count == index) {
+                    result = fields.substr(start, pos - start);
+                    return false;
+                }
+
+                ++count;
+                start = pos + 1;
+
+                return true;
+            });
+
+            if (complete && count == index) {
+                result = fields.substr(start);
+            }
+
+            return result;
+        }
+    }
+
+    void split_fields(const std::string_view fields, std::vector<std::string_view>& dst) {
+        impl::split_fields(impl::active_field_scan_kernel(), fields, dst);
+    }
+
+    auto field_at(const std::string_view fields, const std::size_t index)
+        -> std::optional<std::string_view> {
+
+        return impl::field_at(impl::active_field_scan_kernel(), fields, index);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef LIBANKI_NOTE_FIELDS_HPP
+#define LIBANKI_NOTE_FIELDS_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    // Character separating the values of a note's fields within `note::fields`.
+
+    inline constexpr auto field_separator = '\x1f';
+
+    // Splits the field text of a note at each `field_separator`, replacing the contents of `dst`
+    // with views of the individual fields, in order; text with n separators holds n + 1 fields.
+    // No field text is copied, and reusing `dst` across notes avoids allocation once it has grown
+    // to the largest field count. The separator scan is vectorised (with AVX2 where the CPU
+    // supports it, and SSE2 otherwise on x86-64).
+
+    void split_fields(std::string_view fields, std::vector<std::string_view>& dst);
+
+    // Returns the field at `index` within the field text of a note, or `std::nullopt` if the note
+    // has no more than `index` fields.
+
+    auto field_at(std::string_view fields, std::size_t index) -> std::optional<std::string_view>;
+}
+
+#endif
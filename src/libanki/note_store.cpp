@@ -0,0 +1,267 @@
+#include "note_store.hpp"
+
+#include "collection.hpp"
+
+#include <cstring>
+#include <string_view>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto min_shard_capacity = std::size_t{16};
+
+        auto rotate_left(const std::uint64_t value, const int shift) noexcept -> std::uint64_t {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+        // Final mix of MurmurHash3, so that every bit of the result depends on every bit of
+        // `value`; the shard and the table slot of a note are taken from opposite ends of it.
+
+        auto avalanche(std::uint64_t value) noexcept -> std::uint64_t {
+
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccd;
+            value ^= value >> 33;
+            value *= 0xc4ceb9fe1a85ec53;
+            value ^= value >> 33;
+
+            return value;
+        }
+
+        // Hash of `text`, read a word at a time. This need only spread notes over the table, not
+        // resist deliberate collisions: equal hashes are always followed by comparing the text.
+
+        auto hash_text(const std::string_view text) noexcept -> std::uint64_t {
+
+            constexpr auto k1 = std::uint64_t{0x87c37b91114253d5};
+            constexpr auto k2 = std::uint64_t{0x4cf5ad432745937f};
+
+            auto hash = std::uint64_t{text.size()} * k2;
+            auto pos  = std::size_t{0};
+
+            for (; pos + 8 <= text.size(); pos += 8) {
+
+                auto word = std::uint64_t{};
+                std::memcpy(&word, text.data() + pos, 8);
+                hash = rotate_left(hash ^ (word * k1), 31) * k2;
+            }
+
+            // An empty view may have a null `data()`, which `memcpy` must not be given even to
+            // copy nothing.
+
+            auto tail = std::uint64_t{};
+            if (pos < text.size()) {
+                std::memcpy(&tail, text.data() + pos, text.size() - pos);
+            }
+
+            hash = rotate_left(hash ^ (tail * k1), 31) * k2;
+
+            return avalanche(hash);
+        }
+
+        auto note_hash(const std::string_view guid, const std::uint64_t fields_checksum) noexcept
+            -> std::uint64_t {
+
+            return avalanche(hash_text(guid) ^ rotate_left(fields_checksum, 17));
+        }
+
+        auto capacity_for(const std::size_t count) -> std::size_t {
+
+            auto capacity = min_shard_capacity;
+            while (capacity / 4 * 3 < count) {
+                capacity *= 2;
+            }
+
+            return capacity;
+        }
+    }
+
+    note_store::note_store(const std::size_t expected_count) {
+
+        const auto capacity = capacity_for(expected_count / shard_count + 1);
+        for (auto& target : _shards) {
+            target.slots.resize(capacity);
+        }
+    }
+
+    auto note_store::add(const note& note) -> const canonical_note& {
+
+        const auto fields_checksum = hash_text(note.fields);
+        const auto hash            = note_hash(note.guid, fields_checksum);
+
+        auto& target = _shards[shard_index(hash)];
+        const auto lock = std::lock_guard{target.mutex};
+
+        return acquire(target, hash, fields_checksum, note);
+    }
+
+    auto note_store::add(const collection& collection) -> std::vector<const canonical_note*> {
+        return add(collection.notes());
+    }
+
+    auto note_store::add(const std::vector<note>& notes) -> std::vector<const canonical_note*> {
+
+        // Hashing, the bulk of the work, is done before taking any lock; the notes are then
+        // sorted by shard (by counting), so that each shard's lock is taken once.
+
+        struct hashed_note {
+            std::uint64_t hash;
+            std::uint64_t fields_checksum;
+        };
+
+        auto hashed = std::vector<hashed_note>(notes.size());
+        auto starts = std::array<std::size_t, shard_count + 1>{};
+
+        for (auto i = std::size_t{0}; i < notes.size(); ++i) {
+
+            const auto fields_checksum = hash_text(notes[i].fields);
+            hashed[i] = {note_hash(notes[i].guid, fields_checksum), fields_checksum};
+            ++starts[shard_index(hashed[i].hash) + 1];
+        }
+
+        for (auto i = std::size_t{1}; i < starts.size(); ++i) {
+            starts[i] += starts[i - 1];
+        }
+
+        auto order = std::vector<std::size_t>(notes.size());
+        auto ends  = starts;
+
+        for (auto i = std::size_t{0}; i < notes.size(); ++i) {
+            order[ends[shard_index(hashed[i].hash)]++] = i;
+        }
+
+        auto result = std::vector<const canonical_note*>(notes.size());
+
+        for (auto s = std::size_t{0}; s < shard_count; ++s) {
+
+            if (starts[s] == starts[s + 1]) {
+                continue;
+            }
+
+            auto& target = _shards[s];
+            const auto lock = std::lock_guard{target.mutex};
+
+            for (auto i = starts[s]; i < starts[s + 1]; ++i) {
+
+                const auto index = order[i];
+                result[index] = &acquire(
+                    target, hashed[index].hash, hashed[index].fields_checksum, notes[index]);
+            }
+        }
+
+        return result;
+    }
+
+    auto note_store::release(const canonical_note& note) -> bool {
+
+        // A note revived by `acquire()` is revived under its shard's lock, but a release needn't
+        // take it: the count alone decides which release was the last.
+
+        if (note.references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return false;
+        }
+
+        _live_count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    auto note_store::stats() const -> note_store_stats {
+
+        auto result = note_store_stats{};
+        result.added      = _added.load(std::memory_order_relaxed);
+        result.duplicates = _duplicates.load(std::memory_order_relaxed);
+        result.live_count = _live_count.load(std::memory_order_relaxed);
+
+        for (const auto& target : _shards) {
+
+            const auto lock = std::lock_guard{target.mutex};
+            result.canonical_count += target.notes.size();
+        }
+
+        return result;
+    }
+
+    auto note_store::acquire(shard& target, const std::uint64_t hash,
+                             const std::uint64_t fields_checksum, const note& note)
+        -> canonical_note& {
+
+        _added.fetch_add(1, std::memory_order_relaxed);
+
+        const auto mask = target.slots.size() - 1;
+
+        auto i = static_cast<std::size_t>(hash) & mask;
+        for (; target.slots[i].note; i = (i + 1) & mask) {
+
+            const auto& current = target.slots[i];
+            if (current.hash != hash) {
+                continue;
+            }
+
+            auto& existing = *current.note;
+            if (existing.fields_checksum != fields_checksum || existing.note.guid != note.guid
+                || existing.note.fields != note.fields) {
+
+                continue;
+            }
+
+            _duplicates.fetch_add(1, std::memory_order_relaxed);
+            if (existing.references.fetch_add(1, std::memory_order_acq_rel) == 0) {
+                _live_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return existing;
+        }
+
+        // Not found, so `i` is the empty slot that ended the probe; but if inserting would take
+        // the table over its load limit, it is grown first and the slot found afresh.
+
+        if (target.notes.size() + 1 > target.slots.size() / 4 * 3) {
+
+            grow(target);
+
+            const auto new_mask = target.slots.size() - 1;
+            for (i = static_cast<std::size_t>(hash) & new_mask; target.slots[i].note;
+                 i = (i + 1) & new_mask) {
+            }
+        }
+
+        auto stored = note;
+        stored.guid       = target.text.store(note.guid);
+        stored.tags       = target.text.store(note.tags);
+        stored.fields     = target.text.store(note.fields);
+        stored.sort_field = target.text.store(note.sort_field);
+
+        auto& inserted = target.notes.emplace_back();
+        inserted.note            = stored;
+        inserted.fields_checksum = fields_checksum;
+        inserted.references.store(1, std::memory_order_relaxed);
+
+        target.slots[i] = {hash, &inserted};
+        _live_count.fetch_add(1, std::memory_order_relaxed);
+
+        return inserted;
+    }
+
+    void note_store::grow(shard& target) {
+
+        auto slots = std::vector<slot>(target.slots.size() * 2);
+        const auto mask = slots.size() - 1;
+
+        for (const auto& current : target.slots) {
+
+            if (!current.note) {
+                continue;
+            }
+
+            auto i = static_cast<std::size_t>(current.hash) & mask;
+            while (slots[i].note) {
+                i = (i + 1) & mask;
+            }
+
+            slots[i] = current;
+        }
+
+        target.slots = std::move(slots);
+    }
+}
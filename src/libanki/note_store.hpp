@@ -0,0 +1,134 @@
+#ifndef LIBANKI_NOTE_STORE_HPP
+#define LIBANKI_NOTE_STORE_HPP
+
+#include "collection_records.hpp"
+
+#include "ksr/text_arena.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+
+    // Note held once by a `note_store` on behalf of every duplicate added to it: a copy of the
+    // first note added with its GUID and fields, whose text is owned by the store.
+    // `fields_checksum` is a 64-bit hash of the note's fields, and `references` the number of
+    // notes added as this one and not since released.
+
+    struct canonical_note {
+        anki::note                         note;
+        std::uint64_t                      fields_checksum = 0;
+        mutable std::atomic<std::uint32_t> references{0};
+    };
+
+    // Counters of a `note_store`. `canonical_count` includes notes whose references have all been
+    // released, which are kept (see `note_store::release()`); `live_count` excludes them.
+
+    struct note_store_stats {
+        std::uint64_t added           = 0;
+        std::uint64_t duplicates      = 0;
+        std::size_t   canonical_count = 0;
+        std::size_t   live_count      = 0;
+    };
+
+    // Store deduplicating notes across packages, so that notes shared by many overlapping decks
+    // are kept, and can be indexed, once. Two notes are duplicates if they have the same GUID and
+    // the same fields; a note whose fields have since been edited has the same GUID but is kept
+    // separately. Other columns (tags, modification time and so on) are those of the first note
+    // added, and the IDs of later duplicates, which are local to their collections, are ignored.
+    //
+    // Notes are kept in an open-addressing hash table with linear probing, split into shards by
+    // the high bits of the hash of each note's GUID and fields checksum. Each shard has its own
+    // lock, table and text arena, so imports adding notes from several threads at once contend
+    // only when they hash to the same shard; and `add(const collection&)` hashes a whole
+    // collection's notes before taking any lock, then takes each shard's lock once for all of its
+    // notes.
+    //
+    // Canonical notes have stable addresses for the lifetime of the store. A store may be used
+    // from several threads at once. Collections add their notes themselves when opened with a
+    // store as `import_options::dedup_notes`.
+
+    class note_store {
+    public:
+
+        // Sizes the store for `expected_count` distinct notes, so that it needn't grow until then.
+
+        explicit note_store(std::size_t expected_count = 0);
+
+        note_store(const note_store&) = delete;
+        auto operator=(const note_store&) -> note_store& = delete;
+
+        // Adds a reference to the canonical note matching `note`, first copying `note` into the
+        // store if there is none, and returns it.
+
+        auto add(const note& note) -> const canonical_note&;
+
+        // As above, for every note of `notes`, returning the canonical notes in the same order.
+
+        auto add(const std::vector<note>& notes) -> std::vector<const canonical_note*>;
+
+        // As above, for every note of `collection`, returning the canonical notes in the order of
+        // `collection.notes()`. Throws `anki::error` if the collection cannot be read. Not for a
+        // collection opened with this store as `import_options::dedup_notes`, whose notes are
+        // added as they are loaded.
+
+        auto add(const collection& collection) -> std::vector<const canonical_note*>;
+
+        // Removes a reference to `note`, which must have been returned by this store and not
+        // released as often as it was added, returning whether it was the last. A note without
+        // references is kept, and is referenced again if a duplicate of it is added, since
+        // open addressing leaves no cheap way to remove it from its table.
+
+        auto release(const canonical_note& note) -> bool;
+
+        auto stats() const -> note_store_stats;
+
+    private:
+
+        struct slot {
+            std::uint64_t   hash = 0;
+            canonical_note* note = nullptr;
+        };
+
+        // Guarded by `mutex`: the table (with a capacity that is a power of two, and empty slots
+        // being those without a note), the canonical notes in order of insertion, and the text
+        // they refer to. Shards are aligned so that their locks do not share cache lines.
+
+        struct alignas(64) shard {
+            mutable std::mutex         mutex;
+            std::vector<slot>          slots;
+            std::deque<canonical_note> notes;
+            ksr::text_arena            text{std::size_t{1} << 16};
+        };
+
+        static constexpr auto shard_bits  = 6;
+        static constexpr auto shard_count = std::size_t{1} << shard_bits;
+
+        static auto shard_index(std::uint64_t hash) noexcept -> std::size_t {
+            return static_cast<std::size_t>(hash >> (64 - shard_bits));
+        }
+
+        // Adds a reference to the canonical note in `target` matching `note`, inserting it if
+        // there is none. The shard's lock must be held.
+
+        auto acquire(shard& target, std::uint64_t hash, std::uint64_t fields_checksum,
+                     const note& note) -> canonical_note&;
+
+        static void grow(shard& target);
+
+        std::array<shard, shard_count> _shards;
+
+        std::atomic<std::uint64_t> _added{0};
+        std::atomic<std::uint64_t> _duplicates{0};
+        std::atomic<std::size_t>   _live_count{0};
+    };
+}
+
+#endif
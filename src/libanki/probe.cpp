@@ -0,0 +1,112 @@
+#include "probe.hpp"
+
+#include "impl/archive_file.hpp"
+#include "impl/media_manifest.hpp"
+#include "impl/native/central_directory.hpp"
+#include "impl/zip_format.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace anki {
+
+    namespace {
+
+        auto is_unsafe_name(const std::string_view name) -> bool {
+
+            if (!name.empty() && (name.front() == '/' || name.front() == '\\')) {
+                return true;
+            }
+
+            for (auto begin = std::size_t{0}; begin <= name.size(); ) {
+
+                const auto end = std::min(name.find_first_of("/\\", begin), name.size());
+                if (name.substr(begin, end - begin) == "..") {
+                    return true;
+                }
+
+                begin = end + 1;
+            }
+
+            return false;
+        }
+
+        // Whether the data of `target` would extend into the central directory at `limit`. The
+        // local header's own name and extra fields are not known without reading it, so only
+        // its fixed part is counted.
+
+        auto is_out_of_bounds(const impl::native::entry& target, const std::uint64_t limit)
+            -> bool {
+
+            using impl::zip_format::local_header_size;
+
+            const auto header_end = target.local_header_offset + local_header_size;
+            return target.local_header_offset >= limit
+                || header_end > limit
+                || target.info.compressed_size > limit - header_end;
+        }
+    }
+
+    auto probe_result::importable() const noexcept -> bool {
+        return !error && version && has_media_manifest && other_method_count == 0
+            && encrypted_count == 0 && duplicate_count == 0 && out_of_bounds_count == 0
+            && unsafe_name_count == 0;
+    }
+
+    auto probe(const path& src) -> probe_result {
+
+        auto result = probe_result{};
+
+        try {
+
+            const auto file      = impl::archive_file{src};
+            const auto directory = impl::native::central_directory{file};
+            const auto& entries  = directory.entries();
+
+            result.version = archive_apkg_version([&directory] (const path& file_path) {
+                return directory.find(file_path.string()) != nullptr;
+            });
+
+            result.entry_count        = entries.size();
+            result.has_media_manifest = directory.find(impl::media_manifest_path) != nullptr;
+
+            for (const auto& entry : entries) {
+
+                const auto& info = entry.info;
+                result.compressed_size += info.compressed_size;
+                result.size            += info.size;
+
+                switch (info.method) {
+                case zip_method::stored:   ++result.stored_count;       break;
+                case zip_method::deflated: ++result.deflated_count;     break;
+                default:                   ++result.other_method_count; break;
+                }
+
+                if (info.encrypted) {
+                    ++result.encrypted_count;
+                }
+
+                // `find()` returns the first entry of each name, so any other is a duplicate.
+
+                if (directory.find(entry.name) != &entry) {
+                    ++result.duplicate_count;
+                }
+
+                if (is_out_of_bounds(entry, directory.offset())) {
+                    ++result.out_of_bounds_count;
+                }
+
+                if (is_unsafe_name(entry.name)) {
+                    ++result.unsafe_name_count;
+                }
+            }
+        }
+        catch (const error& ex) {
+
+            result = probe_result{};
+            result.error = ex.code();
+        }
+
+        return result;
+    }
+}
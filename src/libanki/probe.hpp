@@ -0,0 +1,57 @@
+#ifndef LIBANKI_PROBE_HPP
+#define LIBANKI_PROBE_HPP
+
+#include "apkg_version.hpp"
+#include "error.hpp"
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace anki {
+
+    // Summary of a package as described by its central directory; see `probe()`.
+    //
+    // * `error` is set if the file could not be read as a zip archive at all, in which case every
+    //   other member is left empty.
+    // * `version` is empty if the archive holds no collection file.
+    // * `compressed_size` and `size` total the sizes of every entry, as stored and decompressed.
+    // * `other_method_count` counts entries compressed by methods libanki cannot decode.
+    // * `duplicate_count` counts entries whose name an earlier entry already has.
+    // * `out_of_bounds_count` counts entries whose data (by their recorded sizes) would overlap
+    //   the central directory, as only a truncated or corrupt archive has.
+    // * `unsafe_name_count` counts entries whose names are absolute or lead out of their parent
+    //   directory through `..`.
+
+    struct probe_result {
+        std::optional<error_code>   error;
+        std::optional<apkg_version> version;
+        std::size_t                 entry_count         = 0;
+        std::uint64_t               compressed_size     = 0;
+        std::uint64_t               size                = 0;
+        std::size_t                 stored_count        = 0;
+        std::size_t                 deflated_count      = 0;
+        std::size_t                 other_method_count  = 0;
+        std::size_t                 encrypted_count     = 0;
+        bool                        has_media_manifest  = false;
+        std::size_t                 duplicate_count     = 0;
+        std::size_t                 out_of_bounds_count = 0;
+        std::size_t                 unsafe_name_count   = 0;
+
+        // Whether nothing found rules out importing the package: it is a readable archive of a
+        // known version with a media manifest, and no entry is unreadable or malformed. Problems
+        // within entries' data can only be found by reading them.
+
+        auto importable() const noexcept -> bool;
+    };
+
+    // Summarises the package at `src` from its central directory alone, without reading any entry
+    // data or even any local header: at most two reads of the file, for its final bytes and any
+    // part of the directory that precedes them. Failures to open or parse the archive are
+    // reported in the result rather than thrown.
+
+    auto probe(const path& src) -> probe_result;
+}
+
+#endif
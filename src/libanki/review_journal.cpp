@@ -0,0 +1,454 @@
+#include "review_journal.hpp"
+
+#include "error.hpp"
+#include "impl/byte_order.hpp"
+#include "impl/crc32.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <limits>
+
+// A journal file (all of whose integers are little-endian) consists of a header of `header_size`
+// bytes, laid out as the `header_*` offsets below describe, followed by a record of `record_size`
+// bytes for each entry, laid out as the `record_*` offsets describe. The checksum of each record
+// is the CRC-32 of the bytes before it.
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto magic   = std::uint32_t{0x4a524b41};  // "AKRJ"
+        constexpr auto version = std::uint32_t{1};
+
+        constexpr auto header_magic       = std::size_t{0};
+        constexpr auto header_version     = std::size_t{4};
+        constexpr auto header_record_size = std::size_t{8};
+        constexpr auto header_size        = std::size_t{16};
+
+        constexpr auto record_id            = std::size_t{0};
+        constexpr auto record_card_id       = std::size_t{8};
+        constexpr auto record_interval      = std::size_t{16};
+        constexpr auto record_last_interval = std::size_t{20};
+        constexpr auto record_ease_factor   = std::size_t{24};
+        constexpr auto record_time          = std::size_t{28};
+        constexpr auto record_ease          = std::size_t{32};
+        constexpr auto record_type          = std::size_t{33};
+        constexpr auto record_checksum      = std::size_t{36};
+        constexpr auto record_size          = std::size_t{40};
+
+        // Records are read this many at a time during recovery and replay.
+
+        constexpr auto read_batch = std::size_t{4096};
+
+        using record_bytes = std::array<std::byte, record_size>;
+
+        [[noreturn]] void throw_system_error() {
+            throw error{error_code::system_error};
+        }
+
+        template<typename t>
+        auto clamp_to(const std::int64_t value) -> t {
+
+            using limits = std::numeric_limits<t>;
+            return static_cast<t>(std::clamp<std::int64_t>(value, limits::min(), limits::max()));
+        }
+
+        auto checksum(const std::byte* const record) -> std::uint32_t {
+            return impl::crc32(0, record, record_checksum);
+        }
+
+        auto encode(const review& entry) -> record_bytes {
+
+            auto result = record_bytes{};
+            const auto dst = result.data();
+
+            impl::store_u64(dst + record_id,      static_cast<std::uint64_t>(entry.id));
+            impl::store_u64(dst + record_card_id, static_cast<std::uint64_t>(entry.card_id));
+            impl::store_u32(dst + record_interval,
+                static_cast<std::uint32_t>(clamp_to<std::int32_t>(entry.interval)));
+            impl::store_u32(dst + record_last_interval,
+                static_cast<std::uint32_t>(clamp_to<std::int32_t>(entry.last_interval)));
+            impl::store_u32(dst + record_ease_factor,
+                static_cast<std::uint32_t>(clamp_to<std::int32_t>(entry.ease_factor)));
+            impl::store_u32(dst + record_time, clamp_to<std::uint32_t>(entry.time));
+
+            dst[record_ease] = static_cast<std::byte>(clamp_to<std::uint8_t>(entry.ease));
+            dst[record_type] = static_cast<std::byte>(clamp_to<std::uint8_t>(entry.type));
+
+            impl::store_u32(dst + record_checksum, checksum(dst));
+            return result;
+        }
+
+        auto decode(const std::byte* const src) -> review {
+
+            const auto load_i32 = [src] (std::size_t offset) {
+                return static_cast<std::int32_t>(impl::load_u32(src + offset));
+            };
+
+            auto result = review{};
+            result.id            = static_cast<std::int64_t>(impl::load_u64(src + record_id));
+            result.card_id       = static_cast<std::int64_t>(impl::load_u64(src + record_card_id));
+            result.usn           = -1;
+            result.interval      = load_i32(record_interval);
+            result.last_interval = load_i32(record_last_interval);
+            result.ease_factor   = load_i32(record_ease_factor);
+            result.time          = impl::load_u32(src + record_time);
+            result.ease          = std::to_integer<std::int64_t>(src[record_ease]);
+            result.type          = std::to_integer<std::int64_t>(src[record_type]);
+
+            return result;
+        }
+
+        auto intact(const std::byte* const record) -> bool {
+            return impl::load_u32(record + record_checksum) == checksum(record);
+        }
+
+        // Reads up to `size` bytes at `offset`, stopping early only at the end of the file, and
+        // returns the number read.
+
+        auto read_at(const int fd, std::byte* data, std::size_t size, std::uint64_t offset)
+            -> std::size_t {
+
+            auto total = std::size_t{0};
+            while (size > 0) {
+
+                const auto result = ::pread(fd, data, size, static_cast<off_t>(offset));
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw_system_error();
+                }
+
+                if (result == 0) {
+                    break;
+                }
+
+                const auto count = static_cast<std::size_t>(result);
+                data   += count;
+                size   -= count;
+                offset += count;
+                total  += count;
+            }
+
+            return total;
+        }
+
+        void write_at(const int fd, const std::byte* data, std::size_t size, std::uint64_t offset) {
+
+            while (size > 0) {
+
+                const auto result = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw_system_error();
+                }
+
+                const auto count = static_cast<std::size_t>(result);
+                data   += count;
+                size   -= count;
+                offset += count;
+            }
+        }
+
+        void sync(const int fd) {
+            if (::fdatasync(fd) != 0) {
+                throw_system_error();
+            }
+        }
+
+        // Syncs the directory `dir`, so that a file just created in it survives a crash.
+
+        void sync_directory(const path& dir) {
+
+            const auto fd = ::open(
+                dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+            if (fd < 0) {
+                throw_system_error();
+            }
+
+            const auto result = ::fsync(fd);
+            ::close(fd);
+
+            if (result != 0) {
+                throw_system_error();
+            }
+        }
+    }
+
+    review_journal::review_journal(const path& path, const review_journal_options& options)
+      : _options{options},
+        _fd{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666)} {
+
+        if (_fd < 0) {
+            throw_system_error();
+        }
+
+        try {
+
+            if (::flock(_fd, LOCK_EX | LOCK_NB) != 0) {
+                throw_system_error();
+            }
+
+            recover(path);
+            _writer = std::thread{[this] { run_writer(); }};
+        }
+        catch (...) {
+
+            ::close(_fd);
+            throw;
+        }
+    }
+
+    review_journal::~review_journal() {
+
+        {
+            const auto lock = std::lock_guard{_mutex};
+            _stopping = true;
+        }
+
+        _queued.notify_one();
+        _writer.join();
+
+        ::close(_fd);
+    }
+
+    auto review_journal::append(const review& entry) -> std::uint64_t {
+
+        const auto record = encode(entry);
+        auto lock = std::unique_lock{_mutex};
+
+        if (_error) {
+            throw_system_error();
+        }
+
+        const auto first = _pending.empty();
+        if (first) {
+            _pending_since = std::chrono::steady_clock::now();
+        }
+
+        _pending.insert(_pending.end(), record.begin(), record.end());
+
+        const auto sequence = ++_appended;
+        const auto full     = (_pending.size() >= _options.max_batch * record_size);
+
+        lock.unlock();
+
+        if (first || full) {
+            _queued.notify_one();
+        }
+
+        return sequence;
+    }
+
+    void review_journal::wait(const std::uint64_t sequence) {
+
+        auto lock = std::unique_lock{_mutex};
+        assert(sequence <= _appended);
+
+        _synced.wait(lock, [this, sequence] { return _durable >= sequence || _error; });
+        if (_durable < sequence) {
+            throw_system_error();
+        }
+    }
+
+    void review_journal::commit(const review& entry) {
+        wait(append(entry));
+    }
+
+    void review_journal::replay(const std::function<void(const review&)>& consume) const {
+
+        // Holding `_replay_mutex` keeps `clear()` from truncating the file while it is read, but
+        // not the writer from appending beyond `end`.
+
+        const auto replay_lock = std::lock_guard{_replay_mutex};
+
+        auto end = std::uint64_t{0};
+        {
+            const auto lock = std::lock_guard{_mutex};
+            end = _end;
+        }
+
+        // Records up to `end` are durable and were checked on opening or written since, so are
+        // not checked again.
+
+        auto buffer = std::vector<std::byte>(read_batch * record_size);
+        for (auto offset = std::uint64_t{header_size}; offset < end;) {
+
+            const auto size  = std::min<std::uint64_t>(buffer.size(), end - offset);
+            const auto count = read_at(_fd, buffer.data(), static_cast<std::size_t>(size), offset);
+
+            if (count != size) {
+                throw_system_error();
+            }
+
+            for (auto pos = std::size_t{0}; pos < count; pos += record_size) {
+                consume(decode(buffer.data() + pos));
+            }
+
+            offset += count;
+        }
+    }
+
+    void review_journal::clear() {
+
+        const auto replay_lock = std::lock_guard{_replay_mutex};
+
+        auto lock = std::unique_lock{_mutex};
+        _synced.wait(lock, [this] { return (_durable == _appended && !_writing) || _error; });
+
+        if (_error) {
+            throw_system_error();
+        }
+
+        // The writer is idle, and stays so while the lock is held.
+
+        if (::ftruncate(_fd, static_cast<off_t>(header_size)) != 0) {
+            throw_system_error();
+        }
+
+        _end = header_size;
+        sync(_fd);
+    }
+
+    // Validates the header (writing it if the file is new) and truncates the file after its last
+    // intact record.
+
+    void review_journal::recover(const path& path) {
+
+        struct stat info;
+        if (::fstat(_fd, &info) != 0) {
+            throw_system_error();
+        }
+
+        const auto file_size = static_cast<std::uint64_t>(info.st_size);
+
+        auto header = std::array<std::byte, header_size>{};
+        impl::store_u32(header.data() + header_magic,       magic);
+        impl::store_u32(header.data() + header_version,     version);
+        impl::store_u32(header.data() + header_record_size, record_size);
+
+        // A file shorter than the header is new, or was being created when the process stopped,
+        // in which case it holds part of the header.
+
+        if (file_size < header_size) {
+
+            auto existing = std::array<std::byte, header_size>{};
+            const auto count = read_at(_fd, existing.data(), existing.size(), 0);
+
+            if (!std::equal(existing.begin(), existing.begin() + count, header.begin())) {
+                throw error{error_code::invalid_review_journal};
+            }
+
+            write_at(_fd, header.data(), header.size(), 0);
+            sync(_fd);
+            sync_directory(path.parent_path());
+
+            _end = header_size;
+            return;
+        }
+
+        auto existing = std::array<std::byte, header_size>{};
+        if (read_at(_fd, existing.data(), existing.size(), 0) != header_size) {
+            throw_system_error();
+        }
+
+        if (existing != header) {
+            throw error{error_code::invalid_review_journal};
+        }
+
+        auto buffer = std::vector<std::byte>(read_batch * record_size);
+        auto end    = std::uint64_t{header_size};
+
+        while (true) {
+
+            const auto count = read_at(_fd, buffer.data(), buffer.size(), end);
+            auto pos = std::size_t{0};
+
+            while (pos + record_size <= count && intact(buffer.data() + pos)) {
+                pos += record_size;
+                ++_recovered;
+            }
+
+            end += pos;
+            if (pos < buffer.size()) {
+                break;
+            }
+        }
+
+        if (end < file_size) {
+
+            if (::ftruncate(_fd, static_cast<off_t>(end)) != 0) {
+                throw_system_error();
+            }
+
+            sync(_fd);
+        }
+
+        _end = end;
+    }
+
+    void review_journal::run_writer() {
+
+        auto lock  = std::unique_lock{_mutex};
+        auto batch = std::vector<std::byte>{};
+
+        while (true) {
+
+            _queued.wait(lock, [this] { return !_pending.empty() || _stopping; });
+            if (_pending.empty()) {
+                return;
+            }
+
+            // Later entries join the batch until the first has waited `max_delay` (if at all).
+
+            const auto batch_size = _options.max_batch * record_size;
+            _queued.wait_until(lock, _pending_since + _options.max_delay,
+                [this, batch_size] { return _stopping || _pending.size() >= batch_size; });
+
+            batch.swap(_pending);
+
+            const auto sequence = _appended;
+            const auto offset   = _end;
+
+            _writing = true;
+            lock.unlock();
+
+            try {
+                write_at(_fd, batch.data(), batch.size(), offset);
+                sync(_fd);
+            }
+            catch (...) {
+
+                lock.lock();
+                _error   = std::current_exception();
+                _writing = false;
+                _synced.notify_all();
+
+                return;
+            }
+
+            lock.lock();
+            _end      = offset + batch.size();
+            _durable  = sequence;
+            _writing  = false;
+            _synced.notify_all();
+
+            batch.clear();
+        }
+    }
+}
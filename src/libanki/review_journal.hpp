@@ -0,0 +1,132 @@
+#ifndef LIBANKI_REVIEW_JOURNAL_HPP
+#define LIBANKI_REVIEW_JOURNAL_HPP
+
+#include "collection_records.hpp"
+#include "filesystem.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anki {
+
+    // Tuning parameters for `review_journal`.
+    //
+    // * `max_delay` is how long the writer waits, once idle, for further entries to join the
+    //   first queued before writing them. With the default of 0, it writes at once, and entries
+    //   appended during each write and sync form the next batch, so batches grow with the rate of
+    //   answers while an answer waits at most two syncs.
+    // * `max_batch` is the number of entries after which a batch is written without waiting
+    //   further.
+
+    struct review_journal_options {
+        std::chrono::microseconds max_delay = std::chrono::microseconds{0};
+        std::size_t               max_batch = 4096;
+    };
+
+    // Append-only log of revlog entries recorded as cards are answered, which makes each answer
+    // durable before the collection (or any snapshot of it) is rewritten to include it.
+    //
+    // Entries are written in fixed-size records, each with a CRC-32 checksum of its contents.
+    // Appending an entry only queues it: a writer thread of the journal's own writes every entry
+    // queued since its last write with one `pwrite()` and one `fdatasync()`, and callers wait for
+    // the sync that covers their entries (group commit). Throughput is therefore bounded by the
+    // disk's write bandwidth rather than its sync rate.
+    //
+    // On opening, the journal is read to the last intact record, and anything after it (a record
+    // torn by a crash mid-write) is truncated away. `replay()` then passes every entry to a
+    // consumer, such as `revlog_stats::add()`, or `scheduler::answer()` with the card's row from
+    // `collection_columns::card_row()`.
+    //
+    // A journal may be used from several threads at once. Its file is locked while open, so that
+    // no other journal (in any process) can write to it too.
+
+    class review_journal {
+    public:
+
+        // Opens the journal at `path`, creating it if it does not exist, and recovers it as
+        // described above. Throws `anki::error` with `error_code::system_error` if the file cannot
+        // be opened, locked, read or truncated, or `error_code::invalid_review_journal` if it is
+        // not a journal of this version.
+
+        explicit review_journal(const path& path, const review_journal_options& options = {});
+
+        // Writes and syncs any entries still queued before closing the journal.
+
+        ~review_journal();
+
+        review_journal(const review_journal&) = delete;
+        auto operator=(const review_journal&) -> review_journal& = delete;
+
+        // Queues `entry` (whose `usn` is not recorded) and returns its sequence number, which
+        // counts entries appended since the journal was opened, from 1. Throws `anki::error` with
+        // `error_code::system_error` if an earlier write has failed.
+
+        auto append(const review& entry) -> std::uint64_t;
+
+        // Blocks until every entry up to sequence number `sequence` is durable. Throws
+        // `anki::error` with `error_code::system_error` if they could not be written.
+
+        void wait(std::uint64_t sequence);
+
+        // Appends `entry` and waits until it is durable.
+
+        void commit(const review& entry);
+
+        // Number of entries recovered when the journal was opened.
+
+        auto recovered_count() const noexcept -> std::uint64_t { return _recovered; }
+
+        // Passes every durable entry to `consume`, in the order appended. `consume` may append to
+        // the journal, but not clear it. Throws `anki::error` with `error_code::system_error` if
+        // the journal cannot be read.
+
+        void replay(const std::function<void(const review&)>& consume) const;
+
+        // Discards every entry, once a collection or snapshot including them has been saved.
+        // Entries still queued are written and discarded first. Throws `anki::error` with
+        // `error_code::system_error` on failure.
+
+        void clear();
+
+    private:
+
+        void recover(const path& path);
+        void run_writer();
+
+        review_journal_options _options;
+        int                    _fd;
+        std::uint64_t          _recovered = 0;
+
+        // Held by `replay()` and `clear()`, and taken before `_mutex` by the latter.
+
+        mutable std::mutex _replay_mutex;
+
+        // Guarded by `_mutex`: entries queued for the next write, the sequence numbers of the last
+        // entry appended and the last made durable, the end of the file, and the writer's state.
+
+        mutable std::mutex      _mutex;
+        std::condition_variable _queued;
+        std::condition_variable _synced;
+
+        std::vector<std::byte>                _pending;
+        std::chrono::steady_clock::time_point _pending_since;
+
+        std::uint64_t      _appended = 0;
+        std::uint64_t      _durable  = 0;
+        std::uint64_t      _end      = 0;
+        bool               _writing  = false;
+        bool               _stopping = false;
+        std::exception_ptr _error;
+
+        std::thread _writer;
+    };
+}
+
+#endif
@@ -0,0 +1,333 @@
+#include "revlog_stats.hpp"
+
+#include "collection.hpp"
+#include "collection_snapshot.hpp"
+#include "impl/parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto seconds_per_day = std::int64_t{86400};
+
+        // Runs shorter than this are not worth a thread of their own.
+
+        constexpr auto min_rows_per_thread = std::size_t{1} << 16;
+
+        template<typename t>
+        auto clamp_to(const std::int64_t value) -> t {
+
+            using limits = std::numeric_limits<t>;
+            return static_cast<t>(std::clamp<std::int64_t>(value, limits::min(), limits::max()));
+        }
+
+        auto floor_div(const std::int64_t lhs, const std::int64_t rhs) -> std::int64_t {
+            return lhs / rhs - ((lhs % rhs != 0) && ((lhs < 0) != (rhs < 0)) ? 1 : 0);
+        }
+
+        void add_entry(
+            review_totals& totals, const std::uint8_t type, const std::uint8_t ease,
+            const std::int32_t last_interval, const std::uint32_t time) {
+
+            switch (type) {
+            case 0:  ++totals.learning;    break;
+            case 1:  ++totals.review;      break;
+            case 2:  ++totals.relearning;  break;
+            case 3:  ++totals.filtered;    break;
+            default: ++totals.rescheduled; return;
+            }
+
+            if (ease >= 1 && ease <= 4) {
+                ++totals.buttons[ease - 1];
+            }
+
+            if (type == 1) {
+
+                const auto mature = (last_interval >= review_totals::mature_interval);
+                const auto passed = (ease > 1);
+
+                auto& counter = mature
+                    ? (passed ? totals.mature_passed : totals.mature_failed)
+                    : (passed ? totals.young_passed : totals.young_failed);
+
+                ++counter;
+            }
+
+            totals.time += time;
+        }
+
+        auto ratio(const std::uint32_t passed, const std::uint32_t failed)
+            -> std::optional<double> {
+
+            const auto total = std::uint64_t{passed} + failed;
+            if (total == 0) {
+                return std::nullopt;
+            }
+
+            return static_cast<double>(passed) / static_cast<double>(total);
+        }
+
+        // Rows `[begin, end)` of the revlog, totalled by one thread into `days`, the first of which
+        // is `first_day`.
+
+        struct run {
+            std::size_t                begin     = 0;
+            std::size_t                end       = 0;
+            std::int32_t               first_day = 0;
+            std::vector<review_totals> days;
+        };
+    }
+
+    auto review_totals::young_retention() const -> std::optional<double> {
+        return ratio(young_passed, young_failed);
+    }
+
+    auto review_totals::mature_retention() const -> std::optional<double> {
+        return ratio(mature_passed, mature_failed);
+    }
+
+    auto review_totals::operator+=(const review_totals& rhs) -> review_totals& {
+
+        learning      += rhs.learning;
+        review        += rhs.review;
+        relearning    += rhs.relearning;
+        filtered      += rhs.filtered;
+        rescheduled   += rhs.rescheduled;
+        young_passed  += rhs.young_passed;
+        young_failed  += rhs.young_failed;
+        mature_passed += rhs.mature_passed;
+        mature_failed += rhs.mature_failed;
+        time          += rhs.time;
+
+        for (auto i = std::size_t{0}; i < buttons.size(); ++i) {
+            buttons[i] += rhs.buttons[i];
+        }
+
+        return *this;
+    }
+
+    revlog_stats::revlog_stats(const collection& collection, const revlog_stats_options& options)
+      : revlog_stats{collection.revlog_columns(), collection.created(), options} {
+    }
+
+    revlog_stats::revlog_stats(
+        const collection_snapshot& snapshot, const revlog_stats_options& options)
+
+      : revlog_stats{snapshot.revlog_columns(), snapshot.created(), options} {
+    }
+
+    revlog_stats::revlog_stats(
+        const review_columns& reviews, const std::int64_t day_origin,
+        const revlog_stats_options& options)
+
+      : _day_origin{day_origin} {
+
+        const auto count = reviews.size();
+        if (count == 0) {
+            return;
+        }
+
+        assert(std::is_sorted(reviews.id.begin(), reviews.id.end()));
+
+        // The dense span is placed around the median entry, as far back as it reaches; entries
+        // outside it lie at either end of the revlog, which is ordered by time, and are totalled
+        // by day afterwards.
+
+        const auto median_day   = std::int64_t{day_of(reviews.id[count / 2])};
+        const auto window_first = std::max<std::int64_t>(
+            day_of(reviews.id.front()), median_day - max_dense_days / 2);
+        const auto window_last  = std::min<std::int64_t>(
+            day_of(reviews.id.back()), window_first + max_dense_days - 1);
+
+        const auto in_window_begin = static_cast<std::size_t>(std::partition_point(
+            reviews.id.begin(), reviews.id.end(), [this, window_first] (const std::int64_t id) {
+                return day_of(id) < window_first;
+            }) - reviews.id.begin());
+
+        const auto in_window_end = static_cast<std::size_t>(std::partition_point(
+            reviews.id.begin(), reviews.id.end(), [this, window_last] (const std::int64_t id) {
+                return day_of(id) <= window_last;
+            }) - reviews.id.begin());
+
+        const auto in_window_count = in_window_end - in_window_begin;
+
+        const auto run_count = impl::parallel_thread_count(
+            options.thread_count, in_window_count / min_rows_per_thread);
+
+        // Every run's days are allocated up front, so that the threads themselves cannot fail.
+
+        auto runs = std::vector<run>(run_count);
+        for (auto i = std::size_t{0}; i < run_count; ++i) {
+
+            auto& current = runs[i];
+            current.begin     = in_window_begin + in_window_count * i / run_count;
+            current.end       = in_window_begin + in_window_count * (i + 1) / run_count;
+            current.first_day = day_of(reviews.id[current.begin]);
+
+            const auto last_day = std::int64_t{day_of(reviews.id[current.end - 1])};
+            current.days.resize(static_cast<std::size_t>(last_day - current.first_day + 1));
+        }
+
+        const auto total_run = [this, &reviews] (run& current) {
+            for (auto row = current.begin; row < current.end; ++row) {
+
+                const auto index = std::int64_t{day_of(reviews.id[row])} - current.first_day;
+                add_entry(current.days[static_cast<std::size_t>(index)], reviews.type[row],
+                    reviews.ease[row], reviews.last_interval[row], reviews.time[row]);
+            }
+        };
+
+        impl::run_parallel(run_count, [&total_run, &runs] (const std::size_t i) {
+            total_run(runs[i]);
+        });
+
+        _first_day = runs.front().first_day;
+
+        const auto last_day = std::int64_t{day_of(reviews.id[in_window_end - 1])};
+        _days.resize(static_cast<std::size_t>(last_day - _first_day + 1));
+
+        for (const auto& current : runs) {
+
+            const auto offset = static_cast<std::size_t>(
+                std::int64_t{current.first_day} - _first_day);
+
+            for (auto i = std::size_t{0}; i < current.days.size(); ++i) {
+                _days[offset + i] += current.days[i];
+            }
+        }
+
+        const auto add_outlying = [this, &reviews] (const std::size_t row) {
+            add_entry(_outlying_days[day_of(reviews.id[row])], reviews.type[row],
+                reviews.ease[row], reviews.last_interval[row], reviews.time[row]);
+        };
+
+        for (auto row = std::size_t{0}; row < in_window_begin; ++row) {
+            add_outlying(row);
+        }
+
+        for (auto row = in_window_end; row < count; ++row) {
+            add_outlying(row);
+        }
+    }
+
+    void revlog_stats::add(const review& entry) {
+
+        // Values are clamped to their columns' types, as when loaded.
+
+        add_entry(bucket(day_of(entry.id)), clamp_to<std::uint8_t>(entry.type),
+            clamp_to<std::uint8_t>(entry.ease), clamp_to<std::int32_t>(entry.last_interval),
+            clamp_to<std::uint32_t>(entry.time));
+    }
+
+    auto revlog_stats::day_of(const std::int64_t id) const -> std::int32_t {
+
+        const auto days = floor_div(floor_div(id, 1000) - _day_origin, seconds_per_day);
+        return clamp_to<std::int32_t>(days);
+    }
+
+    auto revlog_stats::first_day() const noexcept -> std::int32_t {
+
+        if (_outlying_days.empty()) {
+            return _first_day;
+        }
+
+        return std::min(_first_day, _outlying_days.begin()->first);
+    }
+
+    auto revlog_stats::last_day() const noexcept -> std::int32_t {
+
+        const auto dense_last = static_cast<std::int32_t>(dense_last_day());
+        if (_outlying_days.empty()) {
+            return dense_last;
+        }
+
+        return std::max(dense_last, _outlying_days.rbegin()->first);
+    }
+
+    auto revlog_stats::day(const std::int32_t day) const -> review_totals {
+
+        if (day >= _first_day && day <= dense_last_day()) {
+            return _days[static_cast<std::size_t>(std::int64_t{day} - _first_day)];
+        }
+
+        const auto outlying = _outlying_days.find(day);
+        return (outlying != _outlying_days.end()) ? outlying->second : review_totals{};
+    }
+
+    auto revlog_stats::totals(const std::int32_t first, const std::int32_t last) const
+        -> review_totals {
+
+        auto result = review_totals{};
+        if (first > last) {
+            return result;
+        }
+
+        const auto from = std::max<std::int64_t>(first, _first_day);
+        const auto to   = std::min<std::int64_t>(last, dense_last_day());
+
+        for (auto day = from; day <= to; ++day) {
+            result += _days[static_cast<std::size_t>(day - _first_day)];
+        }
+
+        const auto begin = _outlying_days.lower_bound(first);
+        const auto end   = _outlying_days.upper_bound(last);
+
+        for (auto it = begin; it != end; ++it) {
+            result += it->second;
+        }
+
+        return result;
+    }
+
+    auto revlog_stats::totals() const -> review_totals {
+        return totals(first_day(), last_day());
+    }
+
+    // Returns the totals for `day`, extending the dense span to include it if that keeps it
+    // within `max_dense_days`, or holding it apart otherwise. Days held apart that an extended
+    // span now covers are moved into it.
+
+    auto revlog_stats::bucket(const std::int32_t day) -> review_totals& {
+
+        if (_days.empty()) {
+            _first_day = day;
+            _days.resize(1);
+            return _days.front();
+        }
+
+        const auto first = std::min<std::int64_t>(day, _first_day);
+        const auto last  = std::max<std::int64_t>(day, dense_last_day());
+
+        if (last - first >= max_dense_days) {
+            return _outlying_days[day];
+        }
+
+        if (day < _first_day) {
+            const auto added = static_cast<std::size_t>(std::int64_t{_first_day} - day);
+            _days.insert(_days.begin(), added, review_totals{});
+            _first_day = day;
+        }
+        else if (day > dense_last_day()) {
+            _days.resize(static_cast<std::size_t>(std::int64_t{day} - _first_day + 1));
+        }
+
+        const auto begin = _outlying_days.lower_bound(_first_day);
+        const auto end   = _outlying_days.upper_bound(static_cast<std::int32_t>(dense_last_day()));
+
+        for (auto it = begin; it != end; ++it) {
+            _days[static_cast<std::size_t>(std::int64_t{it->first} - _first_day)] += it->second;
+        }
+
+        _outlying_days.erase(begin, end);
+
+        return _days[static_cast<std::size_t>(std::int64_t{day} - _first_day)];
+    }
+
+    auto revlog_stats::dense_last_day() const noexcept -> std::int64_t {
+        return std::int64_t{_first_day} + static_cast<std::int64_t>(_days.size()) - 1;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef LIBANKI_REVLOG_STATS_HPP
+#define LIBANKI_REVLOG_STATS_HPP
+
+#include "collection_columns.hpp"
+#include "collection_records.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+    class collection_snapshot;
+
+    // Totals over a set of revlog entries, from which Anki's statistics are drawn.
+    //
+    // * `learning`, `review`, `relearning` and `filtered` count answers by the type of review
+    //   (revlog types 0 to 3), and `rescheduled` counts entries recording manual changes to a
+    //   card's schedule (types 4 and above), which are not answers.
+    // * `buttons` counts answers by the button pressed, from again to easy.
+    // * `young_*` and `mature_*` count review answers (type 1) that passed (hard or better) or
+    //   failed, by whether the card's previous interval was under or at least
+    //   `mature_interval` days.
+    // * `time` is the total time taken to answer, in milliseconds.
+
+    struct review_totals {
+
+        static constexpr auto mature_interval = std::int32_t{21};
+
+        std::uint32_t                learning      = 0;
+        std::uint32_t                review        = 0;
+        std::uint32_t                relearning    = 0;
+        std::uint32_t                filtered      = 0;
+        std::uint32_t                rescheduled   = 0;
+        std::array<std::uint32_t, 4> buttons       = {};
+        std::uint32_t                young_passed  = 0;
+        std::uint32_t                young_failed  = 0;
+        std::uint32_t                mature_passed = 0;
+        std::uint32_t                mature_failed = 0;
+        std::uint64_t                time          = 0;
+
+        auto answers() const noexcept -> std::uint32_t {
+            return learning + review + relearning + filtered;
+        }
+
+        // Proportions of young and mature review answers that passed, or `std::nullopt` if there
+        // were none.
+
+        auto young_retention()  const -> std::optional<double>;
+        auto mature_retention() const -> std::optional<double>;
+
+        auto operator+=(const review_totals& rhs) -> review_totals&;
+    };
+
+    // Tuning parameters for `revlog_stats`: `thread_count` is the number of threads to aggregate
+    // with, including the calling thread, or 0 to use one per hardware thread.
+
+    struct revlog_stats_options {
+        unsigned thread_count = 0;
+    };
+
+    // Totals of a collection's revlog for each day on which it has entries, with days numbered
+    // from `collection::created()` as the scheduler numbers them. Each statistic (heatmap, time
+    // spent, answer buttons, retention over a period) is a sum over these per-day totals, so is
+    // cheap to recompute for any period, and entries added as cards are answered update only the
+    // total for their day.
+    //
+    // The initial totals are computed in parallel: the revlog, being ordered by time, is divided
+    // into contiguous runs of rows, each thread totals its run into days of its own, and the
+    // days of each run are then added into place (only those straddling two runs receiving more
+    // than one addition).
+    //
+    // Days are held densely over a span of at most `max_dense_days`, chosen around the median
+    // entry; entries on days outside it, as only a corrupt ID should give, are held sparsely by
+    // day instead, so that one bogus ID cannot force an allocation spanning millennia.
+
+    class revlog_stats {
+    public:
+
+        static constexpr auto max_dense_days = std::int64_t{1} << 16;
+
+        // Totals the revlog of `collection`, throwing `anki::error` if it cannot be read.
+
+        explicit revlog_stats(
+            const collection& collection, const revlog_stats_options& options = {});
+
+        // Totals the revlog of `snapshot`, throwing `anki::error` if the snapshot is corrupt.
+
+        explicit revlog_stats(
+            const collection_snapshot& snapshot, const revlog_stats_options& options = {});
+
+        // Totals `reviews`, with day 0 starting at `day_origin`, in seconds since the epoch.
+
+        revlog_stats(
+            const review_columns& reviews, std::int64_t day_origin,
+            const revlog_stats_options& options = {});
+
+        // Adds the revlog entry `entry`, which may fall on any day.
+
+        void add(const review& entry);
+
+        // Day number of the entry with ID (timestamp in milliseconds) `id`.
+
+        auto day_of(std::int64_t id) const -> std::int32_t;
+
+        // Range of days with entries, which is empty (with `first_day() > last_day()`) if there
+        // are none.
+
+        auto first_day() const noexcept -> std::int32_t;
+        auto last_day()  const noexcept -> std::int32_t;
+
+        // Returns the totals for `day`, or for all days from `first` to `last` inclusive.
+
+        auto day(std::int32_t day) const -> review_totals;
+        auto totals(std::int32_t first, std::int32_t last) const -> review_totals;
+        auto totals() const -> review_totals;
+
+    private:
+
+        auto bucket(std::int32_t day) -> review_totals&;
+        auto dense_last_day() const noexcept -> std::int64_t;
+
+        // Totals for the days from `_first_day` densely, and for days outside that span by day.
+        // No day is held in both.
+
+        std::int64_t                          _day_origin;
+        std::int32_t                          _first_day = 0;
+        std::vector<review_totals>            _days;
+        std::map<std::int32_t, review_totals> _outlying_days;
+    };
+}
+
+#endif
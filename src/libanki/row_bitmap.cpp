@@ -0,0 +1,370 @@
+#include "row_bitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace anki {
+
+    namespace {
+
+        auto low_bits(const std::uint32_t row) -> std::uint16_t {
+            return static_cast<std::uint16_t>(row & 0xffff);
+        }
+
+        auto has_bit(const std::vector<std::uint64_t>& words, const std::uint16_t value) -> bool {
+            return (words[value / 64] >> (value % 64)) & 1;
+        }
+
+        void set_bit(std::vector<std::uint64_t>& words, const std::uint16_t value) {
+            words[value / 64] |= std::uint64_t{1} << (value % 64);
+        }
+
+        auto count_bits(const std::vector<std::uint64_t>& words) -> std::uint32_t {
+
+            auto result = std::uint32_t{0};
+            for (const auto word : words) {
+                result += static_cast<std::uint32_t>(__builtin_popcountll(word));
+            }
+
+            return result;
+        }
+    }
+
+    void row_bitmap::insert(const std::uint32_t row) {
+
+        const auto key   = static_cast<std::uint16_t>(row >> 16);
+        const auto value = low_bits(row);
+
+        // Rows added in order always belong to the last group, and usually at its end.
+
+        auto it = _groups.end();
+        if (_groups.empty() || _groups.back().key < key) {
+            it = _groups.insert(_groups.end(), group{});
+            it->key = key;
+        }
+        else if (_groups.back().key != key) {
+
+            it = std::lower_bound(_groups.begin(), _groups.end(), key,
+                [] (const group& group, const std::uint16_t key) { return group.key < key; });
+
+            if (it->key != key) {
+                it = _groups.insert(it, group{});
+                it->key = key;
+            }
+        }
+        else {
+            it = std::prev(_groups.end());
+        }
+
+        auto& group = *it;
+
+        if (group.is_bitmap()) {
+
+            if (!has_bit(group.words, value)) {
+                set_bit(group.words, value);
+                ++group.size;
+            }
+
+            return;
+        }
+
+        if (group.values.empty() || group.values.back() < value) {
+            group.values.push_back(value);
+        }
+        else {
+
+            const auto pos = std::lower_bound(group.values.begin(), group.values.end(), value);
+            if (*pos == value) {
+                return;
+            }
+
+            group.values.insert(pos, value);
+        }
+
+        ++group.size;
+        if (group.size > max_array_size) {
+            to_bitmap(group);
+        }
+    }
+
+    auto row_bitmap::contains(const std::uint32_t row) const -> bool {
+
+        const auto key = static_cast<std::uint16_t>(row >> 16);
+        const auto it  = std::lower_bound(_groups.begin(), _groups.end(), key,
+            [] (const group& group, const std::uint16_t key) { return group.key < key; });
+
+        if (it == _groups.end() || it->key != key) {
+            return false;
+        }
+
+        return it->is_bitmap()
+            ? has_bit(it->words, low_bits(row))
+            : std::binary_search(it->values.begin(), it->values.end(), low_bits(row));
+    }
+
+    auto row_bitmap::size() const noexcept -> std::size_t {
+
+        auto result = std::size_t{0};
+        for (const auto& group : _groups) {
+            result += group.size;
+        }
+
+        return result;
+    }
+
+    auto row_bitmap::rows() const -> std::vector<std::uint32_t> {
+
+        auto result = std::vector<std::uint32_t>{};
+        result.reserve(size());
+
+        for_each([&result] (std::uint32_t row) { result.push_back(row); });
+        return result;
+    }
+
+    // The binary operations walk the groups of both sides in order of key, combining those with
+    // matching keys (and, for union and difference, keeping those only on the left or either side
+    // as they are).
+
+    auto operator&(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap {
+
+        auto result = row_bitmap{};
+
+        auto left  = lhs._groups.begin();
+        auto right = rhs._groups.begin();
+
+        while (left != lhs._groups.end() && right != rhs._groups.end()) {
+
+            if (left->key < right->key) {
+                ++left;
+            }
+            else if (right->key < left->key) {
+                ++right;
+            }
+            else {
+
+                auto group = row_bitmap::intersect(*left++, *right++);
+                if (group.size > 0) {
+                    result._groups.push_back(std::move(group));
+                }
+            }
+        }
+
+        return result;
+    }
+
+    auto operator|(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap {
+
+        auto result = row_bitmap{};
+
+        auto left  = lhs._groups.begin();
+        auto right = rhs._groups.begin();
+
+        while (left != lhs._groups.end() || right != rhs._groups.end()) {
+
+            const auto left_done  = (left == lhs._groups.end());
+            const auto right_done = (right == rhs._groups.end());
+
+            if (right_done || (!left_done && left->key < right->key)) {
+                result._groups.push_back(*left++);
+            }
+            else if (left_done || right->key < left->key) {
+                result._groups.push_back(*right++);
+            }
+            else {
+                result._groups.push_back(row_bitmap::unite(*left++, *right++));
+            }
+        }
+
+        return result;
+    }
+
+    auto operator-(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap {
+
+        auto result = row_bitmap{};
+        auto right  = rhs._groups.begin();
+
+        for (const auto& group : lhs._groups) {
+
+            while (right != rhs._groups.end() && right->key < group.key) {
+                ++right;
+            }
+
+            if (right == rhs._groups.end() || right->key != group.key) {
+                result._groups.push_back(group);
+                continue;
+            }
+
+            auto difference = row_bitmap::subtract(group, *right);
+            if (difference.size > 0) {
+                result._groups.push_back(std::move(difference));
+            }
+        }
+
+        return result;
+    }
+
+    auto operator==(const row_bitmap& lhs, const row_bitmap& rhs) -> bool {
+
+        // Groups are kept compact, so equal sets have identical representations.
+
+        return std::equal(lhs._groups.begin(), lhs._groups.end(),
+            rhs._groups.begin(), rhs._groups.end(),
+            [] (const row_bitmap::group& lhs, const row_bitmap::group& rhs) {
+                return lhs.key == rhs.key && lhs.size == rhs.size && lhs.values == rhs.values
+                    && lhs.words == rhs.words;
+            });
+    }
+
+    auto row_bitmap::intersect(const group& lhs, const group& rhs) -> group {
+
+        auto result = group{};
+        result.key = lhs.key;
+
+        if (lhs.is_bitmap() && rhs.is_bitmap()) {
+
+            result.words.resize(group_words);
+            for (auto i = std::size_t{0}; i < group_words; ++i) {
+                result.words[i] = lhs.words[i] & rhs.words[i];
+            }
+
+            result.size = count_bits(result.words);
+        }
+        else if (lhs.is_bitmap() || rhs.is_bitmap()) {
+
+            const auto& array  = lhs.is_bitmap() ? rhs : lhs;
+            const auto& bitmap = lhs.is_bitmap() ? lhs : rhs;
+
+            for (const auto value : array.values) {
+                if (has_bit(bitmap.words, value)) {
+                    result.values.push_back(value);
+                }
+            }
+
+            result.size = static_cast<std::uint32_t>(result.values.size());
+        }
+        else {
+
+            std::set_intersection(lhs.values.begin(), lhs.values.end(),
+                rhs.values.begin(), rhs.values.end(), std::back_inserter(result.values));
+
+            result.size = static_cast<std::uint32_t>(result.values.size());
+        }
+
+        compact(result);
+        return result;
+    }
+
+    auto row_bitmap::unite(const group& lhs, const group& rhs) -> group {
+
+        auto result = group{};
+        result.key = lhs.key;
+
+        if (!lhs.is_bitmap() && !rhs.is_bitmap() && lhs.size + rhs.size <= max_array_size) {
+
+            std::set_union(lhs.values.begin(), lhs.values.end(),
+                rhs.values.begin(), rhs.values.end(), std::back_inserter(result.values));
+
+            result.size = static_cast<std::uint32_t>(result.values.size());
+            return result;
+        }
+
+        result.words.resize(group_words);
+        for (const auto* side : {&lhs, &rhs}) {
+
+            if (side->is_bitmap()) {
+                for (auto i = std::size_t{0}; i < group_words; ++i) {
+                    result.words[i] |= side->words[i];
+                }
+            }
+            else {
+                for (const auto value : side->values) {
+                    set_bit(result.words, value);
+                }
+            }
+        }
+
+        result.size = count_bits(result.words);
+
+        compact(result);
+        return result;
+    }
+
+    auto row_bitmap::subtract(const group& lhs, const group& rhs) -> group {
+
+        auto result = group{};
+        result.key = lhs.key;
+
+        if (!lhs.is_bitmap()) {
+
+            for (const auto value : lhs.values) {
+
+                const auto removed = rhs.is_bitmap()
+                    ? has_bit(rhs.words, value)
+                    : std::binary_search(rhs.values.begin(), rhs.values.end(), value);
+
+                if (!removed) {
+                    result.values.push_back(value);
+                }
+            }
+
+            result.size = static_cast<std::uint32_t>(result.values.size());
+            return result;
+        }
+
+        result.words = lhs.words;
+        if (rhs.is_bitmap()) {
+            for (auto i = std::size_t{0}; i < group_words; ++i) {
+                result.words[i] &= ~rhs.words[i];
+            }
+        }
+        else {
+            for (const auto value : rhs.values) {
+                result.words[value / 64] &= ~(std::uint64_t{1} << (value % 64));
+            }
+        }
+
+        result.size = count_bits(result.words);
+
+        compact(result);
+        return result;
+    }
+
+    void row_bitmap::to_bitmap(group& group) {
+
+        group.words.assign(group_words, 0);
+        for (const auto value : group.values) {
+            set_bit(group.words, value);
+        }
+
+        group.values.clear();
+        group.values.shrink_to_fit();
+    }
+
+    // Converts a bitmap group small enough to be an array into one, so that a set has only one
+    // representation. An emptied group is left empty, for the caller to drop.
+
+    void row_bitmap::compact(group& group) {
+
+        if (!group.is_bitmap() || group.size > max_array_size) {
+            return;
+        }
+
+        group.values.clear();
+        group.values.reserve(group.size);
+
+        for (auto i = std::size_t{0}; i < group_words; ++i) {
+
+            auto word = group.words[i];
+            while (word != 0) {
+
+                const auto bit = static_cast<std::uint32_t>(__builtin_ctzll(word));
+                group.values.push_back(static_cast<std::uint16_t>(i * 64 + bit));
+
+                word &= word - 1;
+            }
+        }
+
+        group.words.clear();
+        group.words.shrink_to_fit();
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef LIBANKI_ROW_BITMAP_HPP
+#define LIBANKI_ROW_BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace anki {
+
+    // Compressed set of row numbers (such as rows of `note_columns`), in the manner of a roaring
+    // bitmap: rows are grouped by their upper 16 bits, and each group is held either as a sorted
+    // array of its lower 16 bits or, once it has more than 4096 members, as a bitmap of all 65536.
+    // Sparse sets thus take two bytes per row and dense sets one bit, and set operations work a
+    // group at a time, skipping groups absent from either side.
+
+    class row_bitmap {
+    public:
+
+        // Adds `row` to the set. Adding rows in increasing order is cheapest.
+
+        void insert(std::uint32_t row);
+
+        auto contains(std::uint32_t row) const -> bool;
+
+        auto empty() const noexcept -> bool { return _groups.empty(); }
+        auto size()  const noexcept -> std::size_t;
+
+        // Calls `visit` with each row of the set, in increasing order.
+
+        template<typename fn>
+        void for_each(fn visit) const;
+
+        // Returns the rows of the set, in increasing order.
+
+        auto rows() const -> std::vector<std::uint32_t>;
+
+        friend auto operator&(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap;
+        friend auto operator|(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap;
+        friend auto operator-(const row_bitmap& lhs, const row_bitmap& rhs) -> row_bitmap;
+
+        friend auto operator==(const row_bitmap& lhs, const row_bitmap& rhs) -> bool;
+        friend auto operator!=(const row_bitmap& lhs, const row_bitmap& rhs) -> bool {
+            return !(lhs == rhs);
+        }
+
+    private:
+
+        // Rows whose upper 16 bits are `key`. Exactly one of `values` (sorted lower bits) and
+        // `words` (a bitmap of `group_words` words) is in use, and neither is ever empty.
+
+        struct group {
+            std::uint16_t              key  = 0;
+            std::uint32_t              size = 0;
+            std::vector<std::uint16_t> values;
+            std::vector<std::uint64_t> words;
+
+            auto is_bitmap() const noexcept -> bool { return !words.empty(); }
+        };
+
+        static constexpr auto max_array_size = std::size_t{4096};
+        static constexpr auto group_words    = std::size_t{65536 / 64};
+
+        static auto intersect(const group& lhs, const group& rhs) -> group;
+        static auto unite(const group& lhs, const group& rhs) -> group;
+        static auto subtract(const group& lhs, const group& rhs) -> group;
+
+        static void to_bitmap(group& group);
+        static void compact(group& group);
+
+        std::vector<group> _groups;
+    };
+
+    template<typename fn>
+    void row_bitmap::for_each(fn visit) const {
+
+        for (const auto& group : _groups) {
+
+            const auto base = std::uint32_t{group.key} << 16;
+
+            if (!group.is_bitmap()) {
+                for (const auto value : group.values) {
+                    visit(base | value);
+                }
+
+                continue;
+            }
+
+            for (auto i = std::size_t{0}; i < group_words; ++i) {
+
+                auto word = group.words[i];
+                while (word != 0) {
+
+                    const auto bit = static_cast<std::uint32_t>(__builtin_ctzll(word));
+                    visit(base | static_cast<std::uint32_t>(i * 64) | bit);
+
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,570 @@
+#include "scheduler.hpp"
+
+#include "collection.hpp"
+#include "collection_snapshot.hpp"
+#include "error.hpp"
+#include "impl/scheduling_models.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto seconds_per_day = std::int64_t{86400};
+        constexpr auto minutes_per_day = 1440.0;
+
+        // As in the models, intervals and lateness are capped at 2^24 days.
+
+        constexpr auto interval_limit_days = std::int64_t{1} << 24;
+
+        // Anki stores the steps remaining in the lowest three decimal digits of `left`.
+
+        constexpr auto left_steps_modulus = std::int32_t{1000};
+
+        template<typename t>
+        auto find_by_id(const std::vector<t>& entries, const std::int64_t id) -> const t* {
+
+            const auto it = std::lower_bound(entries.begin(), entries.end(), id,
+                [] (const t& entry, const std::int64_t id) { return entry.id < id; });
+
+            return (it != entries.end() && it->id == id) ? &*it : nullptr;
+        }
+
+        auto is_set_aside(const card_queue queue) -> bool {
+            return queue == card_queue::suspended || queue == card_queue::sched_buried
+                || queue == card_queue::user_buried;
+        }
+    }
+
+    scheduler::scheduler(
+        const collection& collection, const std::int64_t now, const scheduler_options& options)
+
+      : scheduler{collection.created(), collection.columns(), collection.decks(),
+                  collection.deck_configs(), now, options} {
+    }
+
+    scheduler::scheduler(
+        const collection_snapshot& snapshot, const std::int64_t now,
+        const scheduler_options& options)
+
+      : scheduler{snapshot.created(), snapshot.columns(), snapshot.decks(),
+                  snapshot.deck_configs(), now, options} {
+    }
+
+    scheduler::scheduler(
+        const std::int64_t created, const collection_columns& columns,
+        const std::vector<deck>& decks, const std::vector<deck_config>& deck_configs,
+        const std::int64_t now, const scheduler_options& options)
+
+      : _created{created},
+        _today{day_of(now)},
+        _options{options},
+        _configs{deck_configs} {
+
+        std::transform(options.fsrs.weights.begin(), options.fsrs.weights.end(), _weights.begin(),
+            [] (double weight) { return static_cast<float>(weight); });
+
+        // The options group of each deck (by dictionary code), as an index into `_configs`, with
+        // the defaults appended for decks without one.
+
+        if (deck_configs.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw error{error_code::invalid_collection};
+        }
+
+        const auto& cards = columns.cards;
+
+        _configs.emplace_back();
+        const auto defaults = ksr::narrow_cast<std::uint16_t>(_configs.size() - 1);
+
+        auto config_of_deck = std::vector<std::uint16_t>{};
+        config_of_deck.reserve(columns.deck_ids.size());
+
+        for (const auto deck_id : columns.deck_ids) {
+
+            const auto deck   = find_by_id(decks, deck_id);
+            const auto config = (deck && !deck->filtered)
+                ? find_by_id(deck_configs, deck->config_id)
+                : nullptr;
+
+            config_of_deck.push_back(config
+                ? ksr::narrow_cast<std::uint16_t>(config - deck_configs.data())
+                : defaults);
+        }
+
+        const auto count = cards.size();
+
+        _config.resize(count);
+        _type.resize(count);
+        _queue.resize(count);
+        _due.resize(count);
+        _interval.resize(count);
+        _ease_factor.resize(count);
+        _reps.resize(count);
+        _lapses.resize(count);
+        _left.resize(count);
+        _last_review.resize(count);
+        _stability.resize(count);
+        _difficulty.resize(count);
+
+        const auto fsrs = (_options.model == scheduling_model::fsrs);
+
+        for (auto row = std::size_t{0}; row < count; ++row) {
+
+            _config[row]      = config_of_deck[cards.deck[row]];
+            _type[row]        = static_cast<card_type>(cards.type[row]);
+            _queue[row]       = static_cast<card_queue>(cards.queue[row]);
+            _due[row]         = cards.due[row];
+            _interval[row]    = cards.interval[row];
+            _ease_factor[row] = cards.ease_factor[row];
+            _reps[row]        = cards.reps[row];
+            _lapses[row]      = cards.lapses[row];
+            _left[row]        = cards.left[row] % left_steps_modulus;
+
+            const auto review = (_type[row] == card_type::review);
+            _last_review[row] = review
+                ? ksr::narrow_cast<std::int32_t>(std::clamp<std::int64_t>(
+                    _due[row] - _interval[row], std::numeric_limits<std::int32_t>::min(), _today))
+                : _today;
+
+            if (fsrs && (review || _type[row] == card_type::relearning)) {
+
+                const auto state = impl::fsrs::state_from_sm2(_weights,
+                    static_cast<float>(_ease_factor[row]) * 0.001f,
+                    static_cast<float>(_interval[row]));
+
+                _stability[row]  = state.stability;
+                _difficulty[row] = state.difficulty;
+            }
+        }
+
+        auto queued = std::vector<std::pair<std::uint32_t, std::int64_t>>{};
+        for (auto row = std::uint32_t{0}; row < count; ++row) {
+
+            if (const auto time = due_time(row)) {
+                queued.emplace_back(row, *time);
+            }
+            else if (_queue[row] == card_queue::new_card) {
+                _new_cards.push_back(row);
+            }
+        }
+
+        _due_queue = ksr::indexed_heap<std::int64_t>{count};
+        _due_queue.assign(std::move(queued));
+
+        std::stable_sort(_new_cards.begin(), _new_cards.end(),
+            [this] (std::uint32_t lhs, std::uint32_t rhs) { return _due[lhs] < _due[rhs]; });
+    }
+
+    auto scheduler::next_due(const std::int64_t now) const -> std::optional<std::uint32_t> {
+
+        if (_due_queue.empty() || _due_queue.top_key() > now) {
+            return std::nullopt;
+        }
+
+        return _due_queue.top();
+    }
+
+    auto scheduler::next_new() -> std::optional<std::uint32_t> {
+
+        // Cards leave the new queue only when answered, so those passed over are skipped here.
+
+        while (_next_new < _new_cards.size()) {
+
+            const auto row = _new_cards[_next_new];
+            if (_queue[row] == card_queue::new_card) {
+                return row;
+            }
+
+            ++_next_new;
+        }
+
+        return std::nullopt;
+    }
+
+    auto scheduler::schedule(const std::uint32_t row) const -> card_schedule {
+
+        assert(row < card_count());
+
+        auto result = card_schedule{};
+        result.type        = _type[row];
+        result.queue       = _queue[row];
+        result.due         = _due[row];
+        result.interval    = _interval[row];
+        result.ease_factor = _ease_factor[row];
+        result.reps        = _reps[row];
+        result.lapses      = _lapses[row];
+        result.left        = _left[row];
+        result.stability   = _stability[row];
+        result.difficulty  = _difficulty[row];
+
+        return result;
+    }
+
+    void scheduler::answer(const std::uint32_t row, const rating answer, const std::int64_t now) {
+
+        assert(row < card_count());
+
+        if (is_set_aside(_queue[row])) {
+            return;
+        }
+
+        _today = day_of(now);
+        ++_reps[row];
+
+        if (_type[row] == card_type::review) {
+            answer_review(row, answer, now);
+        }
+        else {
+            answer_learning(row, answer, now);
+        }
+
+        _last_review[row] = _today;
+        requeue(row);
+    }
+
+    auto scheduler::review_intervals(const std::int64_t now) const -> answer_intervals {
+
+        const auto count = card_count();
+        const auto today = day_of(now);
+
+        auto result = answer_intervals{};
+        result.again.resize(count);
+        result.hard.resize(count);
+        result.good.resize(count);
+        result.easy.resize(count);
+
+        // Review cards are grouped by options group with a counting sort, so that each group's
+        // parameters are constant across one run of the model.
+
+        auto offsets = std::vector<std::size_t>(_configs.size() + 1);
+        for (auto row = std::size_t{0}; row < count; ++row) {
+            if (_type[row] == card_type::review) {
+                ++offsets[_config[row] + 1];
+            }
+        }
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        auto rows = std::vector<std::uint32_t>(offsets.back());
+        auto next = offsets;
+
+        for (auto row = std::uint32_t{0}; row < count; ++row) {
+            if (_type[row] == card_type::review) {
+                rows[next[_config[row]]++] = row;
+            }
+        }
+
+        auto intervals = std::vector<std::int32_t>(rows.size() * 4);
+        const auto dst = impl::answer_columns{
+            intervals.data(),
+            intervals.data() + rows.size(),
+            intervals.data() + rows.size() * 2,
+            intervals.data() + rows.size() * 3,
+        };
+
+        for (auto config = std::size_t{0}; config < _configs.size(); ++config) {
+
+            const auto begin = offsets[config];
+            const auto size  = offsets[config + 1] - begin;
+
+            const auto group = impl::answer_columns{
+                dst.again + begin, dst.hard + begin, dst.good + begin, dst.easy + begin};
+
+            review_intervals(rows.data() + begin, size, today, group);
+        }
+
+        for (auto i = std::size_t{0}; i < rows.size(); ++i) {
+
+            const auto row = rows[i];
+            result.again[row] = dst.again[i];
+            result.hard[row]  = dst.hard[i];
+            result.good[row]  = dst.good[i];
+            result.easy[row]  = dst.easy[i];
+        }
+
+        return result;
+    }
+
+    auto scheduler::day_of(const std::int64_t time) const -> std::int32_t {
+
+        const auto elapsed = time - _created;
+        const auto days    = (elapsed >= 0)
+            ? elapsed / seconds_per_day
+            : -((-elapsed + seconds_per_day - 1) / seconds_per_day);
+
+        return static_cast<std::int32_t>(std::clamp<std::int64_t>(days,
+            std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max()));
+    }
+
+    auto scheduler::config_of(const std::uint32_t row) const -> const deck_config& {
+        return _configs[_config[row]];
+    }
+
+    // Learning cards are due at a time in seconds, and review and day-learning cards at the start
+    // of a day; others are not in the due queue.
+
+    auto scheduler::due_time(const std::uint32_t row) const -> std::optional<std::int64_t> {
+
+        switch (_queue[row]) {
+        case card_queue::learning:
+        case card_queue::preview:
+            return _due[row];
+
+        case card_queue::review:
+        case card_queue::day_learning:
+            return _created + _due[row] * seconds_per_day;
+
+        default:
+            return std::nullopt;
+        }
+    }
+
+    void scheduler::review_intervals(
+        const std::uint32_t* const rows, const std::size_t count, const std::int32_t today,
+        const impl::answer_columns& dst) const {
+
+        if (count == 0) {
+            return;
+        }
+
+        // The inputs of the model are gathered into contiguous arrays first, so that its loop
+        // reads each sequentially.
+
+        const auto& config = config_of(rows[0]);
+
+        if (_options.model == scheduling_model::sm2) {
+
+            auto interval  = std::vector<std::int32_t>(count);
+            auto ease      = std::vector<std::int32_t>(count);
+            auto days_late = std::vector<std::int32_t>(count);
+
+            for (auto i = std::size_t{0}; i < count; ++i) {
+
+                const auto row = rows[i];
+                interval[i]  = _interval[row];
+                ease[i]      = _ease_factor[row];
+                days_late[i] = static_cast<std::int32_t>(
+                    std::clamp<std::int64_t>(today - _due[row], 0, interval_limit_days));
+            }
+
+            const auto src = impl::sm2::review_inputs{
+                interval.data(), ease.data(), days_late.data()};
+            impl::sm2::review_intervals(config, count, src, dst);
+        }
+        else {
+
+            auto stability  = std::vector<float>(count);
+            auto difficulty = std::vector<float>(count);
+            auto elapsed    = std::vector<float>(count);
+
+            for (auto i = std::size_t{0}; i < count; ++i) {
+
+                const auto row = rows[i];
+                stability[i]  = _stability[row];
+                difficulty[i] = _difficulty[row];
+                elapsed[i]    = static_cast<float>(std::max(today - _last_review[row], 0));
+            }
+
+            const auto src = impl::fsrs::review_inputs{
+                stability.data(), difficulty.data(), elapsed.data()};
+
+            impl::fsrs::review_intervals(_weights,
+                static_cast<float>(_options.fsrs.desired_retention),
+                static_cast<std::int32_t>(std::min<std::int64_t>(
+                    config.maximum_interval, std::numeric_limits<std::int32_t>::max())),
+                count, src, dst);
+        }
+    }
+
+    void scheduler::answer_learning(
+        const std::uint32_t row, const rating answer, const std::int64_t now) {
+
+        const auto& config = config_of(row);
+        const auto& steps  = (_type[row] == card_type::relearning)
+            ? config.relearning_steps
+            : config.learning_steps;
+
+        if (_type[row] == card_type::new_card) {
+            _type[row] = card_type::learning;
+            _left[row] = static_cast<std::int32_t>(steps.size());
+        }
+
+        update_memory(row, answer);
+
+        const auto step_count = static_cast<std::int32_t>(steps.size());
+        if (step_count == 0) {
+            graduate(row, answer);
+            return;
+        }
+
+        const auto remaining = std::clamp(_left[row], 1, step_count);
+        const auto index     = static_cast<std::size_t>(step_count - remaining);
+
+        switch (answer) {
+        case rating::again:
+
+            _left[row] = step_count;
+            schedule_step(row, steps[0], now);
+            break;
+
+        case rating::hard: {
+
+            // Hard repeats the current step, except that on the first it waits halfway to the
+            // second (or half as long again, but no more than a day longer, if there is none).
+
+            const auto delay = (index > 0) ? steps[index]
+                : (step_count > 1) ? (steps[0] + steps[1]) / 2
+                : std::min(steps[0] * 1.5, steps[0] + minutes_per_day);
+
+            _left[row] = remaining;
+            schedule_step(row, delay, now);
+            break;
+        }
+        case rating::good:
+
+            if (remaining <= 1) {
+                graduate(row, answer);
+            }
+            else {
+                _left[row] = remaining - 1;
+                schedule_step(row, steps[index + 1], now);
+            }
+
+            break;
+
+        case rating::easy:
+            graduate(row, answer);
+            break;
+        }
+    }
+
+    void scheduler::answer_review(
+        const std::uint32_t row, const rating answer, const std::int64_t now) {
+
+        // The intervals come from the same model run as `review_intervals()`, over the state
+        // before the answer.
+
+        std::int32_t intervals[4];
+        review_intervals(&row, 1, _today, impl::answer_columns{
+            &intervals[0], &intervals[1], &intervals[2], &intervals[3]});
+
+        update_memory(row, answer);
+
+        if (_options.model == scheduling_model::sm2) {
+
+            auto& ease = _ease_factor[row];
+            switch (answer) {
+            case rating::again: ease += impl::sm2::again_ease; break;
+            case rating::hard:  ease += impl::sm2::hard_ease;  break;
+            case rating::good:                                 break;
+            case rating::easy:  ease += impl::sm2::easy_ease;  break;
+            }
+
+            ease = std::max(ease, impl::sm2::minimum_ease);
+        }
+
+        _interval[row] = intervals[static_cast<std::size_t>(answer) - 1];
+
+        if (answer == rating::again) {
+
+            ++_lapses[row];
+
+            const auto& steps = config_of(row).relearning_steps;
+            if (!steps.empty()) {
+
+                _type[row] = card_type::relearning;
+                _left[row] = static_cast<std::int32_t>(steps.size());
+                schedule_step(row, steps[0], now);
+
+                return;
+            }
+        }
+
+        _queue[row] = card_queue::review;
+        _due[row]   = _today + _interval[row];
+    }
+
+    // Makes a learning or relearning card a review card. Relearning cards keep the interval they
+    // were given when they lapsed (one day longer, if answered easy); learning cards take the
+    // graduating or easy interval from their options, or with FSRS, that of their stability.
+
+    void scheduler::graduate(const std::uint32_t row, const rating answer) {
+
+        const auto& config = config_of(row);
+        const auto  easy   = (answer == rating::easy);
+
+        const auto maximum = static_cast<std::int32_t>(
+            std::clamp<std::int64_t>(config.maximum_interval, 1, interval_limit_days));
+
+        auto interval = std::int64_t{0};
+
+        if (_options.model == scheduling_model::fsrs) {
+            interval = impl::fsrs::interval_for(_stability[row],
+                static_cast<float>(_options.fsrs.desired_retention), maximum);
+        }
+        else if (_type[row] == card_type::relearning) {
+            interval = std::int64_t{_interval[row]} + (easy ? 1 : 0);
+        }
+        else {
+            interval = easy ? config.easy_interval : config.graduating_interval;
+            _ease_factor[row] = ksr::narrow_cast<std::int32_t>(config.initial_ease);
+        }
+
+        _type[row]     = card_type::review;
+        _queue[row]    = card_queue::review;
+        _left[row]     = 0;
+        _interval[row] = static_cast<std::int32_t>(std::clamp<std::int64_t>(interval, 1, maximum));
+        _due[row]      = _today + _interval[row];
+    }
+
+    void scheduler::update_memory(const std::uint32_t row, const rating answer) {
+
+        if (_options.model != scheduling_model::fsrs) {
+            return;
+        }
+
+        const auto grade = static_cast<int>(answer);
+        const auto state = (_stability[row] > 0.0f)
+            ? impl::fsrs::next_state(_weights, {_stability[row], _difficulty[row]},
+                static_cast<float>(std::max(_today - _last_review[row], 0)), grade)
+            : impl::fsrs::initial_state(_weights, grade);
+
+        _stability[row]  = state.stability;
+        _difficulty[row] = state.difficulty;
+    }
+
+    // Schedules the next learning step, `minutes` from `now`. Steps of a day or more are counted
+    // in days, as Anki's day-learning queue does.
+
+    void scheduler::schedule_step(
+        const std::uint32_t row, const double minutes, const std::int64_t now) {
+
+        const auto seconds = static_cast<std::int64_t>(std::llround(minutes * 60.0));
+
+        if (seconds >= seconds_per_day) {
+            _queue[row] = card_queue::day_learning;
+            _due[row]   = _today + (seconds + seconds_per_day / 2) / seconds_per_day;
+        }
+        else {
+            _queue[row] = card_queue::learning;
+            _due[row]   = now + std::max<std::int64_t>(seconds, 0);
+        }
+    }
+
+    void scheduler::requeue(const std::uint32_t row) {
+
+        if (const auto time = due_time(row)) {
+            _due_queue.update(row, *time);
+        }
+        else {
+            _due_queue.erase(row);
+        }
+    }
+}
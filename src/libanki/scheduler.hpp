@@ -0,0 +1,218 @@
+#ifndef LIBANKI_SCHEDULER_HPP
+#define LIBANKI_SCHEDULER_HPP
+
+#include "collection_metadata.hpp"
+
+#include "ksr/indexed_heap.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+    class collection_snapshot;
+    struct collection_columns;
+
+    namespace impl {
+        struct answer_columns;
+    }
+
+    // Card types and queues, with the values Anki stores in `card::type` and `card::queue`.
+
+    enum class card_type : std::int8_t {
+        new_card   = 0,
+        learning   = 1,
+        review     = 2,
+        relearning = 3,
+    };
+
+    enum class card_queue : std::int8_t {
+        user_buried  = -3,
+        sched_buried = -2,
+        suspended    = -1,
+        new_card     = 0,
+        learning     = 1,
+        review       = 2,
+        day_learning = 3,
+        preview      = 4,
+    };
+
+    // Answers to a card, with the values Anki records in `review::ease`.
+
+    enum class rating : std::uint8_t {
+        again = 1,
+        hard  = 2,
+        good  = 3,
+        easy  = 4,
+    };
+
+    enum class scheduling_model : std::uint8_t {
+        sm2,
+        fsrs,
+    };
+
+    // Parameters of the FSRS model, which default to those FSRS 5 was trained to before
+    // optimisation for any one user.
+
+    struct fsrs_parameters {
+
+        std::array<double, 19> weights = {
+            0.40255, 1.18385, 3.173, 15.69105, 7.1949, 0.5345, 1.4604, 0.0046, 1.54575, 0.1192,
+            1.01925, 1.9395, 0.11, 0.29605, 2.2698, 0.2315, 2.9898, 0.51655, 0.6621,
+        };
+
+        double desired_retention = 0.9;
+    };
+
+    struct scheduler_options {
+        scheduling_model model = scheduling_model::sm2;
+        fsrs_parameters  fsrs;
+    };
+
+    // Scheduling state of a card, with members as in `card`, except that `left` holds only the
+    // number of learning steps remaining. `stability` and `difficulty` are the card's FSRS memory
+    // state, or 0 if it has none (as for new cards, or when scheduling with SM-2).
+
+    struct card_schedule {
+        card_type    type        = card_type::new_card;
+        card_queue   queue       = card_queue::new_card;
+        std::int64_t due         = 0;
+        std::int32_t interval    = 0;
+        std::int32_t ease_factor = 0;
+        std::int32_t reps        = 0;
+        std::int32_t lapses      = 0;
+        std::int32_t left        = 0;
+        float        stability   = 0.0f;
+        float        difficulty  = 0.0f;
+    };
+
+    // Intervals, in days, that each answer would give each card, indexed by card row. Rows of
+    // cards that are not review cards hold 0.
+
+    struct answer_intervals {
+        std::vector<std::int32_t> again;
+        std::vector<std::int32_t> hard;
+        std::vector<std::int32_t> good;
+        std::vector<std::int32_t> easy;
+    };
+
+    // Scheduler for the cards of a collection, which keeps its own copy of their scheduling state
+    // in columnar form, indexed by the rows of `collection::columns().cards`, and updates it as
+    // cards are answered. Each card follows the options group of its deck (or the defaults, for
+    // filtered decks and missing groups), as Anki's v3 scheduler does, except that intervals are
+    // not fuzzed, leeches are not acted on, and daily limits are left to the caller.
+    //
+    // Learning and review cards wait in a due queue, a 4-ary heap ordered by due time (review
+    // cards being due at the start of their due day), which answering a card updates in place
+    // rather than rebuilding. New cards are introduced in order of position.
+    //
+    // With FSRS, review cards lacking a memory state are given one estimated from their SM-2
+    // interval and ease factor, and new cards are given one on their first answer.
+
+    class scheduler {
+    public:
+
+        // Loads the cards of `collection` as of `now`, in seconds since the epoch. Throws
+        // `anki::error` if the collection cannot be read, or with `error_code::invalid_collection`
+        // if it has more options groups than a card's index into them can hold (65535).
+
+        scheduler(
+            const collection& collection, std::int64_t now, const scheduler_options& options = {});
+
+        // As above, for the cards of `snapshot`. Throws `anki::error` if the snapshot is corrupt.
+
+        scheduler(
+            const collection_snapshot& snapshot, std::int64_t now,
+            const scheduler_options& options = {});
+
+        // As above, for cards given as `columns`, of a collection created at `created` whose
+        // decks and options groups are `decks` and `deck_configs`, each in order of ID.
+
+        scheduler(
+            std::int64_t created, const collection_columns& columns,
+            const std::vector<deck>& decks, const std::vector<deck_config>& deck_configs,
+            std::int64_t now, const scheduler_options& options = {});
+
+        auto card_count() const noexcept -> std::size_t { return _type.size(); }
+
+        // Day number (counted from `collection::created()`) as of the time given on construction
+        // or to the last call to `answer()`.
+
+        auto today() const noexcept -> std::int32_t { return _today; }
+
+        // Returns the row of the learning or review card due soonest, if it is due by `now`.
+
+        auto next_due(std::int64_t now) const -> std::optional<std::uint32_t>;
+
+        // Number of learning and review cards in the due queue, whether due yet or not.
+
+        auto queued_count() const noexcept -> std::size_t { return _due_queue.size(); }
+
+        // Returns the row of the next new card to introduce, if any remain. Not `const`, since it
+        // moves the scheduler's place in the new cards past those answered since the last call.
+
+        auto next_new() -> std::optional<std::uint32_t>;
+
+        auto schedule(std::uint32_t row) const -> card_schedule;
+
+        // Records `answer` to card `row` at `now`, updating its scheduling state and its place in
+        // the due queue. Suspended and buried cards are left unchanged.
+
+        void answer(std::uint32_t row, rating answer, std::int64_t now);
+
+        // Computes the interval each answer would give every review card if answered at `now`,
+        // grouping cards by options group and running the model over each group's cards at once.
+
+        auto review_intervals(std::int64_t now) const -> answer_intervals;
+
+    private:
+
+        auto day_of(std::int64_t time) const -> std::int32_t;
+        auto config_of(std::uint32_t row) const -> const deck_config&;
+        auto due_time(std::uint32_t row) const -> std::optional<std::int64_t>;
+
+        // Runs the model over the review cards `rows`, all of one options group, writing the
+        // intervals for the card at `rows[i]` to element `i` of each column of `dst`.
+
+        void review_intervals(
+            const std::uint32_t* rows, std::size_t count, std::int32_t today,
+            const impl::answer_columns& dst) const;
+
+        void answer_learning(std::uint32_t row, rating answer, std::int64_t now);
+        void answer_review(std::uint32_t row, rating answer, std::int64_t now);
+        void graduate(std::uint32_t row, rating answer);
+
+        void update_memory(std::uint32_t row, rating answer);
+        void schedule_step(std::uint32_t row, double minutes, std::int64_t now);
+        void requeue(std::uint32_t row);
+
+        std::int64_t             _created;
+        std::int32_t             _today;
+        scheduler_options        _options;
+        std::array<float, 19>    _weights;
+        std::vector<deck_config> _configs;
+
+        std::vector<std::uint16_t> _config;
+        std::vector<card_type>     _type;
+        std::vector<card_queue>    _queue;
+        std::vector<std::int64_t>  _due;
+        std::vector<std::int32_t>  _interval;
+        std::vector<std::int32_t>  _ease_factor;
+        std::vector<std::int32_t>  _reps;
+        std::vector<std::int32_t>  _lapses;
+        std::vector<std::int32_t>  _left;
+        std::vector<std::int32_t>  _last_review;
+        std::vector<float>         _stability;
+        std::vector<float>         _difficulty;
+
+        ksr::indexed_heap<std::int64_t> _due_queue;
+        std::vector<std::uint32_t>      _new_cards;
+        std::size_t                     _next_new = 0;
+    };
+}
+
+#endif
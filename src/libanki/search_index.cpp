@@ -0,0 +1,569 @@
+#include "search_index.hpp"
+
+#include "collection.hpp"
+#include "collection_snapshot.hpp"
+#include "error.hpp"
+#include "note_fields.hpp"
+#include "impl/byte_order.hpp"
+#include "impl/mapped_file.hpp"
+#include "impl/replace_file.hpp"
+#include "impl/text_tokenizer.hpp"
+
+#include "ksr/narrow_cast.hpp"
+#include "ksr/string_pool.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <utility>
+
+// An index file (all of whose integers are little-endian) consists of:
+//
+// * a header of `header_size` bytes, laid out as the `header_*` offsets below describe, with the
+//   offset of each following section from the start of the file;
+// * the ID of each indexed note, as 8 bytes, in the order the postings number them;
+// * an entry of `term_entry_size` bytes for each term, in order of the term's bytes, laid out as
+//   the `term_*` offsets below describe, locating its text and postings within the sections
+//   that follow;
+// * the text of every term, concatenated; and
+// * the postings of every term. For each note containing the term, in order, these hold the
+//   difference between its number and that of the previous note (or its number, for the first),
+//   then the size in bytes of its positions, then the difference between each position of the
+//   term in the note and the previous position (or the position itself, for the first). All are
+//   unsigned LEB128 integers.
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto magic   = std::uint32_t{0x49534b41};  // "AKSI"
+        constexpr auto version = std::uint32_t{1};
+
+        constexpr auto header_magic      = std::size_t{0};
+        constexpr auto header_version    = std::size_t{4};
+        constexpr auto header_note_count = std::size_t{8};
+        constexpr auto header_term_count = std::size_t{12};
+        constexpr auto header_note_ids   = std::size_t{16};
+        constexpr auto header_terms      = std::size_t{24};
+        constexpr auto header_term_text  = std::size_t{32};
+        constexpr auto header_postings   = std::size_t{40};
+        constexpr auto header_file_size  = std::size_t{48};
+        constexpr auto header_size       = std::size_t{64};
+
+        constexpr auto term_postings      = std::size_t{0};
+        constexpr auto term_postings_size = std::size_t{8};
+        constexpr auto term_text          = std::size_t{16};
+        constexpr auto term_text_size     = std::size_t{24};
+        constexpr auto term_doc_count     = std::size_t{28};
+        constexpr auto term_entry_size    = std::size_t{32};
+
+        [[noreturn]] void throw_invalid() {
+            throw error{error_code::invalid_search_index};
+        }
+
+        void put_varint(std::vector<std::byte>& dst, std::uint64_t value) {
+
+            while (value >= 0x80) {
+                dst.push_back(static_cast<std::byte>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+
+            dst.push_back(static_cast<std::byte>(value));
+        }
+
+        auto get_varint(const std::byte*& src, const std::byte* const end) -> std::uint32_t {
+
+            auto result = std::uint32_t{0};
+            for (auto shift = 0; shift < 35; shift += 7) {
+
+                if (src == end) {
+                    throw_invalid();
+                }
+
+                const auto byte = std::to_integer<std::uint32_t>(*src++);
+                result |= (byte & 0x7f) << shift;
+
+                if ((byte & 0x80) == 0) {
+                    return result;
+                }
+            }
+
+            throw_invalid();
+        }
+
+        // Postings of one term as they are built, note by note.
+
+        struct term_postings_builder {
+            std::vector<std::byte> bytes;
+            std::uint32_t          last_doc  = 0;
+            std::uint32_t          doc_count = 0;
+        };
+    }
+
+    // Reads the postings of one term, stopping at each note in turn.
+
+    class search_index::posting_cursor {
+    public:
+
+        posting_cursor(
+            const std::byte* const begin, const std::byte* const end, const std::uint32_t doc_count,
+            const std::uint32_t note_count)
+
+          : _pos{begin}, _end{end}, _remaining{doc_count}, _note_count{note_count} {
+
+            next();
+        }
+
+        auto done() const noexcept -> bool          { return _done; }
+        auto doc()  const noexcept -> std::uint32_t { return _doc; }
+
+        void next() {
+
+            if (_remaining == 0) {
+                _done = true;
+                return;
+            }
+
+            const auto delta = get_varint(_pos, _end);
+            if (delta >= _note_count - _doc || (delta == 0 && _doc_count > 0)) {
+                throw_invalid();
+            }
+
+            const auto size = get_varint(_pos, _end);
+            if (size > static_cast<std::size_t>(_end - _pos)) {
+                throw_invalid();
+            }
+
+            _doc += delta;
+            _positions     = _pos;
+            _positions_end = _pos + size;
+            _pos          += size;
+
+            --_remaining;
+            ++_doc_count;
+        }
+
+        // Advances to the first note numbered at least `target`.
+
+        void seek(const std::uint32_t target) {
+            while (!_done && _doc < target) {
+                next();
+            }
+        }
+
+        // Replaces the contents of `dst` with the positions of the term in the current note.
+
+        void positions(std::vector<std::uint32_t>& dst) const {
+
+            dst.clear();
+
+            auto src      = _positions;
+            auto position = std::uint32_t{0};
+
+            while (src != _positions_end) {
+                position += get_varint(src, _positions_end);
+                dst.push_back(position);
+            }
+        }
+
+        // Number of notes the term occurs in, for choosing which cursor drives an intersection.
+
+        auto total_count() const noexcept -> std::uint32_t { return _doc_count + _remaining; }
+
+    private:
+
+        const std::byte* _pos;
+        const std::byte* _end;
+        const std::byte* _positions     = nullptr;
+        const std::byte* _positions_end = nullptr;
+
+        std::uint32_t _remaining;
+        std::uint32_t _note_count;
+        std::uint32_t _doc       = 0;
+        std::uint32_t _doc_count = 0;
+        bool          _done      = false;
+    };
+
+    namespace {
+
+        // Calls `visit` for each note that all of `cursors` stop at, in order, with the cursors
+        // positioned at it. Each cursor leaps ahead to the note the others have reached, so the
+        // rarest term bounds the work done.
+
+        template<typename cursor, typename fn>
+        void intersect(std::vector<cursor>& cursors, fn visit) {
+
+            if (cursors.empty()) {
+                return;
+            }
+
+            auto& lead = *std::min_element(cursors.begin(), cursors.end(),
+                [] (const cursor& lhs, const cursor& rhs) {
+                    return lhs.total_count() < rhs.total_count();
+                });
+
+            while (!lead.done()) {
+
+                const auto target = lead.doc();
+                auto next = target;
+
+                for (auto& other : cursors) {
+
+                    other.seek(target);
+                    if (other.done()) {
+                        return;
+                    }
+
+                    next = std::max(next, other.doc());
+                }
+
+                if (next == target) {
+                    visit(target);
+                    lead.next();
+                }
+                else {
+                    lead.seek(next);
+                }
+            }
+        }
+    }
+
+    search_index::search_index(const collection& collection)
+      : search_index{collection.columns().notes} {
+    }
+
+    search_index::search_index(const collection_snapshot& snapshot)
+      : search_index{snapshot.columns().notes} {
+    }
+
+    search_index::search_index(const note_columns& notes) {
+
+        auto terms    = ksr::string_pool{};
+        auto postings = std::vector<term_postings_builder>{};
+
+        auto tokenizer   = impl::text_tokenizer{};
+        auto fields      = std::vector<std::string_view>{};
+        auto tokens      = std::vector<std::string_view>{};
+        auto occurrences = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+        auto positions   = std::vector<std::byte>{};
+
+        const auto note_count = ksr::narrow_cast<std::uint32_t>(notes.size());
+        for (auto doc = std::uint32_t{0}; doc < note_count; ++doc) {
+
+            // Each field is followed by an unused position, so that no phrase spans two fields.
+
+            occurrences.clear();
+            auto position = std::uint32_t{0};
+
+            split_fields(notes.fields[doc], fields);
+            for (const auto field : fields) {
+
+                tokenizer.tokenize(field, tokens);
+                for (const auto token : tokens) {
+                    occurrences.emplace_back(terms.intern(token), position++);
+                }
+
+                ++position;
+            }
+
+            std::sort(occurrences.begin(), occurrences.end());
+            postings.resize(terms.size());
+
+            auto it = occurrences.begin();
+            while (it != occurrences.end()) {
+
+                const auto term = it->first;
+                auto& builder   = postings[term];
+
+                positions.clear();
+                auto previous = std::uint32_t{0};
+
+                for (; it != occurrences.end() && it->first == term; ++it) {
+                    put_varint(positions, it->second - previous);
+                    previous = it->second;
+                }
+
+                put_varint(builder.bytes, doc - builder.last_doc);
+                put_varint(builder.bytes, positions.size());
+                builder.bytes.insert(builder.bytes.end(), positions.begin(), positions.end());
+
+                builder.last_doc = doc;
+                ++builder.doc_count;
+            }
+        }
+
+        auto order = std::vector<std::uint32_t>(terms.size());
+        std::iota(order.begin(), order.end(), std::uint32_t{0});
+        std::sort(order.begin(), order.end(), [&terms] (std::uint32_t lhs, std::uint32_t rhs) {
+            return terms[lhs] < terms[rhs];
+        });
+
+        auto text_size     = std::size_t{0};
+        auto postings_size = std::size_t{0};
+
+        for (auto id = std::size_t{0}; id < terms.size(); ++id) {
+            text_size     += terms[id].size();
+            postings_size += postings[id].bytes.size();
+        }
+
+        const auto term_count     = ksr::narrow_cast<std::uint32_t>(terms.size());
+        const auto note_ids_begin = header_size;
+        const auto terms_begin    = note_ids_begin + std::size_t{note_count} * 8;
+        const auto text_begin     = terms_begin + std::size_t{term_count} * term_entry_size;
+        const auto postings_begin = text_begin + text_size;
+        const auto file_size      = postings_begin + postings_size;
+
+        _bytes.resize(file_size);
+        const auto dst = _bytes.data();
+
+        impl::store_u32(dst + header_magic,      magic);
+        impl::store_u32(dst + header_version,    version);
+        impl::store_u32(dst + header_note_count, note_count);
+        impl::store_u32(dst + header_term_count, term_count);
+        impl::store_u64(dst + header_note_ids,   note_ids_begin);
+        impl::store_u64(dst + header_terms,      terms_begin);
+        impl::store_u64(dst + header_term_text,  text_begin);
+        impl::store_u64(dst + header_postings,   postings_begin);
+        impl::store_u64(dst + header_file_size,  file_size);
+
+        for (auto doc = std::size_t{0}; doc < note_count; ++doc) {
+            impl::store_u64(
+                dst + note_ids_begin + doc * 8, static_cast<std::uint64_t>(notes.id[doc]));
+        }
+
+        auto text_offset     = std::size_t{0};
+        auto postings_offset = std::size_t{0};
+
+        for (auto i = std::size_t{0}; i < order.size(); ++i) {
+
+            const auto  text    = terms[order[i]];
+            const auto& builder = postings[order[i]];
+            const auto& bytes   = builder.bytes;
+            const auto  entry   = dst + terms_begin + i * term_entry_size;
+
+            impl::store_u64(entry + term_postings,      postings_offset);
+            impl::store_u64(entry + term_postings_size, bytes.size());
+            impl::store_u64(entry + term_text,          text_offset);
+            impl::store_u32(entry + term_text_size,     static_cast<std::uint32_t>(text.size()));
+            impl::store_u32(entry + term_doc_count,     builder.doc_count);
+
+            std::transform(text.begin(), text.end(), dst + text_begin + text_offset,
+                [] (char c) { return static_cast<std::byte>(c); });
+            std::copy(bytes.begin(), bytes.end(), dst + postings_begin + postings_offset);
+
+            text_offset     += text.size();
+            postings_offset += bytes.size();
+        }
+
+        attach(_bytes.data(), _bytes.size());
+    }
+
+    auto search_index::open(const path& src) -> search_index {
+
+        auto result = search_index{};
+        result._file = std::make_unique<impl::mapped_file>(src);
+        result.attach(result._file->data(), result._file->size());
+
+        return result;
+    }
+
+    search_index::~search_index() = default;
+
+    search_index::search_index(search_index&& rhs) noexcept = default;
+    auto search_index::operator=(search_index&& rhs) noexcept -> search_index& = default;
+
+    void search_index::save(const path& dst) const {
+        impl::replace_file(dst, _data, _size);
+    }
+
+    auto search_index::match_all(const std::string_view query) const -> std::vector<std::int64_t> {
+
+        auto cursors = cursors_for(query);
+        auto result  = std::vector<std::int64_t>{};
+
+        intersect(cursors, [&] (std::uint32_t doc) { result.push_back(note_id(doc)); });
+        return result;
+    }
+
+    auto search_index::match_any(const std::string_view query) const -> std::vector<std::int64_t> {
+
+        auto tokenizer = impl::text_tokenizer{};
+        auto tokens    = std::vector<std::string_view>{};
+        auto docs      = std::vector<std::uint32_t>{};
+
+        tokenizer.tokenize(query, tokens);
+        for (const auto token : tokens) {
+
+            if (auto cursor = find_term(token)) {
+                for (; !cursor->done(); cursor->next()) {
+                    docs.push_back(cursor->doc());
+                }
+            }
+        }
+
+        std::sort(docs.begin(), docs.end());
+        docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+
+        auto result = std::vector<std::int64_t>{};
+        result.reserve(docs.size());
+
+        for (const auto doc : docs) {
+            result.push_back(note_id(doc));
+        }
+
+        return result;
+    }
+
+    auto search_index::match_phrase(const std::string_view query) const
+        -> std::vector<std::int64_t> {
+
+        auto cursors   = cursors_for(query);
+        auto positions = std::vector<std::vector<std::uint32_t>>(cursors.size());
+        auto result    = std::vector<std::int64_t>{};
+
+        // Within a note containing every term, the phrase occurs where the i-th term is found i
+        // positions after the first.
+
+        intersect(cursors, [&] (std::uint32_t doc) {
+
+            for (auto i = std::size_t{0}; i < cursors.size(); ++i) {
+                cursors[i].positions(positions[i]);
+            }
+
+            const auto found = std::any_of(positions[0].begin(), positions[0].end(),
+                [&] (std::uint32_t first) {
+
+                    for (auto i = std::size_t{1}; i < positions.size(); ++i) {
+
+                        const auto& candidates = positions[i];
+                        const auto target      = first + static_cast<std::uint32_t>(i);
+
+                        if (!std::binary_search(candidates.begin(), candidates.end(), target)) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                });
+
+            if (found) {
+                result.push_back(note_id(doc));
+            }
+        });
+
+        return result;
+    }
+
+    void search_index::attach(const std::byte* const data, const std::size_t size) {
+
+        if (size < header_size || impl::load_u32(data + header_magic) != magic
+            || impl::load_u32(data + header_version) != version
+            || impl::load_u64(data + header_file_size) != size) {
+
+            throw_invalid();
+        }
+
+        _note_count = impl::load_u32(data + header_note_count);
+        _term_count = impl::load_u32(data + header_term_count);
+        _note_ids   = impl::load_u64(data + header_note_ids);
+        _terms      = impl::load_u64(data + header_terms);
+        _term_text  = impl::load_u64(data + header_term_text);
+        _postings   = impl::load_u64(data + header_postings);
+
+        // The sections must follow one another in order; the entries of each term are checked as
+        // they are read.
+
+        const auto sections_valid = _note_ids == header_size
+            && _terms == _note_ids + std::uint64_t{_note_count} * 8
+            && _term_text == _terms + std::uint64_t{_term_count} * term_entry_size
+            && _term_text <= _postings && _postings <= size;
+
+        if (!sections_valid) {
+            throw_invalid();
+        }
+
+        _data = data;
+        _size = size;
+    }
+
+    auto search_index::note_id(const std::uint32_t doc) const -> std::int64_t {
+        return static_cast<std::int64_t>(impl::load_u64(_data + _note_ids + std::size_t{doc} * 8));
+    }
+
+    auto search_index::find_term(const std::string_view term) const
+        -> std::optional<posting_cursor> {
+
+        const auto text_size     = _postings - _term_text;
+        const auto postings_size = _size - _postings;
+
+        const auto entry_at = [this] (std::size_t index) {
+            return _data + _terms + index * term_entry_size;
+        };
+
+        const auto text_of = [&] (const std::byte* entry) {
+
+            const auto offset = impl::load_u64(entry + term_text);
+            const auto size   = impl::load_u32(entry + term_text_size);
+
+            if (offset > text_size || size > text_size - offset) {
+                throw_invalid();
+            }
+
+            return std::string_view{
+                reinterpret_cast<const char*>(_data + _term_text + offset), size};
+        };
+
+        auto lo = std::size_t{0};
+        auto hi = std::size_t{_term_count};
+
+        while (lo < hi) {
+
+            const auto mid = lo + (hi - lo) / 2;
+            if (text_of(entry_at(mid)) < term) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+
+        if (lo == _term_count || text_of(entry_at(lo)) != term) {
+            return std::nullopt;
+        }
+
+        const auto entry  = entry_at(lo);
+        const auto offset = impl::load_u64(entry + term_postings);
+        const auto size   = impl::load_u64(entry + term_postings_size);
+
+        if (offset > postings_size || size > postings_size - offset) {
+            throw_invalid();
+        }
+
+        const auto begin = _data + _postings + offset;
+        return posting_cursor{
+            begin, begin + size, impl::load_u32(entry + term_doc_count), _note_count};
+    }
+
+    auto search_index::cursors_for(const std::string_view query) const
+        -> std::vector<posting_cursor> {
+
+        auto tokenizer = impl::text_tokenizer{};
+        auto tokens    = std::vector<std::string_view>{};
+        auto result    = std::vector<posting_cursor>{};
+
+        tokenizer.tokenize(query, tokens);
+        result.reserve(tokens.size());
+
+        for (const auto token : tokens) {
+
+            auto cursor = find_term(token);
+            if (!cursor) {
+                return {};
+            }
+
+            result.push_back(*cursor);
+        }
+
+        return result;
+    }
+}
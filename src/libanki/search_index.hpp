@@ -0,0 +1,112 @@
+#ifndef LIBANKI_SEARCH_INDEX_HPP
+#define LIBANKI_SEARCH_INDEX_HPP
+
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    class collection;
+    class collection_snapshot;
+    struct note_columns;
+
+    namespace impl {
+        class mapped_file;
+    }
+
+    // Inverted index of the text of every note of a collection, answering word and phrase queries
+    // without scanning the notes. Text is split into terms as described for
+    // `impl::text_tokenizer`, so queries ignore markup, case and diacritics; the fields of a note
+    // are indexed together, but a phrase never spans two fields.
+    //
+    // The index is a single block of bytes in the format that `save()` writes, whether built in
+    // memory or mapped from a file by `open()`, so a saved index is usable immediately and only
+    // the parts a query touches are read from disk. Each term's postings (the notes containing it,
+    // and its positions within each) are delta-encoded as variable-length integers.
+    //
+    // An index is immutable once built, and may be queried from several threads at once.
+
+    class search_index {
+    public:
+
+        // Indexes every note of `collection`, from `collection.columns()`. Throws `anki::error`
+        // if the collection cannot be read.
+
+        explicit search_index(const collection& collection);
+
+        // As above, from `snapshot.columns()`. Throws `anki::error` if the snapshot is corrupt.
+
+        explicit search_index(const collection_snapshot& snapshot);
+
+        // Maps the index saved at `src`. Throws `anki::error` with `error_code::system_error` if
+        // the file cannot be mapped, or `error_code::invalid_search_index` if it is not an index
+        // of this version. Postings are validated only when a query reads them, so a query may
+        // also throw `error_code::invalid_search_index` if the file is corrupt.
+
+        static auto open(const path& src) -> search_index;
+
+        ~search_index();
+
+        search_index(search_index&& rhs) noexcept;
+        auto operator=(search_index&& rhs) noexcept -> search_index&;
+
+        search_index(const search_index&) = delete;
+        auto operator=(const search_index&) -> search_index& = delete;
+
+        // Writes the index to `dst`, replacing any existing file as `impl::replace_file()` does.
+        // Throws `anki::error` with `error_code::system_error` on failure, in which case `dst` is
+        // left as it was.
+
+        void save(const path& dst) const;
+
+        auto note_count() const noexcept -> std::size_t { return _note_count; }
+        auto term_count() const noexcept -> std::size_t { return _term_count; }
+
+        // Each of these returns the IDs, in ascending order, of the notes whose text contains
+        // every term of `query`, any term of `query`, or the terms of `query` consecutively and
+        // in order. A query without terms matches nothing.
+
+        auto match_all(std::string_view query)    const -> std::vector<std::int64_t>;
+        auto match_any(std::string_view query)    const -> std::vector<std::int64_t>;
+        auto match_phrase(std::string_view query) const -> std::vector<std::int64_t>;
+
+    private:
+
+        class posting_cursor;
+
+        search_index() = default;
+
+        explicit search_index(const note_columns& notes);
+
+        void attach(const std::byte* data, std::size_t size);
+
+        auto note_id(std::uint32_t doc) const -> std::int64_t;
+        auto find_term(std::string_view term) const -> std::optional<posting_cursor>;
+
+        // Cursors over the postings of each term of `query`, in order, or an empty vector if any
+        // term is not indexed.
+
+        auto cursors_for(std::string_view query) const -> std::vector<posting_cursor>;
+
+        std::vector<std::byte>             _bytes;
+        std::unique_ptr<impl::mapped_file> _file;
+
+        const std::byte* _data = nullptr;
+        std::size_t      _size = 0;
+
+        std::uint32_t _note_count = 0;
+        std::uint32_t _term_count = 0;
+        std::uint64_t _note_ids   = 0;
+        std::uint64_t _terms      = 0;
+        std::uint64_t _term_text  = 0;
+        std::uint64_t _postings   = 0;
+    };
+}
+
+#endif
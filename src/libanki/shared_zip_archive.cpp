@@ -0,0 +1,52 @@
+#include "shared_zip_archive.hpp"
+
+#include "impl/archive_file.hpp"
+#include "impl/native/archive.hpp"
+
+#include <cassert>
+
+namespace anki {
+
+    shared_zip_archive::shared_zip_archive(const path& src)
+      : _archive{std::make_shared<const impl::native::archive>(impl::archive_file{src})} {
+    }
+
+    auto shared_zip_archive::contains_file(const path& file_path) const -> bool {
+
+        assert(_archive);
+        return _archive->contains_file(file_path);
+    }
+
+    auto shared_zip_archive::open_file(const path& file_path) const -> zip_file {
+
+        assert(_archive);
+        return zip_file{_archive->open_file(file_path, false)};
+    }
+
+    auto shared_zip_archive::open_raw_file(const path& file_path) const -> zip_file {
+
+        assert(_archive);
+        return zip_file{_archive->open_file(file_path, true)};
+    }
+
+    auto shared_zip_archive::stat_file(const path& file_path) const -> zip_entry_info {
+
+        assert(_archive);
+        return _archive->stat_file(file_path);
+    }
+
+    auto shared_zip_archive::read_shared(const path& file_path) const -> shared_entry {
+
+        assert(_archive);
+
+        const auto load = [this, &file_path] {
+            return _archive->open_file(file_path, false)->read_all();
+        };
+
+        if (!_cache) {
+            return std::make_shared<const std::vector<std::byte>>(load());
+        }
+
+        return _cache->get(file_path.string(), load);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef LIBANKI_SHARED_ZIP_ARCHIVE_HPP
+#define LIBANKI_SHARED_ZIP_ARCHIVE_HPP
+
+#include "entry_cache.hpp"
+#include "filesystem.hpp"
+#include "zip_entry_info.hpp"
+#include "zip_file.hpp"
+
+#include <memory>
+
+namespace anki {
+
+    namespace impl::native {
+        class archive;
+    }
+
+    // Read-only zip archive that may be used from any number of threads at once, unlike
+    // `zip_archive`, whose members may not be called concurrently even where `const`. The central
+    // directory is parsed once, on construction, and is immutable thereafter; opening and reading
+    // files take no locks, with decoder state kept per thread. Always uses the native backend
+    // (see `zip_backend`), since libzip handles may only be used by one thread at a time.
+    //
+    // Copies are cheap and refer to the same archive, which stays open for as long as any copy
+    // exists; there is no `close()`. Files opened from the archive must each be used by one
+    // thread at a time, and throw `zip_archive_closed` if read after every copy of the archive
+    // has been destroyed.
+
+    class shared_zip_archive {
+    public:
+
+        // Opens an archive available from the filesystem path `src`. Throws `zip_error` on
+        // failure.
+
+        explicit shared_zip_archive(const path& src);
+
+        // As for the corresponding members of `zip_archive`. Safe to call concurrently.
+
+        auto contains_file(const path& file_path) const -> bool;
+        auto open_file(const path& file_path) const -> zip_file;
+        auto open_raw_file(const path& file_path) const -> zip_file;
+        auto stat_file(const path& file_path) const -> zip_entry_info;
+
+        // As for the corresponding members of `zip_archive`. A cache is attached only to this
+        // copy of the archive and to copies made from it afterwards. `read_shared()` is safe to
+        // call concurrently, with concurrent misses for one file decompressing it only once.
+
+        void set_cache(std::shared_ptr<entry_cache> cache) { _cache = std::move(cache); }
+        auto read_shared(const path& file_path) const -> shared_entry;
+
+    private:
+
+        std::shared_ptr<const impl::native::archive> _archive;
+        std::shared_ptr<entry_cache>                 _cache;
+    };
+}
+
+#endif
@@ -0,0 +1,321 @@
+#include "tag_index.hpp"
+
+#include "collection_columns.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto hierarchy_separator = std::string_view{"::"};
+
+        auto to_lower(const char c) -> char {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        auto to_lower(const std::string_view text) -> std::string {
+
+            auto result = std::string{text};
+            std::transform(result.begin(), result.end(), result.begin(),
+                [] (char c) { return to_lower(c); });
+
+            return result;
+        }
+
+        auto equals_nocase(const std::string_view lhs, const std::string_view rhs) -> bool {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                [] (char lhs, char rhs) { return to_lower(lhs) == to_lower(rhs); });
+        }
+
+        // Returns whether `text` matches `pattern`, in which `*` matches any run of characters.
+        // On a mismatch after a `*`, the run it matches is extended by one character and the
+        // match retried from there, which suffices since only the last `*` need ever backtrack.
+
+        auto glob_match(const std::string_view pattern, const std::string_view text) -> bool {
+
+            auto p = std::size_t{0};
+            auto t = std::size_t{0};
+
+            auto star_p = std::string_view::npos;
+            auto star_t = std::size_t{0};
+
+            while (t < text.size()) {
+
+                if (p < pattern.size() && pattern[p] == '*') {
+                    star_p = p++;
+                    star_t = t;
+                }
+                else if (p < pattern.size() && pattern[p] == text[t]) {
+                    ++p;
+                    ++t;
+                }
+                else if (star_p != std::string_view::npos) {
+                    p = star_p + 1;
+                    t = ++star_t;
+                }
+                else {
+                    return false;
+                }
+            }
+
+            while (p < pattern.size() && pattern[p] == '*') {
+                ++p;
+            }
+
+            return p == pattern.size();
+        }
+
+        [[noreturn]] void throw_invalid() {
+            throw error{error_code::invalid_tag_query};
+        }
+    }
+
+    // Recursive-descent parser for `tag_index::query()`, evaluating the query as it goes.
+
+    class tag_index::parser {
+    public:
+
+        parser(const tag_index& index, const std::string_view query)
+          : _index{index}, _query{query} {
+        }
+
+        auto parse() -> row_bitmap {
+
+            skip_space();
+            if (_pos == _query.size()) {
+                return _index._all;
+            }
+
+            auto result = parse_or();
+
+            skip_space();
+            if (_pos != _query.size()) {
+                throw_invalid();
+            }
+
+            return result;
+        }
+
+    private:
+
+        auto parse_or() -> row_bitmap {
+
+            auto result = parse_and();
+            while (accept_keyword("or")) {
+                result = result | parse_and();
+            }
+
+            return result;
+        }
+
+        auto parse_and() -> row_bitmap {
+
+            auto result = parse_term();
+            while (true) {
+
+                skip_space();
+                if (_pos == _query.size() || _query[_pos] == ')' || peek_keyword("or")) {
+                    return result;
+                }
+
+                accept_keyword("and");
+                result = result & parse_term();
+            }
+        }
+
+        auto parse_term() -> row_bitmap {
+
+            skip_space();
+            if (_pos == _query.size()) {
+                throw_invalid();
+            }
+
+            switch (_query[_pos]) {
+            case '-':
+
+                ++_pos;
+                return _index._all - parse_term();
+
+            case '(': {
+
+                ++_pos;
+                auto result = parse_or();
+
+                skip_space();
+                if (_pos == _query.size() || _query[_pos] != ')') {
+                    throw_invalid();
+                }
+
+                ++_pos;
+                return result;
+            }
+            case ')':
+                throw_invalid();
+            }
+
+            auto word = read_word();
+            if (equals_nocase(word, "and") || equals_nocase(word, "or")) {
+                throw_invalid();
+            }
+
+            static constexpr auto tag_prefix = std::string_view{"tag:"};
+            if (equals_nocase(word.substr(0, tag_prefix.size()), tag_prefix)) {
+                word.remove_prefix(tag_prefix.size());
+            }
+
+            if (word.empty()) {
+                throw_invalid();
+            }
+
+            return equals_nocase(word, "none") ? _index._untagged : _index.match(word);
+        }
+
+        auto read_word() -> std::string_view {
+
+            const auto begin = _pos;
+            while (_pos < _query.size() && !is_space(_query[_pos])
+                && _query[_pos] != '(' && _query[_pos] != ')') {
+
+                ++_pos;
+            }
+
+            return _query.substr(begin, _pos - begin);
+        }
+
+        auto peek_keyword(const std::string_view keyword) const -> bool {
+
+            const auto end = _pos + keyword.size();
+            if (end > _query.size() || !equals_nocase(_query.substr(_pos, end - _pos), keyword)) {
+                return false;
+            }
+
+            return end == _query.size() || is_space(_query[end]) || _query[end] == '(';
+        }
+
+        auto accept_keyword(const std::string_view keyword) -> bool {
+
+            skip_space();
+            if (!peek_keyword(keyword)) {
+                return false;
+            }
+
+            _pos += keyword.size();
+            return true;
+        }
+
+        void skip_space() {
+            while (_pos < _query.size() && is_space(_query[_pos])) {
+                ++_pos;
+            }
+        }
+
+        static auto is_space(const char c) -> bool {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        const tag_index& _index;
+        std::string_view _query;
+        std::size_t      _pos = 0;
+    };
+
+    tag_index::tag_index(const collection_columns& columns)
+      : _note_count{columns.notes.size()} {
+
+        const auto& notes = columns.notes;
+        const auto& pool  = columns.tags;
+
+        // Each interned tag names itself and each of its ancestors, which are collected in lower
+        // case, then sorted so that each tag ID can be mapped to the indices of its names.
+
+        auto names_of = std::vector<std::vector<std::string>>(pool.size());
+        for (auto id = std::size_t{0}; id < pool.size(); ++id) {
+
+            const auto name = to_lower(pool[static_cast<std::uint32_t>(id)]);
+
+            auto pos = name.find(hierarchy_separator);
+            while (pos != std::string::npos) {
+                names_of[id].push_back(name.substr(0, pos));
+                pos = name.find(hierarchy_separator, pos + hierarchy_separator.size());
+            }
+
+            names_of[id].push_back(name);
+            _tags.insert(_tags.end(), names_of[id].begin(), names_of[id].end());
+        }
+
+        std::sort(_tags.begin(), _tags.end());
+        _tags.erase(std::unique(_tags.begin(), _tags.end()), _tags.end());
+
+        auto indices_of = std::vector<std::vector<std::uint32_t>>(pool.size());
+        for (auto id = std::size_t{0}; id < pool.size(); ++id) {
+            for (const auto& name : names_of[id]) {
+
+                const auto it = std::lower_bound(_tags.begin(), _tags.end(), name);
+                indices_of[id].push_back(static_cast<std::uint32_t>(it - _tags.begin()));
+            }
+        }
+
+        // Rows are visited in order, so every insertion appends.
+
+        _notes.resize(_tags.size());
+
+        for (auto row = std::uint32_t{0}; row < notes.size(); ++row) {
+
+            _all.insert(row);
+
+            const auto tags = notes.tags_of(row);
+            if (tags.size() == 0) {
+                _untagged.insert(row);
+            }
+
+            for (const auto tag : tags) {
+                for (const auto index : indices_of[tag]) {
+                    _notes[index].insert(row);
+                }
+            }
+        }
+    }
+
+    auto tag_index::notes_tagged(const std::string_view tag) const -> const row_bitmap& {
+
+        static const auto none = row_bitmap{};
+
+        const auto name = to_lower(tag);
+        const auto it   = std::lower_bound(_tags.begin(), _tags.end(), name);
+
+        if (it == _tags.end() || *it != name) {
+            return none;
+        }
+
+        return _notes[static_cast<std::size_t>(it - _tags.begin())];
+    }
+
+    auto tag_index::query(const std::string_view query) const -> row_bitmap {
+        return parser{*this, query}.parse();
+    }
+
+    auto tag_index::match(const std::string_view pattern) const -> row_bitmap {
+
+        if (pattern.find('*') == std::string_view::npos) {
+            return notes_tagged(pattern);
+        }
+
+        // Only the names matching the literal text before the first `*` need be tested, and they
+        // are adjacent in sorted order.
+
+        const auto lowered = to_lower(pattern);
+        const auto prefix  = std::string_view{lowered}.substr(0, lowered.find('*'));
+
+        auto result = row_bitmap{};
+        for (auto it = std::lower_bound(_tags.begin(), _tags.end(), prefix);
+             it != _tags.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+
+            if (glob_match(lowered, *it)) {
+                result = result | _notes[static_cast<std::size_t>(it - _tags.begin())];
+            }
+        }
+
+        return result;
+    }
+}
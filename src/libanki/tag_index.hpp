@@ -0,0 +1,67 @@
+#ifndef LIBANKI_TAG_INDEX_HPP
+#define LIBANKI_TAG_INDEX_HPP
+
+#include "row_bitmap.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anki {
+
+    struct collection_columns;
+
+    // Index of the notes of a collection by tag, holding the set of note rows (of
+    // `collection_columns::notes`) with each tag as a `row_bitmap`. Anki's tags form a hierarchy
+    // through `::` separators, and a search for a tag also finds the tags beneath it, so each
+    // ancestor of a tag is indexed too: a note tagged `lang::es::verbs` is in the sets of
+    // `lang`, `lang::es` and `lang::es::verbs`. Tags are compared ignoring ASCII case, as in Anki.
+    //
+    // Card rows can be filtered through the index by testing `collection_columns::cards::note`.
+    // An index is immutable once built, and may be queried from several threads at once.
+
+    class tag_index {
+    public:
+
+        explicit tag_index(const collection_columns& columns);
+
+        auto note_count() const noexcept -> std::size_t { return _note_count; }
+
+        // Every distinct tag and ancestor of a tag, in lower case and sorted.
+
+        auto tags() const noexcept -> const std::vector<std::string>& { return _tags; }
+
+        // Returns the rows of the notes with tag `tag` or a tag beneath it, which are empty if
+        // there are none.
+
+        auto notes_tagged(std::string_view tag) const -> const row_bitmap&;
+
+        // Returns the rows of the notes matching `query`, which is written as the tag terms of an
+        // Anki search:
+        //
+        // * a term `tag:NAME` (or just `NAME`) matches as `notes_tagged(NAME)`, except that `*`
+        //   in `NAME` matches any run of characters, and `tag:none` matches untagged notes;
+        // * terms separated by whitespace or `and` must all match, and terms separated by `or`
+        //   need only one to, with `and` binding more tightly; and
+        // * a term preceded by `-` is negated, and parentheses group terms.
+        //
+        // Throws `anki::error` with `error_code::invalid_tag_query` if `query` is malformed.
+
+        auto query(std::string_view query) const -> row_bitmap;
+
+    private:
+
+        class parser;
+
+        auto match(std::string_view pattern) const -> row_bitmap;
+
+        std::size_t              _note_count = 0;
+        std::vector<std::string> _tags;
+        std::vector<row_bitmap>  _notes;
+        row_bitmap               _all;
+        row_bitmap               _untagged;
+    };
+}
+
+#endif
@@ -0,0 +1,239 @@
+#include "verify.hpp"
+
+#include "impl/archive_file.hpp"
+#include "impl/crc32.hpp"
+#include "impl/native/central_directory.hpp"
+#include "impl/parallel.hpp"
+#include "impl/zlib/inflater.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto chunk_size = std::size_t{1} << 20; // Arbitrary; not profiled
+
+        // State of a thread verifying entries, kept from one entry to the next. Entry data is
+        // read with `pread()` rather than through a mapping, so that an archive truncated while
+        // it is verified fails with an error rather than a signal.
+
+        class verifier {
+        public:
+
+            explicit verifier(const impl::archive_file& file)
+              : _file{file} {
+            }
+
+            // Checks `target`, throwing the error that reading it would.
+
+            void check(const impl::native::entry& target) {
+
+                const auto& info = target.info;
+
+                if (info.encrypted) {
+                    throw error{error_code::zip_password_required};
+                }
+
+                const auto offset = impl::native::data_offset(_file, target);
+
+                if (_input.empty()) {
+                    _input.resize(chunk_size);
+                }
+
+                switch (info.method) {
+                case zip_method::stored:
+
+                    if (info.compressed_size != info.size) {
+                        throw error{error_code::zip_archive_inconsistent};
+                    }
+
+                    check_stored(info, offset);
+                    break;
+
+                case zip_method::deflated:
+                    check_deflated(info, offset);
+                    break;
+
+                default:
+                    throw error{error_code::zip_unsupported_compression_method};
+                }
+            }
+
+        private:
+
+            void check_stored(const zip_entry_info& info, const std::uint64_t offset) {
+
+                auto crc = std::uint32_t{0};
+
+                for (auto pos = std::uint64_t{0}; pos < info.size; ) {
+
+                    const auto size = ksr::narrow_cast<std::size_t>(
+                        std::min<std::uint64_t>(_input.size(), info.size - pos));
+
+                    _file.read_exact_at(offset + pos, _input.data(), size);
+                    crc = impl::crc32(crc, _input.data(), size);
+                    pos += size;
+                }
+
+                if (crc != info.crc) {
+                    throw error{error_code::zip_bad_crc};
+                }
+            }
+
+            void check_deflated(const zip_entry_info& info, const std::uint64_t offset) {
+
+                if (_inflater) {
+                    _inflater->reset();
+                }
+                else {
+                    _inflater = std::make_unique<impl::zlib::inflater>();
+                    _output.resize(chunk_size);
+                }
+
+                auto src_pos  = std::uint64_t{0};
+                auto size     = std::uint64_t{0};
+                auto crc      = std::uint32_t{0};
+                auto finished = false;
+
+                while (!finished && src_pos < info.compressed_size) {
+
+                    const auto src_size = ksr::narrow_cast<std::size_t>(
+                        std::min<std::uint64_t>(_input.size(), info.compressed_size - src_pos));
+
+                    _file.read_exact_at(offset + src_pos, _input.data(), src_size);
+                    src_pos += src_size;
+
+                    auto consumed = std::size_t{0};
+                    while (!finished) {
+
+                        const auto result = _inflater->inflate(
+                            _input.data() + consumed, src_size - consumed,
+                            _output.data(), _output.size());
+
+                        consumed += result.consumed;
+                        finished  = result.finished;
+
+                        if (result.produced == 0 && result.consumed == 0) {
+                            break;
+                        }
+
+                        // Inflation stops as soon as the data outgrows its recorded size, so
+                        // that a decompression bomb cannot tie up this thread for long.
+
+                        if (result.produced > info.size - size) {
+                            throw error{error_code::zip_archive_inconsistent};
+                        }
+
+                        crc   = impl::crc32(crc, _output.data(), result.produced);
+                        size += result.produced;
+                    }
+                }
+
+                if (!finished) {
+                    throw error{error_code::zip_invalid_compressed_data};
+                }
+
+                if (size != info.size) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                if (crc != info.crc) {
+                    throw error{error_code::zip_bad_crc};
+                }
+            }
+
+            const impl::archive_file&             _file;
+            std::vector<std::byte>                _input;
+            std::vector<std::byte>                _output;
+            std::unique_ptr<impl::zlib::inflater> _inflater;
+        };
+    }
+
+    auto verify_report::ok() const noexcept -> bool {
+
+        return !error && std::all_of(entries.begin(), entries.end(), [] (const auto& entry) {
+            return entry.ok();
+        });
+    }
+
+    auto verify(const path& src, const verify_options& options) -> verify_report {
+
+        auto report = verify_report{};
+
+        auto file      = std::optional<impl::archive_file>{};
+        auto directory = std::optional<impl::native::central_directory>{};
+
+        try {
+            file.emplace(src);
+            directory.emplace(*file);
+        }
+        catch (const error& ex) {
+            report.error = ex.code();
+            return report;
+        }
+
+        const auto& entries = directory->entries();
+        if (entries.empty()) {
+            return report;
+        }
+
+        report.entries.resize(entries.size());
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+            report.entries[i].name = entries[i].name;
+            report.entries[i].info = entries[i].info;
+        }
+
+        // Entries are handed out largest first, so that no thread is left with a large entry to
+        // verify alone at the end.
+
+        auto order = std::vector<std::size_t>(entries.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::stable_sort(order.begin(), order.end(), [&entries] (auto lhs, auto rhs) {
+            return entries[lhs].info.compressed_size > entries[rhs].info.compressed_size;
+        });
+
+        auto next    = std::atomic<std::size_t>{0};
+        auto stopped = std::atomic<bool>{false};
+
+        const auto run = [&] {
+
+            auto current = verifier{*file};
+
+            for (auto i = next++; i < order.size() && !stopped.load(std::memory_order_relaxed);
+                 i = next++) {
+
+                auto& result = report.entries[order[i]];
+
+                try {
+                    current.check(entries[order[i]]);
+                }
+                catch (const error& ex) {
+                    result.error = ex.code();
+                }
+                catch (const std::bad_alloc&) {
+                    result.error = error_code::zip_bad_alloc;
+                }
+
+                if (result.error && options.stop_at_first_error) {
+                    stopped.store(true, std::memory_order_relaxed);
+                }
+
+                result.checked = true;
+            }
+        };
+
+        impl::run_parallel(
+            impl::parallel_thread_count(options.thread_count, entries.size()),
+            [&run] (std::size_t) { run(); });
+
+        return report;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef LIBANKI_VERIFY_HPP
+#define LIBANKI_VERIFY_HPP
+
+#include "error.hpp"
+#include "filesystem.hpp"
+#include "zip_entry_info.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace anki {
+
+    // Tuning parameters for `verify()`.
+    //
+    // * `thread_count` is the number of threads to verify with, including the calling thread, or
+    //   0 to use one per hardware thread.
+    // * `stop_at_first_error` stops every thread once any entry fails, for callers that only need
+    //   to know whether an archive is intact; entries not yet verified are then left unchecked.
+
+    struct verify_options {
+        unsigned thread_count        = 0;
+        bool     stop_at_first_error = false;
+    };
+
+    // Outcome of verifying one entry: `error` holds the error that reading the entry would throw,
+    // if any. An entry is left unchecked only when verification stopped at an earlier error.
+
+    struct entry_verification {
+        std::string               name;
+        zip_entry_info            info;
+        bool                      checked = false;
+        std::optional<error_code> error;
+
+        auto ok() const noexcept -> bool { return checked && !error; }
+    };
+
+    // Outcome of verifying an archive: `error` is set if the archive could not be opened or its
+    // central directory parsed, in which case `entries` is empty; otherwise `entries` holds one
+    // result for each entry, in the order of the central directory.
+
+    struct verify_report {
+        std::optional<error_code>       error;
+        std::vector<entry_verification> entries;
+
+        // Whether the archive and every entry in it verified successfully.
+
+        auto ok() const noexcept -> bool;
+    };
+
+    // Checks that every entry of the archive at `src` can be read: that its local header is
+    // consistent with the central directory, that its data decompresses to exactly its recorded
+    // size, and that the result has its recorded CRC. Entries are divided between several
+    // threads, largest first, and decompressed in chunks into buffers kept by each thread, so
+    // nothing is retained and memory use does not grow with entry size. Failures are reported
+    // rather than thrown.
+
+    auto verify(const path& src, const verify_options& options = {}) -> verify_report;
+}
+
+#endif
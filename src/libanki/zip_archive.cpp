@@ -1,33 +1,197 @@
 #include "zip_archive.hpp"
 
-#include "impl/libzip/error.hpp"
+#include "batch_reader.hpp"
+#include "error.hpp"
+#include "impl/archive_backend.hpp"
+#include "impl/archive_file.hpp"
+#include "impl/libzip/archive.hpp"
+#include "impl/native/archive.hpp"
+#include "impl/zip_format.hpp"
 #include "zip_file.hpp"
 
-#include "zip.h"
-
+#include <algorithm>
 #include <cassert>
+#include <mutex>
+#include <utility>
 
-using namespace anki::impl::libzip;
+using anki::impl::archive_file;
+using anki::impl::cached_range;
 
 namespace anki {
 
     namespace {
 
-        auto handle_cast(void* handle) -> zip_t* {
-            return static_cast<zip_t*>(handle);
+        void check_complete(const std::vector<read_request>& requests) {
+
+            const auto is_short = [] (const read_request& request) {
+                return request.bytes_read != request.size;
+            };
+
+            if (std::any_of(requests.begin(), requests.end(), is_short)) {
+                throw error{error_code::zip_premature_eof};
+            }
+        }
+
+        // Reads and returns the final bytes of each archive, which hold its end of central
+        // directory record. The reads are staged through the reader's registered arena where it
+        // is large enough, in as many batches as that requires, holding it for the duration.
+
+        auto read_tails(const std::vector<archive_file>& files, batch_reader& reader)
+            -> std::vector<cached_range> {
+
+            static constexpr auto slot_size = impl::zip_format::max_tail_size;
+
+            const auto use_arena  = reader.arena_size() >= slot_size;
+            const auto batch_size = use_arena ? reader.arena_size() / slot_size : files.size();
+
+            const auto arena_lock =
+                use_arena ? reader.lock_arena() : std::unique_lock<std::mutex>{};
+
+            auto tails = std::vector<cached_range>(files.size());
+
+            for (auto begin = std::size_t{0}; begin < files.size(); begin += batch_size) {
+
+                const auto end = std::min(begin + batch_size, files.size());
+
+                auto requests = std::vector<read_request>(end - begin);
+
+                for (auto i = begin; i < end; ++i) {
+
+                    const auto& file = files[i];
+                    const auto size = std::min<std::uint64_t>(file.size(), slot_size);
+
+                    auto& range = tails[i];
+                    range.offset = file.size() - size;
+                    range.bytes.resize(size);
+
+                    auto& request = requests[i - begin];
+                    request.fd     = file.fd();
+                    request.offset = range.offset;
+                    request.dst    = use_arena
+                        ? reader.arena() + (i - begin) * slot_size
+                        : range.bytes.data();
+                    request.size   = size;
+                }
+
+                reader.read(requests);
+                check_complete(requests);
+
+                if (use_arena) {
+                    for (auto i = begin; i < end; ++i) {
+                        auto& bytes = tails[i].bytes;
+                        std::copy_n(requests[i - begin].dst, bytes.size(), bytes.data());
+                    }
+                }
+            }
+
+            return tails;
+        }
+
+        // Reads the central directory of each archive into a further cached range, in a single
+        // batch, unless the directory already lies within the archive's tail. Archives whose
+        // directory cannot be located are skipped; the backend diagnoses them when they are
+        // opened.
+
+        void read_central_directories(
+            std::vector<archive_file>& files, const std::vector<cached_range>& tails,
+            batch_reader& reader) {
+
+            auto ranges   = std::vector<cached_range>(files.size());
+            auto requests = std::vector<read_request>{};
+
+            for (auto i = std::size_t{0}; i < files.size(); ++i) {
+
+                const auto& tail = tails[i];
+                const auto location = impl::zip_format::locate_central_directory(
+                    tail.bytes.data(), tail.bytes.size(), tail.offset);
+
+                if (!location || location->offset >= tail.offset) {
+                    continue;
+                }
+
+                auto& range = ranges[i];
+                range.offset = location->offset;
+                range.bytes.resize(location->size);
+
+                auto& request = requests.emplace_back();
+                request.fd     = files[i].fd();
+                request.offset = range.offset;
+                request.dst    = range.bytes.data();
+                request.size   = range.bytes.size();
+            }
+
+            reader.read(requests);
+            check_complete(requests);
+
+            for (auto i = std::size_t{0}; i < files.size(); ++i) {
+                if (!ranges[i].bytes.empty()) {
+                    files[i].add_cached_range(std::move(ranges[i]));
+                }
+            }
+        }
+
+        auto make_backend(archive_file file, zip_backend backend)
+            -> std::unique_ptr<impl::archive_backend> {
+
+            switch (backend) {
+            case zip_backend::libzip:
+                return std::make_unique<impl::libzip::archive>(
+                    std::make_unique<archive_file>(std::move(file)));
+            case zip_backend::native:
+                return std::make_unique<impl::native::archive>(std::move(file));
+            }
+
+            assert(false);
+            throw error{error_code::internal_error};
         }
     }
 
-    zip_archive::zip_archive(const path& src) {
+    zip_archive::zip_archive(const path& src, const zip_backend backend) {
+
+        switch (backend) {
+        case zip_backend::libzip:
+            _backend = std::make_unique<impl::libzip::archive>(src);
+            break;
+        case zip_backend::native:
+            _backend = std::make_unique<impl::native::archive>(archive_file{src});
+            break;
+        }
 
-        const auto libzip_src = src.string();
+        assert(_backend);
+    }
+
+    zip_archive::zip_archive(std::unique_ptr<impl::archive_backend> backend)
+      : _backend{std::move(backend)} {
+    }
+
+    auto zip_archive::open_all(
+        const std::vector<path>& srcs, const ksr::mut_observer<batch_reader> reader_ref,
+        const zip_backend backend) -> std::vector<zip_archive> {
+
+        auto& reader = reader_ref.get();
+
+        auto files = std::vector<archive_file>{};
+        files.reserve(srcs.size());
+
+        for (const auto& src : srcs) {
+            files.emplace_back(src, &reader);
+        }
 
-        auto error_code = ZIP_ER_OK;
-        _handle = zip_open(libzip_src.c_str(), ZIP_RDONLY, &error_code);
+        auto tails = read_tails(files, reader);
+        read_central_directories(files, tails, reader);
 
-        if (!_handle) {
-            throw_error(error_code);
+        for (auto i = std::size_t{0}; i < files.size(); ++i) {
+            files[i].add_cached_range(std::move(tails[i]));
         }
+
+        auto archives = std::vector<zip_archive>{};
+        archives.reserve(files.size());
+
+        for (auto& file : files) {
+            archives.push_back(zip_archive{make_backend(std::move(file), backend)});
+        }
+
+        return archives;
     }
 
     zip_archive::~zip_archive() {
@@ -38,52 +202,51 @@ namespace anki {
         catch (...) {}
     }
 
+    zip_archive::zip_archive(zip_archive&& rhs) noexcept = default;
+    auto zip_archive::operator=(zip_archive&& rhs) noexcept -> zip_archive& = default;
+
     auto zip_archive::contains_file(const path& file_path) const -> bool {
 
-        const auto handle = handle_cast(_handle);
-        assert(handle);
+        assert(_backend);
+        return _backend->contains_file(file_path);
+    }
 
-        const auto libzip_file = file_path.string();
-        const auto result = zip_name_locate(handle, libzip_file.c_str(), 0);
+    auto zip_archive::open_file(const path& file_path) const -> zip_file {
 
-        // Somewhat strangely, `zip_name_locate()` fails and sets a `ZIP_ER_NOENT` when the file is not
-        // contained within the archive. So we explicitly exclude that case from error detection.
+        assert(_backend);
+        return zip_file{_backend->open_file(file_path, false)};
+    }
 
-        const auto error = zip_get_error(handle);
-        if (error && has_error_excluding(*error, ZIP_ER_NOENT)) {
-            throw_error(*error);
-        }
+    auto zip_archive::open_raw_file(const path& file_path) const -> zip_file {
 
-        return result >= 0;
+        assert(_backend);
+        return zip_file{_backend->open_file(file_path, true)};
     }
 
-    auto zip_archive::open_file(const path& file_path) const -> zip_file {
+    auto zip_archive::stat_file(const path& file_path) const -> zip_entry_info {
 
-        const auto handle = handle_cast(_handle);
-        assert(handle);
+        assert(_backend);
+        return _backend->stat_file(file_path);
+    }
 
-        const auto libzip_file_path = file_path.string();
-        const auto file_handle      = zip_fopen(handle, libzip_file_path.c_str(), 0);
+    auto zip_archive::read_shared(const path& file_path) const -> shared_entry {
 
-        if (!file_handle) {
-            throw_error(*handle);
+        const auto load = [this, &file_path] { return open_file(file_path).read_all(); };
+
+        if (!_cache) {
+            return std::make_shared<const std::vector<std::byte>>(load());
         }
 
-        return zip_file{file_handle};
+        return _cache->get(file_path.string(), load);
     }
 
     void zip_archive::close() {
 
-        const auto handle = handle_cast(_handle);
-        if (!handle) {
+        if (!_backend) {
             return;
         }
 
-        const bool result = zip_close(handle);
-        if (result != 0) {
-            throw_error(*handle);
-        }
-
-        _handle = nullptr;
+        _backend->close();
+        _backend.reset();
     }
 }
@@ -1,24 +1,50 @@
 #ifndef LIBANKI_ZIP_ARCHIVE_HPP
 #define LIBANKI_ZIP_ARCHIVE_HPP
 
+#include "entry_cache.hpp"
 #include "filesystem.hpp"
+#include "zip_backend.hpp"
+#include "zip_entry_info.hpp"
 #include "zip_file.hpp"
 
-#include <utility>
+#include "ksr/ref_annotations.hpp"
+
+#include <memory>
+#include <vector>
 
 namespace anki {
 
+    class batch_reader;
+
+    namespace impl {
+        class archive_backend;
+    }
+
     // Opaque RAII wrapper for performing a limited number of operations upon a zip archive.
     // Serves to encapsulate use of the underlying library and to enforce consistent error handling.
     // Has two states: open and closed. Some operations may only be performed in the open state.
+    //
+    // An archive and the files opened from it may only be used by one thread at a time, even
+    // through `const` members; see `shared_zip_archive` for concurrent use.
 
     class zip_archive {
     public:
 
-        // Opens an archive available from the filesystem path `src`. After construction, the
-        // archive is in an open state. Throws `zip_error` on failure.
+        // Opens an archive available from the filesystem path `src`, using the specified backend.
+        // After construction, the archive is in an open state. Throws `zip_error` on failure.
+
+        explicit zip_archive(const path& src, zip_backend backend = zip_backend::libzip);
 
-        explicit zip_archive(const path& src);
+        // Opens every archive in `srcs`, returning them in the same order, with all file I/O
+        // performed through `reader`. The final bytes of every archive, and then every central
+        // directory, are each fetched in a single batch, so opening many archives costs a handful
+        // of round trips rather than several blocking reads apiece; subsequent reads of entry data
+        // also go through `reader`, which must therefore outlive the returned archives. Throws
+        // `zip_error` if any archive cannot be opened.
+
+        static auto open_all(
+            const std::vector<path>& srcs, ksr::mut_observer<batch_reader> reader,
+            zip_backend backend = zip_backend::libzip) -> std::vector<zip_archive>;
 
         // Performs the action of `close()` but does not propagate exceptions. To correctly handle
         // errors arising from close operations, calling code should explicitly call `close()`; the
@@ -27,13 +53,8 @@ namespace anki {
 
         ~zip_archive();
 
-        zip_archive(zip_archive&& rhs) noexcept
-          : _handle{std::exchange(rhs._handle, nullptr)} {}
-
-        auto operator=(zip_archive&& rhs) noexcept -> zip_archive& {
-            _handle = std::exchange(rhs._handle, nullptr);
-            return *this;
-        }
+        zip_archive(zip_archive&& rhs) noexcept;
+        auto operator=(zip_archive&& rhs) noexcept -> zip_archive&;
 
         zip_archive(const zip_archive&) = delete;
         auto operator=(const zip_archive&) -> zip_archive& = delete;
@@ -44,7 +65,7 @@ namespace anki {
 
         auto contains_file(const path& file_path) const -> bool;
 
-        auto is_open() const -> bool { return _handle != nullptr; }
+        auto is_open() const -> bool { return _backend != nullptr; }
 
         // Opens the specified file within the archive and returns an object that can be used to
         // manage it. The archive must not have been closed; if it is closed before the returned
@@ -53,6 +74,29 @@ namespace anki {
 
         auto open_file(const path& file_path) const -> zip_file;
 
+        // As for `open_file()`, but reads from the returned file yield the entry's data exactly as
+        // stored in the archive, without decompression or CRC verification. Used where the caller
+        // decompresses the data itself; `stat_file()` describes how that data is encoded.
+
+        auto open_raw_file(const path& file_path) const -> zip_file;
+
+        // Returns the central directory record for the specified file within the archive. The
+        // archive must not have been closed. Throws `zip_error` on failure, including when the
+        // archive does not contain the specified file.
+
+        auto stat_file(const path& file_path) const -> zip_entry_info;
+
+        // Attaches `cache` to the archive, or detaches any cache if it is null. The cache may be
+        // shared with other handles to the same archive, but not with other archives.
+
+        void set_cache(std::shared_ptr<entry_cache> cache) { _cache = std::move(cache); }
+
+        // Returns the decompressed contents of the specified file, from the attached cache if it
+        // holds them, and otherwise reading them with `open_file()` (and caching them, if a cache
+        // is attached). The archive must not have been closed. Throws `zip_error` on failure.
+
+        auto read_shared(const path& file_path) const -> shared_entry;
+
         // Closes the archive if it is currently in an open state. May be called to no effect if the
         // archive has already been closed. Throws `zip_error` on failure.
 
@@ -60,9 +104,11 @@ namespace anki {
 
     private:
 
-        void* _handle = nullptr;
+        explicit zip_archive(std::unique_ptr<impl::archive_backend> backend);
+
+        std::unique_ptr<impl::archive_backend> _backend;
+        std::shared_ptr<entry_cache>           _cache;
     };
 }
 
 #endif
-
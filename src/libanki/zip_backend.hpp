@@ -0,0 +1,20 @@
+#ifndef LIBANKI_ZIP_BACKEND_HPP
+#define LIBANKI_ZIP_BACKEND_HPP
+
+namespace anki {
+
+    // Implementations available behind `zip_archive` and `zip_file`, selected when an archive is
+    // opened. Both support the same operations with the same error reporting.
+    //
+    // * `libzip` delegates everything to libzip, which decompresses entries with streaming zlib.
+    // * `native` uses libanki's own read-only parser for the central directory and local headers
+    //   (including zip64 archives), and decompresses each entry whole into a buffer of its final
+    //   size, with libdeflate where available.
+
+    enum class zip_backend {
+        libzip,
+        native,
+    };
+}
+
+#endif
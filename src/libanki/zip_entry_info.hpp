@@ -0,0 +1,29 @@
+#ifndef LIBANKI_ZIP_ENTRY_INFO_HPP
+#define LIBANKI_ZIP_ENTRY_INFO_HPP
+
+#include <cstdint>
+
+namespace anki {
+
+    // Compression methods for zip archive entries, using the numeric identifiers from the zip
+    // specification. Only the methods that libanki can decode are enumerated; other values may
+    // still be held by a `zip_method` object describing an entry that cannot be read.
+
+    enum class zip_method : std::uint16_t {
+        stored   = 0,
+        deflated = 8,
+    };
+
+    // Properties of a single entry within a zip archive, as recorded in the archive's central
+    // directory; see `zip_archive::stat_file()`.
+
+    struct zip_entry_info {
+        zip_method    method          = zip_method::stored;
+        std::uint64_t compressed_size = 0;
+        std::uint64_t size            = 0;
+        std::uint32_t crc             = 0;
+        bool          encrypted       = false;
+    };
+}
+
+#endif
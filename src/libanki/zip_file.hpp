@@ -4,19 +4,25 @@
 #include "filesystem.hpp"
 
 #include <cstddef>
-#include <utility>
+#include <memory>
 #include <vector>
 
 namespace anki {
 
+    class shared_zip_archive;
     class zip_archive;
 
+    namespace impl {
+        class file_backend;
+    }
+
     // RAII wrapper for managing a file opened within a zip archive; see `zip_archive::open_file()`.
     // Has two states: open and closed. When returned from `zip_archive::open_file()`, the object is
     // in an open state. Some operations may only be performed in the open state.
 
     class zip_file {
 
+        friend shared_zip_archive;
         friend zip_archive;
 
     public:
@@ -28,18 +34,20 @@ namespace anki {
 
         ~zip_file();
 
-        zip_file(zip_file&& rhs) noexcept
-          : _handle{std::exchange(rhs._handle, nullptr)} {}
-
-        auto operator=(zip_file&& rhs) noexcept -> zip_file& {
-            _handle = std::exchange(rhs._handle, nullptr);
-            return *this;
-        }
+        zip_file(zip_file&& rhs) noexcept;
+        auto operator=(zip_file&& rhs) noexcept -> zip_file&;
 
         zip_file(const zip_file&) = delete;
         auto operator=(const zip_file&) -> zip_file& = delete;
 
-        auto is_open() const -> bool { return _handle != nullptr; }
+        auto is_open() const -> bool { return _backend != nullptr; }
+
+        // Reads up to `size` bytes from the current position in the file into `dst`, advancing
+        // that position, and returns the number of bytes read. Fewer than `size` bytes are read
+        // only at the end of the file. The file must not have been closed. Throws `zip_error` on
+        // failure.
+
+        auto read(std::byte* dst, std::size_t size) const -> std::size_t;
 
         // Reads the contents of the file into memory and returns the loaded byte data. The file
         // must not have been closed. Throws `zip_error` on failure.
@@ -53,10 +61,9 @@ namespace anki {
 
     private:
 
-        explicit zip_file(void* handle)
-          : _handle{handle} {}
+        explicit zip_file(std::unique_ptr<impl::file_backend> backend);
 
-        void* _handle = nullptr;
+        std::unique_ptr<impl::file_backend> _backend;
     };
 }
 
@@ -0,0 +1,413 @@
+#include "zip_stream_reader.hpp"
+
+#include "error.hpp"
+#include "impl/byte_order.hpp"
+#include "impl/crc32.hpp"
+#include "impl/zip_format.hpp"
+#include "impl/zlib/inflater.hpp"
+
+#include "ksr/narrow_cast.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+using namespace anki::impl::zip_format;
+
+using anki::impl::load_u16;
+using anki::impl::load_u32;
+using anki::impl::load_u64;
+
+namespace anki {
+
+    namespace {
+
+        constexpr auto buffer_size = std::size_t{1} << 16; // Arbitrary; not profiled
+
+        // Decompressed bytes allowed beyond `max_deflate_ratio` times the compressed bytes
+        // consumed, for the framing of a short stream and whatever the decoder holds back.
+
+        constexpr auto inflate_slack = std::uint64_t{4096};
+
+        constexpr auto flag_encrypted       = std::uint16_t{0x0001};
+        constexpr auto flag_data_descriptor = std::uint16_t{0x0008};
+
+        // Reads the zip64 sizes of a local header from its extra fields `[extra, extra + size)`,
+        // into those of `info` that hold the marker value, returning whether there were any.
+
+        auto apply_zip64_extra(zip_entry_info& info, const std::byte* extra, std::size_t size)
+            -> bool {
+
+            while (size >= 4) {
+
+                const auto id        = load_u16(extra);
+                const auto data_size = std::size_t{load_u16(extra + 2)};
+
+                if (data_size > size - 4) {
+                    throw error{error_code::zip_archive_inconsistent};
+                }
+
+                if (id == zip64_extra_id) {
+
+                    // Unlike in the central directory, a local header's zip64 field holds both
+                    // sizes whenever it is present.
+
+                    if (data_size < 16) {
+                        throw error{error_code::zip_archive_inconsistent};
+                    }
+
+                    if (info.size == zip64_marker_32) {
+                        info.size = load_u64(extra + 4);
+                    }
+
+                    if (info.compressed_size == zip64_marker_32) {
+                        info.compressed_size = load_u64(extra + 12);
+                    }
+
+                    return true;
+                }
+
+                extra += 4 + data_size;
+                size  -= 4 + data_size;
+            }
+
+            return false;
+        }
+    }
+
+    zip_stream_reader::zip_stream_reader(const int fd, const bool verify_crc)
+      : _fd{fd}, _verify_crc{verify_crc}, _buffer(buffer_size) {
+    }
+
+    zip_stream_reader::~zip_stream_reader() = default;
+
+    auto zip_stream_reader::next_entry() -> std::optional<zip_stream_entry> {
+
+        if (_done) {
+            return std::nullopt;
+        }
+
+        if (_open) {
+            skip_entry();
+        }
+
+        if (!_started) {
+
+            _started = true;
+            if (available() == 0 && fill() == 0) {
+                _done = true;
+                return std::nullopt;
+            }
+        }
+
+        const auto signature = load_u32(peek(4));
+        if (signature == central_header_signature || signature == eocd_signature
+            || signature == zip64_eocd_signature) {
+
+            _done = true;
+            return std::nullopt;
+        }
+
+        if (signature != local_header_signature) {
+            throw error{error_code::zip_invalid_archive};
+        }
+
+        const auto header = take(local_header_size);
+        const auto flags  = load_u16(header + 6);
+
+        auto entry = zip_stream_entry{};
+        entry.info.method          = static_cast<zip_method>(load_u16(header + 8));
+        entry.info.crc             = load_u32(header + 14);
+        entry.info.compressed_size = load_u32(header + 18);
+        entry.info.size            = load_u32(header + 22);
+        entry.info.encrypted       = (flags & flag_encrypted) != 0;
+        entry.sizes_deferred       = (flags & flag_data_descriptor) != 0;
+
+        const auto name_size  = std::size_t{load_u16(header + 26)};
+        const auto extra_size = std::size_t{load_u16(header + 28)};
+
+        const auto name  = take(name_size + extra_size);
+        const auto extra = name + name_size;
+
+        entry.name.assign(reinterpret_cast<const char*>(name), name_size);
+        _zip64 = apply_zip64_extra(entry.info, extra, extra_size);
+
+        // Data described only by a later descriptor can be delimited only by decoding it.
+
+        if (entry.sizes_deferred) {
+
+            if (entry.info.method != zip_method::deflated || entry.info.encrypted) {
+                throw error{error_code::zip_unsupported_operation};
+            }
+
+            entry.info.crc             = 0;
+            entry.info.compressed_size = 0;
+            entry.info.size            = 0;
+        }
+
+        _entry    = std::move(entry);
+        _open     = true;
+        _consumed = 0;
+        _produced = 0;
+        _crc      = 0;
+
+        if (_entry.info.method == zip_method::deflated) {
+
+            if (_inflater) {
+                _inflater->reset();
+            }
+            else {
+                _inflater = std::make_unique<impl::zlib::inflater>();
+            }
+        }
+
+        return _entry;
+    }
+
+    auto zip_stream_reader::read(std::byte* const dst, const std::size_t size) -> std::size_t {
+
+        if (!_open || size == 0) {
+            return 0;
+        }
+
+        if (_entry.info.encrypted) {
+            throw error{error_code::zip_password_required};
+        }
+
+        switch (_entry.info.method) {
+        case zip_method::stored:   return read_stored(dst, size);
+        case zip_method::deflated: return read_deflated(dst, size);
+        }
+
+        throw error{error_code::zip_unsupported_compression_method};
+    }
+
+    auto zip_stream_reader::fill() -> std::size_t {
+
+        if (_pos == _end) {
+            _pos = _end = 0;
+        }
+        else if (_end == _buffer.size() && _pos > 0) {
+            std::memmove(_buffer.data(), _buffer.data() + _pos, _end - _pos);
+            _end -= _pos;
+            _pos  = 0;
+        }
+
+        if (_end == _buffer.size()) {
+            _buffer.resize(_buffer.size() * 2);
+        }
+
+        for (;;) {
+
+            const auto result = ::read(_fd, _buffer.data() + _end, _buffer.size() - _end);
+            if (result < 0) {
+
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw error{error_code::zip_read_error};
+            }
+
+            _end += static_cast<std::size_t>(result);
+            return static_cast<std::size_t>(result);
+        }
+    }
+
+    auto zip_stream_reader::peek(const std::size_t size) -> const std::byte* {
+
+        while (available() < size) {
+            if (fill() == 0) {
+                throw error{error_code::zip_premature_eof};
+            }
+        }
+
+        return _buffer.data() + _pos;
+    }
+
+    auto zip_stream_reader::take(const std::size_t size) -> const std::byte* {
+
+        const auto taken = peek(size);
+        _pos += size;
+
+        return taken;
+    }
+
+    auto zip_stream_reader::read_stored(std::byte* const dst, const std::size_t size)
+        -> std::size_t {
+
+        const auto remaining = _entry.info.compressed_size - _consumed;
+        if (remaining == 0) {
+            finish_entry();
+            return 0;
+        }
+
+        const auto wanted = ksr::narrow_cast<std::size_t>(std::min<std::uint64_t>(size, remaining));
+        auto size_read = std::min(wanted, available());
+
+        // Data not already buffered is read straight into `dst`, rather than through the buffer.
+
+        if (size_read > 0) {
+            std::memcpy(dst, _buffer.data() + _pos, size_read);
+            _pos += size_read;
+        }
+        else {
+
+            for (;;) {
+
+                const auto result = ::read(_fd, dst, wanted);
+                if (result < 0) {
+
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw error{error_code::zip_read_error};
+                }
+
+                if (result == 0) {
+                    throw error{error_code::zip_premature_eof};
+                }
+
+                size_read = static_cast<std::size_t>(result);
+                break;
+            }
+        }
+
+        if (_verify_crc) {
+            _crc = impl::crc32(_crc, dst, size_read);
+        }
+
+        _consumed += size_read;
+        _produced += size_read;
+
+        return size_read;
+    }
+
+    auto zip_stream_reader::read_deflated(std::byte* const dst, const std::size_t size)
+        -> std::size_t {
+
+        for (;;) {
+
+            // With known sizes the decoder is given no more than the entry's own data, so that a
+            // corrupt stream cannot run on into the next header.
+
+            auto input = available();
+            if (!_entry.sizes_deferred) {
+                input = ksr::narrow_cast<std::size_t>(
+                    std::min<std::uint64_t>(input, _entry.info.compressed_size - _consumed));
+            }
+
+            const auto result = _inflater->inflate(_buffer.data() + _pos, input, dst, size);
+
+            _pos      += result.consumed;
+            _consumed += result.consumed;
+            _produced += result.produced;
+
+            if (_verify_crc) {
+                _crc = impl::crc32(_crc, dst, result.produced);
+            }
+
+            // Without sizes to check against until the data descriptor, the data is bounded by
+            // what deflate could genuinely have produced from it, so that a crafted stream cannot
+            // expand without limit before the descriptor is reached.
+
+            const auto plausible = max_deflate_ratio * _consumed + inflate_slack;
+            if (_entry.sizes_deferred && _produced > plausible) {
+                throw error{error_code::zip_archive_inconsistent};
+            }
+
+            if (result.finished) {
+
+                finish_entry();
+                return result.produced;
+            }
+
+            if (result.produced > 0) {
+                return result.produced;
+            }
+
+            if (result.consumed == 0) {
+
+                const auto exhausted = !_entry.sizes_deferred
+                    && _consumed == _entry.info.compressed_size;
+
+                if (exhausted) {
+                    throw error{error_code::zip_invalid_compressed_data};
+                }
+
+                if (fill() == 0) {
+                    throw error{error_code::zip_premature_eof};
+                }
+            }
+        }
+    }
+
+    void zip_stream_reader::skip_entry() {
+
+        // Undecoded data of known size is discarded as is; anything else must be decoded to find
+        // its end (and is verified on the way).
+
+        if (!_entry.sizes_deferred) {
+
+            auto remaining = _entry.info.compressed_size - _consumed;
+            while (remaining > 0) {
+
+                if (available() == 0 && fill() == 0) {
+                    throw error{error_code::zip_premature_eof};
+                }
+
+                const auto skipped = ksr::narrow_cast<std::size_t>(
+                    std::min<std::uint64_t>(remaining, available()));
+
+                _pos      += skipped;
+                remaining -= skipped;
+            }
+
+            _open = false;
+            return;
+        }
+
+        auto scratch = std::array<std::byte, 16384>{};
+        while (_open) {
+            read(scratch.data(), scratch.size());
+        }
+    }
+
+    void zip_stream_reader::finish_entry() {
+
+        _open = false;
+
+        auto& info = _entry.info;
+
+        if (_entry.sizes_deferred) {
+
+            // The descriptor's signature is optional, so a descriptor begins with either it or
+            // the CRC.
+
+            const auto size_width = _zip64 ? std::size_t{8} : std::size_t{4};
+
+            auto descriptor = take(4);
+            if (load_u32(descriptor) == data_descriptor_signature) {
+                descriptor = take(4);
+            }
+
+            info.crc = load_u32(descriptor);
+
+            const auto sizes = take(2 * size_width);
+            info.compressed_size = _zip64 ? load_u64(sizes) : load_u32(sizes);
+            info.size            = _zip64 ? load_u64(sizes + 8) : load_u32(sizes + 4);
+        }
+
+        if (_consumed != info.compressed_size || _produced != info.size) {
+            throw error{error_code::zip_archive_inconsistent};
+        }
+
+        if (_verify_crc && _crc != info.crc) {
+            throw error{error_code::zip_bad_crc};
+        }
+    }
+}
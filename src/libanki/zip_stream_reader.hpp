@@ -0,0 +1,111 @@
+#ifndef LIBANKI_ZIP_STREAM_READER_HPP
+#define LIBANKI_ZIP_STREAM_READER_HPP
+
+#include "zip_entry_info.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace anki {
+
+    namespace impl::zlib {
+        class inflater;
+    }
+
+    // Local header of an entry met by a `zip_stream_reader`. Where `sizes_deferred` is set, the
+    // entry's CRC and sizes follow its data in a data descriptor, and `info` holds zeros for them.
+
+    struct zip_stream_entry {
+        std::string    name;
+        zip_entry_info info;
+        bool           sizes_deferred = false;
+    };
+
+    // Reader of a zip archive from a file descriptor that need not be seekable, such as a pipe or
+    // socket, walking its local headers (and any data descriptors) in order rather than reading
+    // its central directory, which comes last. Data is decompressed as it arrives, so an entry can
+    // be processed while the rest of the archive is still being received.
+    //
+    // Since the central directory is not read, entries that an archive lists there but not in
+    // sequence before it (as only an unusual writer produces) are not found. A stored entry whose
+    // sizes are deferred cannot be delimited without the central directory, so is rejected.
+    //
+    // The descriptor is not owned, and is read only as far as the central directory. Like
+    // `zip_archive`, a reader may only be used by one thread at a time.
+
+    class zip_stream_reader {
+    public:
+
+        // `verify_crc` may be cleared to skip checksumming decompressed data, as for
+        // `pipeline_options`; sizes are still checked.
+
+        explicit zip_stream_reader(int fd, bool verify_crc = true);
+        ~zip_stream_reader();
+
+        zip_stream_reader(const zip_stream_reader&) = delete;
+        auto operator=(const zip_stream_reader&) -> zip_stream_reader& = delete;
+
+        // Skips whatever remains of the current entry and reads the next local header, returning
+        // it, or `std::nullopt` once the central directory is reached (or at once if the stream
+        // is empty, which like an empty file is an empty archive). Throws `anki::error` if the
+        // stream ends first or is not a zip archive, with `error_code::zip_read_error` if it
+        // cannot be read, or with `error_code::zip_unsupported_operation` for a stored entry with
+        // deferred sizes.
+
+        auto next_entry() -> std::optional<zip_stream_entry>;
+
+        // Reads up to `size` bytes of the current entry's decompressed data into `dst`, returning
+        // the number read, which is 0 only at the end of the entry. Reading the last of an entry
+        // verifies its size and CRC. Throws `anki::error` as `zip_file::read()` does, or if the
+        // stream ends first. An entry with deferred sizes fails with
+        // `error_code::zip_archive_inconsistent` as soon as its data expands by more than deflate
+        // allows (see `impl::zip_format::max_deflate_ratio`).
+
+        auto read(std::byte* dst, std::size_t size) -> std::size_t;
+
+    private:
+
+        // `peek()` and `take()` return the next `size` bytes of the stream, receiving more as
+        // needed; only `take()` consumes them. Either invalidates earlier results of both.
+
+        auto fill() -> std::size_t;
+        auto peek(std::size_t size) -> const std::byte*;
+        auto take(std::size_t size) -> const std::byte*;
+        auto available() const noexcept -> std::size_t { return _end - _pos; }
+
+        auto read_stored(std::byte* dst, std::size_t size) -> std::size_t;
+        auto read_deflated(std::byte* dst, std::size_t size) -> std::size_t;
+        void skip_entry();
+        void finish_entry();
+
+        int  _fd;
+        bool _verify_crc;
+        bool _started = false;
+        bool _done    = false;
+
+        // Bytes received but not yet parsed are `[_pos, _end)` of `_buffer`.
+
+        std::vector<std::byte> _buffer;
+        std::size_t            _pos = 0;
+        std::size_t            _end = 0;
+
+        // State of the current entry: whether data remains to be read, whether its data
+        // descriptor has zip64 sizes, the compressed bytes consumed and decompressed bytes
+        // produced so far, and the running CRC of the latter.
+
+        zip_stream_entry _entry;
+        bool             _open     = false;
+        bool             _zip64    = false;
+        std::uint64_t    _consumed = 0;
+        std::uint64_t    _produced = 0;
+        std::uint32_t    _crc      = 0;
+
+        std::unique_ptr<impl::zlib::inflater> _inflater;
+    };
+}
+
+#endif
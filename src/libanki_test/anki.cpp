@@ -0,0 +1,85 @@
+#include "libanki/anki.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Imports `package` as received through a socket, returning the code of any error thrown.
+    // The package is sent from another thread, which stops sending if the import gives up on it.
+
+    auto import_streamed(const bytes& package, const import_options& options)
+        -> std::optional<error_code> {
+
+        int fds[2];
+        KSR_CHECK(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+
+        auto sender = std::thread{[&package, fd = fds[1]] {
+
+            auto pos = std::size_t{0};
+            while (pos < package.size()) {
+
+                const auto sent = ::send(
+                    fd, package.data() + pos, package.size() - pos, MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    break;
+                }
+
+                pos += static_cast<std::size_t>(sent);
+            }
+
+            ::close(fd);
+        }};
+
+        const auto result = error_of([&fds, &options] { import(fds[0], options); });
+
+        ::close(fds[0]);
+        sender.join();
+
+        return result;
+    }
+}
+
+KSR_TEST(import_streams_entries_with_deferred_sizes) {
+
+    // Zeros deflate about as far as deflate allows, so the collection here is close to the bound
+    // that data with deferred sizes is held to, without passing it.
+
+    const auto package = descriptor_archive({
+        make_entry("collection.anki2", zip_method::deflated, bytes(16 << 20)),
+        make_entry("media", zip_method::deflated, to_bytes("{}")),
+    }, false);
+
+    KSR_CHECK(import_streamed(package, {}) == std::nullopt);
+
+    auto options = import_options{};
+    options.max_entry_size = 16 << 20;
+
+    KSR_CHECK(import_streamed(package, options) == std::nullopt);
+}
+
+KSR_TEST(import_bounds_entries_with_deferred_sizes) {
+
+    const auto package = descriptor_archive({
+        make_entry("collection.anki2", zip_method::deflated, bytes(16 << 20)),
+        make_entry("media", zip_method::deflated, to_bytes("{}")),
+    }, true);
+
+    auto options = import_options{};
+    options.max_entry_size = 1 << 20;
+
+    KSR_CHECK(import_streamed(package, options) == error_code::zip_archive_inconsistent);
+}
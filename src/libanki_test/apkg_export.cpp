@@ -0,0 +1,127 @@
+#include "libanki/apkg_export.hpp"
+#include "libanki/error.hpp"
+#include "libanki/zip_archive.hpp"
+
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Deterministic data that deflates well, but not trivially.
+
+    auto sample_data(const std::size_t size, const unsigned seed) -> bytes {
+
+        auto result = bytes(size);
+        for (auto i = std::size_t{0}; i < size; ++i) {
+            result[i] = static_cast<std::byte>("anki"[i % 4] + (i / 1000 + seed) % 7);
+        }
+
+        return result;
+    }
+
+    auto sample_media() -> std::vector<media_file> {
+
+        auto result = std::vector<media_file>{};
+        for (auto i = 0u; i < 20; ++i) {
+            result.push_back({"file " + std::to_string(i), sample_data(10000 + i * 997, i)});
+        }
+
+        // Already compressed, so stored, and empty.
+
+        result.push_back({"image.png", to_bytes("\x89PNG not really")});
+        result.push_back({"empty", {}});
+
+        return result;
+    }
+
+    // Names of the files in `dir`, which `export_apkg()` should leave no temporary files in.
+
+    auto file_names(const path& dir) -> std::vector<std::string> {
+
+        auto result = std::vector<std::string>{};
+        for (const auto& entry : std::filesystem::directory_iterator{dir}) {
+            result.push_back(entry.path().filename().string());
+        }
+
+        return result;
+    }
+
+    // Checks that the package at `src` holds `collection` and `media` as written.
+
+    void check_package(
+        const path& src, const bytes& collection, const std::vector<media_file>& media) {
+
+        const auto archive = zip_archive{src, zip_backend::native};
+
+        KSR_CHECK(archive.open_file("collection.anki21").read_all() == collection);
+        KSR_CHECK(archive.contains_file("media"));
+
+        for (auto i = std::size_t{0}; i < media.size(); ++i) {
+            KSR_CHECK(archive.open_file(std::to_string(i)).read_all() == media[i].bytes);
+        }
+    }
+}
+
+// Small blocks give the collection more blocks than compression may run ahead of the writer, so
+// that the workers wait for it.
+
+KSR_TEST(export_apkg_round_trips_entries) {
+
+    const auto dir        = scratch_dir{};
+    const auto collection = sample_data(std::size_t{1} << 21, 0);
+    const auto media      = sample_media();
+
+    for (const auto thread_count : {1u, 3u, 0u}) {
+
+        auto options = export_options{};
+        options.thread_count = thread_count;
+        options.block_size   = 4096;
+
+        export_apkg(dir / "out.apkg", apkg_version::anki_2_1, collection, media, options);
+        check_package(dir / "out.apkg", collection, media);
+    }
+}
+
+KSR_TEST(export_apkg_replaces_existing_file) {
+
+    const auto dir        = scratch_dir{};
+    const auto collection = sample_data(100000, 0);
+    const auto media      = sample_media();
+
+    write_file(dir / "out.apkg", to_bytes("old package"));
+    export_apkg(dir / "out.apkg", apkg_version::anki_2_1, collection, media);
+
+    check_package(dir / "out.apkg", collection, media);
+    KSR_CHECK(file_names(dir / "") == std::vector<std::string>{"out.apkg"});
+}
+
+// A directory cannot be replaced by the finished package, so the export fails only once it has
+// been written in full, and must leave the directory and nothing else behind.
+
+KSR_TEST(export_apkg_failure_leaves_destination) {
+
+    const auto dir = scratch_dir{};
+    std::filesystem::create_directory(dir / "out.apkg");
+    write_file(dir / "out.apkg" / "kept", to_bytes("kept"));
+
+    auto threw = false;
+    try {
+        export_apkg(dir / "out.apkg", apkg_version::anki_2_1, sample_data(100000, 0), {});
+    }
+    catch (const error&) {
+        threw = true;
+    }
+
+    KSR_CHECK(threw);
+    KSR_CHECK(read_file(dir / "out.apkg" / "kept") == to_bytes("kept"));
+    KSR_CHECK(file_names(dir / "") == std::vector<std::string>{"out.apkg"});
+}
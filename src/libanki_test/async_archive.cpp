@@ -0,0 +1,304 @@
+#include "libanki/anki.hpp"
+#include "libanki/async_archive.hpp"
+#include "libanki/error.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+#include "test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Fixed set of threads running tasks in the order posted. Tasks still queued on destruction
+    // are run before the threads are joined.
+
+    class thread_pool {
+    public:
+
+        explicit thread_pool(const std::size_t thread_count) {
+            for (auto i = std::size_t{0}; i < thread_count; ++i) {
+                _threads.emplace_back([this] { run(); });
+            }
+        }
+
+        ~thread_pool() {
+
+            {
+                const auto lock = std::lock_guard{_mutex};
+                _stopping = true;
+            }
+
+            _wakeup.notify_all();
+            for (auto& thread : _threads) {
+                thread.join();
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+        auto executor() -> anki::executor {
+            return [this] (std::function<void()> task) { post(std::move(task)); };
+        }
+
+    private:
+
+        void post(std::function<void()> task) {
+
+            {
+                const auto lock = std::lock_guard{_mutex};
+                _tasks.push_back(std::move(task));
+            }
+
+            _wakeup.notify_one();
+        }
+
+        void run() {
+
+            for (;;) {
+
+                auto task = std::function<void()>{};
+
+                {
+                    auto lock = std::unique_lock{_mutex};
+                    _wakeup.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+
+                    if (_tasks.empty()) {
+                        return;
+                    }
+
+                    task = std::move(_tasks.front());
+                    _tasks.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        std::mutex                        _mutex;
+        std::condition_variable           _wakeup;
+        std::deque<std::function<void()>> _tasks;
+        bool                              _stopping = false;
+        std::vector<std::thread>          _threads;
+    };
+
+    // Executors that run each task before returning, counting the tasks posted to each. Handlers
+    // can check `in_completion` to tell whether they were called through `completion`.
+
+    struct inline_executors {
+
+        std::atomic<int> io_tasks         = 0;
+        std::atomic<int> compute_tasks    = 0;
+        std::atomic<int> completion_tasks = 0;
+        bool             in_completion    = false;
+
+        auto executors() -> async_executors {
+
+            auto result = async_executors{};
+            result.io = [this] (std::function<void()> task) {
+                ++io_tasks;
+                task();
+            };
+
+            result.compute = [this] (std::function<void()> task) {
+                ++compute_tasks;
+                task();
+            };
+
+            result.completion = [this] (std::function<void()> task) {
+                ++completion_tasks;
+                in_completion = true;
+                task();
+                in_completion = false;
+            };
+
+            return result;
+        }
+    };
+
+    // Rethrows `ex`, if set, for `error_of()`.
+
+    void rethrow_if(const std::exception_ptr& ex) {
+        if (ex) {
+            std::rethrow_exception(ex);
+        }
+    }
+
+    // Imports `src` with inline executors, checking that the handler is called once, through
+    // `completion`, before `import_async()` returns, and returns the code of its error.
+
+    auto import_inline(const path& src, const import_options& options)
+        -> std::optional<error_code> {
+
+        auto executors = inline_executors{};
+        auto calls     = 0;
+        auto result    = std::optional<error_code>{};
+
+        import_async(src, options, executors.executors(),
+            [&executors, &calls, &result] (std::exception_ptr ex) {
+
+                KSR_CHECK(executors.in_completion);
+                ++calls;
+                result = error_of([&ex] { rethrow_if(ex); });
+            });
+
+        KSR_CHECK(calls == 1);
+        return result;
+    }
+}
+
+KSR_TEST(async_archive_reads_through_executors) {
+
+    const auto dir  = scratch_dir{};
+    const auto data = sample_data(100000);
+
+    write_archive(dir / "package.apkg", {
+        make_entry("collection.anki2", zip_method::deflated, data),
+        make_entry("media", zip_method::stored, to_bytes("{}")),
+    });
+
+    auto executors = inline_executors{};
+    auto archive   = std::optional<async_archive>{};
+
+    async_archive::open(dir / "package.apkg", executors.executors(),
+        [&archive] (std::exception_ptr ex, async_archive opened) {
+            KSR_CHECK(!ex);
+            archive = std::move(opened);
+        });
+
+    KSR_CHECK(archive.has_value());
+    KSR_CHECK(executors.io_tasks == 1);
+    KSR_CHECK(executors.completion_tasks == 1);
+
+    // The version needs only the central directory, so posts nothing but its completion.
+
+    auto version = std::optional<apkg_version>{};
+    archive->apkg_version([&version] (std::exception_ptr ex, std::optional<apkg_version> found) {
+        KSR_CHECK(!ex);
+        version = found;
+    });
+
+    KSR_CHECK(version == apkg_version::anki_2);
+    KSR_CHECK(executors.io_tasks == 1);
+    KSR_CHECK(executors.compute_tasks == 0);
+    KSR_CHECK(executors.completion_tasks == 2);
+
+    auto read = bytes{};
+    archive->read("collection.anki2", [&read] (std::exception_ptr ex, bytes result) {
+        KSR_CHECK(!ex);
+        read = std::move(result);
+    });
+
+    KSR_CHECK(read == data);
+    KSR_CHECK(executors.io_tasks == 2);
+    KSR_CHECK(executors.compute_tasks == 1);
+    KSR_CHECK(executors.completion_tasks == 3);
+
+    // A missing entry fails on `io`, without decompressing anything.
+
+    auto missing = std::optional<error_code>{};
+    archive->read("missing", [&missing] (std::exception_ptr ex, bytes) {
+        missing = error_of([&ex] { rethrow_if(ex); });
+    });
+
+    KSR_CHECK(missing == error_code::zip_file_not_found);
+    KSR_CHECK(executors.compute_tasks == 1);
+    KSR_CHECK(executors.completion_tasks == 4);
+}
+
+KSR_TEST(import_async_with_inline_executors) {
+
+    const auto dir = scratch_dir{};
+
+    write_package(dir / "package.apkg", {test_note{1, "guid", 1, "", "front\x1f" "back"}});
+    write_archive(dir / "media_only.apkg", {
+        make_entry("media", zip_method::stored, to_bytes("{}")),
+    });
+
+    KSR_CHECK(import_inline(dir / "package.apkg", native_options()) == std::nullopt);
+    KSR_CHECK(import_inline(dir / "missing.apkg", native_options())
+        == error_code::zip_file_not_found);
+    KSR_CHECK(import_inline(dir / "media_only.apkg", native_options())
+        == error_code::unsupported_apkg_version);
+}
+
+KSR_TEST(import_async_with_thread_pools) {
+
+    const auto dir = scratch_dir{};
+
+    write_package(dir / "package.apkg", {test_note{1, "guid", 1, "", "front\x1f" "back"}});
+    write_archive(dir / "media_only.apkg", {
+        make_entry("media", zip_method::stored, to_bytes("{}")),
+    });
+
+    auto io         = thread_pool{2};
+    auto compute    = thread_pool{2};
+    auto completion = thread_pool{1};
+
+    const auto executors = async_executors{
+        io.executor(), compute.executor(), completion.executor()};
+
+    // Several imports at once, each completing through its own future.
+
+    auto succeeded   = std::vector<std::future<void>>{};
+    auto missing     = std::vector<std::future<void>>{};
+    auto unsupported = std::vector<std::future<void>>{};
+
+    for (auto i = 0; i < 4; ++i) {
+        succeeded.push_back(import_async(dir / "package.apkg", native_options(), executors));
+        missing.push_back(import_async(dir / "missing.apkg", native_options(), executors));
+        unsupported.push_back(import_async(dir / "media_only.apkg", native_options(), executors));
+    }
+
+    for (auto i = std::size_t{0}; i < succeeded.size(); ++i) {
+        KSR_CHECK(error_of([&] { succeeded[i].get(); }) == std::nullopt);
+        KSR_CHECK(error_of([&] { missing[i].get(); }) == error_code::zip_file_not_found);
+        KSR_CHECK(error_of([&] { unsupported[i].get(); }) == error_code::unsupported_apkg_version);
+    }
+}
+
+KSR_TEST(import_async_libzip_fallback_completes_through_executor) {
+
+    const auto dir = scratch_dir{};
+    write_package(dir / "package.apkg", {test_note{1, "guid", 1, "", "front\x1f" "back"}});
+
+    auto options = import_options{};
+    options.backend = zip_backend::libzip;
+
+    // The whole import runs as one task on `io`. Whatever its outcome (which depends on the
+    // libzip linked), the handler is called once, through `completion`.
+
+    auto executors = inline_executors{};
+    auto calls     = 0;
+
+    import_async(dir / "package.apkg", options, executors.executors(),
+        [&executors, &calls] (std::exception_ptr) {
+            KSR_CHECK(executors.in_completion);
+            ++calls;
+        });
+
+    KSR_CHECK(calls == 1);
+    KSR_CHECK(executors.io_tasks == 1);
+    KSR_CHECK(executors.compute_tasks == 0);
+    KSR_CHECK(executors.completion_tasks == 1);
+
+    // A missing package fails the same way through either backend.
+
+    KSR_CHECK(import_inline(dir / "missing.apkg", options).has_value());
+}
@@ -0,0 +1,170 @@
+#include "libanki/card_renderer.hpp"
+#include "libanki/impl/template_filters.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace anki;
+
+namespace {
+
+    // Both sides of a card rendered from a one-template note type with fields `Front` and
+    // `Back` (or `Text` and `Extra` for a cloze note type).
+
+    struct sides {
+        std::string question;
+        std::string answer;
+    };
+
+    auto render(
+        const std::string& question_format, const std::string& answer_format,
+        const std::string_view fields, const bool cloze = false, const std::size_t ordinal = 0)
+        -> sides {
+
+        auto type = notetype{};
+        type.name   = "Basic";
+        type.cloze  = cloze;
+        type.fields = cloze
+            ? std::vector<std::string>{"Text", "Extra"}
+            : std::vector<std::string>{"Front", "Back"};
+
+        type.templates.push_back({"Card 1", question_format, answer_format});
+
+        auto context = card_context{};
+        context.tags      = " one two ";
+        context.deck_name = "Languages::French";
+
+        auto card = rendered_card{};
+        const auto compiled = compiled_notetype{type};
+        KSR_CHECK(compiled.render(ordinal, fields, context, card));
+
+        return sides{std::string{card.question()}, std::string{card.answer()}};
+    }
+
+    auto render_question(const std::string& format, const std::string_view fields) -> std::string {
+        return render(format, "", fields).question;
+    }
+}
+
+KSR_TEST(template_substitutes_note_and_special_fields) {
+
+    const auto result = render(
+        "{{Front}}|{{ Back }}|{{Type}}|{{Card}}|{{Deck}}|{{Subdeck}}|{{Tags}}",
+        "{{FrontSide}}<hr id=answer>{{Back}}", "front\x1f" "back");
+
+    KSR_CHECK(result.question
+        == "front|back|Basic|Card 1|Languages::French|French|one two");
+    KSR_CHECK(result.answer
+        == "front|back|Basic|Card 1|Languages::French|French|one two<hr id=answer>back");
+}
+
+KSR_TEST(template_sections_test_whether_fields_are_empty) {
+
+    const auto format = std::string{"{{#Back}}has {{Back}}{{/Back}}{{^Back}}no back{{/Back}}"};
+
+    KSR_CHECK(render_question(format, "f\x1f" "b") == "has b");
+    KSR_CHECK(render_question(format, "f\x1f") == "no back");
+    KSR_CHECK(render_question(format, "f\x1f" " <br> <div></div>\n") == "no back");
+    KSR_CHECK(render_question(format, "f\x1f" "<b></b>") == "has <b></b>");
+}
+
+KSR_TEST(template_sections_nest) {
+
+    const auto format = std::string{
+        "{{#Front}}[{{#Back}}both{{/Back}}{{^Back}}front only{{/Back}}]{{/Front}}"};
+
+    KSR_CHECK(render_question(format, "f\x1f" "b") == "[both]");
+    KSR_CHECK(render_question(format, "f\x1f") == "[front only]");
+    KSR_CHECK(render_question(format, "\x1f" "b").empty());
+}
+
+KSR_TEST(template_renders_unknown_fields_as_anki_does) {
+
+    KSR_CHECK(render_question("a{{Missing}}b", "f\x1f" "b") == "a{unknown field Missing}b");
+    KSR_CHECK(render_question("{{text:Missing}}", "f\x1f" "b") == "{unknown field Missing}");
+
+    // Sections on unknown fields test an empty value.
+
+    KSR_CHECK(render_question("{{#Missing}}x{{/Missing}}", "f\x1f" "b").empty());
+    KSR_CHECK(render_question("{{^Missing}}y{{/Missing}}", "f\x1f" "b") == "y");
+}
+
+KSR_TEST(template_applies_filters_and_ignores_unknown_ones) {
+
+    const auto fields = std::string_view{"<b>a</b> &amp; b\x1f" "x"};
+
+    KSR_CHECK(render_question("{{text:Front}}", fields) == "a & b");
+    KSR_CHECK(render_question("{{tts en_US:Front}}", fields) == "<b>a</b> &amp; b");
+    KSR_CHECK(render_question("{{tts en_US:text:Front}}", fields) == "a & b");
+    KSR_CHECK(render_question("{{type:Back}}", fields) == "[[type:Back]]");
+    KSR_CHECK(render_question("{{kanji:Back}}|{{kana:Back}}", "\x1f" "日本[にほん]")
+        == "日本|にほん");
+
+    const auto hint = render_question("{{hint:Back}}", fields);
+    KSR_CHECK(hint.find(">Back</a>") != std::string::npos);
+    KSR_CHECK(hint.find(">x</div>") != std::string::npos);
+    KSR_CHECK(render_question("{{hint:Back}}", "a\x1f").empty());
+}
+
+KSR_TEST(template_renders_cloze_deletions) {
+
+    const auto fields = std::string_view{"a {{c1::one}} b {{c2::two::hint}} {{c1::three}}\x1f" "e"};
+    const auto answer = std::string{"{{cloze:Text}}|{{Extra}}"};
+
+    const auto first = render("{{cloze:Text}}", answer, fields, true, 0);
+    KSR_CHECK(first.question
+        == "a <span class=cloze>[...]</span> b two <span class=cloze>[...]</span>");
+    KSR_CHECK(first.answer
+        == "a <span class=cloze>one</span> b two <span class=cloze>three</span>|e");
+
+    const auto second = render("{{cloze:Text}}", answer, fields, true, 1);
+    KSR_CHECK(second.question == "a one b <span class=cloze>[hint]</span> three");
+    KSR_CHECK(second.answer == "a one b <span class=cloze>two</span> three|e");
+
+    KSR_CHECK(render("{{cloze-only:Text}}", "", fields, true, 0).question == "one, three");
+    KSR_CHECK(render("{{cloze-only:Text}}", "", fields, true, 1).question == "two");
+}
+
+KSR_TEST(template_renders_malformed_tags_leniently) {
+
+    const auto fields = std::string_view{"f\x1f"};
+
+    // Unterminated and empty tags are literal text.
+
+    KSR_CHECK(render_question("a {{Front", fields) == "a {{Front");
+    KSR_CHECK(render_question("a {{}} {{ }} b", fields) == "a {{}} {{ }} b");
+    KSR_CHECK(render_question("{{Front}} }} {{", fields) == "f }} {{");
+
+    // Unmatched section ends are ignored, and unclosed sections end with the template.
+
+    KSR_CHECK(render_question("x{{/Front}}y", fields) == "xy");
+    KSR_CHECK(render_question("{{#Back}}hidden", fields).empty());
+    KSR_CHECK(render_question("{{#Front}}a{{/Back}}b", fields) == "ab");
+    KSR_CHECK(render_question("{{#Back}}a{{/Front}}b", fields).empty());
+}
+
+KSR_TEST(template_render_fails_without_template) {
+
+    auto type = notetype{};
+    type.fields = {"Front", "Back"};
+    type.templates.push_back({"Card 1", "{{Front}}", "{{Back}}"});
+
+    auto card = rendered_card{};
+    const auto compiled = compiled_notetype{type};
+
+    KSR_CHECK(compiled.render(0, "f\x1f" "b", card_context{}, card));
+    KSR_CHECK(!compiled.render(1, "f\x1f" "b", card_context{}, card));
+    KSR_CHECK(card.question().empty() && card.answer().empty());
+}
+
+KSR_TEST(template_filters_field_is_empty) {
+
+    KSR_CHECK(impl::field_is_empty(""));
+    KSR_CHECK(impl::field_is_empty(" \t\n<br><BR/><div> </div><br />"));
+    KSR_CHECK(!impl::field_is_empty("<br>x"));
+    KSR_CHECK(!impl::field_is_empty("<img src=a.png>"));
+    KSR_CHECK(!impl::field_is_empty("&nbsp;"));
+}
@@ -0,0 +1,295 @@
+#include "libanki/collection.hpp"
+#include "libanki/collection_snapshot.hpp"
+#include "libanki/error.hpp"
+
+#include "test_files.hpp"
+#include "test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    auto sample_collection() -> test_collection {
+
+        auto result = test_collection{};
+        result.created = 1'600'000'000;
+
+        result.notetypes_json =
+            R"({"1": {"id": 1, "name": "Basic", "flds": [{"name": "Front"}, {"name": "Back"}]},)"
+            R"( "2": {"id": 2, "name": "Cloze", "type": 1}})";
+        result.decks_json =
+            R"({"1": {"id": 1, "name": "Default", "conf": 1},)"
+            R"( "5": {"id": 5, "name": "Languages", "conf": 1}})";
+        result.deck_configs_json =
+            R"({"1": {"id": 1, "name": "Default", "new": {"delays": [1, 10]}}})";
+
+        result.notes = {
+            {10, "a", 1, " verb french ", "parler\x1f" "to speak"},
+            {20, "b", 2, "",              "{{c1::Paris}} is in France\x1f" ""},
+            {30, "c", 1, " french ",      "chat\x1f" "cat"},
+        };
+
+        result.cards = {
+            {100, 10, 5, 0, 3,  0, 0,    0, 0, 0,    0, 0},
+            {200, 20, 1, 0, 19, 4, 2500, 3, 0, 0,    2, 2},
+            {300, 30, 5, 1, 7,  0, 2500, 1, 1, 1002, 1, 1},
+            {400, 99, 1, 0, 0,  0, 0,    0, 0, 0,    0, 0},
+        };
+
+        result.reviews = {
+            {1'600'000'000'000, 200, 3, 1, 0,  8000, 0},
+            {1'600'086'400'000, 200, 3, 4, 1,  5000, 1},
+            {1'600'086'500'000, 300, 1, 0, -600, 12000, 0},
+        };
+
+        return result;
+    }
+
+    auto same_strings(const snapshot_strings& lhs, const std::vector<std::string_view>& rhs)
+        -> bool {
+
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+
+        for (auto i = std::size_t{0}; i < rhs.size(); ++i) {
+            if (lhs[i] != rhs[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<typename t>
+    auto same_column(const ksr::array_view<t> lhs, const std::vector<t>& rhs) -> bool {
+        return std::vector<t>(lhs.begin(), lhs.end()) == rhs;
+    }
+
+    // Offsets of the snapshot format that the tests below corrupt: the magic number, the table of
+    // sections, and the sections of note IDs and card deck codes within it.
+
+    constexpr auto section_table      = std::size_t{64};
+    constexpr auto section_entry_size = std::size_t{16};
+    constexpr auto note_id_section    = std::size_t{0};
+    constexpr auto card_deck_section  = std::size_t{10};
+
+    auto section_offset(const bytes& snapshot, const std::size_t section) -> std::uint64_t {
+
+        auto offset = std::uint64_t{0};
+        std::memcpy(&offset,
+            snapshot.data() + section_table + section * section_entry_size, sizeof(offset));
+
+        return offset;
+    }
+
+    template<typename t>
+    void store_at(bytes& snapshot, const std::size_t pos, const t value) {
+        std::memcpy(snapshot.data() + pos, &value, sizeof(value));
+    }
+}
+
+KSR_TEST(collection_snapshot_round_trips_columns_and_metadata) {
+
+    const auto dir = scratch_dir{};
+    write_package(dir / "deck.apkg", sample_collection());
+
+    const auto source = collection{dir / "deck.apkg", native_options()};
+    collection_snapshot::save(source, dir / "deck.snapshot");
+
+    const auto snapshot = collection_snapshot::open(dir / "deck.snapshot");
+
+    KSR_CHECK(snapshot.created() == source.created());
+    KSR_CHECK(snapshot.notetypes_json() == source.notetypes_json());
+    KSR_CHECK(snapshot.decks_json() == source.decks_json());
+    KSR_CHECK(snapshot.deck_configs_json() == source.deck_configs_json());
+
+    const auto& expected = source.columns();
+    const auto& notes    = snapshot.notes();
+    const auto& cards    = snapshot.cards();
+
+    KSR_CHECK(notes.size() == 3);
+    KSR_CHECK(same_column(notes.id, expected.notes.id));
+    KSR_CHECK(same_column(notes.notetype, expected.notes.notetype));
+    KSR_CHECK(same_column(notes.modified, expected.notes.modified));
+    KSR_CHECK(same_strings(notes.fields, expected.notes.fields));
+    KSR_CHECK(same_column(notes.tag_offsets, expected.notes.tag_offsets));
+    KSR_CHECK(same_column(notes.tags, expected.notes.tags));
+
+    KSR_CHECK(cards.size() == 4);
+    KSR_CHECK(same_column(cards.id, expected.cards.id));
+    KSR_CHECK(same_column(cards.note_id, expected.cards.note_id));
+    KSR_CHECK(same_column(cards.note, expected.cards.note));
+    KSR_CHECK(same_column(cards.deck, expected.cards.deck));
+    KSR_CHECK(same_column(cards.ordinal, expected.cards.ordinal));
+    KSR_CHECK(same_column(cards.due, expected.cards.due));
+    KSR_CHECK(same_column(cards.interval, expected.cards.interval));
+    KSR_CHECK(same_column(cards.ease_factor, expected.cards.ease_factor));
+    KSR_CHECK(same_column(cards.reps, expected.cards.reps));
+    KSR_CHECK(same_column(cards.lapses, expected.cards.lapses));
+    KSR_CHECK(same_column(cards.left, expected.cards.left));
+    KSR_CHECK(same_column(cards.queue, expected.cards.queue));
+    KSR_CHECK(same_column(cards.type, expected.cards.type));
+
+    KSR_CHECK(same_column(snapshot.deck_ids(), expected.deck_ids));
+    KSR_CHECK(same_strings(snapshot.deck_names(), expected.deck_names));
+    KSR_CHECK(same_column(snapshot.notetype_ids(), expected.notetype_ids));
+    KSR_CHECK(same_strings(snapshot.notetype_names(), expected.notetype_names));
+    KSR_CHECK(snapshot.tags().size() == expected.tags.size());
+
+    const auto& expected_revlog = source.revlog_columns();
+    const auto& revlog          = snapshot.revlog();
+
+    KSR_CHECK(revlog.size() == 3);
+    KSR_CHECK(same_column(revlog.id, expected_revlog.id));
+    KSR_CHECK(same_column(revlog.card_id, expected_revlog.card_id));
+    KSR_CHECK(same_column(revlog.interval, expected_revlog.interval));
+    KSR_CHECK(same_column(revlog.last_interval, expected_revlog.last_interval));
+    KSR_CHECK(same_column(revlog.time, expected_revlog.time));
+    KSR_CHECK(same_column(revlog.ease, expected_revlog.ease));
+    KSR_CHECK(same_column(revlog.type, expected_revlog.type));
+
+    // The copies that `columns()` makes agree with the collection's own, down to the tag names
+    // behind each ID.
+
+    const auto& columns = snapshot.columns();
+    KSR_CHECK(columns.notes.fields == expected.notes.fields);
+    KSR_CHECK(columns.cards.note == expected.cards.note);
+    KSR_CHECK(columns.cards.note[3] == no_row);
+    KSR_CHECK(columns.deck_names == expected.deck_names);
+    KSR_CHECK(columns.tags.size() == expected.tags.size());
+
+    for (auto id = ksr::string_pool::id_type{0}; id < expected.tags.size(); ++id) {
+        KSR_CHECK(columns.tags[id] == expected.tags[id]);
+    }
+
+    KSR_CHECK(snapshot.revlog_columns().interval == expected_revlog.interval);
+
+    KSR_CHECK(snapshot.notetypes().size() == 2);
+    KSR_CHECK(snapshot.decks().size() == 2);
+    KSR_CHECK(snapshot.deck_configs().size() == 1);
+    KSR_CHECK(snapshot.deck_configs()[0].learning_steps == (std::vector<double>{1.0, 10.0}));
+}
+
+KSR_TEST(collection_snapshot_rejects_corrupt_files) {
+
+    const auto dir = scratch_dir{};
+    write_package(dir / "deck.apkg", sample_collection());
+
+    collection_snapshot::save(
+        collection{dir / "deck.apkg", native_options()}, dir / "deck.snapshot");
+
+    const auto good = read_file(dir / "deck.snapshot");
+
+    const auto open_error = [&dir] (const bytes& snapshot) {
+
+        write_file(dir / "bad.snapshot", snapshot);
+        return error_of([&dir] { collection_snapshot::open(dir / "bad.snapshot"); });
+    };
+
+    KSR_CHECK(open_error(good) == std::nullopt);
+
+    // Truncated anywhere, a snapshot no longer matches the size in its header.
+
+    for (const auto size : {std::size_t{0}, std::size_t{10}, std::size_t{100}, good.size() - 1}) {
+        KSR_CHECK(open_error(bytes(good.begin(), good.begin() + size))
+            == error_code::invalid_snapshot);
+    }
+
+    auto bad_magic = good;
+    bad_magic[0] ^= std::byte{1};
+    KSR_CHECK(open_error(bad_magic) == error_code::invalid_snapshot);
+
+    // A section entry may place its section beyond the file, or misalign it.
+
+    const auto entry = section_table + note_id_section * section_entry_size;
+
+    auto past_end = good;
+    store_at(past_end, entry, static_cast<std::uint64_t>(good.size()));
+    KSR_CHECK(open_error(past_end) == error_code::invalid_snapshot);
+
+    auto oversized = good;
+    store_at(oversized, entry + 8, static_cast<std::uint64_t>(good.size()));
+    KSR_CHECK(open_error(oversized) == error_code::invalid_snapshot);
+
+    auto misaligned = good;
+    store_at(misaligned, entry, section_offset(good, note_id_section) + 4);
+    KSR_CHECK(open_error(misaligned) == error_code::invalid_snapshot);
+
+    // Codes and IDs are only checked as the columns are loaded from the snapshot.
+
+    const auto columns_error = [&dir] (const bytes& snapshot) {
+
+        write_file(dir / "bad.snapshot", snapshot);
+        const auto opened = collection_snapshot::open(dir / "bad.snapshot");
+
+        return error_of([&opened] { opened.columns(); });
+    };
+
+    KSR_CHECK(columns_error(good) == std::nullopt);
+
+    auto bad_deck = good;
+    store_at(bad_deck, section_offset(good, card_deck_section), std::uint32_t{1000});
+    KSR_CHECK(columns_error(bad_deck) == error_code::invalid_snapshot);
+
+    auto unordered = good;
+    store_at(unordered, section_offset(good, note_id_section), std::int64_t{25});
+    KSR_CHECK(columns_error(unordered) == error_code::invalid_snapshot);
+}
+
+KSR_TEST(collection_snapshot_rebuilds_stale_snapshots) {
+
+    const auto dir      = scratch_dir{};
+    const auto package  = dir / "deck.apkg";
+    const auto snapshot = dir / "deck.snapshot";
+
+    auto contents = sample_collection();
+    write_package(package, contents);
+
+    KSR_CHECK(collection_snapshot::open_or_create(package, snapshot, native_options())
+        .notes().size() == 3);
+
+    // A snapshot is judged up to date by the package's size and modification time alone. A
+    // database grows by whole pages, so a note edited slightly leaves the package's size as it
+    // was, and with its modification time restored the snapshot is kept.
+
+    const auto size  = std::filesystem::file_size(package);
+    const auto mtime = std::filesystem::last_write_time(package);
+
+    contents.notes.back().fields = "chien\x1f" "cow";
+    write_package(package, contents);
+    std::filesystem::last_write_time(package, mtime);
+
+    KSR_CHECK(std::filesystem::file_size(package) == size);
+
+    const auto kept = collection_snapshot::open_or_create(package, snapshot, native_options());
+    KSR_CHECK(kept.notes().fields[2] == "chat\x1f" "cat");
+
+    // Once the package's modification time changes, the snapshot is rebuilt from it.
+
+    std::filesystem::last_write_time(package, mtime + std::chrono::seconds{1});
+
+    const auto rebuilt = collection_snapshot::open_or_create(package, snapshot, native_options());
+    KSR_CHECK(rebuilt.notes().size() == 3);
+    KSR_CHECK(rebuilt.notes().fields[2] == "chien\x1f" "cow");
+
+    // A snapshot that is not one at all is replaced too.
+
+    write_file(snapshot, to_bytes("not a snapshot"));
+
+    const auto replaced = collection_snapshot::open_or_create(package, snapshot, native_options());
+    KSR_CHECK(replaced.notes().fields[2] == "chien\x1f" "cow");
+}
@@ -0,0 +1,146 @@
+#include "libanki/impl/crc32.hpp"
+
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Bit-at-a-time CRC-32 over the reflected zip polynomial, slow enough to be obviously right.
+
+    auto reference_crc32(std::uint32_t crc, const std::byte* const data, const std::size_t size)
+        -> std::uint32_t {
+
+        crc = ~crc;
+
+        for (auto i = std::size_t{0}; i < size; ++i) {
+
+            crc ^= std::to_integer<std::uint32_t>(data[i]);
+            for (auto bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+            }
+        }
+
+        return ~crc;
+    }
+
+    // Bytes with no short period, so that a kernel folding the wrong blocks together cannot
+    // happen on the right answer.
+
+    auto noise(const std::size_t size) -> bytes {
+
+        auto result = bytes(size);
+        auto state  = std::uint32_t{0x12345678};
+
+        for (auto& byte : result) {
+            state = state * 1664525u + 1013904223u;
+            byte  = static_cast<std::byte>(state >> 24);
+        }
+
+        return result;
+    }
+
+    auto supported_kernels() -> std::vector<impl::crc32_kernel> {
+
+        auto kernels = std::vector<impl::crc32_kernel>{};
+        for (const auto kernel : {impl::crc32_kernel::scalar, impl::crc32_kernel::pclmul}) {
+            if (impl::crc32_kernel_supported(kernel)) {
+                kernels.push_back(kernel);
+            }
+        }
+
+        return kernels;
+    }
+}
+
+KSR_TEST(crc32_matches_known_value) {
+
+    const auto data = to_bytes("123456789");
+
+    KSR_CHECK(impl::crc32(0, data.data(), data.size()) == 0xcbf43926);
+    KSR_CHECK(reference_crc32(0, data.data(), data.size()) == 0xcbf43926);
+    KSR_CHECK(impl::crc32(0, nullptr, 0) == 0);
+}
+
+KSR_TEST(crc32_kernels_match_reference) {
+
+    const auto data = noise(70000);
+
+    auto sizes = std::vector<std::size_t>{};
+    for (auto size = std::size_t{0}; size <= 300; ++size) {
+        sizes.push_back(size);
+    }
+
+    for (const auto size : {1023, 1024, 4096, 4111, 16383, 65536}) {
+        sizes.push_back(static_cast<std::size_t>(size));
+    }
+
+    for (const auto kernel : supported_kernels()) {
+        for (const auto offset : {0, 1, 3, 8, 15}) {
+            for (const auto size : sizes) {
+
+                const auto src      = data.data() + offset;
+                const auto expected = reference_crc32(0x5a5a5a5a, src, size);
+                const auto actual   = impl::crc32(kernel, 0x5a5a5a5a, src, size);
+
+                const auto description = "kernel " + std::to_string(static_cast<int>(kernel))
+                    + " matches reference over " + std::to_string(size) + " bytes at offset "
+                    + std::to_string(offset);
+
+                ksr_test::check(actual == expected, description.c_str(), __FILE__, __LINE__);
+            }
+        }
+    }
+}
+
+KSR_TEST(crc32_kernels_continue_split_updates) {
+
+    const auto data     = noise(5000);
+    const auto expected = reference_crc32(0, data.data(), data.size());
+
+    for (const auto kernel : supported_kernels()) {
+        for (const auto split : {1, 15, 63, 64, 65, 200, 1000, 4095, 4999}) {
+
+            auto crc = impl::crc32(kernel, 0, data.data(), static_cast<std::size_t>(split));
+            crc = impl::crc32(kernel, crc, data.data() + split, data.size() - split);
+
+            const auto description = "kernel " + std::to_string(static_cast<int>(kernel))
+                + " continues an update split at " + std::to_string(split);
+
+            ksr_test::check(crc == expected, description.c_str(), __FILE__, __LINE__);
+        }
+
+        // Uneven pieces, each continuing from the last.
+
+        auto crc = std::uint32_t{0};
+        auto pos = std::size_t{0};
+
+        for (auto piece = std::size_t{1}; pos < data.size(); piece = piece * 3 % 257 + 1) {
+
+            const auto size = std::min(piece, data.size() - pos);
+            crc = impl::crc32(kernel, crc, data.data() + pos, size);
+            pos += size;
+        }
+
+        KSR_CHECK(crc == expected);
+    }
+}
+
+KSR_TEST(crc32_combine_joins_checksums) {
+
+    const auto data = noise(3000);
+    const auto crc1 = impl::crc32(0, data.data(), 1234);
+    const auto crc2 = impl::crc32(0, data.data() + 1234, data.size() - 1234);
+
+    KSR_CHECK(impl::crc32_combine(crc1, crc2, data.size() - 1234)
+        == reference_crc32(0, data.data(), data.size()));
+}
@@ -0,0 +1,220 @@
+#include "libanki/entry_cache.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace anki;
+
+namespace {
+
+    // Runs `body(i)` on each of `count` threads, released together so that they contend.
+
+    template<typename function>
+    void run_together(const int count, const function& body) {
+
+        auto go      = std::atomic<bool>{false};
+        auto threads = std::vector<std::thread>{};
+
+        for (auto i = 0; i < count; ++i) {
+            threads.emplace_back([&go, &body, i] {
+
+                while (!go) {
+                    std::this_thread::yield();
+                }
+
+                body(i);
+            });
+        }
+
+        go = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+KSR_TEST(entry_cache_loads_concurrent_misses_once) {
+
+    auto cache = entry_cache{1 << 20};
+    auto loads = std::atomic<int>{0};
+
+    constexpr auto thread_count = 8;
+    auto results = std::vector<shared_entry>(thread_count);
+
+    run_together(thread_count, [&cache, &loads, &results] (const int i) {
+
+        results[i] = cache.get("entry", [&loads] {
+
+            ++loads;
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+            return std::vector<std::byte>(100, std::byte{7});
+        });
+    });
+
+    KSR_CHECK(loads == 1);
+
+    for (const auto& result : results) {
+        KSR_CHECK(result == results.front());
+        KSR_CHECK(result->size() == 100);
+    }
+
+    const auto stats = cache.stats();
+    KSR_CHECK(stats.misses == 1);
+    KSR_CHECK(stats.hits == thread_count - 1);
+    KSR_CHECK(stats.size == 100);
+    KSR_CHECK(stats.entry_count == 1);
+}
+
+KSR_TEST(entry_cache_evicts_by_clock_within_budget) {
+
+    auto cache = entry_cache{1000};
+    auto loads = 0;
+
+    const auto get = [&cache, &loads] (const std::string& name, const std::size_t size) {
+        return cache.get(name, [&loads, size] {
+            ++loads;
+            return std::vector<std::byte>(size);
+        });
+    };
+
+    get("a", 400);
+    get("b", 400);
+    get("a", 400);
+
+    KSR_CHECK(loads == 2);
+
+    // The hit on `a` gives it a second chance, so `c` displaces `b`, clearing `a`'s bit on the
+    // way; `b` then displaces `a`.
+
+    get("c", 400);
+    KSR_CHECK(loads == 3);
+    KSR_CHECK(cache.stats().evictions == 1);
+
+    get("b", 400);
+    KSR_CHECK(loads == 4);
+
+    get("c", 400);
+    KSR_CHECK(loads == 4);
+
+    auto stats = cache.stats();
+    KSR_CHECK(stats.hits == 2);
+    KSR_CHECK(stats.misses == 4);
+    KSR_CHECK(stats.evictions == 2);
+    KSR_CHECK(stats.size == 800);
+    KSR_CHECK(stats.entry_count == 2);
+
+    // An entry larger than the whole budget is returned but not cached, and evicts nothing.
+
+    KSR_CHECK(get("big", 1001)->size() == 1001);
+    KSR_CHECK(get("big", 1001)->size() == 1001);
+    KSR_CHECK(loads == 6);
+
+    stats = cache.stats();
+    KSR_CHECK(stats.misses == 6);
+    KSR_CHECK(stats.evictions == 2);
+    KSR_CHECK(stats.size == 800);
+
+    cache.clear();
+
+    stats = cache.stats();
+    KSR_CHECK(stats.evictions == 4);
+    KSR_CHECK(stats.size == 0);
+    KSR_CHECK(stats.entry_count == 0);
+}
+
+KSR_TEST(entry_cache_stays_within_budget_under_load) {
+
+    constexpr auto budget       = std::size_t{10000};
+    constexpr auto thread_count = 4;
+    constexpr auto rounds       = 2000;
+
+    auto cache       = entry_cache{budget};
+    auto over_budget = std::atomic<bool>{false};
+    auto wrong_data  = std::atomic<bool>{false};
+
+    run_together(thread_count, [&] (const int thread) {
+
+        for (auto round = 0; round < rounds; ++round) {
+
+            // Entries of many sizes, some named far more often than others.
+
+            const auto key  = (round * 7 + thread * 13) % (round % 3 == 0 ? 5 : 40);
+            const auto size = static_cast<std::size_t>(100 + key * 97);
+
+            const auto data = cache.get(std::to_string(key), [size] {
+                return std::vector<std::byte>(size, static_cast<std::byte>(size));
+            });
+
+            if (data->size() != size || data->front() != static_cast<std::byte>(size)) {
+                wrong_data = true;
+            }
+
+            if (cache.stats().size > budget) {
+                over_budget = true;
+            }
+        }
+    });
+
+    KSR_CHECK(!over_budget);
+    KSR_CHECK(!wrong_data);
+
+    const auto stats = cache.stats();
+    KSR_CHECK(stats.hits + stats.misses == thread_count * rounds);
+    KSR_CHECK(stats.evictions > 0);
+    KSR_CHECK(stats.size <= budget);
+}
+
+KSR_TEST(entry_cache_releases_failed_load) {
+
+    auto cache = entry_cache{1 << 20};
+    auto loads = std::atomic<int>{0};
+    auto fails = std::atomic<int>{0};
+
+    // Every caller sees the failure, whether it made the load or waited for it.
+
+    run_together(4, [&cache, &loads, &fails] (int) {
+
+        try {
+            cache.get("entry", [&loads] () -> std::vector<std::byte> {
+
+                ++loads;
+                std::this_thread::sleep_for(std::chrono::milliseconds{20});
+
+                throw std::runtime_error{"load failed"};
+            });
+        }
+        catch (const std::runtime_error&) {
+            ++fails;
+        }
+    });
+
+    KSR_CHECK(fails == 4);
+    KSR_CHECK(loads >= 1);
+
+    auto stats = cache.stats();
+    KSR_CHECK(stats.size == 0);
+    KSR_CHECK(stats.entry_count == 0);
+
+    // The entry is then loaded afresh, and cached.
+
+    const auto loaded = cache.get("entry", [] { return std::vector<std::byte>(10); });
+    KSR_CHECK(loaded->size() == 10);
+
+    const auto cached = cache.get("entry", [] () -> std::vector<std::byte> {
+        throw std::runtime_error{"not cached"};
+    });
+
+    KSR_CHECK(cached == loaded);
+
+    stats = cache.stats();
+    KSR_CHECK(stats.size == 10);
+    KSR_CHECK(stats.entry_count == 1);
+}
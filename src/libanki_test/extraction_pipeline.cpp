@@ -0,0 +1,247 @@
+#include "libanki/error.hpp"
+#include "libanki/extraction_pipeline.hpp"
+#include "libanki/zip_archive.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Small buffers, so that every entry here takes several of each, and the stages must wait on
+    // one another.
+
+    auto small_buffers() -> pipeline_options {
+
+        auto result = pipeline_options{};
+        result.read_buffer_size    = 1000;
+        result.inflate_buffer_size = 4096;
+        result.buffer_count        = 2;
+
+        return result;
+    }
+}
+
+KSR_TEST(extract_pipelined_reads_entries_across_buffer_boundaries) {
+
+    const auto dir     = scratch_dir{};
+    const auto options = small_buffers();
+
+    // Sizes at and either side of multiples of both buffer sizes, and larger than every buffer of
+    // both links together.
+
+    auto entries = std::vector<test_entry>{};
+    for (const auto size : {std::size_t{0}, std::size_t{1}, std::size_t{999}, std::size_t{1000},
+             std::size_t{1001}, std::size_t{2000}, std::size_t{4095}, std::size_t{4096},
+             std::size_t{4097}, std::size_t{8192}, std::size_t{8193}, std::size_t{100000}}) {
+
+        for (const auto method : {zip_method::stored, zip_method::deflated}) {
+
+            const auto name = std::to_string(size)
+                + (method == zip_method::stored ? ".stored" : ".deflated");
+            entries.push_back(make_entry(name, method, sample_data(size)));
+        }
+    }
+
+    write_archive(dir / "sizes.zip", entries);
+    const auto archive = zip_archive{dir / "sizes.zip", zip_backend::native};
+
+    for (const auto& entry : entries) {
+
+        auto blocks_fit = true;
+        auto data       = bytes{};
+
+        extract_pipelined(archive, entry.name, [&] (const std::byte* src, std::size_t size) {
+            blocks_fit = blocks_fit && size > 0 && size <= options.inflate_buffer_size;
+            data.insert(data.end(), src, src + size);
+        }, options);
+
+        ksr_test::check(data == entry.data, entry.name.c_str(), __FILE__, __LINE__);
+        KSR_CHECK(blocks_fit);
+        KSR_CHECK(read_all_pipelined(archive, entry.name, options) == entry.data);
+    }
+
+    // Compressed data of exactly one read buffer ends with an empty block, and of one byte more
+    // with a block of one byte.
+
+    for (const auto& entry : entries) {
+
+        if (entry.info.method != zip_method::deflated) {
+            continue;
+        }
+
+        for (const auto size : {entry.stored.size() - 1, entry.stored.size(),
+                 entry.stored.size() + 1}) {
+
+            auto sized = options;
+            sized.read_buffer_size = std::max<std::size_t>(size, 1);
+
+            ksr_test::check(read_all_pipelined(archive, entry.name, sized) == entry.data,
+                entry.name.c_str(), __FILE__, __LINE__);
+        }
+    }
+}
+
+KSR_TEST(extract_pipelined_rethrows_consumer_errors) {
+
+    const auto dir  = scratch_dir{};
+    const auto data = sample_data(200000);
+
+    write_archive(dir / "data.zip", {
+        make_entry("stored", zip_method::stored, data),
+        make_entry("deflated", zip_method::deflated, data),
+    });
+
+    const auto archive = zip_archive{dir / "data.zip", zip_backend::native};
+
+    for (const auto name : {"stored", "deflated"}) {
+
+        // The consumer fails part way through, while the other stages are blocked waiting for it
+        // to recycle a block. They must be stopped and joined before the error is rethrown.
+
+        auto calls  = 0;
+        auto caught = std::string{};
+
+        try {
+            extract_pipelined(archive, name, [&calls] (const std::byte*, std::size_t) {
+                if (++calls == 3) {
+                    throw std::runtime_error{"consumer failed"};
+                }
+            }, small_buffers());
+        }
+        catch (const std::runtime_error& ex) {
+            caught = ex.what();
+        }
+
+        KSR_CHECK(caught == "consumer failed");
+        KSR_CHECK(calls == 3);
+
+        // The archive is left usable.
+
+        KSR_CHECK(read_all_pipelined(archive, name, small_buffers()) == data);
+    }
+}
+
+KSR_TEST(extract_pipelined_rejects_damaged_entries) {
+
+    const auto dir  = scratch_dir{};
+    const auto data = sample_data(100000);
+
+    auto entries = std::vector<test_entry>{
+        make_entry("stored_crc", zip_method::stored, data),
+        make_entry("deflated_crc", zip_method::deflated, data),
+        make_entry("stored_long", zip_method::stored, data),
+        make_entry("deflated_long", zip_method::deflated, data),
+        make_entry("deflated_short", zip_method::deflated, data),
+    };
+
+    entries[0].info.crc ^= 1;
+    entries[1].info.crc ^= 1;
+
+    // Data longer than its recorded size, by far in the deflated case, as in a decompression
+    // bomb; and data shorter than its recorded size.
+
+    entries[2].info.size -= 1;
+    entries[3].info.size  = 10;
+    entries[4].info.size += 1;
+
+    write_archive(dir / "damaged.zip", entries);
+    const auto archive = zip_archive{dir / "damaged.zip", zip_backend::native};
+
+    auto options = small_buffers();
+
+    const auto extract_error = [&archive, &options] (const char* name) {
+        return error_of([&archive, &options, name] { read_all_pipelined(archive, name, options); });
+    };
+
+    KSR_CHECK(extract_error("stored_crc") == error_code::zip_bad_crc);
+    KSR_CHECK(extract_error("deflated_crc") == error_code::zip_bad_crc);
+    KSR_CHECK(extract_error("deflated_short") == error_code::zip_archive_inconsistent);
+
+    // Overlong data is rejected before any more than the recorded size reaches the consumer.
+
+    for (const auto& entry : {entries[2], entries[3]}) {
+
+        auto consumed = std::size_t{0};
+
+        const auto consume = [&consumed] (const std::byte*, std::size_t size) {
+            consumed += size;
+        };
+
+        const auto code = error_of([&] {
+            extract_pipelined(archive, entry.name, consume, options);
+        });
+
+        ksr_test::check(code == error_code::zip_archive_inconsistent, entry.name.c_str(),
+            __FILE__, __LINE__);
+        KSR_CHECK(consumed <= entry.info.size);
+    }
+
+    // Without checksums, a bad CRC goes unnoticed, but sizes are still checked.
+
+    options.verify_crc = false;
+    KSR_CHECK(read_all_pipelined(archive, "stored_crc", options) == data);
+    KSR_CHECK(read_all_pipelined(archive, "deflated_crc", options) == data);
+    KSR_CHECK(extract_error("deflated_long") == error_code::zip_archive_inconsistent);
+}
+
+KSR_TEST(extract_pipelined_reuses_resources_on_one_thread) {
+
+    const auto dir  = scratch_dir{};
+    const auto data = sample_data(50000);
+
+    write_archive(dir / "data.zip", {
+        make_entry("stored", zip_method::stored, data),
+        make_entry("deflated", zip_method::deflated, data),
+    });
+
+    const auto archive = zip_archive{dir / "data.zip", zip_backend::native};
+
+    auto options = small_buffers();
+    options.reuse_resources = true;
+
+    // Blocks are handed to the consumer in place, so a pipeline that reuses its predecessor's
+    // buffers passes only pointers that the predecessor passed too.
+
+    const auto extract = [&archive, &options, &data] (const char* name) {
+
+        auto blocks = std::set<const std::byte*>{};
+        auto result = bytes{};
+
+        extract_pipelined(archive, name, [&] (const std::byte* src, std::size_t size) {
+            blocks.insert(src);
+            result.insert(result.end(), src, src + size);
+        }, options);
+
+        KSR_CHECK(result == data);
+        return blocks;
+    };
+
+    for (const auto name : {"stored", "deflated"}) {
+
+        const auto first  = extract(name);
+        const auto second = extract(name);
+
+        KSR_CHECK(std::includes(first.begin(), first.end(), second.begin(), second.end()));
+    }
+
+    // Extracting a stored entry leaves the decoder of a deflated one in place, reset for reuse.
+
+    const auto deflated = extract("deflated");
+    extract("stored");
+    const auto again = extract("deflated");
+
+    KSR_CHECK(std::includes(deflated.begin(), deflated.end(), again.begin(), again.end()));
+}
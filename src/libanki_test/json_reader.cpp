@@ -0,0 +1,277 @@
+#include "libanki/error.hpp"
+#include "libanki/impl/json_reader.hpp"
+
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Reads every value of the document in `reader`, as a caller wanting all of it would.
+
+    void read_all(impl::json_reader& reader) {
+
+        switch (reader.peek()) {
+        case impl::json_type::object:
+
+            reader.begin_object();
+            while (reader.next_member()) {
+                read_all(reader);
+            }
+
+            break;
+
+        case impl::json_type::array:
+
+            reader.begin_array();
+            while (reader.next_element()) {
+                read_all(reader);
+            }
+
+            break;
+
+        case impl::json_type::string:  reader.read_string(); break;
+        case impl::json_type::number:  reader.read_double(); break;
+        case impl::json_type::boolean: reader.read_bool();   break;
+        case impl::json_type::null:    reader.skip();        break;
+        }
+    }
+
+    // Returns the code of the `anki::error` thrown by reading the whole of `json`, by reading
+    // every value if `skip` is false, or by skipping the top-level value if true. Any other
+    // exception escapes, failing the test.
+
+    auto read_error(const std::string_view json, const bool skip) -> std::optional<error_code> {
+
+        return error_of([json, skip] {
+
+            auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+            if (skip) {
+                reader.skip();
+            }
+            else {
+                read_all(reader);
+            }
+
+            reader.finish();
+        });
+    }
+
+    auto read_string(const std::string_view json) -> std::string {
+
+        auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+        auto result = reader.read_string();
+
+        reader.finish();
+        return result;
+    }
+}
+
+KSR_TEST(json_reader_decodes_escapes) {
+
+    KSR_CHECK(read_string(R"("plain")") == "plain");
+    KSR_CHECK(read_string(R"("\"\\\/\b\f\n\r\t")") == "\"\\/\b\f\n\r\t");
+    KSR_CHECK(read_string(R"("\u0041\u00e9\u20AC")") == "A\xc3\xa9\xe2\x82\xac");
+    KSR_CHECK(read_string(R"("\u0000")") == std::string(1, '\0'));
+
+    // Characters outside the basic multilingual plane, as surrogate pairs.
+
+    KSR_CHECK(read_string(R"("\ud83d\ude00")") == "\xf0\x9f\x98\x80");
+    KSR_CHECK(read_string(R"("a\ud800\udc00b")") == "a\xf0\x90\x80\x80" "b");
+    KSR_CHECK(read_string(R"("\udbff\udfff")") == "\xf4\x8f\xbf\xbf");
+
+    // Escapes either side of where the vectorised scan moves on to the next 16 bytes.
+
+    for (auto prefix = std::size_t{0}; prefix <= 40; ++prefix) {
+
+        const auto plain = std::string(prefix, 'x');
+        KSR_CHECK(read_string("\"" + plain + R"(\u00e9\n)" + plain + "\"")
+            == plain + "\xc3\xa9\n" + plain);
+    }
+
+    // Keys with escapes are decoded too.
+
+    auto reader = impl::json_reader{
+        R"({"k\u00e9y": 1, "\uD83D\uDE00": 2})", error_code::invalid_snapshot};
+    reader.begin_object();
+
+    KSR_CHECK(reader.next_member() == "k\xc3\xa9y");
+    KSR_CHECK(reader.read_int64() == 1);
+    KSR_CHECK(reader.next_member() == "\xf0\x9f\x98\x80");
+    KSR_CHECK(reader.read_int64() == 2);
+    KSR_CHECK(reader.next_member() == std::nullopt);
+
+    reader.finish();
+}
+
+KSR_TEST(json_reader_rejects_bad_escapes) {
+
+    const std::string_view bad[] = {
+        R"("\x")",
+        R"("\u12")",
+        R"("\u12g4")",
+        R"("\ud83d")",
+        R"("\ud83dx")",
+        R"("\ud83d\n")",
+        R"("\ud83d\u0041")",
+        R"("\ude00")",
+        R"("\ude00\ud83d")",
+    };
+
+    for (const auto json : bad) {
+
+        ksr_test::check(read_error(json, false) == error_code::invalid_snapshot,
+            std::string{json}.c_str(), __FILE__, __LINE__);
+    }
+
+    // Skipping a string steps over escapes without decoding them.
+
+    KSR_CHECK(read_error(R"("\ude00\"")", true) == std::nullopt);
+}
+
+KSR_TEST(json_reader_skips_nested_members) {
+
+    const auto json = std::string_view{R"({
+        "unknown": {"a": [1, -2.5e3, {"b": "]}\"{["}, [], {}], "c": null, "d": [true, false]},
+        "wanted": "yes",
+        "also unknown": [[["deep"]]],
+        "number": 12
+    })"};
+
+    auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+    reader.begin_object();
+
+    auto wanted = std::string{};
+    auto number = std::int64_t{0};
+
+    while (const auto key = reader.next_member()) {
+
+        if (*key == "wanted") {
+            wanted = reader.read_string();
+        }
+        else if (*key == "number") {
+            number = reader.read_int64();
+        }
+        else {
+            reader.skip();
+        }
+    }
+
+    reader.finish();
+
+    KSR_CHECK(wanted == "yes");
+    KSR_CHECK(number == 12);
+
+    // Skipping checks that brackets balance, but nothing more.
+
+    KSR_CHECK(read_error(R"({"a": [1}, "b": 2})", true) == error_code::invalid_snapshot);
+    KSR_CHECK(read_error(R"([{]})", true) == error_code::invalid_snapshot);
+    KSR_CHECK(read_error(R"([1 2 : 3])", true) == std::nullopt);
+}
+
+KSR_TEST(json_reader_reads_numbers_and_flags) {
+
+    using limits = std::numeric_limits<std::int64_t>;
+
+    const auto int64 = [] (const std::string_view json) {
+
+        auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+        return reader.read_int64();
+    };
+
+    KSR_CHECK(int64("9223372036854775807") == limits::max());
+    KSR_CHECK(int64("-42") == -42);
+    KSR_CHECK(int64("1.9") == 1);
+    KSR_CHECK(int64("-1.9") == -1);
+    KSR_CHECK(int64("1e30") == limits::max());
+    KSR_CHECK(int64("-1e30") == limits::min());
+
+    const auto flag = [] (const std::string_view json) {
+
+        auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+        return reader.read_bool();
+    };
+
+    KSR_CHECK(flag("true"));
+    KSR_CHECK(!flag("false"));
+    KSR_CHECK(flag("2"));
+    KSR_CHECK(!flag("0"));
+    KSR_CHECK(!flag("0.0"));
+}
+
+KSR_TEST(json_reader_rejects_malformed_text) {
+
+    const std::string_view bad[] = {
+        "",
+        "   ",
+        "nul",
+        "tru",
+        "[1,]",
+        "[1 2]",
+        "{\"a\" 1}",
+        "{\"a\": 1,}",
+        "{\"a\": 1 \"b\": 2}",
+        "{1: 2}",
+        "\"unterminated",
+        "\"control\x01\"",
+        "-",
+        "1.2.3",
+        "{} {}",
+        "[] x",
+    };
+
+    for (const auto json : bad) {
+
+        ksr_test::check(read_error(json, false) == error_code::invalid_snapshot,
+            std::string{json}.c_str(), __FILE__, __LINE__);
+    }
+
+    // Values of a type other than that requested.
+
+    const auto mismatched = [] (const std::string_view json, const auto read) {
+
+        return error_of([json, &read] {
+            auto reader = impl::json_reader{json, error_code::invalid_snapshot};
+            read(reader);
+        }) == error_code::invalid_snapshot;
+    };
+
+    KSR_CHECK(mismatched("1", [] (auto& reader) { reader.read_string(); }));
+    KSR_CHECK(mismatched(R"("1")", [] (auto& reader) { reader.read_double(); }));
+    KSR_CHECK(mismatched(R"("1")", [] (auto& reader) { reader.read_int64(); }));
+    KSR_CHECK(mismatched("null", [] (auto& reader) { reader.read_bool(); }));
+    KSR_CHECK(mismatched("[]", [] (auto& reader) { reader.begin_object(); }));
+    KSR_CHECK(mismatched("{}", [] (auto& reader) { reader.begin_array(); }));
+}
+
+KSR_TEST(json_reader_rejects_truncated_text) {
+
+    const auto json = std::string_view{
+        R"({"a": [1, 2.5, {"b": "text \"quoted\" )" "\xc3\xa9" R"( \ud83d\ude00"}], )"
+        R"("c": true, )"
+        R"("d": null, "e": {"f": [[], {}]}, "g": -12})"};
+
+    KSR_CHECK(read_error(json, false) == std::nullopt);
+    KSR_CHECK(read_error(json, true) == std::nullopt);
+
+    // Every strict prefix is incomplete, whether read or skipped.
+
+    auto rejected = true;
+    for (auto size = std::size_t{0}; size < json.size(); ++size) {
+
+        const auto prefix = json.substr(0, size);
+        rejected = rejected && read_error(prefix, false) == error_code::invalid_snapshot
+            && read_error(prefix, true) == error_code::invalid_snapshot;
+    }
+
+    KSR_CHECK(rejected);
+}
@@ -0,0 +1,163 @@
+#include "libanki/error.hpp"
+#include "libanki/media_extraction.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Writes a package of `media` with the manifest `manifest` to `dst`.
+
+    void write_media_package(
+        const path& dst, const std::string& manifest, std::vector<test_entry> media) {
+
+        media.insert(media.begin(), make_entry("media", zip_method::stored, to_bytes(manifest)));
+        write_archive(dst, media);
+    }
+
+    auto file_count(const path& dir) -> std::size_t {
+
+        auto result = std::size_t{0};
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator{dir}) {
+            ++result;
+        }
+
+        return result;
+    }
+}
+
+KSR_TEST(extract_media_writes_each_file) {
+
+    const auto dir = scratch_dir{};
+
+    // Large enough to take several chunks to inflate and several copies to copy.
+
+    const auto large  = sample_data(5 << 20);
+    const auto small  = sample_data(1000);
+    const auto binary = to_bytes(std::string{"\0\xff\x80\x01", 4});
+
+    write_media_package(dir / "media.apkg",
+        R"({"0": "large.bin", "1": "small.txt", "2": "large copy.bin", "3": "binary", )"
+        R"("4": "empty"})", {
+            make_entry("0", zip_method::deflated, large),
+            make_entry("1", zip_method::stored, small),
+            make_entry("2", zip_method::stored, large),
+            make_entry("3", zip_method::deflated, binary),
+            make_entry("4", zip_method::stored, {}),
+        });
+
+    for (const auto thread_count : {1u, 3u}) {
+        for (const auto verify_crc : {true, false}) {
+
+            const auto out = dir / ("out_" + std::to_string(thread_count)
+                + (verify_crc ? "_crc" : ""));
+            std::filesystem::create_directory(out);
+
+            auto options = media_extraction_options{};
+            options.thread_count = thread_count;
+            options.verify_crc   = verify_crc;
+
+            KSR_CHECK(extract_media(dir / "media.apkg", out, options) == 5);
+            KSR_CHECK(file_count(out) == 5);
+
+            KSR_CHECK(read_file(out / "large.bin") == large);
+            KSR_CHECK(read_file(out / "small.txt") == small);
+            KSR_CHECK(read_file(out / "large copy.bin") == large);
+            KSR_CHECK(read_file(out / "binary") == binary);
+            KSR_CHECK(std::filesystem::exists(out / "empty"));
+            KSR_CHECK(read_file(out / "empty").empty());
+        }
+    }
+}
+
+KSR_TEST(extract_media_rejects_names_outside_destination) {
+
+    const auto dir = scratch_dir{};
+    std::filesystem::create_directory(dir / "out");
+
+    const std::string names[] = {"../escaped", "sub/file", "/absolute", "..", ".", ""};
+
+    for (const auto& name : names) {
+
+        write_media_package(dir / "media.apkg",
+            R"({"0": "fine", "1": ")" + name + R"("})", {
+                make_entry("0", zip_method::stored, to_bytes("fine")),
+                make_entry("1", zip_method::stored, to_bytes("escaped")),
+            });
+
+        // The manifest is checked as a whole before any file is written.
+
+        KSR_CHECK(error_of([&dir] { extract_media(dir / "media.apkg", dir / "out", {}); })
+            == error_code::invalid_media_manifest);
+        KSR_CHECK(file_count(dir / "out") == 0);
+    }
+
+    KSR_CHECK(!std::filesystem::exists(dir / "escaped"));
+}
+
+KSR_TEST(extract_media_keeps_last_listing_of_a_name) {
+
+    const auto dir = scratch_dir{};
+    std::filesystem::create_directory(dir / "out");
+
+    write_media_package(dir / "media.apkg",
+        R"({"0": "same.txt", "1": "other.txt", "2": "same.txt"})", {
+            make_entry("0", zip_method::deflated, to_bytes("first listing")),
+            make_entry("1", zip_method::stored, to_bytes("other")),
+            make_entry("2", zip_method::stored, to_bytes("last listing")),
+        });
+
+    auto options = media_extraction_options{};
+    options.thread_count = 3;
+
+    KSR_CHECK(extract_media(dir / "media.apkg", dir / "out", options) == 2);
+    KSR_CHECK(file_count(dir / "out") == 2);
+    KSR_CHECK(read_file(dir / "out" / "same.txt") == to_bytes("last listing"));
+    KSR_CHECK(read_file(dir / "out" / "other.txt") == to_bytes("other"));
+}
+
+KSR_TEST(extract_media_removes_file_failing_crc) {
+
+    const auto dir = scratch_dir{};
+
+    for (const auto method : {zip_method::stored, zip_method::deflated}) {
+
+        auto damaged = make_entry("1", method, sample_data(3 << 20));
+        damaged.info.crc ^= 1;
+
+        write_media_package(dir / "media.apkg", R"({"0": "good.txt", "1": "damaged.bin"})", {
+            make_entry("0", zip_method::stored, to_bytes("good")),
+            damaged,
+        });
+
+        // With one thread, files are extracted in order, so the good file is already in place.
+
+        const auto out = dir / (method == zip_method::stored ? "stored" : "deflated");
+        std::filesystem::create_directory(out);
+
+        auto options = media_extraction_options{};
+        options.thread_count = 1;
+
+        KSR_CHECK(error_of([&] { extract_media(dir / "media.apkg", out, options); })
+            == error_code::zip_bad_crc);
+        KSR_CHECK(!std::filesystem::exists(out / "damaged.bin"));
+        KSR_CHECK(read_file(out / "good.txt") == to_bytes("good"));
+
+        // Without checksums, the damage goes unnoticed.
+
+        options.verify_crc = false;
+        KSR_CHECK(extract_media(dir / "media.apkg", out, options) == 2);
+        KSR_CHECK(read_file(out / "damaged.bin") == damaged.data);
+    }
+}
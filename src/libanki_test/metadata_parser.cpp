@@ -0,0 +1,190 @@
+#include "libanki/error.hpp"
+#include "libanki/impl/metadata_parser.hpp"
+
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Note types as Anki writes them, with fields and templates listed out of order, and members
+    // libanki has no use for, some of them nested.
+
+    constexpr auto notetypes_json = std::string_view{R"json({
+        "1700000000002": {
+            "id": 1700000000002,
+            "name": "Cloze \u2013 \ud83d\ude00",
+            "type": 1,
+            "sortf": 1,
+            "mod": 1700000500,
+            "req": [[0, "any", [0, 1]], [1, "all", []]],
+            "latexPre": "\\documentclass{article}\n",
+            "flds": [
+                {"name": "Extra", "ord": 1, "font": "Arial", "media": [], "sticky": false},
+                {"name": "Text", "ord": 0, "rtl": false, "size": 20}
+            ],
+            "tmpls": [
+                {"name": "Cloze", "ord": 0, "qfmt": "{{cloze:Text}}", "afmt": "{{cloze:Text}}",
+                 "bqfmt": "", "did": null}
+            ],
+            "css": ".card { color: \"black\"; }",
+            "tags": ["unused"],
+            "vers": []
+        },
+        "1700000000001": {
+            "name": "Basic (and reversed card)",
+            "type": 0,
+            "tmpls": [
+                {"ord": 1, "name": "Card 2", "qfmt": "{{Back}}", "afmt": "{{Front}}"},
+                {"ord": 0, "name": "Card 1", "qfmt": "{{Front}}", "afmt": "{{Back}}"}
+            ],
+            "flds": [{"ord": 1, "name": "Back"}, {"ord": 0, "name": "Front"}]
+        }
+    })json"};
+
+    constexpr auto decks_json = std::string_view{R"({
+        "1": {"id": 1, "name": "Default", "conf": 1, "dyn": 0, "desc": "", "collapsed": false},
+        "1700000000010": {"name": "Languages\u001fFrench", "conf": 5, "dyn": false,
+                          "newToday": [0, 0], "extendRev": 50},
+        "1700000000011": {"id": 1700000000011, "name": "Filtered", "conf": 1, "dyn": 1,
+                          "terms": [["deck:Default", 100, 0]], "resched": true},
+        "1700000000012": {"id": 1700000000012, "name": "Also filtered", "dyn": true,
+                          "conf": 7}
+    })"};
+
+    template<typename fn>
+    auto parse_error(const std::string_view json, fn parse) -> std::optional<error_code> {
+        return error_of([&] { parse(json); });
+    }
+}
+
+KSR_TEST(notetypes_are_parsed_in_order) {
+
+    const auto notetypes = impl::parse_notetypes(notetypes_json);
+
+    KSR_CHECK(notetypes.size() == 2);
+
+    // In order of ID, the second taking its ID from its key.
+
+    const auto& basic = notetypes[0];
+    KSR_CHECK(basic.id == 1700000000001);
+    KSR_CHECK(basic.name == "Basic (and reversed card)");
+    KSR_CHECK(!basic.cloze);
+    KSR_CHECK(basic.sort_field == 0);
+    KSR_CHECK(basic.fields == (std::vector<std::string>{"Front", "Back"}));
+    KSR_CHECK(basic.templates.size() == 2);
+    KSR_CHECK(basic.templates[0].name == "Card 1");
+    KSR_CHECK(basic.templates[0].question_format == "{{Front}}");
+    KSR_CHECK(basic.templates[1].name == "Card 2");
+    KSR_CHECK(basic.templates[1].answer_format == "{{Front}}");
+
+    const auto& cloze = notetypes[1];
+    KSR_CHECK(cloze.id == 1700000000002);
+    KSR_CHECK(cloze.name == "Cloze \xe2\x80\x93 \xf0\x9f\x98\x80");
+    KSR_CHECK(cloze.cloze);
+    KSR_CHECK(cloze.sort_field == 1);
+    KSR_CHECK(cloze.modified == 1700000500);
+    KSR_CHECK(cloze.fields == (std::vector<std::string>{"Text", "Extra"}));
+    KSR_CHECK(cloze.templates.size() == 1);
+    KSR_CHECK(cloze.templates[0].question_format == "{{cloze:Text}}");
+    KSR_CHECK(cloze.css == ".card { color: \"black\"; }");
+}
+
+KSR_TEST(decks_are_parsed_with_filtered_flags) {
+
+    const auto decks = impl::parse_decks(decks_json);
+
+    KSR_CHECK(decks.size() == 4);
+
+    KSR_CHECK(decks[0].id == 1);
+    KSR_CHECK(decks[0].name == "Default");
+    KSR_CHECK(decks[0].config_id == 1);
+    KSR_CHECK(!decks[0].filtered);
+
+    KSR_CHECK(decks[1].id == 1700000000010);
+    KSR_CHECK(decks[1].name == "Languages\x1f" "French");
+    KSR_CHECK(decks[1].config_id == 5);
+    KSR_CHECK(!decks[1].filtered);
+
+    // Filtered decks, flagged by number or by boolean, have no options group whatever their
+    // `conf` says, and whichever order the members come in.
+
+    KSR_CHECK(decks[2].filtered);
+    KSR_CHECK(decks[2].config_id == 0);
+    KSR_CHECK(decks[3].filtered);
+    KSR_CHECK(decks[3].config_id == 0);
+}
+
+KSR_TEST(metadata_rejects_malformed_json) {
+
+    const auto notetypes = [] (const std::string_view json) { impl::parse_notetypes(json); };
+    const auto decks     = [] (const std::string_view json) { impl::parse_decks(json); };
+
+    KSR_CHECK(parse_error(notetypes_json, notetypes) == std::nullopt);
+    KSR_CHECK(parse_error(decks_json, decks) == std::nullopt);
+    KSR_CHECK(parse_error("{}", decks) == std::nullopt);
+
+    const std::string_view bad[] = {
+        "",
+        "[]",
+        "null",
+        R"({"1": {"name": "x"}} trailing)",
+        R"({"1": {"name": "x",}})",
+        R"({"1": {"name": "\ud83d"}})",
+        R"({"1": {"flds": [{"name": "x"]}})",
+        R"({"1": {"unknown": [1, 2}})",
+    };
+
+    for (const auto json : bad) {
+
+        ksr_test::check(parse_error(json, notetypes) == error_code::invalid_collection,
+            std::string{json}.c_str(), __FILE__, __LINE__);
+        ksr_test::check(parse_error(json, decks) == error_code::invalid_collection,
+            std::string{json}.c_str(), __FILE__, __LINE__);
+    }
+
+    // Every strict prefix is incomplete, however much of it is skipped.
+
+    auto rejected = true;
+    for (auto size = std::size_t{0}; size < notetypes_json.size(); ++size) {
+
+        const auto prefix = notetypes_json.substr(0, size);
+        rejected = rejected && parse_error(prefix, notetypes) == error_code::invalid_collection
+            && parse_error(prefix, decks) == error_code::invalid_collection;
+    }
+
+    for (auto size = std::size_t{0}; size < decks_json.size(); ++size) {
+        rejected = rejected
+            && parse_error(decks_json.substr(0, size), decks) == error_code::invalid_collection;
+    }
+
+    KSR_CHECK(rejected);
+}
+
+KSR_TEST(deck_config_keeps_default_steps_for_non_arrays) {
+
+    const auto configs = impl::parse_deck_configs(
+        R"({"1": {"new": {"delays": null}, "lapse": {"delays": "5"}}})");
+
+    KSR_CHECK(configs.size() == 1);
+    KSR_CHECK(configs[0].learning_steps == (std::vector<double>{1.0, 10.0}));
+    KSR_CHECK(configs[0].relearning_steps == (std::vector<double>{10.0}));
+}
+
+KSR_TEST(deck_config_skips_non_numeric_steps) {
+
+    const auto configs = impl::parse_deck_configs(
+        R"({"1": {"new": {"delays": [1, null, "x", 2.5, [3]]}, "lapse": {"delays": []}}})");
+
+    KSR_CHECK(configs.size() == 1);
+    KSR_CHECK(configs[0].learning_steps == (std::vector<double>{1.0, 2.5}));
+    KSR_CHECK(configs[0].relearning_steps.empty());
+}
@@ -0,0 +1,188 @@
+#include "libanki/impl/field_scan.hpp"
+#include "libanki/note_fields.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anki;
+
+namespace {
+
+    // Split a byte at a time, slow enough to be obviously right.
+
+    auto reference_split(const std::string_view fields) -> std::vector<std::string_view> {
+
+        auto result = std::vector<std::string_view>{};
+        auto start  = std::size_t{0};
+
+        for (auto i = std::size_t{0}; i < fields.size(); ++i) {
+            if (fields[i] == field_separator) {
+                result.push_back(fields.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+
+        result.push_back(fields.substr(start));
+        return result;
+    }
+
+    auto supported_kernels() -> std::vector<impl::field_scan_kernel> {
+
+        auto kernels = std::vector<impl::field_scan_kernel>{};
+        for (const auto kernel : {impl::field_scan_kernel::scalar, impl::field_scan_kernel::sse2,
+                 impl::field_scan_kernel::avx2}) {
+
+            if (impl::field_scan_kernel_supported(kernel)) {
+                kernels.push_back(kernel);
+            }
+        }
+
+        return kernels;
+    }
+
+    // Field text of `size` bytes, with bytes from all over the range (including those at and
+    // above 0x80, which compare negative as `char`) and separators at `separators`.
+
+    auto field_text(const std::size_t size, const std::vector<std::size_t>& separators)
+        -> std::string {
+
+        auto result = std::string(size, '\0');
+        auto state  = std::uint32_t{0x9e3779b9};
+
+        for (auto& c : result) {
+
+            state = state * 1664525u + 1013904223u;
+            c     = static_cast<char>(state >> 24);
+
+            if (c == field_separator) {
+                c = static_cast<char>(0x9f);
+            }
+        }
+
+        for (const auto pos : separators) {
+            if (pos < size) {
+                result[pos] = field_separator;
+            }
+        }
+
+        return result;
+    }
+
+    // Checks every kernel against the reference over `fields`, for every field index and one
+    // past the last.
+
+    void check_kernels(const std::string_view fields, const std::string& description) {
+
+        const auto expected = reference_split(fields);
+
+        for (const auto kernel : supported_kernels()) {
+
+            const auto prefix = "kernel " + std::to_string(static_cast<int>(kernel)) + " over "
+                + description;
+
+            auto split = std::vector<std::string_view>{"stale"};
+            impl::split_fields(kernel, fields, split);
+
+            // Views must be into `fields` itself, not merely equal to its fields.
+
+            auto same = split.size() == expected.size();
+            for (auto i = std::size_t{0}; same && i < split.size(); ++i) {
+                same = split[i].data() == expected[i].data()
+                    && split[i].size() == expected[i].size();
+            }
+
+            ksr_test::check(same, (prefix + " splits as reference").c_str(), __FILE__, __LINE__);
+
+            auto found = true;
+            for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+
+                const auto field = impl::field_at(kernel, fields, i);
+                found = found && field && field->data() == expected[i].data()
+                    && field->size() == expected[i].size();
+            }
+
+            found = found && !impl::field_at(kernel, fields, expected.size())
+                && !impl::field_at(kernel, fields, expected.size() + 40);
+
+            ksr_test::check(found, (prefix + " finds each field").c_str(), __FILE__, __LINE__);
+        }
+    }
+}
+
+KSR_TEST(note_fields_split_examples) {
+
+    auto split = std::vector<std::string_view>{};
+
+    split_fields("", split);
+    KSR_CHECK(split == std::vector<std::string_view>{""});
+
+    split_fields("front\x1f" "back", split);
+    KSR_CHECK((split == std::vector<std::string_view>{"front", "back"}));
+
+    split_fields("\x1f\x1f" "a\x1f", split);
+    KSR_CHECK((split == std::vector<std::string_view>{"", "", "a", ""}));
+
+    KSR_CHECK(field_at("front\x1f" "back", 0) == "front");
+    KSR_CHECK(field_at("front\x1f" "back", 1) == "back");
+    KSR_CHECK(field_at("front\x1f" "back", 2) == std::nullopt);
+    KSR_CHECK(field_at("", 0) == "");
+    KSR_CHECK(field_at("", 1) == std::nullopt);
+}
+
+KSR_TEST(note_fields_kernels_match_reference) {
+
+    KSR_CHECK(impl::field_scan_kernel_supported(impl::field_scan_kernel::scalar));
+    KSR_CHECK(impl::field_scan_kernel_supported(impl::active_field_scan_kernel()));
+
+    for (auto size = std::size_t{0}; size <= 130; ++size) {
+
+        // No separators; one every 7 bytes; separators leading, trailing and adjacent; and
+        // separators either side of each vector width boundary.
+
+        const auto sparse = [size] {
+            auto result = std::vector<std::size_t>{};
+            for (auto pos = std::size_t{3}; pos < size; pos += 7) {
+                result.push_back(pos);
+            }
+
+            return result;
+        }();
+
+        const auto edges = std::vector<std::size_t>{
+            0, 1, size / 2, size / 2 + 1, size >= 2 ? size - 2 : 0, size >= 1 ? size - 1 : 0};
+
+        const auto boundaries = std::vector<std::size_t>{15, 16, 31, 32, 47, 48, 63, 64, 95, 96,
+            127, 128};
+
+        const auto cases = {
+            std::pair{"none", std::vector<std::size_t>{}},
+            std::pair{"sparse", sparse},
+            std::pair{"edges", edges},
+            std::pair{"boundaries", boundaries},
+        };
+
+        for (const auto& [name, separators] : cases) {
+
+            const auto text = field_text(size, separators);
+            check_kernels(text, std::to_string(size) + " bytes, " + name);
+        }
+
+        // Every byte a separator.
+
+        check_kernels(std::string(size, field_separator), std::to_string(size) + " separators");
+    }
+
+    // Offsets into a larger buffer, so that loads are unaligned.
+
+    const auto text = field_text(200, {0, 17, 33, 34, 64, 100, 199});
+    for (const auto offset : {1, 3, 8, 15, 31}) {
+        check_kernels(std::string_view{text}.substr(static_cast<std::size_t>(offset), 130),
+            "130 bytes at offset " + std::to_string(offset));
+    }
+}
@@ -0,0 +1,65 @@
+#include "libanki/collection.hpp"
+#include "libanki/note_store.hpp"
+
+#include "test_files.hpp"
+#include "test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <memory>
+#include <optional>
+
+using namespace anki;
+using namespace libanki_test;
+
+KSR_TEST(collections_share_notes_through_note_store) {
+
+    const auto dir = scratch_dir{};
+
+    write_package(dir / "a.apkg", {
+        {1, "shared", 1, "a", "front\x1f" "back"},
+        {2, "only_a", 1, "",  "a\x1f" "a"},
+        {3, "edited", 1, "",  "old\x1f" "text"},
+    });
+
+    write_package(dir / "b.apkg", {
+        {10, "shared", 1, "b", "front\x1f" "back"},
+        {11, "edited", 1, "",  "new\x1f" "text"},
+    });
+
+    auto options = native_options();
+    options.dedup_notes = std::make_shared<note_store>();
+
+    const auto a = collection{dir / "a.apkg", options};
+    auto       b = std::optional<collection>{std::in_place, dir / "b.apkg", options};
+
+    const auto& a_notes = a.notes();
+    const auto& b_notes = b->notes();
+
+    // Duplicates view the same text, but keep their own IDs and tags.
+
+    KSR_CHECK(a_notes[0].fields == "front\x1f" "back");
+    KSR_CHECK(a_notes[0].fields.data() == b_notes[0].fields.data());
+    KSR_CHECK(a_notes[0].guid.data() == b_notes[0].guid.data());
+    KSR_CHECK(a_notes[0].id == 1 && b_notes[0].id == 10);
+    KSR_CHECK(a_notes[0].tags == "a" && b_notes[0].tags == "b");
+
+    // A note whose fields were edited is held separately.
+
+    KSR_CHECK(a_notes[2].fields == "old\x1f" "text");
+    KSR_CHECK(b_notes[1].fields == "new\x1f" "text");
+
+    auto stats = options.dedup_notes->stats();
+    KSR_CHECK(stats.added == 5);
+    KSR_CHECK(stats.duplicates == 1);
+    KSR_CHECK(stats.canonical_count == 4);
+    KSR_CHECK(stats.live_count == 4);
+
+    // Destroying a collection releases its notes, leaving those still shared live.
+
+    b.reset();
+
+    stats = options.dedup_notes->stats();
+    KSR_CHECK(stats.live_count == 3);
+    KSR_CHECK(a_notes[0].fields == "front\x1f" "back");
+}
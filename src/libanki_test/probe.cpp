@@ -0,0 +1,175 @@
+#include "libanki/impl/byte_order.hpp"
+#include "libanki/impl/zip_format.hpp"
+#include "libanki/probe.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    auto package_entries() -> std::vector<test_entry> {
+        return {
+            make_entry("collection.anki2", zip_method::deflated, sample_data(20000)),
+            make_entry("media", zip_method::stored, to_bytes("{}")),
+        };
+    }
+
+    // Writes a package of `package_entries()` followed by `extra`, returning its probe.
+
+    auto probe_with(const scratch_dir& dir, std::vector<test_entry> extra) -> probe_result {
+
+        auto entries = package_entries();
+        entries.insert(entries.end(), extra.begin(), extra.end());
+
+        write_archive(dir / "package.apkg", entries);
+        return probe(dir / "package.apkg");
+    }
+}
+
+KSR_TEST(probe_summarises_packages) {
+
+    const auto dir     = scratch_dir{};
+    const auto entries = package_entries();
+
+    write_archive(dir / "package.apkg", entries);
+    const auto result = probe(dir / "package.apkg");
+
+    KSR_CHECK(!result.error);
+    KSR_CHECK(result.version == apkg_version::anki_2);
+    KSR_CHECK(result.entry_count == 2);
+    KSR_CHECK(result.compressed_size
+        == entries[0].info.compressed_size + entries[1].info.compressed_size);
+    KSR_CHECK(result.size == 20002);
+    KSR_CHECK(result.stored_count == 1);
+    KSR_CHECK(result.deflated_count == 1);
+    KSR_CHECK(result.other_method_count == 0);
+    KSR_CHECK(result.encrypted_count == 0);
+    KSR_CHECK(result.has_media_manifest);
+    KSR_CHECK(result.duplicate_count == 0);
+    KSR_CHECK(result.out_of_bounds_count == 0);
+    KSR_CHECK(result.unsafe_name_count == 0);
+    KSR_CHECK(result.importable());
+
+    // A package missing its media manifest or any collection is readable, but not importable.
+
+    write_archive(dir / "no_media.apkg", {entries[0]});
+    const auto no_media = probe(dir / "no_media.apkg");
+    KSR_CHECK(no_media.version == apkg_version::anki_2);
+    KSR_CHECK(!no_media.has_media_manifest);
+    KSR_CHECK(!no_media.importable());
+
+    write_archive(dir / "no_collection.apkg", {entries[1]});
+    const auto no_collection = probe(dir / "no_collection.apkg");
+    KSR_CHECK(!no_collection.error);
+    KSR_CHECK(!no_collection.version);
+    KSR_CHECK(!no_collection.importable());
+}
+
+KSR_TEST(probe_counts_duplicate_names) {
+
+    const auto dir    = scratch_dir{};
+    const auto result = probe_with(dir, {
+        make_entry("0", zip_method::stored, to_bytes("a")),
+        make_entry("0", zip_method::stored, to_bytes("b")),
+        make_entry("media", zip_method::stored, to_bytes("{}")),
+    });
+
+    KSR_CHECK(result.entry_count == 5);
+    KSR_CHECK(result.duplicate_count == 2);
+    KSR_CHECK(!result.importable());
+}
+
+KSR_TEST(probe_counts_unsafe_names) {
+
+    const auto dir = scratch_dir{};
+
+    for (const auto name : {"../x", "/abs", "a\\..\\b", "a/../../b", "\\abs", ".."}) {
+
+        const auto result = probe_with(dir, {make_entry(name, zip_method::stored, {})});
+
+        const auto description = std::string{"probe counts "} + name + " as unsafe";
+        ksr_test::check(result.unsafe_name_count == 1 && !result.importable(),
+            description.c_str(), __FILE__, __LINE__);
+    }
+
+    // Dots that are not a whole path component are harmless.
+
+    const auto safe = probe_with(dir, {
+        make_entry("a..b", zip_method::stored, {}),
+        make_entry("..a/b..", zip_method::stored, {}),
+        make_entry("./a", zip_method::stored, {}),
+    });
+
+    KSR_CHECK(safe.unsafe_name_count == 0);
+    KSR_CHECK(safe.importable());
+}
+
+KSR_TEST(probe_counts_other_methods) {
+
+    const auto dir = scratch_dir{};
+
+    auto bzip2 = make_entry("0", zip_method::stored, to_bytes("data"));
+    bzip2.info.method = static_cast<zip_method>(12);
+
+    const auto result = probe_with(dir, {bzip2});
+
+    KSR_CHECK(result.stored_count == 1);
+    KSR_CHECK(result.deflated_count == 1);
+    KSR_CHECK(result.other_method_count == 1);
+    KSR_CHECK(!result.importable());
+}
+
+KSR_TEST(probe_counts_entries_overlapping_the_directory) {
+
+    const auto dir = scratch_dir{};
+    write_archive(dir / "package.apkg", package_entries());
+
+    // Recording a larger compressed size for the last entry in the central directory runs its
+    // data on into the directory itself, beyond the slack left by its local header's name, which
+    // a probe does not read. The entry's record follows that of the collection.
+
+    using namespace impl::zip_format;
+
+    auto data = read_file(dir / "package.apkg");
+
+    const auto eocd      = data.data() + data.size() - eocd_size;
+    const auto first     = data.data() + impl::load_u32(eocd + 16);
+    const auto last      = first + central_header_size + impl::load_u16(first + 28)
+        + impl::load_u16(first + 30) + impl::load_u16(first + 32);
+    const auto last_size = last + 20;
+
+    KSR_CHECK(impl::load_u32(last) == central_header_signature);
+    impl::store_u32(last_size, impl::load_u32(last_size) + 100);
+
+    write_file(dir / "package.apkg", data);
+    const auto result = probe(dir / "package.apkg");
+
+    KSR_CHECK(!result.error);
+    KSR_CHECK(result.out_of_bounds_count == 1);
+    KSR_CHECK(!result.importable());
+}
+
+KSR_TEST(probe_reports_non_archives) {
+
+    const auto dir = scratch_dir{};
+    write_file(dir / "text.apkg", to_bytes("this is not a zip archive, however it is named"));
+
+    const auto result = probe(dir / "text.apkg");
+
+    KSR_CHECK(result.error == error_code::zip_invalid_archive);
+    KSR_CHECK(result.entry_count == 0);
+    KSR_CHECK(!result.version);
+    KSR_CHECK(!result.importable());
+
+    KSR_CHECK(probe(dir / "missing.apkg").error.has_value());
+}
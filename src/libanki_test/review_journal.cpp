@@ -0,0 +1,174 @@
+#include "libanki/error.hpp"
+#include "libanki/review_journal.hpp"
+
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Sizes of the journal's header and of each record, as laid out in review_journal.cpp.
+
+    constexpr auto header_size = std::size_t{16};
+    constexpr auto record_size = std::size_t{40};
+
+    auto make_review(const std::int64_t id) -> review {
+
+        auto result = review{};
+        result.id          = id;
+        result.card_id     = 1000 + id;
+        result.ease        = 3;
+        result.interval    = 10;
+        result.ease_factor = 2500;
+        result.usn         = -1;
+
+        return result;
+    }
+
+    // Writes a journal of `count` entries to `dst`, with IDs from 1.
+
+    void write_journal(const path& dst, const std::int64_t count) {
+
+        auto journal = review_journal{dst};
+        for (auto id = std::int64_t{1}; id <= count; ++id) {
+            journal.commit(make_review(id));
+        }
+    }
+
+    // IDs of the entries replayed from the journal at `src`, and the number it recovered.
+
+    struct replayed {
+        std::vector<std::int64_t> ids;
+        std::uint64_t             recovered = 0;
+    };
+
+    auto replay(const path& src) -> replayed {
+
+        auto result = replayed{};
+        const auto journal = review_journal{src};
+
+        result.recovered = journal.recovered_count();
+        journal.replay([&result] (const review& entry) {
+
+            if (entry.card_id == 1000 + entry.id && entry.ease == 3 && entry.interval == 10) {
+                result.ids.push_back(entry.id);
+            }
+        });
+
+        return result;
+    }
+
+    auto ids_up_to(const std::int64_t count) -> std::vector<std::int64_t> {
+
+        auto result = std::vector<std::int64_t>{};
+        for (auto id = std::int64_t{1}; id <= count; ++id) {
+            result.push_back(id);
+        }
+
+        return result;
+    }
+}
+
+KSR_TEST(review_journal_replays_what_was_committed) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 5);
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.recovered == 5);
+    KSR_CHECK(result.ids == ids_up_to(5));
+}
+
+KSR_TEST(review_journal_drops_torn_tail) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 5);
+
+    std::filesystem::resize_file(dir / "journal", header_size + 4 * record_size + record_size / 2);
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.recovered == 4);
+    KSR_CHECK(result.ids == ids_up_to(4));
+    KSR_CHECK(std::filesystem::file_size(dir / "journal") == header_size + 4 * record_size);
+}
+
+KSR_TEST(review_journal_drops_zero_filled_tail) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 3);
+
+    // A crash after the file was extended but before its data reached the disk leaves zeros.
+
+    auto data = read_file(dir / "journal");
+    data.resize(data.size() + 2 * record_size + 7);
+    write_file(dir / "journal", data);
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.recovered == 3);
+    KSR_CHECK(result.ids == ids_up_to(3));
+    KSR_CHECK(std::filesystem::file_size(dir / "journal") == header_size + 3 * record_size);
+}
+
+KSR_TEST(review_journal_stops_at_corrupt_record) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 6);
+
+    auto data = read_file(dir / "journal");
+    data[header_size + 2 * record_size + 9] ^= std::byte{0x40};
+    write_file(dir / "journal", data);
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.recovered == 2);
+    KSR_CHECK(result.ids == ids_up_to(2));
+}
+
+KSR_TEST(review_journal_appends_after_recovery) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 3);
+
+    std::filesystem::resize_file(dir / "journal", header_size + 2 * record_size + 1);
+
+    {
+        auto journal = review_journal{dir / "journal"};
+        journal.commit(make_review(3));
+        journal.commit(make_review(4));
+    }
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.recovered == 4);
+    KSR_CHECK(result.ids == ids_up_to(4));
+}
+
+KSR_TEST(review_journal_rejects_foreign_file) {
+
+    const auto dir = scratch_dir{};
+    write_file(dir / "journal", to_bytes("not a review journal at all"));
+
+    KSR_CHECK(error_of([&dir] { review_journal{dir / "journal"}; })
+        == error_code::invalid_review_journal);
+}
+
+KSR_TEST(review_journal_clear_discards_entries) {
+
+    const auto dir = scratch_dir{};
+    write_journal(dir / "journal", 3);
+
+    {
+        auto journal = review_journal{dir / "journal"};
+        journal.clear();
+        journal.commit(make_review(1));
+    }
+
+    const auto result = replay(dir / "journal");
+    KSR_CHECK(result.ids == ids_up_to(1));
+}
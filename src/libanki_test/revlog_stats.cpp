@@ -0,0 +1,267 @@
+#include "libanki/collection_columns.hpp"
+#include "libanki/collection_records.hpp"
+#include "libanki/revlog_stats.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace anki;
+
+namespace {
+
+    constexpr auto seconds_per_day = std::int64_t{86400};
+    constexpr auto day_origin      = std::int64_t{1600000000};
+
+    // ID of an entry `second` seconds into day `day`.
+
+    auto id_at(const std::int64_t day, const std::int64_t second) -> std::int64_t {
+        return (day_origin + day * seconds_per_day + second) * 1000;
+    }
+
+    auto make_review(
+        const std::int64_t id, const std::int64_t type, const std::int64_t ease,
+        const std::int64_t last_interval, const std::int64_t time) -> review {
+
+        auto result = review{};
+        result.id            = id;
+        result.card_id       = 1;
+        result.ease          = ease;
+        result.interval      = 1;
+        result.last_interval = last_interval;
+        result.time          = time;
+        result.type          = type;
+
+        return result;
+    }
+
+    auto to_columns(const std::vector<review>& entries) -> review_columns {
+
+        auto result = review_columns{};
+        for (const auto& entry : entries) {
+            result.id.push_back(entry.id);
+            result.card_id.push_back(entry.card_id);
+            result.interval.push_back(static_cast<std::int32_t>(entry.interval));
+            result.last_interval.push_back(static_cast<std::int32_t>(entry.last_interval));
+            result.time.push_back(static_cast<std::uint32_t>(entry.time));
+            result.ease.push_back(static_cast<std::uint8_t>(entry.ease));
+            result.type.push_back(static_cast<std::uint8_t>(entry.type));
+        }
+
+        return result;
+    }
+
+    // Totals computed one entry at a time, straight from the definitions in revlog_stats.hpp.
+
+    struct naive_totals {
+
+        std::map<std::int32_t, review_totals> days;
+
+        void add(const review& entry) {
+
+            auto seconds = entry.id / 1000;
+            if (entry.id % 1000 < 0) {
+                --seconds;
+            }
+
+            auto day = (seconds - day_origin) / seconds_per_day;
+            if ((seconds - day_origin) % seconds_per_day < 0) {
+                --day;
+            }
+
+            auto& totals = days[static_cast<std::int32_t>(day)];
+            if (entry.type > 3) {
+                ++totals.rescheduled;
+                return;
+            }
+
+            totals.learning   += (entry.type == 0) ? 1 : 0;
+            totals.review     += (entry.type == 1) ? 1 : 0;
+            totals.relearning += (entry.type == 2) ? 1 : 0;
+            totals.filtered   += (entry.type == 3) ? 1 : 0;
+            totals.buttons[static_cast<std::size_t>(entry.ease - 1)] += 1;
+            totals.time += static_cast<std::uint64_t>(entry.time);
+
+            if (entry.type == 1) {
+
+                const auto mature = (entry.last_interval >= 21);
+                const auto passed = (entry.ease > 1);
+
+                totals.young_passed  += (!mature && passed) ? 1 : 0;
+                totals.young_failed  += (!mature && !passed) ? 1 : 0;
+                totals.mature_passed += (mature && passed) ? 1 : 0;
+                totals.mature_failed += (mature && !passed) ? 1 : 0;
+            }
+        }
+
+        auto total() const -> review_totals {
+
+            auto result = review_totals{};
+            for (const auto& day : days) {
+                result += day.second;
+            }
+
+            return result;
+        }
+    };
+
+    auto same_totals(const review_totals& lhs, const review_totals& rhs) -> bool {
+        return lhs.learning == rhs.learning && lhs.review == rhs.review
+            && lhs.relearning == rhs.relearning && lhs.filtered == rhs.filtered
+            && lhs.rescheduled == rhs.rescheduled && lhs.buttons == rhs.buttons
+            && lhs.young_passed == rhs.young_passed && lhs.young_failed == rhs.young_failed
+            && lhs.mature_passed == rhs.mature_passed && lhs.mature_failed == rhs.mature_failed
+            && lhs.time == rhs.time;
+    }
+
+    // Checks `stats` against `expected` for every day with entries and in total.
+
+    void check_matches(const revlog_stats& stats, const naive_totals& expected) {
+
+        KSR_CHECK(stats.first_day() == expected.days.begin()->first);
+        KSR_CHECK(stats.last_day() == expected.days.rbegin()->first);
+        KSR_CHECK(same_totals(stats.totals(), expected.total()));
+
+        auto mismatched = std::size_t{0};
+        for (const auto& day : expected.days) {
+            if (!same_totals(stats.day(day.first), day.second)) {
+                ++mismatched;
+            }
+        }
+
+        KSR_CHECK(mismatched == 0);
+    }
+
+    // About 300,000 entries over 50 days at random times, enough for four threads to take a run
+    // each, with runs ending part way through days.
+
+    auto random_revlog() -> std::vector<review> {
+
+        auto random = std::mt19937{40};
+        auto second = std::uniform_int_distribution<std::int64_t>{0, 2 * seconds_per_day / 6000};
+        auto type   = std::uniform_int_distribution<std::int64_t>{0, 4};
+        auto ease   = std::uniform_int_distribution<std::int64_t>{1, 4};
+        auto last   = std::uniform_int_distribution<std::int64_t>{-600, 60};
+        auto time   = std::uniform_int_distribution<std::int64_t>{0, 60000};
+
+        auto result = std::vector<review>{};
+        for (auto at = id_at(0, 0); at < id_at(50, 0); at += second(random) * 1000 + 1) {
+            result.push_back(
+                make_review(at, type(random), ease(random), last(random), time(random)));
+        }
+
+        return result;
+    }
+}
+
+KSR_TEST(revlog_stats_match_naive_totals) {
+
+    auto entries = random_revlog();
+    KSR_CHECK(entries.size() > 4 * (std::size_t{1} << 16));
+
+    // A bogus ID at each end, far outside the span that can be held densely.
+
+    entries.insert(entries.begin(), make_review(-(std::int64_t{1} << 52), 1, 1, 30, 1000));
+    entries.push_back(make_review(std::int64_t{1} << 52, 0, 3, 0, 2000));
+
+    auto expected = naive_totals{};
+    for (const auto& entry : entries) {
+        expected.add(entry);
+    }
+
+    const auto columns = to_columns(entries);
+
+    for (const auto threads : {1u, 3u, 4u}) {
+
+        const auto stats = revlog_stats{columns, day_origin, revlog_stats_options{threads}};
+        check_matches(stats, expected);
+
+        // Periods that include or leave out the bogus days.
+
+        auto period = review_totals{};
+        for (auto day = std::int32_t{10}; day <= 19; ++day) {
+            period += expected.days[day];
+        }
+
+        KSR_CHECK(same_totals(stats.totals(10, 19), period));
+        KSR_CHECK(same_totals(stats.totals(0, 49), stats.totals(0, 1 << 20)));
+        KSR_CHECK(same_totals(stats.totals(20, 10), review_totals{}));
+    }
+}
+
+KSR_TEST(revlog_stats_add_widens_dense_days) {
+
+    auto stats    = revlog_stats{review_columns{}, day_origin};
+    auto expected = naive_totals{};
+
+    KSR_CHECK(stats.first_day() > stats.last_day());
+    KSR_CHECK(same_totals(stats.totals(), review_totals{}));
+
+    const auto add = [&stats, &expected] (const review& entry) {
+        stats.add(entry);
+        expected.add(entry);
+    };
+
+    // Each added day widens the dense span, backwards or forwards, unless that would make it
+    // longer than `max_dense_days`, so the last two days here are held apart.
+
+    add(make_review(id_at(100, 10), 1, 3, 30, 500));
+    add(make_review(id_at(90, 10), 1, 1, 5, 500));
+    add(make_review(id_at(120, 10), 0, 4, 0, 500));
+    add(make_review(id_at(100, 20), 4, 0, 0, 0));
+    add(make_review(id_at(120 + revlog_stats::max_dense_days, 0), 2, 2, 0, 500));
+    add(make_review(id_at(-revlog_stats::max_dense_days, 0), 3, 3, 0, 500));
+
+    check_matches(stats, expected);
+    KSR_CHECK(same_totals(stats.totals(90, 120), stats.totals(-1, 121)));
+    KSR_CHECK(stats.totals(91, 119).review == 1);
+    KSR_CHECK(stats.day(100).rescheduled == 1);
+    KSR_CHECK(stats.day(110).answers() == 0);
+    KSR_CHECK(stats.day(100).mature_passed == 1);
+    KSR_CHECK(stats.day(90).young_failed == 1);
+}
+
+KSR_TEST(revlog_stats_add_absorbs_outlying_days) {
+
+    // The dense span is placed around the median entry, leaving the first entry, more than half
+    // of `max_dense_days` earlier, on a day of its own.
+
+    const auto outlying = -revlog_stats::max_dense_days * 3 / 4;
+
+    auto entries = std::vector<review>{make_review(id_at(outlying, 0), 1, 3, 30, 100)};
+    for (auto day = 0; day < 10; ++day) {
+        entries.push_back(make_review(id_at(day, 0), 1, 4, 1, 100));
+    }
+
+    auto stats    = revlog_stats{to_columns(entries), day_origin};
+    auto expected = naive_totals{};
+
+    for (const auto& entry : entries) {
+        expected.add(entry);
+    }
+
+    check_matches(stats, expected);
+
+    // Widening the dense span back over the outlying day moves it in, and each entry is counted
+    // once only.
+
+    const auto added = {
+        make_review(id_at(outlying / 2, 0), 0, 1, 0, 100),
+        make_review(id_at(outlying, 100), 1, 1, 30, 100),
+        make_review(id_at(outlying - 1, 0), 2, 3, 0, 100),
+    };
+
+    for (const auto& entry : added) {
+        stats.add(entry);
+        expected.add(entry);
+    }
+
+    check_matches(stats, expected);
+    KSR_CHECK(stats.day(outlying).mature_passed == 1);
+    KSR_CHECK(stats.day(outlying).mature_failed == 1);
+    KSR_CHECK(stats.totals().answers() == 14);
+}
@@ -0,0 +1,154 @@
+#include "libanki/row_bitmap.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace anki;
+
+namespace {
+
+    using rows = std::vector<std::uint32_t>;
+
+    auto make_bitmap(const rows& values) -> row_bitmap {
+
+        auto result = row_bitmap{};
+        for (const auto value : values) {
+            result.insert(value);
+        }
+
+        return result;
+    }
+
+    auto sorted_unique(rows values) -> rows {
+
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        return values;
+    }
+
+    // Checks each set operation on `lhs` and `rhs` against the same operation on sorted vectors.
+
+    void check_operations(const rows& lhs, const rows& rhs) {
+
+        const auto a = make_bitmap(lhs);
+        const auto b = make_bitmap(rhs);
+
+        const auto x = sorted_unique(lhs);
+        const auto y = sorted_unique(rhs);
+
+        auto expected = rows{};
+        std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected));
+        KSR_CHECK((a & b).rows() == expected);
+        KSR_CHECK((a & b) == make_bitmap(expected));
+
+        expected.clear();
+        std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected));
+        KSR_CHECK((a | b).rows() == expected);
+        KSR_CHECK((a | b) == make_bitmap(expected));
+        KSR_CHECK((a | b).size() == expected.size());
+
+        expected.clear();
+        std::set_difference(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected));
+        KSR_CHECK((a - b).rows() == expected);
+        KSR_CHECK((a - b) == make_bitmap(expected));
+        KSR_CHECK((a - b).empty() == expected.empty());
+    }
+
+    // Rows `first` to `last` of the group with upper bits `key`.
+
+    auto run(const std::uint32_t key, const std::uint32_t first, const std::uint32_t last)
+        -> rows {
+
+        auto result = rows{};
+        for (auto low = first; low <= last; ++low) {
+            result.push_back((key << 16) | low);
+        }
+
+        return result;
+    }
+
+    auto concat(rows lhs, const rows& rhs) -> rows {
+
+        lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+        return lhs;
+    }
+}
+
+KSR_TEST(row_bitmap_holds_rows_in_order) {
+
+    const auto values = rows{70000, 3, 65535, 65536, 3, 0xffffffff, 0, 64, 63};
+    const auto bitmap = make_bitmap(values);
+
+    KSR_CHECK(bitmap.rows() == sorted_unique(values));
+    KSR_CHECK(bitmap.size() == 8);
+    KSR_CHECK(bitmap.contains(65536) && bitmap.contains(0xffffffff) && bitmap.contains(0));
+    KSR_CHECK(!bitmap.contains(1) && !bitmap.contains(65537) && !bitmap.contains(0xfffffffe));
+
+    auto visited = rows{};
+    bitmap.for_each([&visited] (const std::uint32_t row) { visited.push_back(row); });
+    KSR_CHECK(visited == bitmap.rows());
+
+    KSR_CHECK(row_bitmap{}.empty() && row_bitmap{}.rows().empty());
+    KSR_CHECK(make_bitmap({5}) != make_bitmap({6}));
+}
+
+KSR_TEST(row_bitmap_converts_between_arrays_and_bitmaps) {
+
+    // A group holds an array of up to 4096 rows, and a bitmap beyond.
+
+    for (const auto size : {4095u, 4096u, 4097u, 65536u}) {
+
+        const auto values = run(1, 0, size - 1);
+        const auto bitmap = make_bitmap(values);
+
+        KSR_CHECK(bitmap.size() == size);
+        KSR_CHECK(bitmap.rows() == values);
+        KSR_CHECK(bitmap.contains(0x10000 + size - 1) && !bitmap.contains(0x10000 + size));
+    }
+
+    // Shrinking a bitmap group back to array size must leave it equal to one built small.
+
+    const auto dense  = make_bitmap(run(2, 0, 9999));
+    const auto sparse = make_bitmap(run(2, 100, 199));
+
+    KSR_CHECK((dense - make_bitmap(concat(run(2, 0, 99), run(2, 200, 9999)))) == sparse);
+    KSR_CHECK((dense & sparse) == sparse);
+    KSR_CHECK((sparse | dense) == dense);
+    KSR_CHECK((dense - dense).empty());
+}
+
+KSR_TEST(row_bitmap_operations_match_sorted_sets) {
+
+    // Runs ending on and either side of 64-bit word boundaries, in array and bitmap groups.
+
+    check_operations(run(0, 0, 63), run(0, 63, 64));
+    check_operations(run(0, 1, 127), run(0, 64, 191));
+    check_operations(run(0, 0, 8191), run(0, 4095, 4160));
+    check_operations(run(0, 0, 65535), run(0, 65472, 65535));
+    check_operations(
+        concat(run(0, 0, 5000), run(3, 0, 10)), concat(run(1, 0, 10), run(3, 5, 6000)));
+    check_operations(run(7, 0, 4096), run(7, 0, 4096));
+    check_operations(run(7, 0, 4096), {});
+    check_operations({}, run(7, 0, 4096));
+
+    auto random = std::mt19937{49};
+    for (const auto limit : {100u, 5000u, 200000u}) {
+        for (const auto count : {10u, 3000u, 9000u}) {
+
+            auto dist = std::uniform_int_distribution<std::uint32_t>{0, limit};
+
+            auto lhs = rows(count);
+            auto rhs = rows(count / 2 + 1);
+            std::generate(lhs.begin(), lhs.end(), [&random, &dist] { return dist(random); });
+            std::generate(rhs.begin(), rhs.end(), [&random, &dist] { return dist(random); });
+
+            check_operations(lhs, rhs);
+        }
+    }
+}
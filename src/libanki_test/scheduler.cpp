@@ -0,0 +1,434 @@
+#include "libanki/collection_columns.hpp"
+#include "libanki/collection_metadata.hpp"
+#include "libanki/impl/scheduling_models.hpp"
+#include "libanki/scheduler.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using namespace anki;
+
+namespace {
+
+    constexpr auto seconds_per_day = std::int64_t{86400};
+
+    // The collection was created at the epoch, and the tests run an hour into day 10.
+
+    constexpr auto today = std::int32_t{10};
+    constexpr auto now   = today * seconds_per_day + 3600;
+
+    // Cards of the collection below, by row.
+
+    enum test_row : std::uint32_t {
+        new_second,    // new, at position 2
+        new_first,     // new, at position 1
+        review_due,    // review, due today
+        review_late,   // review, due 4 days ago
+        suspended,     // suspended review card
+        learning_last, // learning, on its last step, due a minute ago
+        review_easy,   // review, due yesterday
+        review_lapse,  // review, due 2 days ago
+    };
+
+    // Anki's default options, spelled out so that the expected intervals below follow from them.
+
+    auto make_config() -> deck_config {
+
+        auto result = deck_config{};
+        result.id                     = 1;
+        result.learning_steps         = {1.0, 10.0};
+        result.graduating_interval    = 1;
+        result.easy_interval          = 4;
+        result.initial_ease           = 2500;
+        result.easy_bonus             = 1.3;
+        result.interval_modifier      = 1.0;
+        result.maximum_interval       = 36500;
+        result.relearning_steps       = {10.0};
+        result.lapse_multiplier       = 0.0;
+        result.minimum_lapse_interval = 1;
+
+        return result;
+    }
+
+    struct test_card {
+        card_type    type        = card_type::new_card;
+        card_queue   queue       = card_queue::new_card;
+        std::int64_t due         = 0;
+        std::int32_t interval    = 0;
+        std::int32_t ease_factor = 0;
+        std::int32_t left        = 0;
+    };
+
+    auto make_columns(const std::vector<test_card>& cards) -> collection_columns {
+
+        auto result = collection_columns{};
+        result.deck_ids = {1};
+
+        auto& columns = result.cards;
+        for (auto i = std::size_t{0}; i < cards.size(); ++i) {
+
+            const auto& card = cards[i];
+            const auto  id   = static_cast<std::int64_t>(i + 1);
+
+            columns.id.push_back(id);
+            columns.note_id.push_back(id);
+            columns.note.push_back(no_row);
+            columns.deck.push_back(0);
+            columns.ordinal.push_back(0);
+            columns.due.push_back(card.due);
+            columns.interval.push_back(card.interval);
+            columns.ease_factor.push_back(card.ease_factor);
+            columns.reps.push_back(0);
+            columns.lapses.push_back(0);
+            columns.left.push_back(card.left);
+            columns.queue.push_back(static_cast<std::int8_t>(card.queue));
+            columns.type.push_back(static_cast<std::int8_t>(card.type));
+        }
+
+        return result;
+    }
+
+    auto review_card(const std::int64_t due) -> test_card {
+        return test_card{card_type::review, card_queue::review, due, 10, 2500, 0};
+    }
+
+    auto make_scheduler(const scheduler_options& options = {}) -> scheduler {
+
+        const auto columns = make_columns({
+            test_card{card_type::new_card, card_queue::new_card, 2, 0, 0, 0},
+            test_card{card_type::new_card, card_queue::new_card, 1, 0, 0, 0},
+            review_card(today),
+            review_card(today - 4),
+            test_card{card_type::review, card_queue::suspended, today, 10, 2500, 0},
+            test_card{card_type::learning, card_queue::learning, now - 60, 0, 0, 1001},
+            review_card(today - 1),
+            review_card(today - 2),
+        });
+
+        return scheduler{0, columns, {deck{1, "Default", 1, false}}, {make_config()}, now, options};
+    }
+
+    auto fsrs_options() -> scheduler_options {
+
+        auto result = scheduler_options{};
+        result.model = scheduling_model::fsrs;
+
+        return result;
+    }
+
+    auto to_weights(const fsrs_parameters& parameters) -> impl::fsrs::weights {
+
+        auto result = impl::fsrs::weights{};
+        for (auto i = std::size_t{0}; i < result.size(); ++i) {
+            result[i] = static_cast<float>(parameters.weights[i]);
+        }
+
+        return result;
+    }
+
+    // Compares with values computed in double precision from the FSRS 5 formulas.
+
+    auto near(const float actual, const double expected) -> bool {
+        return std::abs(actual - expected) <= 1e-3 * std::abs(expected);
+    }
+}
+
+KSR_TEST(scheduler_sm2_review_intervals) {
+
+    const auto config = make_config();
+
+    const std::int32_t interval[]  = {10, 10, 1, 20000};
+    const std::int32_t ease[]      = {2500, 2500, 1300, 2500};
+    const std::int32_t days_late[] = {0, 4, 0, 0};
+
+    std::int32_t again[4], hard[4], good[4], easy[4];
+    impl::sm2::review_intervals(config, 4, {interval, ease, days_late}, {again, hard, good, easy});
+
+    // Hard is 1.2 times the interval; good adds half the days late and easy all of them before
+    // multiplying by the ease factor (and the easy bonus).
+
+    KSR_CHECK(again[0] == 1);
+    KSR_CHECK(hard[0] == 12);
+    KSR_CHECK(good[0] == 25);
+    KSR_CHECK(easy[0] == 32);
+
+    KSR_CHECK(again[1] == 1);
+    KSR_CHECK(hard[1] == 12);
+    KSR_CHECK(good[1] == 30);
+    KSR_CHECK(easy[1] == 45);
+
+    // Each answer gives at least a day more than the one before, however short the interval and
+    // low the ease, and none more than the maximum interval.
+
+    KSR_CHECK(again[2] == 1);
+    KSR_CHECK(hard[2] == 2);
+    KSR_CHECK(good[2] == 3);
+    KSR_CHECK(easy[2] == 4);
+
+    KSR_CHECK(hard[3] == 24000);
+    KSR_CHECK(good[3] == 36500);
+    KSR_CHECK(easy[3] == 36500);
+}
+
+KSR_TEST(scheduler_sm2_review_answers) {
+
+    auto scheduler = make_scheduler();
+    KSR_CHECK(scheduler.today() == today);
+
+    const auto intervals = scheduler.review_intervals(now);
+    KSR_CHECK(intervals.good[review_due] == 25);
+    KSR_CHECK(intervals.easy[review_late] == 45);
+    KSR_CHECK(intervals.good[new_first] == 0);
+    KSR_CHECK(intervals.good[learning_last] == 0);
+
+    scheduler.answer(review_due, rating::good, now);
+
+    const auto good = scheduler.schedule(review_due);
+    KSR_CHECK(good.type == card_type::review);
+    KSR_CHECK(good.queue == card_queue::review);
+    KSR_CHECK(good.interval == 25);
+    KSR_CHECK(good.ease_factor == 2500);
+    KSR_CHECK(good.due == today + 25);
+    KSR_CHECK(good.reps == 1);
+
+    scheduler.answer(review_late, rating::hard, now);
+
+    const auto hard = scheduler.schedule(review_late);
+    KSR_CHECK(hard.interval == 12);
+    KSR_CHECK(hard.ease_factor == 2350);
+    KSR_CHECK(hard.due == today + 12);
+
+    scheduler.answer(review_easy, rating::easy, now);
+
+    const auto easy = scheduler.schedule(review_easy);
+    KSR_CHECK(easy.interval == 35);
+    KSR_CHECK(easy.ease_factor == 2650);
+    KSR_CHECK(easy.due == today + 35);
+}
+
+KSR_TEST(scheduler_sm2_lapse_and_relearning) {
+
+    auto scheduler = make_scheduler();
+    scheduler.answer(review_lapse, rating::again, now);
+
+    // The card lapses into its one relearning step, keeping the interval it will return with.
+
+    const auto lapsed = scheduler.schedule(review_lapse);
+    KSR_CHECK(lapsed.type == card_type::relearning);
+    KSR_CHECK(lapsed.queue == card_queue::learning);
+    KSR_CHECK(lapsed.interval == 1);
+    KSR_CHECK(lapsed.ease_factor == 2300);
+    KSR_CHECK(lapsed.lapses == 1);
+    KSR_CHECK(lapsed.left == 1);
+    KSR_CHECK(lapsed.due == now + 600);
+
+    scheduler.answer(review_lapse, rating::good, now + 600);
+
+    const auto relearnt = scheduler.schedule(review_lapse);
+    KSR_CHECK(relearnt.type == card_type::review);
+    KSR_CHECK(relearnt.queue == card_queue::review);
+    KSR_CHECK(relearnt.interval == 1);
+    KSR_CHECK(relearnt.ease_factor == 2300);
+    KSR_CHECK(relearnt.lapses == 1);
+    KSR_CHECK(relearnt.left == 0);
+    KSR_CHECK(relearnt.due == today + 1);
+
+    // Easy out of relearning adds a day.
+
+    scheduler.answer(review_due, rating::again, now);
+    scheduler.answer(review_due, rating::easy, now + 60);
+    KSR_CHECK(scheduler.schedule(review_due).interval == 2);
+}
+
+KSR_TEST(scheduler_sm2_learning_steps) {
+
+    auto scheduler = make_scheduler();
+
+    // New cards are introduced by position, not by row.
+
+    KSR_CHECK(scheduler.next_new() == std::optional<std::uint32_t>{new_first});
+
+    scheduler.answer(new_first, rating::good, now);
+
+    const auto stepped = scheduler.schedule(new_first);
+    KSR_CHECK(stepped.type == card_type::learning);
+    KSR_CHECK(stepped.queue == card_queue::learning);
+    KSR_CHECK(stepped.left == 1);
+    KSR_CHECK(stepped.due == now + 600);
+    KSR_CHECK(scheduler.next_new() == std::optional<std::uint32_t>{new_second});
+
+    scheduler.answer(new_first, rating::good, now + 600);
+
+    const auto graduated = scheduler.schedule(new_first);
+    KSR_CHECK(graduated.type == card_type::review);
+    KSR_CHECK(graduated.queue == card_queue::review);
+    KSR_CHECK(graduated.interval == 1);
+    KSR_CHECK(graduated.ease_factor == 2500);
+    KSR_CHECK(graduated.left == 0);
+    KSR_CHECK(graduated.reps == 2);
+    KSR_CHECK(graduated.due == today + 1);
+
+    // Hard on the first step waits halfway to the second; again returns to the first.
+
+    scheduler.answer(new_second, rating::hard, now);
+
+    const auto hard = scheduler.schedule(new_second);
+    KSR_CHECK(hard.left == 2);
+    KSR_CHECK(hard.due == now + 330);
+
+    scheduler.answer(new_second, rating::good, now + 330);
+    scheduler.answer(new_second, rating::again, now + 930);
+
+    const auto again = scheduler.schedule(new_second);
+    KSR_CHECK(again.type == card_type::learning);
+    KSR_CHECK(again.left == 2);
+    KSR_CHECK(again.due == now + 990);
+
+    scheduler.answer(new_second, rating::easy, now + 990);
+
+    const auto easy = scheduler.schedule(new_second);
+    KSR_CHECK(easy.type == card_type::review);
+    KSR_CHECK(easy.interval == 4);
+    KSR_CHECK(easy.due == today + 4);
+    KSR_CHECK(!scheduler.next_new());
+}
+
+KSR_TEST(scheduler_due_queue_order) {
+
+    auto scheduler = make_scheduler();
+
+    // Review cards are due at the start of their due day, so those most overdue come first, and
+    // all come before the learning card due a minute ago. The suspended card is not queued.
+
+    KSR_CHECK(scheduler.queued_count() == 5);
+
+    const std::uint32_t order[] = {
+        review_late, review_lapse, review_easy, review_due, learning_last};
+
+    for (const auto row : order) {
+
+        KSR_CHECK(scheduler.next_due(now) == std::optional<std::uint32_t>{row});
+        scheduler.answer(row, (row == review_lapse) ? rating::again : rating::good, now);
+    }
+
+    // Only the lapsed card is due again today, once its relearning step has passed.
+
+    KSR_CHECK(scheduler.queued_count() == 5);
+    KSR_CHECK(!scheduler.next_due(now + 599));
+    KSR_CHECK(scheduler.next_due(now + 600) == std::optional<std::uint32_t>{review_lapse});
+
+    scheduler.answer(review_lapse, rating::good, now + 600);
+    KSR_CHECK(!scheduler.next_due(now + seconds_per_day - 3601));
+
+    // Tomorrow, the graduated learning card and the relearnt card are due.
+
+    const auto tomorrow = (today + 1) * seconds_per_day;
+    KSR_CHECK(scheduler.schedule(learning_last).due == today + 1);
+    KSR_CHECK(scheduler.schedule(review_lapse).due == today + 1);
+    KSR_CHECK(scheduler.next_due(tomorrow).has_value());
+}
+
+KSR_TEST(scheduler_set_aside_cards_are_left_unchanged) {
+
+    auto scheduler = make_scheduler();
+    scheduler.answer(suspended, rating::good, now);
+
+    const auto schedule = scheduler.schedule(suspended);
+    KSR_CHECK(schedule.queue == card_queue::suspended);
+    KSR_CHECK(schedule.interval == 10);
+    KSR_CHECK(schedule.due == today);
+    KSR_CHECK(schedule.reps == 0);
+    KSR_CHECK(scheduler.queued_count() == 5);
+}
+
+KSR_TEST(scheduler_fsrs_memory_states) {
+
+    const auto w = to_weights(fsrs_parameters{});
+
+    KSR_CHECK(near(impl::fsrs::retrievability(10.0f, 10.0f), 0.9));
+
+    const auto good = impl::fsrs::initial_state(w, 3);
+    KSR_CHECK(near(good.stability, 3.173));
+    KSR_CHECK(near(good.difficulty, 5.28243));
+
+    const auto again = impl::fsrs::initial_state(w, 1);
+    KSR_CHECK(near(again.stability, 0.40255));
+    KSR_CHECK(near(again.difficulty, 7.1949));
+
+    // Same-day reviews use the short-term model; later ones depend on retrievability (0.9047
+    // after 3 days).
+
+    const auto same_day = impl::fsrs::next_state(w, good, 0.0f, 3);
+    KSR_CHECK(near(same_day.stability, 4.46686));
+    KSR_CHECK(near(same_day.difficulty, 5.27297));
+
+    const auto recalled = impl::fsrs::next_state(w, good, 3.0f, 3);
+    KSR_CHECK(near(recalled.stability, 10.7389));
+    KSR_CHECK(near(recalled.difficulty, 5.27297));
+
+    const auto forgotten = impl::fsrs::next_state(w, good, 3.0f, 1);
+    KSR_CHECK(near(forgotten.stability, 1.05556));
+    KSR_CHECK(near(forgotten.difficulty, 6.79693));
+
+    const auto converted = impl::fsrs::state_from_sm2(w, 2.5f, 10.0f);
+    KSR_CHECK(near(converted.stability, 10.0));
+    KSR_CHECK(near(converted.difficulty, 7.07916));
+
+    KSR_CHECK(impl::fsrs::interval_for(10.0f, 0.9f, 36500) == 10);
+    KSR_CHECK(impl::fsrs::interval_for(10.0f, 0.9f, 5) == 5);
+    KSR_CHECK(impl::fsrs::interval_for(0.1f, 0.9f, 36500) == 1);
+}
+
+KSR_TEST(scheduler_fsrs_answers) {
+
+    auto scheduler = make_scheduler(fsrs_options());
+
+    // Review cards are given a memory state from their SM-2 interval and ease factor, and are
+    // reviewed 10 days after they were last, at 90% retrievability.
+
+    const auto converted = scheduler.schedule(review_due);
+    KSR_CHECK(near(converted.stability, 10.0));
+    KSR_CHECK(near(converted.difficulty, 7.07916));
+
+    const auto intervals = scheduler.review_intervals(now);
+    KSR_CHECK(intervals.again[review_due] == 2);
+    KSR_CHECK(intervals.hard[review_due] == 13);
+    KSR_CHECK(intervals.good[review_due] == 25);
+    KSR_CHECK(intervals.easy[review_due] == 55);
+
+    scheduler.answer(review_due, rating::good, now);
+
+    const auto reviewed = scheduler.schedule(review_due);
+    KSR_CHECK(near(reviewed.stability, 25.0));
+    KSR_CHECK(near(reviewed.difficulty, 7.06143));
+    KSR_CHECK(reviewed.interval == 25);
+    KSR_CHECK(reviewed.due == today + 25);
+
+    scheduler.answer(review_late, rating::again, now);
+
+    const auto lapsed = scheduler.schedule(review_late);
+    KSR_CHECK(lapsed.type == card_type::relearning);
+    KSR_CHECK(near(lapsed.difficulty, 8.00498));
+
+    // New cards get their first memory state on the first answer, and graduate at the interval
+    // of their stability.
+
+    scheduler.answer(new_first, rating::good, now);
+
+    const auto learning = scheduler.schedule(new_first);
+    KSR_CHECK(learning.type == card_type::learning);
+    KSR_CHECK(near(learning.stability, 3.173));
+    KSR_CHECK(near(learning.difficulty, 5.28243));
+
+    scheduler.answer(new_first, rating::good, now + 600);
+
+    const auto graduated = scheduler.schedule(new_first);
+    KSR_CHECK(graduated.type == card_type::review);
+    KSR_CHECK(near(graduated.stability, 4.46686));
+    KSR_CHECK(graduated.interval == 4);
+    KSR_CHECK(graduated.due == today + 4);
+}
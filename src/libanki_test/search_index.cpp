@@ -0,0 +1,132 @@
+#include "libanki/collection.hpp"
+#include "libanki/error.hpp"
+#include "libanki/impl/text_tokenizer.hpp"
+#include "libanki/search_index.hpp"
+
+#include "test_files.hpp"
+#include "test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    auto tokenize(const std::string_view text) -> std::vector<std::string> {
+
+        auto tokenizer = impl::text_tokenizer{};
+        auto terms     = std::vector<std::string_view>{};
+        tokenizer.tokenize(text, terms);
+
+        return std::vector<std::string>(terms.begin(), terms.end());
+    }
+
+    using ids = std::vector<std::int64_t>;
+
+    // Checks the answers of `index` to queries over the notes written by `write_notes()`.
+
+    void check_queries(const search_index& index) {
+
+        KSR_CHECK(index.note_count() == 4);
+
+        KSR_CHECK(index.match_all("brown fox") == (ids{1, 3}));
+        KSR_CHECK(index.match_all("BROWN Fóx") == (ids{1, 3}));
+        KSR_CHECK(index.match_all("brown cat").empty());
+        KSR_CHECK(index.match_any("dog jumps") == (ids{1, 2}));
+        KSR_CHECK(index.match_any("cat").empty());
+
+        // A phrase matches only within a field, so not across note 2's.
+
+        KSR_CHECK(index.match_phrase("quick brown") == (ids{1}));
+        KSR_CHECK(index.match_phrase("brown quick").empty());
+        KSR_CHECK(index.match_phrase("日本") == (ids{4}));
+
+        KSR_CHECK(index.match_all("").empty());
+        KSR_CHECK(index.match_any("<b></b>").empty());
+    }
+
+    void write_notes(const path& dst) {
+
+        write_package(dst, {
+            {1, "a", 1, "", "The quick brown fox\x1f" "jumps"},
+            {2, "b", 1, "", "quick\x1f" "brown dog"},
+            {3, "c", 1, "", "<i>Brown</i> fox\x1f"},
+            {4, "d", 1, "", "日本語\x1f"},
+        });
+    }
+}
+
+KSR_TEST(tokenizer_splits_and_folds_terms) {
+
+    KSR_CHECK(tokenize("Hello, World! abc123 x_2") == (std::vector<std::string>{
+        "hello", "world", "abc123", "x", "2"}));
+
+    KSR_CHECK(tokenize("<b>Café</b>&amp;na&#xEF;ve ＡＢＣ") == (std::vector<std::string>{
+        "cafe", "naive", "abc"}));
+
+    KSR_CHECK(tokenize("Άλφα λόγος ПРИВЕТ") == (std::vector<std::string>{
+        "αλφα", "λογοσ", "привет"}));
+    KSR_CHECK(tokenize("日本語テスト") == (std::vector<std::string>{
+        "日", "本", "語", "テ", "ス", "ト"}));
+
+    KSR_CHECK(tokenize("").empty());
+    KSR_CHECK(tokenize(" <br> &nbsp; -- ").empty());
+}
+
+KSR_TEST(tokenizer_drops_overlong_terms) {
+
+    const auto longest = std::string(impl::text_tokenizer::max_term_size, 'a');
+
+    KSR_CHECK(tokenize(longest + " b") == (std::vector<std::string>{longest, "b"}));
+    KSR_CHECK(tokenize(longest + "a b") == (std::vector<std::string>{"b"}));
+}
+
+KSR_TEST(search_index_answers_queries) {
+
+    const auto dir = scratch_dir{};
+    write_notes(dir / "notes.apkg");
+
+    const auto options = native_options();
+
+    check_queries(search_index{collection{dir / "notes.apkg", options}});
+}
+
+KSR_TEST(search_index_round_trips_through_file) {
+
+    const auto dir = scratch_dir{};
+    write_notes(dir / "notes.apkg");
+
+    const auto options = native_options();
+
+    const auto built = search_index{collection{dir / "notes.apkg", options}};
+
+    // Saving replaces whatever is there.
+
+    write_file(dir / "index", to_bytes("stale"));
+    built.save(dir / "index");
+
+    const auto opened = search_index::open(dir / "index");
+    KSR_CHECK(opened.term_count() == built.term_count());
+    check_queries(opened);
+
+    // Saving an index that was itself mapped from a file writes the same bytes.
+
+    opened.save(dir / "copy");
+    KSR_CHECK(read_file(dir / "copy") == read_file(dir / "index"));
+}
+
+KSR_TEST(search_index_rejects_foreign_file) {
+
+    const auto dir = scratch_dir{};
+    write_file(dir / "index", to_bytes("not a search index"));
+
+    KSR_CHECK(error_of([&dir] { search_index::open(dir / "index"); })
+        == error_code::invalid_search_index);
+}
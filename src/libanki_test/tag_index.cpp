@@ -0,0 +1,122 @@
+#include "libanki/collection.hpp"
+#include "libanki/error.hpp"
+#include "libanki/tag_index.hpp"
+
+#include "test_files.hpp"
+#include "test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    using rows = std::vector<std::uint32_t>;
+
+    // Rows 0 to 5 of a collection, in order of note ID.
+
+    void write_tagged_notes(const path& dst) {
+
+        write_package(dst, {
+            {1, "a", 1, " lang::es::verbs ",  "a\x1f"},
+            {2, "b", 1, " Lang::FR misc ",    "b\x1f"},
+            {3, "c", 1, " misc ",             "c\x1f"},
+            {4, "d", 1, "",                   "d\x1f"},
+            {5, "e", 1, " lang::es ",         "e\x1f"},
+            {6, "f", 1, " other::lang::es ",  "f\x1f"},
+        });
+    }
+}
+
+KSR_TEST(tag_index_indexes_tags_and_ancestors) {
+
+    const auto dir = scratch_dir{};
+    write_tagged_notes(dir / "tags.apkg");
+
+    const auto options = native_options();
+
+    const auto col   = collection{dir / "tags.apkg", options};
+    const auto index = tag_index{col.columns()};
+
+    KSR_CHECK(index.note_count() == 6);
+    KSR_CHECK(index.tags() == (std::vector<std::string>{
+        "lang", "lang::es", "lang::es::verbs", "lang::fr", "misc", "other", "other::lang",
+        "other::lang::es"}));
+
+    KSR_CHECK(index.notes_tagged("lang").rows() == (rows{0, 1, 4}));
+    KSR_CHECK(index.notes_tagged("LANG::Es").rows() == (rows{0, 4}));
+    KSR_CHECK(index.notes_tagged("es").empty());
+    KSR_CHECK(index.notes_tagged("lang::e").empty());
+}
+
+KSR_TEST(tag_index_evaluates_queries) {
+
+    const auto dir = scratch_dir{};
+    write_tagged_notes(dir / "tags.apkg");
+
+    const auto options = native_options();
+
+    const auto col   = collection{dir / "tags.apkg", options};
+    const auto index = tag_index{col.columns()};
+
+    const auto check = [&index] (const std::string_view query, const rows& expected) {
+        ksr_test::check(index.query(query).rows() == expected, query.data(), __FILE__, __LINE__);
+    };
+
+    check("",                          rows{0, 1, 2, 3, 4, 5});
+    check("tag:lang",                  rows{0, 1, 4});
+    check("lang misc",                 rows{1});
+    check("lang and misc",             rows{1});
+    check("lang or misc",              rows{0, 1, 2, 4});
+    check("LANG OR MISC",              rows{0, 1, 2, 4});
+    check("tag:none",                  rows{3});
+    check("-lang",                     rows{2, 3, 5});
+    check("--lang",                    rows{0, 1, 4});
+    check("-tag:none -misc",           rows{0, 4, 5});
+
+    // `and` binds more tightly than `or`, and parentheses override that.
+
+    check("misc or lang::es and lang::es::verbs",   rows{0, 1, 2});
+    check("(misc or lang::es) and lang::es::verbs", rows{0});
+    check("-(lang or misc)",                        rows{3, 5});
+    check("((lang::fr)or(tag:none))",               rows{1, 3});
+    check("lang -(lang::es -lang::es::verbs)",      rows{0, 1});
+
+    // Wildcards match any run of characters, across `::` too.
+
+    check("lang::*",    rows{0, 1, 4});
+    check("*::es",      rows{0, 4, 5});
+    check("*es*",       rows{0, 4, 5});
+    check("l*::f*",     rows{1});
+    check("nothing*",   rows{});
+    check("*",          rows{0, 1, 2, 4, 5});
+}
+
+KSR_TEST(tag_index_rejects_malformed_queries) {
+
+    const auto dir = scratch_dir{};
+    write_tagged_notes(dir / "tags.apkg");
+
+    const auto options = native_options();
+
+    const auto col   = collection{dir / "tags.apkg", options};
+    const auto index = tag_index{col.columns()};
+
+    static constexpr const char* queries[] = {
+        "(", "lang)", "(lang", "()", "or", "lang or", "and lang", "-", "lang and", "tag:",
+        "lang ) misc",
+    };
+
+    for (const auto query : queries) {
+        ksr_test::check(
+            error_of([&] { index.query(query); }) == error_code::invalid_tag_query, query,
+            __FILE__, __LINE__);
+    }
+}
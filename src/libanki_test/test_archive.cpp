@@ -0,0 +1,153 @@
+#include "test_archive.hpp"
+
+#include "libanki/impl/crc32.hpp"
+#include "libanki/impl/zip_format.hpp"
+#include "libanki/impl/zip_writer.hpp"
+#include "libanki/impl/zlib/deflater.hpp"
+
+#include <utility>
+
+namespace libanki_test {
+
+    auto deflate(const bytes& data) -> bytes {
+
+        auto result = bytes{};
+        anki::impl::zlib::deflater{6}.deflate(data.data(), data.size(), true, result);
+
+        return result;
+    }
+
+    auto make_entry(std::string name, const anki::zip_method method, const bytes& data)
+        -> test_entry {
+
+        auto entry = test_entry{};
+        entry.name        = std::move(name);
+        entry.info.method = method;
+        entry.info.size   = data.size();
+        entry.info.crc    = anki::impl::crc32(0, data.data(), data.size());
+        entry.stored      = (method == anki::zip_method::deflated) ? deflate(data) : data;
+        entry.data        = data;
+
+        entry.info.compressed_size = entry.stored.size();
+        return entry;
+    }
+
+    auto sample_data(const std::size_t size) -> bytes {
+
+        auto result = bytes(size);
+        for (auto i = std::size_t{0}; i < size; ++i) {
+            result[i] = static_cast<std::byte>("anki"[i % 4] + (i / 1000) % 7);
+        }
+
+        return result;
+    }
+
+    void write_archive(const anki::path& dst, const std::vector<test_entry>& entries) {
+
+        auto writer = anki::impl::zip_writer{dst};
+
+        for (const auto& entry : entries) {
+            writer.begin_entry(entry.name, entry.info);
+            writer.write(entry.stored.data(), entry.stored.size());
+        }
+
+        writer.finish();
+    }
+
+    auto descriptor_archive(const std::vector<test_entry>& entries, const bool zip64) -> bytes {
+
+        using namespace anki::impl::zip_format;
+
+        auto result = archive_bytes{};
+
+        constexpr auto version  = std::uint16_t{20};
+        constexpr auto flags    = std::uint16_t{0x0008};
+        constexpr auto dos_date = std::uint16_t{(1 << 5) | 1};
+
+        auto local_offsets = std::vector<std::uint64_t>{};
+
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+            const auto& entry = entries[i];
+            const auto  sizes = zip64 ? zip64_marker_32 : std::uint32_t{0};
+
+            local_offsets.push_back(result.size());
+
+            result.put_u32(local_header_signature);
+            result.put_u16(zip64 ? 45 : version);
+            result.put_u16(flags);
+            result.put_u16(static_cast<std::uint16_t>(entry.info.method));
+            result.put_u16(0);                                  // Time
+            result.put_u16(dos_date);
+            result.put_u32(0);                                  // CRC
+            result.put_u32(sizes);
+            result.put_u32(sizes);
+            result.put_u16(static_cast<std::uint16_t>(entry.name.size()));
+            result.put_u16(zip64 ? 20 : 0);                     // Extra field size
+            result.put_bytes(entry.name);
+
+            if (zip64) {
+                result.put_u16(zip64_extra_id);
+                result.put_u16(16);
+                result.put_u64(0);
+                result.put_u64(0);
+            }
+
+            result.put_bytes(entry.stored);
+
+            if (i % 2 == 0) {
+                result.put_u32(data_descriptor_signature);
+            }
+
+            result.put_u32(entry.info.crc);
+
+            if (zip64) {
+                result.put_u64(entry.info.compressed_size);
+                result.put_u64(entry.info.size);
+            }
+            else {
+                result.put_u32(static_cast<std::uint32_t>(entry.info.compressed_size));
+                result.put_u32(static_cast<std::uint32_t>(entry.info.size));
+            }
+        }
+
+        const auto directory_offset = result.size();
+
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+            const auto& entry = entries[i];
+
+            result.put_u32(central_header_signature);
+            result.put_u16(version);                            // Version made by
+            result.put_u16(version);                            // Version needed
+            result.put_u16(flags);
+            result.put_u16(static_cast<std::uint16_t>(entry.info.method));
+            result.put_u16(0);                                  // Time
+            result.put_u16(dos_date);
+            result.put_u32(entry.info.crc);
+            result.put_u32(static_cast<std::uint32_t>(entry.info.compressed_size));
+            result.put_u32(static_cast<std::uint32_t>(entry.info.size));
+            result.put_u16(static_cast<std::uint16_t>(entry.name.size()));
+            result.put_u16(0);                                  // Extra field size
+            result.put_u16(0);                                  // Comment size
+            result.put_u16(0);                                  // Disk
+            result.put_u16(0);                                  // Internal attributes
+            result.put_u32(0);                                  // External attributes
+            result.put_u32(static_cast<std::uint32_t>(local_offsets[i]));
+            result.put_bytes(entry.name);
+        }
+
+        const auto directory_size = result.size() - directory_offset;
+
+        result.put_u32(eocd_signature);
+        result.put_u16(0);                                      // Disk
+        result.put_u16(0);                                      // Disk holding the directory
+        result.put_u16(static_cast<std::uint16_t>(entries.size()));
+        result.put_u16(static_cast<std::uint16_t>(entries.size()));
+        result.put_u32(static_cast<std::uint32_t>(directory_size));
+        result.put_u32(static_cast<std::uint32_t>(directory_offset));
+        result.put_u16(0);                                      // Comment size
+
+        return result.data;
+    }
+}
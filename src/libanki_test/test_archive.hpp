@@ -0,0 +1,80 @@
+#ifndef LIBANKI_TEST_TEST_ARCHIVE_HPP
+#define LIBANKI_TEST_TEST_ARCHIVE_HPP
+
+#include "test_files.hpp"
+
+#include "libanki/impl/byte_order.hpp"
+#include "libanki/zip_entry_info.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace libanki_test {
+
+    auto deflate(const bytes& data) -> bytes;
+
+    // An entry of a test archive: its data as stored (compressed by `info.method`) and as it
+    // should read back.
+
+    struct test_entry {
+        std::string          name;
+        anki::zip_entry_info info;
+        bytes                stored;
+        bytes                data;
+    };
+
+    auto make_entry(std::string name, anki::zip_method method, const bytes& data) -> test_entry;
+
+    // Deterministic data that deflates well, but not trivially.
+
+    auto sample_data(std::size_t size) -> bytes;
+
+    // Writes `entries` to `dst` with libanki's own writer, which uses zip64 structures only where
+    // they are needed.
+
+    void write_archive(const anki::path& dst, const std::vector<test_entry>& entries);
+
+    // Returns an archive of deflated `entries` laid out as a writer that cannot seek produces it:
+    // each local header defers the entry's CRC and sizes to a data descriptor after its data.
+    // The descriptor's signature is optional, so only every other entry's has one. If `zip64` is
+    // set, local headers have zip64 fields and descriptors 64-bit sizes.
+
+    auto descriptor_archive(const std::vector<test_entry>& entries, bool zip64) -> bytes;
+
+    // Bytes of an archive assembled field by field, for layouts that `impl::zip_writer` does not
+    // produce.
+
+    struct archive_bytes {
+        bytes data;
+
+        auto size() const -> std::uint64_t { return data.size(); }
+
+        void put_u16(const std::uint16_t value) {
+            data.resize(data.size() + 2);
+            anki::impl::store_u16(data.data() + data.size() - 2, value);
+        }
+
+        void put_u32(const std::uint32_t value) {
+            data.resize(data.size() + 4);
+            anki::impl::store_u32(data.data() + data.size() - 4, value);
+        }
+
+        void put_u64(const std::uint64_t value) {
+            data.resize(data.size() + 8);
+            anki::impl::store_u64(data.data() + data.size() - 8, value);
+        }
+
+        template<typename t>
+        void put_bytes(const t& src) {
+            std::transform(src.begin(), src.end(), std::back_inserter(data), [] (auto value) {
+                return static_cast<std::byte>(value);
+            });
+        }
+    };
+}
+
+#endif
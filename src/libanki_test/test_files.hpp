@@ -0,0 +1,109 @@
+#ifndef LIBANKI_TEST_TEST_FILES_HPP
+#define LIBANKI_TEST_TEST_FILES_HPP
+
+#include "libanki/error.hpp"
+#include "libanki/filesystem.hpp"
+#include "libanki/import_options.hpp"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace libanki_test {
+
+    using bytes = std::vector<std::byte>;
+
+    inline auto to_bytes(const std::string& text) -> bytes {
+
+        auto result = bytes(text.size());
+        std::transform(text.begin(), text.end(), result.begin(), [] (const char c) {
+            return static_cast<std::byte>(c);
+        });
+
+        return result;
+    }
+
+    inline auto read_file(const anki::path& src) -> bytes {
+
+        auto stream = std::ifstream{src, std::ios::binary};
+        const auto text = std::string{std::istreambuf_iterator<char>{stream}, {}};
+
+        return to_bytes(text);
+    }
+
+    inline void write_file(const anki::path& dst, const bytes& data) {
+
+        auto stream = std::ofstream{dst, std::ios::binary};
+        stream.write(
+            reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    // Returns the code of the `anki::error` that `run` throws, if any. Other exceptions escape,
+    // failing the test.
+
+    template<typename function>
+    auto error_of(const function& run) -> std::optional<anki::error_code> {
+
+        try {
+            run();
+        }
+        catch (const anki::error& ex) {
+            return ex.code();
+        }
+
+        return std::nullopt;
+    }
+
+    // Options importing through the native zip backend, which behaves the same whatever libzip
+    // is linked.
+
+    inline auto native_options() -> anki::import_options {
+
+        auto result = anki::import_options{};
+        result.backend = anki::zip_backend::native;
+
+        return result;
+    }
+
+    // Temporary directory, removed with its contents on destruction.
+
+    class scratch_dir {
+    public:
+
+        scratch_dir() {
+
+            auto templ = (std::filesystem::temp_directory_path() / "libanki_test.XXXXXX").string();
+            if (!mkdtemp(templ.data())) {
+                throw std::system_error{errno, std::generic_category()};
+            }
+
+            _path = templ;
+        }
+
+        ~scratch_dir() {
+
+            auto ignored = std::error_code{};
+            std::filesystem::remove_all(_path, ignored);
+        }
+
+        scratch_dir(const scratch_dir&) = delete;
+        auto operator=(const scratch_dir&) -> scratch_dir& = delete;
+
+        auto operator/(const std::string& name) const -> anki::path { return _path / name; }
+
+    private:
+
+        anki::path _path;
+    };
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "test_package.hpp"
+
+#include "test_files.hpp"
+
+#include "libanki/impl/crc32.hpp"
+#include "libanki/impl/zip_writer.hpp"
+
+#include <sqlite3.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace libanki_test {
+
+    namespace {
+
+        constexpr auto schema =
+            "CREATE TABLE col (id INTEGER PRIMARY KEY, crt INTEGER, models TEXT, decks TEXT, "
+            "dconf TEXT);"
+            "CREATE TABLE notes (id INTEGER PRIMARY KEY, guid TEXT, mid INTEGER, mod INTEGER, "
+            "usn INTEGER, tags TEXT, flds TEXT, sfld TEXT);"
+            "CREATE TABLE cards (id INTEGER PRIMARY KEY, nid INTEGER, did INTEGER, ord INTEGER, "
+            "mod INTEGER, usn INTEGER, type INTEGER, queue INTEGER, due INTEGER, ivl INTEGER, "
+            "factor INTEGER, reps INTEGER, lapses INTEGER, left INTEGER, odue INTEGER, "
+            "odid INTEGER, flags INTEGER);"
+            "CREATE TABLE revlog (id INTEGER PRIMARY KEY, cid INTEGER, usn INTEGER, ease INTEGER, "
+            "ivl INTEGER, lastIvl INTEGER, factor INTEGER, time INTEGER, type INTEGER);";
+
+        struct database_closer {
+            void operator()(sqlite3* const handle) const { sqlite3_close(handle); }
+        };
+
+        struct statement_finalizer {
+            void operator()(sqlite3_stmt* const handle) const { sqlite3_finalize(handle); }
+        };
+
+        void check(const int result, sqlite3* const db) {
+            if (result != SQLITE_OK && result != SQLITE_DONE) {
+                throw std::runtime_error{sqlite3_errmsg(db)};
+            }
+        }
+
+        // Binds `values` to the parameters of `statement` in order, steps it and resets it.
+
+        template<typename... values>
+        void insert_row(sqlite3* const db, sqlite3_stmt* const statement, const values&... row) {
+
+            auto index = 0;
+            const auto bind = [db, statement, &index] (const auto& value) {
+
+                ++index;
+
+                using value_type = std::decay_t<decltype(value)>;
+                if constexpr (std::is_same_v<value_type, std::string>) {
+                    check(sqlite3_bind_text(
+                        statement, index, value.c_str(), -1, SQLITE_TRANSIENT), db);
+                }
+                else {
+                    check(sqlite3_bind_int64(statement, index, value), db);
+                }
+            };
+
+            (bind(row), ...);
+
+            check(sqlite3_step(statement), db);
+            check(sqlite3_reset(statement), db);
+        }
+
+        auto prepare(sqlite3* const db, const char* const sql)
+            -> std::unique_ptr<sqlite3_stmt, statement_finalizer> {
+
+            auto handle = static_cast<sqlite3_stmt*>(nullptr);
+            check(sqlite3_prepare_v2(db, sql, -1, &handle, nullptr), db);
+
+            return std::unique_ptr<sqlite3_stmt, statement_finalizer>{handle};
+        }
+
+        void write_database(const anki::path& dst, const test_collection& collection) {
+
+            auto handle = static_cast<sqlite3*>(nullptr);
+            const auto opened = sqlite3_open(dst.c_str(), &handle);
+
+            const auto db = std::unique_ptr<sqlite3, database_closer>{handle};
+            check(opened, handle);
+            check(sqlite3_exec(handle, schema, nullptr, nullptr, nullptr), handle);
+
+            insert_row(handle, prepare(handle, "INSERT INTO col VALUES (1, ?, ?, ?, ?)").get(),
+                collection.created, collection.notetypes_json, collection.decks_json,
+                collection.deck_configs_json);
+
+            const auto notes = prepare(
+                handle, "INSERT INTO notes VALUES (?, ?, ?, 0, 0, ?, ?, '')");
+            for (const auto& note : collection.notes) {
+                insert_row(handle, notes.get(),
+                    note.id, note.guid, note.notetype_id, note.tags, note.fields);
+            }
+
+            const auto cards = prepare(handle,
+                "INSERT INTO cards VALUES (?, ?, ?, ?, 0, 0, ?, ?, ?, ?, ?, ?, ?, ?, 0, 0, 0)");
+
+            for (const auto& card : collection.cards) {
+                insert_row(handle, cards.get(),
+                    card.id, card.note_id, card.deck_id, card.ordinal, card.type, card.queue,
+                    card.due, card.interval, card.ease_factor, card.reps, card.lapses, card.left);
+            }
+
+            const auto reviews = prepare(handle,
+                "INSERT INTO revlog VALUES (?, ?, 0, ?, ?, ?, 0, ?, ?)");
+
+            for (const auto& review : collection.reviews) {
+                insert_row(handle, reviews.get(),
+                    review.id, review.card_id, review.ease, review.interval, review.last_interval,
+                    review.time, review.type);
+            }
+        }
+
+        void add_stored(
+            anki::impl::zip_writer& writer, const std::string& name, const bytes& data) {
+
+            auto info = anki::zip_entry_info{};
+            info.method          = anki::zip_method::stored;
+            info.size            = data.size();
+            info.compressed_size = data.size();
+            info.crc             = anki::impl::crc32(0, data.data(), data.size());
+
+            writer.begin_entry(name, info);
+            writer.write(data.data(), data.size());
+        }
+    }
+
+    void write_package(const anki::path& dst, const test_collection& collection) {
+
+        auto database_path = dst;
+        database_path += ".anki2";
+
+        write_database(database_path, collection);
+        const auto database = read_file(database_path);
+        std::filesystem::remove(database_path);
+
+        auto writer = anki::impl::zip_writer{dst};
+        add_stored(writer, "collection.anki2", database);
+        add_stored(writer, "media", to_bytes("{}"));
+        writer.finish();
+    }
+
+    void write_package(const anki::path& dst, const std::vector<test_note>& notes) {
+
+        auto collection = test_collection{};
+        collection.notes = notes;
+
+        write_package(dst, collection);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef LIBANKI_TEST_TEST_PACKAGE_HPP
+#define LIBANKI_TEST_TEST_PACKAGE_HPP
+
+#include "libanki/filesystem.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace libanki_test {
+
+    // Note of a package written by `write_package()`, with fields separated by `\x1f` as Anki
+    // stores them.
+
+    struct test_note {
+        std::int64_t id          = 0;
+        std::string  guid;
+        std::int64_t notetype_id = 1;
+        std::string  tags;
+        std::string  fields;
+    };
+
+    // Card and review history rows of a package written by `write_package()`, with the columns
+    // of the `cards` and `revlog` tables that libanki reads.
+
+    struct test_card {
+        std::int64_t id          = 0;
+        std::int64_t note_id     = 0;
+        std::int64_t deck_id     = 1;
+        int          ordinal     = 0;
+        std::int64_t due         = 0;
+        int          interval    = 0;
+        int          ease_factor = 0;
+        int          reps        = 0;
+        int          lapses      = 0;
+        int          left        = 0;
+        int          queue       = 0;
+        int          type        = 0;
+    };
+
+    struct test_review {
+        std::int64_t id            = 0;
+        std::int64_t card_id       = 0;
+        int          ease          = 0;
+        int          interval      = 0;
+        int          last_interval = 0;
+        int          time          = 0;
+        int          type          = 0;
+    };
+
+    // Contents of the collection of a package written by `write_package()`, with metadata given
+    // as the JSON of the `models`, `decks` and `dconf` columns.
+
+    struct test_collection {
+        std::int64_t             created           = 0;
+        std::string              notetypes_json    = "{}";
+        std::string              decks_json        = "{}";
+        std::string              deck_configs_json = "{}";
+        std::vector<test_note>   notes;
+        std::vector<test_card>   cards;
+        std::vector<test_review> reviews;
+    };
+
+    // Writes an Anki 2.0 package to `dst` holding `collection`, and no media. Throws
+    // `std::runtime_error` on failure.
+
+    void write_package(const anki::path& dst, const test_collection& collection);
+
+    // As above, for a collection holding `notes`, with no cards, review history or media, and
+    // empty metadata.
+
+    void write_package(const anki::path& dst, const std::vector<test_note>& notes);
+}
+
+#endif
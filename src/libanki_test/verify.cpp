@@ -0,0 +1,160 @@
+#include "libanki/verify.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    auto find_entry(const verify_report& report, const std::string& name)
+        -> const entry_verification* {
+
+        for (const auto& entry : report.entries) {
+            if (entry.name == name) {
+                return &entry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Returns the error that verification reported for the entry named `name`, which must have
+    // been checked.
+
+    auto entry_error(const verify_report& report, const std::string& name)
+        -> std::optional<error_code> {
+
+        const auto entry = find_entry(report, name);
+        KSR_CHECK(entry && entry->checked);
+
+        return entry ? entry->error : std::nullopt;
+    }
+}
+
+KSR_TEST(verify_passes_intact_archives) {
+
+    const auto dir = scratch_dir{};
+
+    write_archive(dir / "good.zip", {
+        make_entry("collection.anki2", zip_method::deflated, sample_data(3 << 20)),
+        make_entry("media", zip_method::stored, to_bytes("{}")),
+        make_entry("0", zip_method::deflated, sample_data(100)),
+        make_entry("empty", zip_method::deflated, {}),
+    });
+
+    for (const auto thread_count : {1u, 3u}) {
+
+        auto options = verify_options{};
+        options.thread_count = thread_count;
+
+        const auto report = verify(dir / "good.zip", options);
+
+        KSR_CHECK(report.ok());
+        KSR_CHECK(report.entries.size() == 4);
+        KSR_CHECK(report.entries[0].name == "collection.anki2");
+        KSR_CHECK(report.entries[3].name == "empty");
+    }
+}
+
+KSR_TEST(verify_reports_each_damaged_entry) {
+
+    const auto dir = scratch_dir{};
+
+    auto entries = std::vector<test_entry>{
+        make_entry("good", zip_method::deflated, sample_data(5000)),
+        make_entry("stored_crc", zip_method::stored, sample_data(5000)),
+        make_entry("deflated_crc", zip_method::deflated, sample_data(5000)),
+        make_entry("truncated", zip_method::deflated, sample_data(50000)),
+        make_entry("oversized", zip_method::deflated, sample_data(50000)),
+        make_entry("stored_size", zip_method::stored, sample_data(5000)),
+    };
+
+    entries[1].info.crc ^= 1;
+    entries[2].info.crc ^= 1;
+
+    // Deflate data cut short, with its compressed size recorded to match, never finishes.
+
+    auto& truncated = entries[3];
+    truncated.stored.resize(truncated.stored.size() / 2);
+    truncated.info.compressed_size = truncated.stored.size();
+
+    // Data that decompresses to more than its recorded size fails as it outgrows it.
+
+    entries[4].info.size -= 1;
+    entries[5].info.size -= 1;
+
+    write_archive(dir / "damaged.zip", entries);
+
+    auto options = verify_options{};
+    options.thread_count = 2;
+
+    const auto report = verify(dir / "damaged.zip", options);
+
+    KSR_CHECK(!report.ok());
+    KSR_CHECK(!report.error);
+    KSR_CHECK(report.entries.size() == entries.size());
+
+    KSR_CHECK(entry_error(report, "good") == std::nullopt);
+    KSR_CHECK(entry_error(report, "stored_crc") == error_code::zip_bad_crc);
+    KSR_CHECK(entry_error(report, "deflated_crc") == error_code::zip_bad_crc);
+    KSR_CHECK(entry_error(report, "truncated") == error_code::zip_invalid_compressed_data);
+    KSR_CHECK(entry_error(report, "oversized") == error_code::zip_archive_inconsistent);
+    KSR_CHECK(entry_error(report, "stored_size") == error_code::zip_archive_inconsistent);
+}
+
+KSR_TEST(verify_stops_at_first_error) {
+
+    const auto dir = scratch_dir{};
+
+    // Entries are verified largest first, so the damaged entry is the first one checked.
+
+    auto entries = std::vector<test_entry>{
+        make_entry("small_1", zip_method::stored, sample_data(100)),
+        make_entry("large", zip_method::stored, sample_data(10000)),
+        make_entry("small_2", zip_method::deflated, sample_data(100)),
+    };
+
+    entries[1].info.crc ^= 1;
+    write_archive(dir / "damaged.zip", entries);
+
+    auto options = verify_options{};
+    options.thread_count        = 1;
+    options.stop_at_first_error = true;
+
+    const auto report = verify(dir / "damaged.zip", options);
+
+    KSR_CHECK(!report.ok());
+    KSR_CHECK(entry_error(report, "large") == error_code::zip_bad_crc);
+    KSR_CHECK(!find_entry(report, "small_1")->checked);
+    KSR_CHECK(!find_entry(report, "small_2")->checked);
+
+    // Without stopping, every entry is checked.
+
+    options.stop_at_first_error = false;
+
+    const auto full = verify(dir / "damaged.zip", options);
+    KSR_CHECK(entry_error(full, "small_1") == std::nullopt);
+    KSR_CHECK(entry_error(full, "small_2") == std::nullopt);
+}
+
+KSR_TEST(verify_reports_unreadable_archives) {
+
+    const auto dir = scratch_dir{};
+    write_file(dir / "text.zip", to_bytes("not an archive"));
+
+    const auto report = verify(dir / "text.zip");
+    KSR_CHECK(report.error == error_code::zip_invalid_archive);
+    KSR_CHECK(report.entries.empty());
+    KSR_CHECK(!report.ok());
+
+    KSR_CHECK(verify(dir / "missing.zip").error.has_value());
+}
@@ -0,0 +1,658 @@
+#include "libanki/batch_reader.hpp"
+#include "libanki/error.hpp"
+#include "libanki/impl/zip_format.hpp"
+#include "libanki/shared_zip_archive.hpp"
+#include "libanki/zip_archive.hpp"
+#include "libanki/zip_stream_reader.hpp"
+
+#include "test_archive.hpp"
+#include "test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace anki;
+using namespace libanki_test;
+
+namespace {
+
+    // Returns an archive of `entries` in which every size, offset and count that zip64 can extend
+    // is extended, however small, as some writers produce regardless of need. The zip64 end of
+    // central directory record ends with `extensible_size` bytes of extensible data.
+
+    auto forced_zip64_archive(
+        const std::vector<test_entry>& entries, const std::size_t extensible_size = 0) -> bytes {
+
+        using namespace impl::zip_format;
+
+        auto result = archive_bytes{};
+
+        constexpr auto version  = std::uint16_t{45};
+        constexpr auto dos_date = std::uint16_t{(1 << 5) | 1};
+
+        auto local_offsets = std::vector<std::uint64_t>{};
+
+        for (const auto& entry : entries) {
+
+            local_offsets.push_back(result.size());
+
+            result.put_u32(local_header_signature);
+            result.put_u16(version);
+            result.put_u16(0);                                  // Flags
+            result.put_u16(static_cast<std::uint16_t>(entry.info.method));
+            result.put_u16(0);                                  // Time
+            result.put_u16(dos_date);
+            result.put_u32(entry.info.crc);
+            result.put_u32(zip64_marker_32);
+            result.put_u32(zip64_marker_32);
+            result.put_u16(static_cast<std::uint16_t>(entry.name.size()));
+            result.put_u16(20);                                 // Extra field size
+            result.put_bytes(entry.name);
+            result.put_u16(zip64_extra_id);
+            result.put_u16(16);
+            result.put_u64(entry.info.size);
+            result.put_u64(entry.info.compressed_size);
+            result.put_bytes(entry.stored);
+        }
+
+        const auto directory_offset = result.size();
+
+        for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+            const auto& entry = entries[i];
+
+            result.put_u32(central_header_signature);
+            result.put_u16(version);                            // Version made by
+            result.put_u16(version);                            // Version needed
+            result.put_u16(0);                                  // Flags
+            result.put_u16(static_cast<std::uint16_t>(entry.info.method));
+            result.put_u16(0);                                  // Time
+            result.put_u16(dos_date);
+            result.put_u32(entry.info.crc);
+            result.put_u32(zip64_marker_32);
+            result.put_u32(zip64_marker_32);
+            result.put_u16(static_cast<std::uint16_t>(entry.name.size()));
+            result.put_u16(28);                                 // Extra field size
+            result.put_u16(0);                                  // Comment size
+            result.put_u16(0);                                  // Disk
+            result.put_u16(0);                                  // Internal attributes
+            result.put_u32(0);                                  // External attributes
+            result.put_u32(zip64_marker_32);
+            result.put_bytes(entry.name);
+            result.put_u16(zip64_extra_id);
+            result.put_u16(24);
+            result.put_u64(entry.info.size);
+            result.put_u64(entry.info.compressed_size);
+            result.put_u64(local_offsets[i]);
+        }
+
+        const auto directory_size = result.size() - directory_offset;
+        const auto eocd64_offset  = result.size();
+
+        result.put_u32(zip64_eocd_signature);
+        result.put_u64(zip64_eocd_size - 12 + extensible_size); // Size of the remaining record
+        result.put_u16(version);
+        result.put_u16(version);
+        result.put_u32(0);                                      // Disk
+        result.put_u32(0);                                      // Disk holding the directory
+        result.put_u64(entries.size());
+        result.put_u64(entries.size());
+        result.put_u64(directory_size);
+        result.put_u64(directory_offset);
+        result.put_bytes(bytes(extensible_size));
+
+        result.put_u32(zip64_locator_signature);
+        result.put_u32(0);                                      // Disk holding the record
+        result.put_u64(eocd64_offset);
+        result.put_u32(1);                                      // Total disks
+
+        result.put_u32(eocd_signature);
+        result.put_u16(0);                                      // Disk
+        result.put_u16(0);                                      // Disk holding the directory
+        result.put_u16(zip64_marker_16);
+        result.put_u16(zip64_marker_16);
+        result.put_u32(zip64_marker_32);
+        result.put_u32(zip64_marker_32);
+        result.put_u16(0);                                      // Comment size
+
+        return result.data;
+    }
+
+    // What reading one entry through a backend yields: either data or the code of the error
+    // thrown instead.
+
+    struct read_result {
+        std::optional<error_code> error;
+        bytes                     data;
+
+        auto operator==(const read_result& rhs) const -> bool {
+            return error == rhs.error && data == rhs.data;
+        }
+    };
+
+    struct entry_outcome {
+        bool                          contained = false;
+        std::optional<zip_entry_info> info;
+        std::optional<error_code>     stat_error;
+        read_result                   whole;
+        read_result                   chunked;
+        read_result                   rest;
+
+        auto operator==(const entry_outcome& rhs) const -> bool {
+
+            const auto same_info = (info.has_value() == rhs.info.has_value()) && (!info ||
+                (info->method == rhs.info->method && info->size == rhs.info->size &&
+                 info->compressed_size == rhs.info->compressed_size &&
+                 info->crc == rhs.info->crc && info->encrypted == rhs.info->encrypted));
+
+            return contained == rhs.contained && same_info && stat_error == rhs.stat_error &&
+                whole == rhs.whole && chunked == rhs.chunked && rest == rhs.rest;
+        }
+    };
+
+    struct archive_outcome {
+        std::optional<error_code>  open_error;
+        std::vector<entry_outcome> entries;
+
+        auto operator==(const archive_outcome& rhs) const -> bool {
+            return open_error == rhs.open_error && entries == rhs.entries;
+        }
+    };
+
+    // Sets `result` to what `read` returns, or to the code of the `anki::error` it throws.
+
+    template<typename function>
+    void capture(read_result& result, const function& read) {
+
+        try {
+            result.data = read();
+        }
+        catch (const error& ex) {
+            result.error = ex.code();
+            result.data.clear();
+        }
+    }
+
+    // Opens `src` with `backend`, individually or through a `batch_reader`, and records what
+    // each of `names` yields when read whole and in small chunks, and what is left to read after
+    // reading it whole (which should be nothing).
+
+    auto read_archive(
+        const path& src, const zip_backend backend, const bool batched,
+        const std::vector<std::string>& names) -> archive_outcome {
+
+        auto outcome = archive_outcome{};
+        auto reader  = batch_reader{};
+
+        auto archive = std::optional<zip_archive>{};
+
+        outcome.open_error = error_of([&] {
+            if (batched) {
+                archive.emplace(std::move(zip_archive::open_all(
+                    {src}, ksr::mut_observer<batch_reader>{reader}, backend).front()));
+            }
+            else {
+                archive.emplace(src, backend);
+            }
+        });
+
+        if (outcome.open_error) {
+            return outcome;
+        }
+
+        for (const auto& name : names) {
+
+            auto& entry = outcome.entries.emplace_back();
+            entry.contained = archive->contains_file(name);
+
+            entry.stat_error = error_of([&archive, &entry, &name] {
+                entry.info = archive->stat_file(name);
+            });
+
+            capture(entry.whole, [&archive, &name] {
+                return archive->open_file(name).read_all();
+            });
+
+            capture(entry.chunked, [&archive, &name] {
+
+                const auto file = archive->open_file(name);
+
+                auto data  = bytes{};
+                auto chunk = std::array<std::byte, 7>{};
+
+                while (const auto size_read = file.read(chunk.data(), chunk.size())) {
+                    data.insert(data.end(), chunk.begin(), chunk.begin() + size_read);
+                }
+
+                return data;
+            });
+
+            capture(entry.rest, [&archive, &name] {
+
+                auto file = archive->open_file(name);
+                file.read_all();
+
+                auto chunk = std::array<std::byte, 7>{};
+                const auto size_read = file.read(chunk.data(), chunk.size());
+
+                auto data = file.read_all();
+                data.insert(data.begin(), chunk.begin(), chunk.begin() + size_read);
+
+                return data;
+            });
+        }
+
+        archive->close();
+        return outcome;
+    }
+
+    // One archive to read with every backend, and what reading each of `names` should yield.
+
+    struct test_case {
+        std::string              name;
+        path                     src;
+        std::vector<std::string> names;
+        archive_outcome          expected;
+    };
+
+    // What reading every entry of `entries` should yield: its data and central directory record,
+    // or `read_error` in place of its data if given.
+
+    auto expected_outcome(
+        const std::vector<test_entry>& entries,
+        const std::optional<error_code> read_error = std::nullopt) -> archive_outcome {
+
+        auto outcome = archive_outcome{};
+
+        for (const auto& entry : entries) {
+
+            auto& expected = outcome.entries.emplace_back();
+            expected.contained = true;
+            expected.info      = entry.info;
+
+            if (read_error) {
+                expected.whole.error   = read_error;
+                expected.chunked.error = read_error;
+                expected.rest.error    = read_error;
+            }
+            else {
+                expected.whole.data   = entry.data;
+                expected.chunked.data = entry.data;
+            }
+        }
+
+        return outcome;
+    }
+
+    auto names_of(const std::vector<test_entry>& entries) -> std::vector<std::string> {
+
+        auto names = std::vector<std::string>{};
+        for (const auto& entry : entries) {
+            names.push_back(entry.name);
+        }
+
+        return names;
+    }
+
+    auto make_cases(const scratch_dir& dir) -> std::vector<test_case> {
+
+        auto cases = std::vector<test_case>{};
+
+        // A name absent from the archive is queried alongside every case's entries.
+
+        auto missing = entry_outcome{};
+        missing.stat_error    = error_code::zip_file_not_found;
+        missing.whole.error   = error_code::zip_file_not_found;
+        missing.chunked.error = error_code::zip_file_not_found;
+        missing.rest.error    = error_code::zip_file_not_found;
+
+        const auto add_case = [&cases, &missing] (
+            std::string name, path src, std::vector<std::string> names, archive_outcome expected) {
+
+            if (!expected.open_error) {
+                names.push_back("missing");
+                expected.entries.push_back(missing);
+            }
+
+            cases.push_back(
+                {std::move(name), std::move(src), std::move(names), std::move(expected)});
+        };
+
+        const auto stored = std::vector<test_entry>{
+            make_entry("hello.txt", zip_method::stored, to_bytes("hello, world")),
+            make_entry("dir/sample", zip_method::stored, sample_data(10000)),
+            make_entry("empty", zip_method::stored, {}),
+        };
+
+        write_archive(dir / "stored.zip", stored);
+        add_case("stored", dir / "stored.zip", names_of(stored), expected_outcome(stored));
+
+        const auto deflated = std::vector<test_entry>{
+            make_entry("collection.anki2", zip_method::deflated, sample_data(200000)),
+            make_entry("0", zip_method::deflated, to_bytes("x")),
+            make_entry("empty", zip_method::deflated, {}),
+            make_entry("media", zip_method::stored, to_bytes("{}")),
+        };
+
+        write_archive(dir / "deflated.zip", deflated);
+        add_case("deflated", dir / "deflated.zip", names_of(deflated), expected_outcome(deflated));
+
+        write_file(dir / "zip64.zip", forced_zip64_archive(deflated));
+        add_case("zip64", dir / "zip64.zip", names_of(deflated), expected_outcome(deflated));
+
+        // Extensible data puts the zip64 record further from the end than its locator, which
+        // must then be followed to it.
+
+        write_file(dir / "zip64_far.zip",
+            forced_zip64_archive(deflated, impl::zip_format::max_tail_size));
+        add_case("zip64_far", dir / "zip64_far.zip", names_of(deflated),
+            expected_outcome(deflated));
+
+        const auto streamed = std::vector<test_entry>{
+            make_entry("collection.anki2", zip_method::deflated, sample_data(100000)),
+            make_entry("empty", zip_method::deflated, {}),
+            make_entry("media", zip_method::deflated, to_bytes("{}")),
+        };
+
+        write_file(dir / "descriptors.zip", descriptor_archive(streamed, false));
+        add_case("descriptors", dir / "descriptors.zip", names_of(streamed),
+            expected_outcome(streamed));
+
+        write_file(dir / "descriptors64.zip", descriptor_archive(streamed, true));
+        add_case("descriptors64", dir / "descriptors64.zip", names_of(streamed),
+            expected_outcome(streamed));
+
+        auto bad_crc = std::vector<test_entry>{
+            make_entry("stored", zip_method::stored, sample_data(5000)),
+            make_entry("deflated", zip_method::deflated, sample_data(5000)),
+        };
+
+        for (auto& entry : bad_crc) {
+            entry.info.crc ^= 1;
+        }
+
+        write_archive(dir / "bad_crc.zip", bad_crc);
+        add_case("bad_crc", dir / "bad_crc.zip", names_of(bad_crc),
+            expected_outcome(bad_crc, error_code::zip_bad_crc));
+
+        // A stored entry's data is the entry itself, so its sizes must agree; reading either
+        // size's worth would run past its data or stop short of it.
+
+        auto bad_size = std::vector<test_entry>{
+            make_entry("long", zip_method::stored, sample_data(5000)),
+            make_entry("short", zip_method::stored, sample_data(5000)),
+        };
+
+        bad_size[0].info.size += 1;
+        bad_size[1].info.size -= 1;
+
+        write_archive(dir / "bad_size.zip", bad_size);
+        add_case("bad_size", dir / "bad_size.zip", names_of(bad_size),
+            expected_outcome(bad_size, error_code::zip_archive_inconsistent));
+
+        // Archives truncated anywhere before their end of central directory record have none, so
+        // cannot be opened at all; an empty file is an empty archive.
+
+        const auto whole = read_file(dir / "deflated.zip");
+        const auto eocd  = whole.size() - impl::zip_format::eocd_size;
+
+        for (const auto size : {eocd, eocd / 2, std::size_t{10}}) {
+
+            const auto name = "truncated_" + std::to_string(size);
+            write_file(dir / (name + ".zip"), bytes(whole.begin(), whole.begin() + size));
+
+            auto expected = archive_outcome{};
+            expected.open_error = error_code::zip_invalid_archive;
+
+            add_case(name, dir / (name + ".zip"), names_of(deflated), std::move(expected));
+        }
+
+        write_file(dir / "empty.zip", {});
+        add_case("empty_file", dir / "empty.zip", {}, archive_outcome{});
+
+        return cases;
+    }
+}
+
+namespace {
+
+    // What reading an archive in one pass with `zip_stream_reader` yields: the name and data of
+    // each entry met, and the code of any error thrown on moving to an entry.
+
+    struct stream_outcome {
+        std::optional<error_code>                        error;
+        std::vector<std::pair<std::string, read_result>> entries;
+
+        auto operator==(const stream_outcome& rhs) const -> bool {
+            return error == rhs.error && entries == rhs.entries;
+        }
+    };
+
+    auto stream_archive(const path& src) -> stream_outcome {
+
+        const auto fd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        KSR_CHECK(fd >= 0);
+
+        auto outcome = stream_outcome{};
+
+        outcome.error = error_of([fd, &outcome] {
+
+            auto reader = zip_stream_reader{fd};
+            while (const auto entry = reader.next_entry()) {
+
+                auto& [name, result] = outcome.entries.emplace_back();
+                name = entry->name;
+
+                capture(result, [&reader] {
+
+                    auto data  = bytes{};
+                    auto chunk = std::array<std::byte, 7>{};
+
+                    while (const auto size_read = reader.read(chunk.data(), chunk.size())) {
+                        data.insert(data.end(), chunk.begin(), chunk.begin() + size_read);
+                    }
+
+                    return data;
+                });
+            }
+        });
+
+        ::close(fd);
+        return outcome;
+    }
+
+    // What streaming the archive of `test` should yield: each of its entries, in order, as the
+    // native backend reads them.
+
+    auto expected_stream(const test_case& test, const archive_outcome& native) -> stream_outcome {
+
+        auto outcome = stream_outcome{};
+        for (auto i = std::size_t{0}; i < test.names.size(); ++i) {
+            if (native.entries[i].contained) {
+                outcome.entries.emplace_back(test.names[i], native.entries[i].chunked);
+            }
+        }
+
+        return outcome;
+    }
+}
+
+KSR_TEST(zip_backends_agree) {
+
+    const auto dir = scratch_dir{};
+
+    for (const auto& test : make_cases(dir)) {
+        for (const auto batched : {false, true}) {
+
+            const auto libzip = read_archive(test.src, zip_backend::libzip, batched, test.names);
+            const auto native = read_archive(test.src, zip_backend::native, batched, test.names);
+
+            // Failures are reported with the name of the case rather than the expression.
+
+            const auto as_expected = "native backend reads " + test.name + " as expected";
+            const auto as_native   = "libzip backend reads " + test.name + " as native does";
+
+            ksr_test::check(native == test.expected, as_expected.c_str(), __FILE__, __LINE__);
+            ksr_test::check(libzip == native, as_native.c_str(), __FILE__, __LINE__);
+        }
+    }
+}
+
+KSR_TEST(open_all_shares_batch_reader_between_threads) {
+
+    const auto dir = scratch_dir{};
+
+    auto srcs = std::vector<path>{};
+    for (auto i = 0; i < 32; ++i) {
+
+        const auto name = "archive_" + std::to_string(i);
+        srcs.push_back(dir / (name + ".zip"));
+        write_archive(srcs.back(), {make_entry(name, zip_method::stored, to_bytes(name))});
+    }
+
+    // An arena of two slots makes every call stage its tails in many batches.
+
+    auto options = batch_reader_options{};
+    options.arena_size = 2 * impl::zip_format::max_tail_size;
+
+    auto reader = batch_reader{options};
+    auto failed = std::atomic<bool>{false};
+
+    const auto open_repeatedly = [&srcs, &reader, &failed] {
+
+        for (auto round = 0; round < 20; ++round) {
+
+            try {
+                const auto archives = zip_archive::open_all(
+                    srcs, ksr::mut_observer<batch_reader>{reader}, zip_backend::native);
+
+                for (auto i = std::size_t{0}; i < archives.size(); ++i) {
+
+                    const auto name = "archive_" + std::to_string(i);
+                    if (archives[i].open_file(name).read_all() != to_bytes(name)) {
+                        failed = true;
+                    }
+                }
+            }
+            catch (const error&) {
+                failed = true;
+            }
+        }
+    };
+
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < 4; ++i) {
+        threads.emplace_back(open_repeatedly);
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    KSR_CHECK(!failed);
+}
+
+KSR_TEST(shared_zip_archive_opens_files_between_threads) {
+
+    const auto dir = scratch_dir{};
+
+    auto entries = std::vector<test_entry>{};
+    for (auto i = 0; i < 24; ++i) {
+
+        const auto method = (i % 2 == 0) ? zip_method::deflated : zip_method::stored;
+        const auto size   = static_cast<std::size_t>(i) * 7919 + ((i % 6 == 0) ? (1 << 20) : 0);
+
+        entries.push_back(make_entry("entry_" + std::to_string(i), method, sample_data(size)));
+    }
+
+    write_archive(dir / "shared.zip", entries);
+
+    const auto archive = shared_zip_archive{dir / "shared.zip"};
+    auto failed = std::atomic<bool>{false};
+
+    // Each thread works through the entries from a different starting point, on its own copy of
+    // the archive, reading some whole and others in small chunks.
+
+    const auto open_repeatedly = [&entries, &archive, &failed] (const std::size_t start) {
+
+        const auto copy = archive;
+
+        for (auto round = std::size_t{0}; round < 10; ++round) {
+            for (auto i = std::size_t{0}; i < entries.size(); ++i) {
+
+                const auto& entry = entries[(start + i) % entries.size()];
+
+                try {
+                    auto file = copy.open_file(entry.name);
+
+                    auto data = bytes{};
+                    if ((round + i) % 2 == 0) {
+                        data = file.read_all();
+                    }
+                    else {
+
+                        auto chunk = std::array<std::byte, 4093>{};
+                        while (const auto size = file.read(chunk.data(), chunk.size())) {
+                            data.insert(data.end(), chunk.begin(), chunk.begin() + size);
+                        }
+                    }
+
+                    file.close();
+
+                    if (data != entry.data
+                        || copy.stat_file(entry.name).size != entry.data.size()) {
+
+                        failed = true;
+                    }
+                }
+                catch (const error&) {
+                    failed = true;
+                }
+            }
+        }
+    };
+
+    auto threads = std::vector<std::thread>{};
+    for (auto i = std::size_t{0}; i < 4; ++i) {
+        threads.emplace_back(open_repeatedly, i * 5);
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    KSR_CHECK(!failed);
+}
+
+KSR_TEST(zip_stream_reader_agrees_with_backends) {
+
+    const auto dir = scratch_dir{};
+
+    for (const auto& test : make_cases(dir)) {
+
+        // An archive truncated before its end of central directory record cannot be opened,
+        // while a stream reader stops at the central directory, so may still read every entry.
+
+        if (test.expected.open_error) {
+            continue;
+        }
+
+        const auto native    = read_archive(test.src, zip_backend::native, false, test.names);
+        const auto as_native = "zip_stream_reader reads " + test.name + " as native does";
+
+        ksr_test::check(stream_archive(test.src) == expected_stream(test, native),
+            as_native.c_str(), __FILE__, __LINE__);
+    }
+}
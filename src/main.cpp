@@ -1,14 +1,125 @@
+#include "spool_daemon.hpp"
+
 #include "libanki/anki.hpp"
+#include "libanki/probe.hpp"
 
+#include <charconv>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace {
+
+    // Parses `src` as a decimal count, all of it. Throws `std::invalid_argument` naming `option`
+    // if it is not one (including if it is negative or out of range).
+
+    auto parse_count(const std::string_view option, const std::string_view src) -> unsigned {
+
+        auto result = 0u;
+        const auto [end, ec] = std::from_chars(src.data(), src.data() + src.size(), result);
+
+        if (src.empty() || ec != std::errc{} || end != src.data() + src.size()) {
+            throw std::invalid_argument{
+                std::string{option} + " expects a count, not \"" + std::string{src} + '"'};
+        }
+
+        return result;
+    }
+
+    // Parses `whakamori --watch <spool> <done> <failed> [--workers <count>]`, from the arguments
+    // following `--watch`. Throws `std::invalid_argument` if they are malformed.
+
+    auto parse_daemon_options(const int argc, char** const argv) -> whakamori::daemon_options {
+
+        if (argc != 3 && argc != 5) {
+            throw std::invalid_argument{
+                "usage: whakamori --watch <spool> <done> <failed> [--workers <count>]"};
+        }
+
+        auto options = whakamori::daemon_options{};
+        options.spool  = argv[0];
+        options.done   = argv[1];
+        options.failed = argv[2];
+
+        if (argc == 5) {
+
+            if (std::string_view{argv[3]} != "--workers") {
+                throw std::invalid_argument{std::string{"unknown option "} + argv[3]};
+            }
+
+            options.workers = parse_count(argv[3], argv[4]);
+        }
+
+        return options;
+    }
+
+    // Prints a line summarising each of `srcs` (see `anki::probe()`), returning whether every one
+    // of them looks importable.
+
+    auto print_probes(const int count, char** const srcs) -> bool {
+
+        if (count == 0) {
+            throw std::invalid_argument{"usage: whakamori --probe <package>..."};
+        }
+
+        auto all_importable = true;
+
+        for (auto i = 0; i < count; ++i) {
+
+            const auto result = anki::probe(srcs[i]);
+            std::cout << srcs[i] << '\t';
+
+            if (result.error) {
+                std::cout << "error=" << anki::error{*result.error}.what() << '\n';
+                all_importable = false;
+                continue;
+            }
+
+            std::cout << "version=";
+            if (result.version) {
+                std::cout << *result.version;
+            }
+            else {
+                std::cout << "none";
+            }
+
+            std::cout
+                << " entries="       << result.entry_count
+                << " compressed="    << result.compressed_size
+                << " size="          << result.size
+                << " stored="        << result.stored_count
+                << " deflated="      << result.deflated_count
+                << " other_method="  << result.other_method_count
+                << " encrypted="     << result.encrypted_count
+                << " media="         << (result.has_media_manifest ? "yes" : "no")
+                << " duplicates="    << result.duplicate_count
+                << " out_of_bounds=" << result.out_of_bounds_count
+                << " unsafe_names="  << result.unsafe_name_count
+                << " importable="    << (result.importable() ? "yes" : "no") << '\n';
+
+            all_importable &= result.importable();
+        }
+
+        return all_importable;
+    }
+}
 
-auto main() -> int {
+auto main(int argc, char** argv) -> int {
 
     try {
 
-        anki::import("decks.apkg");
+        if (argc > 1 && std::string_view{argv[1]} == "--watch") {
+            whakamori::run_daemon(parse_daemon_options(argc - 2, argv + 2));
+        }
+        else if (argc > 1 && std::string_view{argv[1]} == "--probe") {
+            return print_probes(argc - 2, argv + 2) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else {
+            anki::import(argc > 1 ? argv[1] : "decks.apkg");
+        }
     }
     catch (const std::exception& ex) {
 
@@ -0,0 +1,259 @@
+#include "spool_daemon.hpp"
+
+#include "spool_queue.hpp"
+
+#include "libanki/collection.hpp"
+#include "libanki/collection_snapshot.hpp"
+#include "libanki/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+namespace whakamori {
+
+    namespace {
+
+        // Closes a file descriptor when destroyed.
+
+        class unique_fd {
+        public:
+
+            explicit unique_fd(int fd)
+              : _fd{fd} {
+
+                if (_fd < 0) {
+                    throw anki::error{anki::error_code::system_error};
+                }
+            }
+
+            ~unique_fd() { ::close(_fd); }
+
+            unique_fd(const unique_fd&) = delete;
+            auto operator=(const unique_fd&) -> unique_fd& = delete;
+
+            auto get() const noexcept -> int { return _fd; }
+
+        private:
+
+            int _fd;
+        };
+
+        // Serialises lines of log output from several workers.
+
+        std::mutex log_mutex;
+
+        void log_imported(const std::string& name) {
+
+            const auto lock = std::lock_guard{log_mutex};
+            std::cout << "imported " << name << std::endl;
+        }
+
+        void log_failed(const std::string& name, const std::string_view reason) {
+
+            const auto lock = std::lock_guard{log_mutex};
+            std::cerr << "failed " << name << ": " << reason << std::endl;
+        }
+
+        // Imports the package `name` from the spool and moves it to `done` or `failed`. Failures
+        // to move a package are logged but otherwise ignored, as the daemon cannot do better than
+        // leave the package where it is.
+
+        void process(const daemon_options& options, const std::string& name) {
+
+            const auto src  = options.spool / name;
+            const auto stem = anki::path{name}.stem().string();
+
+            auto ec = std::error_code{};
+
+            try {
+
+                const auto collection = anki::collection{src, options.import};
+                anki::collection_snapshot::save(collection, options.done / (stem + ".snap"));
+
+                std::filesystem::rename(src, options.done / name, ec);
+                if (ec) {
+                    log_failed(name, ec.message());
+                    return;
+                }
+
+                log_imported(name);
+            }
+            catch (const std::exception& ex) {
+
+                log_failed(name, ex.what());
+
+                auto error_file = std::ofstream{options.failed / (stem + ".error")};
+                error_file << ex.what() << '\n';
+
+                std::filesystem::rename(src, options.failed / name, ec);
+                if (ec) {
+                    log_failed(name, ec.message());
+                }
+            }
+        }
+
+        void run_worker(const daemon_options& options, work_queue& queue) {
+
+            auto worker_options = options;
+            worker_options.import.reuse_buffers = true;
+
+            while (const auto name = queue.pop()) {
+                process(worker_options, *name);
+                queue.release(*name);
+            }
+        }
+
+        // Blocks SIGINT and SIGTERM on the calling thread (and so on the threads it starts) and
+        // returns a descriptor from which they can be read instead.
+
+        auto open_signal_fd() -> unique_fd {
+
+            auto signals = sigset_t{};
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGINT);
+            sigaddset(&signals, SIGTERM);
+
+            if (pthread_sigmask(SIG_BLOCK, &signals, nullptr) != 0) {
+                throw anki::error{anki::error_code::system_error};
+            }
+
+            return unique_fd{signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC)};
+        }
+
+        // Reads every pending inotify event from `fd`, passing those for packages in the spool to
+        // `tracker`. If the kernel's event queue has overflowed, the spool is rescanned.
+
+        void read_events(const int fd, settle_tracker& tracker, const work_queue& queue) {
+
+            alignas(inotify_event) char buffer[16 * 1024];
+
+            for (;;) {
+
+                const auto count = ::read(fd, buffer, sizeof buffer);
+                if (count < 0 && errno == EAGAIN) {
+                    return;
+                }
+
+                if (count <= 0) {
+                    throw anki::error{anki::error_code::system_error};
+                }
+
+                for (auto pos = ssize_t{0}; pos < count; ) {
+
+                    const auto& event = *reinterpret_cast<const inotify_event*>(buffer + pos);
+                    pos += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+
+                    if (event.mask & IN_Q_OVERFLOW) {
+                        tracker.scan(queue);
+                    }
+
+                    if (event.len == 0) {
+                        continue;
+                    }
+
+                    const auto name = std::string{event.name};
+                    if (!is_package_name(name) || queue.claimed(name)) {
+                        continue;
+                    }
+
+                    if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        tracker.forget(name);
+                    }
+                    else {
+                        tracker.touch(name);
+                    }
+                }
+            }
+        }
+    }
+
+    void run_daemon(const daemon_options& options) {
+
+        std::filesystem::create_directories(options.done);
+        std::filesystem::create_directories(options.failed);
+
+        const auto signal_fd = open_signal_fd();
+        const auto inotify_fd = unique_fd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)};
+
+        static constexpr auto watch_mask = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO
+                                         | IN_MOVED_FROM | IN_DELETE;
+
+        if (inotify_add_watch(inotify_fd.get(), options.spool.c_str(), watch_mask) < 0) {
+            throw anki::error{anki::error_code::system_error};
+        }
+
+        const auto worker_count = options.workers != 0
+            ? options.workers : std::max(std::thread::hardware_concurrency(), 1u);
+
+        auto queue   = work_queue{2 * std::size_t{worker_count}};
+        auto tracker = settle_tracker{options};
+
+        // Packages already in the spool are picked up once the watch is in place, so that none
+        // written in between is missed.
+
+        tracker.scan(queue);
+
+        auto workers = std::vector<std::thread>{};
+        workers.reserve(worker_count);
+
+        // Starting a worker can fail too, in which case those already started must be joined.
+
+        try {
+
+            for (auto i = 0u; i < worker_count; ++i) {
+                workers.emplace_back([&options, &queue] { run_worker(options, queue); });
+            }
+
+            auto fds = std::array<pollfd, 2>{{
+                {signal_fd.get(), POLLIN, 0},
+                {inotify_fd.get(), POLLIN, 0},
+            }};
+
+            for (;;) {
+
+                if (::poll(fds.data(), fds.size(), tracker.timeout()) < 0 && errno != EINTR) {
+                    throw anki::error{anki::error_code::system_error};
+                }
+
+                if (fds[0].revents & POLLIN) {
+                    break;
+                }
+
+                if (fds[1].revents & POLLIN) {
+                    read_events(inotify_fd.get(), tracker, queue);
+                }
+
+                tracker.queue_settled(queue);
+            }
+        }
+        catch (...) {
+
+            queue.close();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            throw;
+        }
+
+        queue.close();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef WHAKAMORI_SPOOL_DAEMON_HPP
+#define WHAKAMORI_SPOOL_DAEMON_HPP
+
+#include "libanki/filesystem.hpp"
+#include "libanki/import_options.hpp"
+
+#include <chrono>
+
+namespace whakamori {
+
+    // Directories and tuning parameters of `run_daemon()`.
+    //
+    // * `spool` is watched for new packages; `done` and `failed` receive them once imported, and
+    //   must be on the same filesystem as `spool`.
+    // * `workers` is the number of packages imported at once, or 0 for one per hardware thread.
+    // * `settle_time` is how long a package must go unmodified before it is taken to be complete.
+
+    struct daemon_options {
+        anki::path                spool;
+        anki::path                done;
+        anki::path                failed;
+        unsigned                  workers     = 0;
+        std::chrono::milliseconds settle_time = std::chrono::milliseconds{500};
+        anki::import_options      import;
+    };
+
+    // Watches `options.spool` for `.apkg` packages (including any already there) and imports each
+    // once it has settled, until the process receives SIGINT or SIGTERM. A package that imports
+    // successfully is moved into `options.done`, beside a snapshot of its collection (see
+    // `anki::collection_snapshot`) named for it with the extension `.snap`. A package that fails
+    // is moved into `options.failed`, beside a file with the extension `.error` holding the
+    // reason. Files whose names begin with `.` or end with `.part` or `.tmp` are ignored, so that
+    // a package may instead be written under a temporary name and renamed once complete.
+    //
+    // Packages are imported by a fixed pool of worker threads, each keeping its extraction
+    // buffers from one package to the next; packages found while every worker is busy are queued.
+    // On a signal, packages already being imported are finished and queued packages are left in
+    // the spool for the next run. Throws `anki::error` with `error_code::system_error` if the
+    // directories cannot be watched.
+
+    void run_daemon(const daemon_options& options);
+}
+
+#endif
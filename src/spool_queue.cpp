@@ -0,0 +1,144 @@
+#include "spool_queue.hpp"
+
+#include <algorithm>
+#include <string_view>
+#include <system_error>
+
+namespace whakamori {
+
+    auto is_package_name(const std::string& name) -> bool {
+
+        const auto ends_with = [&name] (const std::string_view suffix) {
+            return name.size() >= suffix.size()
+                && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+
+        return !name.empty() && name.front() != '.' && !ends_with(".part")
+            && !ends_with(".tmp") && ends_with(".apkg");
+    }
+
+    auto stat_file(const anki::path& path) -> std::optional<file_state> {
+
+        auto ec = std::error_code{};
+        if (!std::filesystem::is_regular_file(path, ec)) {
+            return std::nullopt;
+        }
+
+        const auto size     = std::filesystem::file_size(path, ec);
+        const auto modified = std::filesystem::last_write_time(path, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+
+        return file_state{size, modified};
+    }
+
+    auto work_queue::try_push(const std::string& name) -> bool {
+
+        const auto lock = std::lock_guard{_mutex};
+        if (_queue.size() >= _capacity) {
+            return false;
+        }
+
+        _queue.push_back(name);
+        _claimed.insert(name);
+        _ready.notify_one();
+
+        return true;
+    }
+
+    auto work_queue::pop() -> std::optional<std::string> {
+
+        auto lock = std::unique_lock{_mutex};
+        _ready.wait(lock, [this] { return _closed || !_queue.empty(); });
+
+        if (_closed) {
+            return std::nullopt;
+        }
+
+        auto name = std::move(_queue.front());
+        _queue.pop_front();
+
+        return name;
+    }
+
+    void work_queue::release(const std::string& name) {
+
+        const auto lock = std::lock_guard{_mutex};
+        _claimed.erase(name);
+    }
+
+    auto work_queue::claimed(const std::string& name) const -> bool {
+
+        const auto lock = std::lock_guard{_mutex};
+        return _claimed.count(name) != 0;
+    }
+
+    void work_queue::close() {
+
+        const auto lock = std::lock_guard{_mutex};
+        _closed = true;
+        _ready.notify_all();
+    }
+
+    void settle_tracker::touch(const std::string& name) {
+
+        auto& candidate = _candidates[name];
+        candidate.deadline = clock::now() + _options.settle_time;
+        candidate.state    = stat_file(_options.spool / name);
+    }
+
+    void settle_tracker::scan(const work_queue& queue) {
+
+        for (const auto& entry : std::filesystem::directory_iterator{_options.spool}) {
+
+            const auto name = entry.path().filename().string();
+            if (is_package_name(name) && !queue.claimed(name)) {
+                touch(name);
+            }
+        }
+    }
+
+    auto settle_tracker::timeout() const -> int {
+
+        if (_candidates.empty()) {
+            return -1;
+        }
+
+        auto next = clock::time_point::max();
+        for (const auto& [name, candidate] : _candidates) {
+            next = std::min(next, candidate.deadline);
+        }
+
+        const auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - clock::now());
+        return static_cast<int>(std::max(wait.count(), std::int64_t{0}));
+    }
+
+    void settle_tracker::queue_settled(work_queue& queue) {
+
+        const auto now = clock::now();
+        for (auto it = _candidates.begin(); it != _candidates.end(); ) {
+
+            auto& [name, candidate] = *it;
+            if (candidate.deadline > now) {
+                ++it;
+                continue;
+            }
+
+            const auto state = stat_file(_options.spool / name);
+            if (!state) {
+                it = _candidates.erase(it);
+                continue;
+            }
+
+            if (state == candidate.state && queue.try_push(name)) {
+                it = _candidates.erase(it);
+                continue;
+            }
+
+            candidate.deadline = now + _options.settle_time;
+            candidate.state    = state;
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef WHAKAMORI_SPOOL_QUEUE_HPP
+#define WHAKAMORI_SPOOL_QUEUE_HPP
+
+#include "spool_daemon.hpp"
+
+#include "libanki/filesystem.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+namespace whakamori {
+
+    // Whether a file in the spool is to be imported (rather than being a temporary file, or
+    // something other than a package).
+
+    auto is_package_name(const std::string& name) -> bool;
+
+    // Size and modification time of a file, compared to tell whether it is still being written.
+
+    struct file_state {
+        std::uintmax_t                  size;
+        std::filesystem::file_time_type modified;
+
+        auto operator==(const file_state& rhs) const noexcept -> bool {
+            return size == rhs.size && modified == rhs.modified;
+        }
+    };
+
+    // Returns the state of the file at `path`, or `std::nullopt` if it does not exist or is not a
+    // regular file.
+
+    auto stat_file(const anki::path& path) -> std::optional<file_state>;
+
+    // Bounded queue of packages awaiting a worker, shared with the set of packages queued or
+    // being imported, so that events for a package being moved out of the spool are ignored.
+
+    class work_queue {
+    public:
+
+        explicit work_queue(std::size_t capacity)
+          : _capacity{capacity} {
+        }
+
+        // Queues `name` unless the queue is full, returning whether it was queued. `name` is
+        // claimed until released.
+
+        auto try_push(const std::string& name) -> bool;
+
+        // Blocks until a package is queued, returning it, or until the queue is closed.
+
+        auto pop() -> std::optional<std::string>;
+
+        void release(const std::string& name);
+
+        auto claimed(const std::string& name) const -> bool;
+
+        // Wakes every worker to exit, abandoning any packages still queued.
+
+        void close();
+
+    private:
+
+        std::size_t _capacity;
+
+        mutable std::mutex      _mutex;
+        std::condition_variable _ready;
+        std::deque<std::string> _queue;
+        std::set<std::string>   _claimed;
+        bool                    _closed = false;
+    };
+
+    // Packages seen in the spool but not yet queued: each is queued once it has gone
+    // `settle_time` without an event and without its size or modification time changing. Only
+    // `options.spool` and `options.settle_time` are used, and `options` must outlive the tracker.
+
+    class settle_tracker {
+    public:
+
+        using clock = std::chrono::steady_clock;
+
+        explicit settle_tracker(const daemon_options& options)
+          : _options{options} {
+        }
+
+        // Notes an event for `name`, putting off queueing it for another `settle_time`.
+
+        void touch(const std::string& name);
+
+        void forget(const std::string& name) { _candidates.erase(name); }
+
+        // Touches every package in the spool not already claimed by `queue`, for when events
+        // may have been missed.
+
+        void scan(const work_queue& queue);
+
+        // Milliseconds until the next deadline, for `poll()`, or -1 if there is none.
+
+        auto timeout() const -> int;
+
+        // Queues every package whose deadline has passed and which is unchanged since it was
+        // last seen, and rechecks later those that have changed or that `queue` has no room
+        // for. Packages that have disappeared are forgotten.
+
+        void queue_settled(work_queue& queue);
+
+    private:
+
+        struct candidate {
+            clock::time_point         deadline;
+            std::optional<file_state> state;
+        };
+
+        const daemon_options&            _options;
+        std::map<std::string, candidate> _candidates;
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "spool_daemon.hpp"
+
+#include "libanki_test/test_files.hpp"
+#include "libanki_test/test_package.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+#include <signal.h>
+
+using namespace whakamori;
+using namespace libanki_test;
+
+namespace {
+
+    using std::chrono::milliseconds;
+
+    // Waits up to ten seconds for `dst` to exist, returning whether it does.
+
+    auto wait_for(const anki::path& dst) -> bool {
+
+        for (auto i = 0; i < 1000; ++i) {
+
+            if (std::filesystem::exists(dst)) {
+                return true;
+            }
+
+            std::this_thread::sleep_for(milliseconds{10});
+        }
+
+        return std::filesystem::exists(dst);
+    }
+}
+
+KSR_TEST(run_daemon_imports_spool_until_signalled) {
+
+    const auto dir = scratch_dir{};
+    std::filesystem::create_directory(dir / "spool");
+
+    auto options = daemon_options{};
+    options.spool          = dir / "spool";
+    options.done           = dir / "done";
+    options.failed         = dir / "failed";
+    options.workers        = 2;
+    options.settle_time    = milliseconds{20};
+    options.import.backend = anki::zip_backend::native;
+
+    // Packages already in the spool before the daemon starts, and files it must leave alone.
+
+    write_package(options.spool / "present.apkg", {test_note{1, "guid", 1, "", "a\x1f" "b"}});
+    write_file(options.spool / "broken.apkg", to_bytes("not a package"));
+    write_file(options.spool / "partial.apkg.part", to_bytes("not yet"));
+    write_file(options.spool / ".hidden.apkg", to_bytes("hidden"));
+
+    auto failure = std::exception_ptr{};
+    auto daemon  = std::thread{[&options, &failure] {
+        try {
+            run_daemon(options);
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+    }};
+
+    // A signal sent before the daemon blocks it would end the whole test, so it is only sent
+    // once the daemon has shown it is running by importing a package.
+
+    const auto present = wait_for(options.done / "present.apkg");
+    const auto broken  = wait_for(options.failed / "broken.apkg");
+
+    // A package written once the daemon is watching, under a temporary name and then renamed
+    // into place.
+
+    write_package(options.spool / "later.apkg.tmp", {test_note{2, "later", 1, "", "a\x1f" "b"}});
+    std::filesystem::rename(options.spool / "later.apkg.tmp", options.spool / "later.apkg");
+
+    const auto later = wait_for(options.done / "later.apkg");
+
+    // The signal is sent to the daemon's thread alone, which blocks it, so that no other thread
+    // of the test can take it instead.
+
+    pthread_kill(daemon.native_handle(), SIGTERM);
+    daemon.join();
+
+    KSR_CHECK(!failure);
+    KSR_CHECK(present);
+    KSR_CHECK(broken);
+    KSR_CHECK(later);
+
+    KSR_CHECK(std::filesystem::exists(options.done / "present.snap"));
+    KSR_CHECK(std::filesystem::exists(options.done / "later.snap"));
+    KSR_CHECK(std::filesystem::exists(options.failed / "broken.error"));
+    KSR_CHECK(!std::filesystem::exists(options.spool / "present.apkg"));
+    KSR_CHECK(!std::filesystem::exists(options.spool / "later.apkg"));
+
+    KSR_CHECK(std::filesystem::exists(options.spool / "partial.apkg.part"));
+    KSR_CHECK(std::filesystem::exists(options.spool / ".hidden.apkg"));
+}
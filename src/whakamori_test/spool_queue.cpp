@@ -0,0 +1,231 @@
+#include "spool_queue.hpp"
+
+#include "libanki_test/test_files.hpp"
+
+#include "ksr_test/test.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace whakamori;
+using namespace libanki_test;
+
+namespace {
+
+    using std::chrono::milliseconds;
+
+    auto spool_options(const scratch_dir& dir, const milliseconds settle_time) -> daemon_options {
+
+        std::filesystem::create_directory(dir / "spool");
+
+        auto result = daemon_options{};
+        result.spool       = dir / "spool";
+        result.settle_time = settle_time;
+
+        return result;
+    }
+
+    void append(const anki::path& dst, const std::string& text) {
+
+        auto stream = std::ofstream{dst, std::ios::binary | std::ios::app};
+        stream << text;
+    }
+}
+
+KSR_TEST(spool_ignores_temporary_names) {
+
+    KSR_CHECK(is_package_name("deck.apkg"));
+    KSR_CHECK(is_package_name("deck.tmp.apkg"));
+    KSR_CHECK(!is_package_name(""));
+    KSR_CHECK(!is_package_name(".apkg"));
+    KSR_CHECK(!is_package_name(".deck.apkg"));
+    KSR_CHECK(!is_package_name("deck.apkg.part"));
+    KSR_CHECK(!is_package_name("deck.apkg.tmp"));
+    KSR_CHECK(!is_package_name("deck.colpkg"));
+    KSR_CHECK(!is_package_name("deck"));
+
+    const auto dir     = scratch_dir{};
+    const auto options = spool_options(dir, milliseconds{0});
+
+    for (const auto name : {".deck.apkg", "deck.apkg.part", "deck.apkg.tmp", "notes.txt"}) {
+        append(options.spool / name, "data");
+    }
+
+    auto queue   = work_queue{8};
+    auto tracker = settle_tracker{options};
+
+    tracker.scan(queue);
+    KSR_CHECK(tracker.timeout() == -1);
+
+    // A package among them is queued, but a directory named as one is not.
+
+    append(options.spool / "deck.apkg", "data");
+    std::filesystem::create_directory(options.spool / "directory.apkg");
+
+    tracker.scan(queue);
+    tracker.queue_settled(queue);
+
+    KSR_CHECK(tracker.timeout() == -1);
+    KSR_CHECK(queue.claimed("deck.apkg"));
+    KSR_CHECK(!queue.claimed("directory.apkg"));
+    KSR_CHECK(queue.pop() == "deck.apkg");
+}
+
+KSR_TEST(spool_waits_for_packages_to_settle) {
+
+    const auto settle_time = milliseconds{200};
+
+    const auto dir     = scratch_dir{};
+    const auto options = spool_options(dir, settle_time);
+    const auto package = options.spool / "deck.apkg";
+
+    auto queue   = work_queue{8};
+    auto tracker = settle_tracker{options};
+
+    append(package, "first");
+    tracker.touch("deck.apkg");
+
+    KSR_CHECK(tracker.timeout() > 0);
+    KSR_CHECK(tracker.timeout() <= settle_time.count());
+
+    tracker.queue_settled(queue);
+    KSR_CHECK(!queue.claimed("deck.apkg"));
+
+    // An event part way through puts off queueing for another `settle_time`.
+
+    std::this_thread::sleep_for(settle_time / 2);
+    append(package, "second");
+    tracker.touch("deck.apkg");
+
+    std::this_thread::sleep_for(settle_time * 3 / 4);
+    tracker.queue_settled(queue);
+    KSR_CHECK(!queue.claimed("deck.apkg"));
+
+    // A change without an event (one missed, say) is noticed when the deadline passes, and puts
+    // off queueing likewise.
+
+    append(package, "third");
+
+    std::this_thread::sleep_for(milliseconds{tracker.timeout()});
+    tracker.queue_settled(queue);
+
+    KSR_CHECK(!queue.claimed("deck.apkg"));
+    KSR_CHECK(tracker.timeout() > settle_time.count() / 2);
+
+    std::this_thread::sleep_for(milliseconds{tracker.timeout()});
+    tracker.queue_settled(queue);
+
+    KSR_CHECK(queue.claimed("deck.apkg"));
+    KSR_CHECK(tracker.timeout() == -1);
+
+    // A package that disappears before settling is forgotten.
+
+    append(options.spool / "gone.apkg", "data");
+    tracker.touch("gone.apkg");
+    std::filesystem::remove(options.spool / "gone.apkg");
+
+    std::this_thread::sleep_for(milliseconds{tracker.timeout()});
+    tracker.queue_settled(queue);
+
+    KSR_CHECK(!queue.claimed("gone.apkg"));
+    KSR_CHECK(tracker.timeout() == -1);
+}
+
+KSR_TEST(spool_rechecks_packages_while_queue_is_full) {
+
+    const auto settle_time = milliseconds{20};
+
+    const auto dir     = scratch_dir{};
+    const auto options = spool_options(dir, settle_time);
+
+    append(options.spool / "a.apkg", "a");
+    append(options.spool / "b.apkg", "b");
+
+    auto queue   = work_queue{1};
+    auto tracker = settle_tracker{options};
+
+    tracker.scan(queue);
+
+    std::this_thread::sleep_for(settle_time);
+    tracker.queue_settled(queue);
+
+    // Only one fits; the other is kept, with a fresh deadline.
+
+    KSR_CHECK(queue.claimed("a.apkg") != queue.claimed("b.apkg"));
+    KSR_CHECK(tracker.timeout() > 0);
+
+    const auto first = queue.pop();
+    KSR_CHECK(first.has_value());
+
+    std::this_thread::sleep_for(milliseconds{tracker.timeout()});
+    tracker.queue_settled(queue);
+
+    const auto second = queue.pop();
+    KSR_CHECK(second.has_value() && second != first);
+    KSR_CHECK(tracker.timeout() == -1);
+}
+
+KSR_TEST(spool_does_not_queue_claimed_packages_twice) {
+
+    const auto dir     = scratch_dir{};
+    const auto options = spool_options(dir, milliseconds{0});
+
+    append(options.spool / "deck.apkg", "data");
+
+    auto queue   = work_queue{8};
+    auto tracker = settle_tracker{options};
+
+    tracker.scan(queue);
+    tracker.queue_settled(queue);
+    KSR_CHECK(queue.claimed("deck.apkg"));
+
+    // Queued, and then being imported, the package is passed over by rescans.
+
+    tracker.scan(queue);
+    KSR_CHECK(tracker.timeout() == -1);
+
+    KSR_CHECK(queue.pop() == "deck.apkg");
+    KSR_CHECK(queue.claimed("deck.apkg"));
+
+    tracker.scan(queue);
+    KSR_CHECK(tracker.timeout() == -1);
+
+    // Once released (as when an import fails to move the package away), it is seen again.
+
+    queue.release("deck.apkg");
+    KSR_CHECK(!queue.claimed("deck.apkg"));
+
+    tracker.scan(queue);
+    KSR_CHECK(tracker.timeout() != -1);
+}
+
+KSR_TEST(work_queue_close_wakes_waiting_workers) {
+
+    auto queue   = work_queue{4};
+    auto workers = std::vector<std::thread>{};
+    auto popped  = std::vector<int>(3);
+
+    for (auto i = std::size_t{0}; i < popped.size(); ++i) {
+        workers.emplace_back([&queue, &popped, i] {
+            while (queue.pop()) {
+                ++popped[i];
+            }
+        });
+    }
+
+    KSR_CHECK(queue.try_push("a.apkg"));
+    KSR_CHECK(queue.try_push("b.apkg"));
+
+    // Workers exit once the queue is closed, whether or not they took a package first.
+
+    queue.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    KSR_CHECK(popped[0] + popped[1] + popped[2] <= 2);
+}